@@ -71,7 +71,7 @@ static BaseType_t prvPerformCopy( const char *pcSourceFile,
 /*
  * Implements the DIR command.
  */
-static BaseType_t prvDIRCommand( char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString );
+static BaseType_t prvDIRCommand( CLI_Session_t *pxSession, char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString );
 
 /*
  * Implements the CD command.
@@ -86,7 +86,7 @@ static BaseType_t prvDELCommand( char *pcWriteBuffer, size_t xWriteBufferLen, co
 /*
  * Implements the TYPE command.
  */
-static BaseType_t prvTYPECommand( char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString );
+static BaseType_t prvTYPECommand( CLI_Session_t *pxSession, char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString );
 
 /*
  * Implements the COPY command.
@@ -99,8 +99,9 @@ static const CLI_Command_Definition_t xDIR =
 {
 	"dir", /* The command string to type. */
 	"\r\ndir:\r\n Lists the files in the current directory\r\n",
-	prvDIRCommand, /* The function to run. */
-	0 /* No parameters are expected. */
+	NULL, /* The session aware function below is run instead. */
+	0, /* No parameters are expected. */
+	prvDIRCommand /* The function to run. */
 };
 
 /* Structure that defines the CD command line command, which changes the
@@ -119,8 +120,9 @@ static const CLI_Command_Definition_t xTYPE =
 {
 	"type", /* The command string to type. */
 	"\r\ntype <filename>:\r\n Prints file contents to the terminal\r\n",
-	prvTYPECommand, /* The function to run. */
-	1 /* One parameter is expected. */
+	NULL, /* The session aware function below is run instead. */
+	1, /* One parameter is expected. */
+	prvTYPECommand /* The function to run. */
 };
 
 /* Structure that defines the DEL command line command, which deletes a file. */
@@ -146,20 +148,32 @@ static const CLI_Command_Definition_t xCOPY =
 
 void vRegisterFileSystemCLICommands( void )
 {
-	/* Register all the command line commands defined immediately above. */
-	FreeRTOS_CLIRegisterCommand( &xDIR );
-	FreeRTOS_CLIRegisterCommand( &xCD );
-	FreeRTOS_CLIRegisterCommand( &xTYPE );
-	FreeRTOS_CLIRegisterCommand( &xDEL );
-	FreeRTOS_CLIRegisterCommand( &xCOPY );
+BaseType_t xStatus;
+
+	/* Register all the command line commands defined immediately above.  This
+	fails if configCOMMAND_INT_MAX_COMMANDS in FreeRTOSConfig.h is too low for
+	all the commands the application registers. */
+	xStatus = FreeRTOS_CLIRegisterCommand( &xDIR );
+	configASSERT( xStatus == pdPASS );
+	xStatus = FreeRTOS_CLIRegisterCommand( &xCD );
+	configASSERT( xStatus == pdPASS );
+	xStatus = FreeRTOS_CLIRegisterCommand( &xTYPE );
+	configASSERT( xStatus == pdPASS );
+	xStatus = FreeRTOS_CLIRegisterCommand( &xDEL );
+	configASSERT( xStatus == pdPASS );
+	xStatus = FreeRTOS_CLIRegisterCommand( &xCOPY );
+	configASSERT( xStatus == pdPASS );
+
+	/* Prevent compiler warnings when configASSERT() is not defined. */
+	( void ) xStatus;
 }
 /*-----------------------------------------------------------*/
 
-static BaseType_t prvTYPECommand( char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString )
+static BaseType_t prvTYPECommand( CLI_Session_t *pxSession, char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString )
 {
 const char *pcParameter;
 BaseType_t xParameterStringLength, xReturn = pdTRUE;
-static F_FILE *pxFile = NULL;
+F_FILE *pxFile = ( F_FILE * ) pxSession->pvCommandState;
 int iChar;
 size_t xByte;
 size_t xColumns = 50U;
@@ -225,6 +239,9 @@ size_t xColumns = 50U;
 
 	strcat( pcWriteBuffer, cliNEW_LINE );
 
+	/* Keep the open file in the session until the next call. */
+	pxSession->pvCommandState = pxFile;
+
 	return xReturn;
 }
 /*-----------------------------------------------------------*/
@@ -267,10 +284,10 @@ size_t xStringLength;
 }
 /*-----------------------------------------------------------*/
 
-static BaseType_t prvDIRCommand( char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString )
+static BaseType_t prvDIRCommand( CLI_Session_t *pxSession, char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString )
 {
-static F_FIND *pxFindStruct = NULL;
-unsigned char ucReturned;
+F_FIND *pxFindStruct = ( F_FIND * ) pxSession->pvCommandState;
+unsigned char ucReturned = F_NO_ERROR;
 BaseType_t xReturn = pdFALSE;
 
 	/* This assumes pcWriteBuffer is long enough. */
@@ -290,12 +307,7 @@ BaseType_t xReturn = pdFALSE;
 		{
 			ucReturned = f_findfirst( "*.*", pxFindStruct );
 
-			if( ucReturned == F_NO_ERROR )
-			{
-				prvCreateFileInfoString( pcWriteBuffer, pxFindStruct );
-				xReturn = pdPASS;
-			}
-			else
+			if( ucReturned != F_NO_ERROR )
 			{
 				snprintf( pcWriteBuffer, xWriteBufferLen, "Error: f_findfirst() failed." );
 			}
@@ -311,24 +323,58 @@ BaseType_t xReturn = pdFALSE;
 		the directory. */
 		ucReturned = f_findnext( pxFindStruct );
 
-		if( ucReturned == F_NO_ERROR )
+		if( ucReturned != F_NO_ERROR )
 		{
-			prvCreateFileInfoString( pcWriteBuffer, pxFindStruct );
-			xReturn = pdPASS;
+			/* There are no more files.  No string to return. */
+			pcWriteBuffer[ 0 ] = 0x00;
 		}
-		else
+	}
+
+	if( ( pxFindStruct != NULL ) && ( ucReturned == F_NO_ERROR ) )
+	{
+		prvCreateFileInfoString( pcWriteBuffer, pxFindStruct );
+		xReturn = pdPASS;
+
+		if( pxSession->pxWriter != NULL )
 		{
-			/* There are no more files.  Free the find structure. */
-			vPortFree( pxFindStruct );
-			pxFindStruct = NULL;
+			/* The session passes its output straight to the transport, so
+			rather than returning one file per call, write each line as it is
+			created and list the whole directory in this call. */
+			do
+			{
+				strcat( pcWriteBuffer, cliNEW_LINE );
+
+				if( FreeRTOS_CLIWrite( pxSession, pcWriteBuffer, strlen( pcWriteBuffer ) ) != pdPASS )
+				{
+					/* The rest of the listing cannot be output. */
+					break;
+				}
+
+				ucReturned = f_findnext( pxFindStruct );
+
+				if( ucReturned == F_NO_ERROR )
+				{
+					prvCreateFileInfoString( pcWriteBuffer, pxFindStruct );
+				}
+			} while( ucReturned == F_NO_ERROR );
 
-			/* No string to return. */
 			pcWriteBuffer[ 0 ] = 0x00;
+			xReturn = pdFALSE;
 		}
 	}
 
+	if( ( xReturn == pdFALSE ) && ( pxFindStruct != NULL ) )
+	{
+		/* The listing is complete, or failed.  Free the find structure. */
+		vPortFree( pxFindStruct );
+		pxFindStruct = NULL;
+	}
+
 	strcat( pcWriteBuffer, cliNEW_LINE );
 
+	/* Keep the find structure in the session until the next call. */
+	pxSession->pvCommandState = pxFindStruct;
+
 	return xReturn;
 }
 /*-----------------------------------------------------------*/
@@ -46,6 +46,10 @@
 /* FreeRTOS+CLI includes. */
 #include "FreeRTOS_CLI.h"
 
+#ifdef _WINDOWS_
+	#define snprintf _snprintf
+#endif
+
 #ifndef  configINCLUDE_TRACE_RELATED_CLI_COMMANDS
 	#define configINCLUDE_TRACE_RELATED_CLI_COMMANDS 0
 #endif
@@ -54,6 +58,25 @@
 	#define configINCLUDE_QUERY_HEAP_COMMAND 0
 #endif
 
+#ifndef configINCLUDE_TASK_RECORDS_COMMAND
+	#define configINCLUDE_TASK_RECORDS_COMMAND 0
+#endif
+
+/* The maximum number of tasks the task-records command can report on.  The
+command uses two statically allocated arrays of this many entries. */
+#ifndef configTASK_RECORDS_MAX_TASKS
+	#define configTASK_RECORDS_MAX_TASKS 32
+#endif
+
+/* The record types output by the task-records command. */
+#define cliINTERVAL_RECORD		'I'
+#define cliTASK_RECORD			'T'
+
+/* The size, in bytes, of the binary records output by the task-records
+command.  Task records are followed by the task's name. */
+#define cliBINARY_INTERVAL_RECORD_SIZE		11
+#define cliBINARY_TASK_RECORD_SIZE			16
+
 /*
  * The function that registers the commands that are defined within this file.
  */
@@ -62,7 +85,19 @@ void vRegisterSampleCLICommands( void );
 /*
  * Implements the task-stats command.
  */
-static BaseType_t prvTaskStatsCommand( char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString );
+static BaseType_t prvTaskStatsCommand( CLI_Session_t *pxSession, char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString );
+
+/*
+ * Implements the task-records command.
+ */
+#if( configINCLUDE_TASK_RECORDS_COMMAND == 1 )
+	static BaseType_t prvTaskRecordsCommand( CLI_Session_t *pxSession, char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString );
+#endif
+
+/*
+ * Returns the character vTaskList() uses to show the state eState.
+ */
+static char prvTaskStateCharacter( eTaskState eState );
 
 /*
  * Implements the run-time-stats command.
@@ -74,12 +109,12 @@ static BaseType_t prvTaskStatsCommand( char *pcWriteBuffer, size_t xWriteBufferL
 /*
  * Implements the echo-three-parameters command.
  */
-static BaseType_t prvThreeParameterEchoCommand( char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString );
+static BaseType_t prvThreeParameterEchoCommand( CLI_Session_t *pxSession, char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString );
 
 /*
  * Implements the echo-parameters command.
  */
-static BaseType_t prvParameterEchoCommand( char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString );
+static BaseType_t prvParameterEchoCommand( CLI_Session_t *pxSession, char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString );
 
 /*
  * Implements the "query heap" command.
@@ -95,117 +130,124 @@ static BaseType_t prvParameterEchoCommand( char *pcWriteBuffer, size_t xWriteBuf
 	static BaseType_t prvStartStopTraceCommand( char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString );
 #endif
 
-/* Structure that defines the "task-stats" command line command.  This generates
-a table that gives information on each task in the system. */
-static const CLI_Command_Definition_t xTaskStats =
-{
-	"task-stats", /* The command string to type. */
-	"\r\ntask-stats:\r\n Displays a table showing the state of each FreeRTOS task\r\n",
-	prvTaskStatsCommand, /* The function to run. */
-	0 /* No parameters are expected. */
-};
-
-/* Structure that defines the "echo_3_parameters" command line command.  This
-takes exactly three parameters that the command simply echos back one at a
-time. */
-static const CLI_Command_Definition_t xThreeParameterEcho =
+/* The commands defined in this file, registered with a single call to
+FreeRTOS_CLIRegisterCommandTable().  "help" lists them in this order. */
+static const CLI_Command_Definition_t xSampleCommands[] =
 {
-	"echo-3-parameters",
-	"\r\necho-3-parameters <param1> <param2> <param3>:\r\n Expects three parameters, echos each in turn\r\n",
-	prvThreeParameterEchoCommand, /* The function to run. */
-	3 /* Three parameters are expected, which can take any value. */
-};
-
-/* Structure that defines the "echo_parameters" command line command.  This
-takes a variable number of parameters that the command simply echos back one at
-a time. */
-static const CLI_Command_Definition_t xParameterEcho =
-{
-	"echo-parameters",
-	"\r\necho-parameters <...>:\r\n Take variable number of parameters, echos each in turn\r\n",
-	prvParameterEchoCommand, /* The function to run. */
-	-1 /* The user can enter any number of commands. */
-};
-
-#if( configGENERATE_RUN_TIME_STATS == 1 )
-	/* Structure that defines the "run-time-stats" command line command.   This
-	generates a table that shows how much run time each task has */
-	static const CLI_Command_Definition_t xRunTimeStats =
+	/* The "task-stats" command line command.  This generates a table that
+	gives information on each task in the system. */
 	{
-		"run-time-stats", /* The command string to type. */
-		"\r\nrun-time-stats:\r\n Displays a table showing how much processing time each FreeRTOS task has used\r\n",
-		prvRunTimeStatsCommand, /* The function to run. */
-		0 /* No parameters are expected. */
-	};
-#endif /* configGENERATE_RUN_TIME_STATS */
-
-#if( configINCLUDE_QUERY_HEAP_COMMAND == 1 )
-	/* Structure that defines the "query_heap" command line command. */
-	static const CLI_Command_Definition_t xQueryHeap =
+		"task-stats", /* The command string to type. */
+		"\r\ntask-stats:\r\n Displays a table showing the state of each FreeRTOS task\r\n",
+		NULL, /* The session aware function below is run instead. */
+		0, /* No parameters are expected. */
+		prvTaskStatsCommand /* The function to run. */
+	},
+
+	/* The "echo_3_parameters" command line command.  This takes exactly three
+	parameters that the command simply echos back one at a time. */
 	{
-		"query-heap",
-		"\r\nquery-heap:\r\n Displays the free heap space, and minimum ever free heap space.\r\n",
-		prvQueryHeapCommand, /* The function to run. */
-		0 /* The user can enter any number of commands. */
-	};
-#endif /* configQUERY_HEAP_COMMAND */
-
-#if configINCLUDE_TRACE_RELATED_CLI_COMMANDS == 1
-	/* Structure that defines the "trace" command line command.  This takes a single
-	parameter, which can be either "start" or "stop". */
-	static const CLI_Command_Definition_t xStartStopTrace =
+		"echo-3-parameters",
+		"\r\necho-3-parameters <param1> <param2> <param3>:\r\n Expects three parameters, echos each in turn\r\n",
+		NULL, /* The session aware function below is run instead. */
+		3, /* Three parameters are expected, which can take any value. */
+		prvThreeParameterEchoCommand /* The function to run. */
+	},
+
+	/* The "echo_parameters" command line command.  This takes a variable
+	number of parameters that the command simply echos back one at a time. */
 	{
-		"trace",
-		"\r\ntrace [start | stop]:\r\n Starts or stops a trace recording for viewing in FreeRTOS+Trace\r\n",
-		prvStartStopTraceCommand, /* The function to run. */
-		1 /* One parameter is expected.  Valid values are "start" and "stop". */
-	};
-#endif /* configINCLUDE_TRACE_RELATED_CLI_COMMANDS */
+		"echo-parameters",
+		"\r\necho-parameters <...>:\r\n Take variable number of parameters, echos each in turn\r\n",
+		NULL, /* The session aware function below is run instead. */
+		-1, /* The user can enter any number of commands. */
+		prvParameterEchoCommand /* The function to run. */
+	},
+
+	#if( configGENERATE_RUN_TIME_STATS == 1 )
+		/* The "run-time-stats" command line command.   This generates a table
+		that shows how much run time each task has */
+		{
+			"run-time-stats", /* The command string to type. */
+			"\r\nrun-time-stats:\r\n Displays a table showing how much processing time each FreeRTOS task has used\r\n",
+			prvRunTimeStatsCommand, /* The function to run. */
+			0 /* No parameters are expected. */
+		},
+	#endif /* configGENERATE_RUN_TIME_STATS */
+
+	#if( configINCLUDE_TASK_RECORDS_COMMAND == 1 )
+		/* The "task-records" command line command.  This outputs a record per
+		task, in a form intended to be read by a program rather than a person,
+		and with the processing time each task used since the previous
+		task-records command, so the host can poll it. */
+		{
+			"task-records",
+			"\r\ntask-records [csv | bin]:\r\n Outputs a record per task, with the processing time used since the last task-records command\r\n",
+			NULL, /* The session aware function below is run instead. */
+			1, /* One parameter is expected.  Valid values are "csv" and "bin". */
+			prvTaskRecordsCommand /* The function to run. */
+		},
+	#endif /* configINCLUDE_TASK_RECORDS_COMMAND */
+
+	#if( configINCLUDE_QUERY_HEAP_COMMAND == 1 )
+		/* The "query_heap" command line command. */
+		{
+			"query-heap",
+			"\r\nquery-heap:\r\n Displays the free heap space, and minimum ever free heap space.\r\n",
+			prvQueryHeapCommand, /* The function to run. */
+			0 /* The user can enter any number of commands. */
+		},
+	#endif /* configQUERY_HEAP_COMMAND */
+
+	#if configINCLUDE_TRACE_RELATED_CLI_COMMANDS == 1
+		/* The "trace" command line command.  This takes a single parameter,
+		which can be either "start" or "stop". */
+		{
+			"trace",
+			"\r\ntrace [start | stop]:\r\n Starts or stops a trace recording for viewing in FreeRTOS+Trace\r\n",
+			prvStartStopTraceCommand, /* The function to run. */
+			1 /* One parameter is expected.  Valid values are "start" and "stop". */
+		},
+	#endif /* configINCLUDE_TRACE_RELATED_CLI_COMMANDS */
+};
 
 /*-----------------------------------------------------------*/
 
 void vRegisterSampleCLICommands( void )
 {
-	/* Register all the command line commands defined immediately above. */
-	FreeRTOS_CLIRegisterCommand( &xTaskStats );	
-	FreeRTOS_CLIRegisterCommand( &xThreeParameterEcho );
-	FreeRTOS_CLIRegisterCommand( &xParameterEcho );
+BaseType_t xStatus;
 
-	#if( configGENERATE_RUN_TIME_STATS == 1 )
-	{
-		FreeRTOS_CLIRegisterCommand( &xRunTimeStats );
-	}
-	#endif
-	
-	#if( configINCLUDE_QUERY_HEAP_COMMAND == 1 )
-	{
-		FreeRTOS_CLIRegisterCommand( &xQueryHeap );
-	}
-	#endif
+	/* Register all the command line commands defined immediately above.  This
+	fails if configCOMMAND_INT_MAX_COMMANDS in FreeRTOSConfig.h is too low for
+	all the commands the application registers. */
+	xStatus = FreeRTOS_CLIRegisterCommandTable( xSampleCommands, sizeof( xSampleCommands ) / sizeof( xSampleCommands[ 0 ] ) );
+	configASSERT( xStatus == pdPASS );
 
-	#if( configINCLUDE_TRACE_RELATED_CLI_COMMANDS == 1 )
-	{
-		FreeRTOS_CLIRegisterCommand( &xStartStopTrace );
-	}
-	#endif
+	/* Prevent compiler warnings when configASSERT() is not defined. */
+	( void ) xStatus;
 }
 /*-----------------------------------------------------------*/
 
-static BaseType_t prvTaskStatsCommand( char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString )
+static BaseType_t prvTaskStatsCommand( CLI_Session_t *pxSession, char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString )
 {
 const char *const pcHeader = "     State   Priority  Stack    #\r\n************************************************\r\n";
+TaskStatus_t *pxTaskStatusArray;
+UBaseType_t uxArraySize, x;
 BaseType_t xSpacePadding;
-
-	/* Remove compile time warnings about unused parameters, and check the
-	write buffer is not NULL.  NOTE - for simplicity, this example assumes the
-	write buffer length is adequate, so does not check for buffer overflows. */
+const char *pcFailed;
+char cStatus;
+/* One line of the table, as generated by vTaskList(). */
+char cLine[ configMAX_TASK_NAME_LEN + 40 ];
+
+	/* Remove compile time warnings about unused parameters.  The table is
+	written a line at a time with FreeRTOS_CLIWrite(), rather than into the
+	write buffer, so only one line of it is held in RAM. */
 	( void ) pcCommandString;
+	( void ) pcWriteBuffer;
 	( void ) xWriteBufferLen;
-	configASSERT( pcWriteBuffer );
 
 	/* Generate a table of task stats. */
-	strcpy( pcWriteBuffer, "Task" );
-	pcWriteBuffer += strlen( pcWriteBuffer );
+	strcpy( cLine, "Task" );
 
 	/* Minus three for the null terminator and half the number of characters in
 	"Task" so the column lines up with the centre of the heading. */
@@ -213,21 +255,303 @@ BaseType_t xSpacePadding;
 	for( xSpacePadding = strlen( "Task" ); xSpacePadding < ( configMAX_TASK_NAME_LEN - 3 ); xSpacePadding++ )
 	{
 		/* Add a space to align columns after the task's name. */
-		*pcWriteBuffer = ' ';
-		pcWriteBuffer++;
+		cLine[ xSpacePadding ] = ' ';
+	}
+
+	( void ) FreeRTOS_CLIWrite( pxSession, cLine, ( size_t ) xSpacePadding );
+	( void ) FreeRTOS_CLIWrite( pxSession, pcHeader, strlen( pcHeader ) );
+
+	/* Take a snapshot of the state of the tasks.  This is the same snapshot
+	vTaskList() would take, but vTaskList() would also write the whole table
+	into a single string. */
+	uxArraySize = uxTaskGetNumberOfTasks();
+	pxTaskStatusArray = pvPortMalloc( uxArraySize * sizeof( TaskStatus_t ) );
+
+	if( pxTaskStatusArray != NULL )
+	{
+		uxArraySize = uxTaskGetSystemState( pxTaskStatusArray, uxArraySize, NULL );
+
+		for( x = 0; x < uxArraySize; x++ )
+		{
+			cStatus = prvTaskStateCharacter( pxTaskStatusArray[ x ].eCurrentState );
+
+			/* The same format as vTaskList(), with the name padded so the
+			columns line up. */
+			snprintf( cLine, sizeof( cLine ), "%-*s\t%c\t%u\t%u\t%u\r\n", ( int ) ( configMAX_TASK_NAME_LEN - 1 ), pxTaskStatusArray[ x ].pcTaskName, cStatus, ( unsigned int ) pxTaskStatusArray[ x ].uxCurrentPriority, ( unsigned int ) pxTaskStatusArray[ x ].usStackHighWaterMark, ( unsigned int ) pxTaskStatusArray[ x ].xTaskNumber );
+
+			if( FreeRTOS_CLIWrite( pxSession, cLine, strlen( cLine ) ) != pdPASS )
+			{
+				/* The rest of the table cannot be output. */
+				break;
+			}
+		}
 
-		/* Ensure always terminated. */
-		*pcWriteBuffer = 0x00;
+		vPortFree( pxTaskStatusArray );
+	}
+	else
+	{
+		pcFailed = "Failed to allocate RAM for the task stats.\r\n";
+		( void ) FreeRTOS_CLIWrite( pxSession, pcFailed, strlen( pcFailed ) );
 	}
-	strcpy( pcWriteBuffer, pcHeader );
-	vTaskList( pcWriteBuffer + strlen( pcHeader ) );
 
-	/* There is no more data to return after this single string, so return
-	pdFALSE. */
+	/* The whole table has been output, so return pdFALSE. */
 	return pdFALSE;
 }
 /*-----------------------------------------------------------*/
 
+static char prvTaskStateCharacter( eTaskState eState )
+{
+char cStatus;
+
+	switch( eState )
+	{
+		case eRunning:		cStatus = 'X';
+							break;
+
+		case eReady:		cStatus = 'R';
+							break;
+
+		case eBlocked:		cStatus = 'B';
+							break;
+
+		case eSuspended:	cStatus = 'S';
+							break;
+
+		case eDeleted:		cStatus = 'D';
+							break;
+
+		case eInvalid:		/* Fall through. */
+		default:			/* Should not get here, but it is included
+							to prevent static checking errors. */
+							cStatus = ' ';
+							break;
+	}
+
+	return cStatus;
+}
+/*-----------------------------------------------------------*/
+
+#if( configINCLUDE_TASK_RECORDS_COMMAND == 1 )
+
+	/*
+	 * Write ulValue into the uxBytes bytes at pucBuffer, least significant
+	 * byte first, so the binary records are the same whatever the endianness of
+	 * the target.
+	 */
+	static void prvWriteLittleEndian( uint8_t *pucBuffer, uint32_t ulValue, UBaseType_t uxBytes );
+
+	/* The snapshots of the tasks taken by the command, with statically
+	allocated arrays, so polling the statistics does not use the heap. */
+	static TaskStatus_t xTaskStatusArray[ configTASK_RECORDS_MAX_TASKS ];
+	static CLI_TaskRunTime_t xPreviousRunTimes[ configTASK_RECORDS_MAX_TASKS ];
+	static CLI_TaskSnapshot_t xTaskSnapshot = { NULL };
+
+	/* The arrays above are shared by all the command consoles, so only one of
+	them can execute task-records at a time. */
+	static BaseType_t xTaskRecordsInUse = pdFALSE;
+
+	/* The command outputs an interval record followed by a record per task.
+	All times are since the previous task-records command, or since the
+	scheduler started the first time.  As CSV, one line per record:
+
+		I,<ticks>,<run time counts>,<number of task records>
+		T,<task number>,<name>,<state>,<priority>,<stack high water mark>,<run time counts>,<CPU use in tenths of a percent>
+
+	In binary, with multi-byte values least significant byte first:
+
+		Interval record, 11 bytes:  'I', number of task records (2 bytes),
+		ticks (4 bytes), run time counts (4 bytes).
+
+		Task record, 16 bytes plus the name:  'T', state (1 byte, as in the CSV
+		record), priority (1 byte), name length (1 byte), task number (4 bytes),
+		stack high water mark (2 bytes), CPU use in tenths of a percent
+		(2 bytes), run time counts (4 bytes), name (not terminated).
+
+	The binary records contain zero bytes, so they can only be output by a
+	console that passes the output straight to the transport (see
+	FreeRTOS_CLISessionSetWriter()), not through its output buffer. */
+	static BaseType_t prvTaskRecordsCommand( CLI_Session_t *pxSession, char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString )
+	{
+	const char *pcParameter, *pcMessage = NULL;
+	BaseType_t xParameterStringLength, xBinary = pdFALSE, xInUse;
+	UBaseType_t uxNumberOfTasks, x;
+	uint32_t ulIntervalRunTime, ulTaskRunTime, ulPermille;
+	TickType_t xIntervalTicks;
+	size_t xLength, xNameLength;
+	/* One record, which is the longest as CSV. */
+	char cRecord[ configMAX_TASK_NAME_LEN + 80 ];
+
+		/* The records are written with FreeRTOS_CLIWrite(), one at a time, so
+		the write buffer is not used. */
+		( void ) pcWriteBuffer;
+		( void ) xWriteBufferLen;
+
+		/* Obtain the format parameter. */
+		pcParameter = FreeRTOS_CLIGetParameter
+						(
+							pcCommandString,		/* The command string itself. */
+							1,						/* Return the first parameter. */
+							&xParameterStringLength	/* Store the parameter string length. */
+						);
+
+		/* Sanity check something was returned. */
+		configASSERT( pcParameter );
+
+		if( strncmp( pcParameter, "bin", strlen( "bin" ) ) == 0 )
+		{
+			xBinary = pdTRUE;
+
+			/* Without a writer the output is read from the session's output
+			buffer as a string, which would end at the first zero byte. */
+			if( pxSession->pxWriter == NULL )
+			{
+				pcMessage = "'bin' is not supported by this console, use 'csv'.\r\n";
+			}
+		}
+		else if( strncmp( pcParameter, "csv", strlen( "csv" ) ) != 0 )
+		{
+			pcMessage = "Valid parameters are 'csv' and 'bin'.\r\n";
+		}
+
+		taskENTER_CRITICAL();
+		{
+			xInUse = xTaskRecordsInUse;
+			xTaskRecordsInUse = pdTRUE;
+		}
+		taskEXIT_CRITICAL();
+
+		if( xInUse != pdFALSE )
+		{
+			pcMessage = "task-records is being executed by another console.\r\n";
+		}
+		else
+		{
+			if( pcMessage == NULL )
+			{
+				if( xTaskSnapshot.pxTaskStatusArray == NULL )
+				{
+					FreeRTOS_CLITaskSnapshotInit( &xTaskSnapshot, xTaskStatusArray, xPreviousRunTimes, configTASK_RECORDS_MAX_TASKS );
+				}
+
+				/* Take the snapshot.  0 is returned if the arrays are too small
+				to hold all the tasks. */
+				uxNumberOfTasks = FreeRTOS_CLITakeTaskSnapshot( &xTaskSnapshot );
+
+				if( uxNumberOfTasks == 0 )
+				{
+					pcMessage = "There are more tasks than configTASK_RECORDS_MAX_TASKS.\r\n";
+				}
+			}
+
+			if( pcMessage == NULL )
+			{
+				/* All the values are for the interval since the previous
+				snapshot.  Unsigned arithmetic handles the counters wrapping. */
+				ulIntervalRunTime = xTaskSnapshot.ulTotalRunTime - xTaskSnapshot.ulPreviousTotalRunTime;
+				xIntervalTicks = xTaskSnapshot.xTickCount - xTaskSnapshot.xPreviousTickCount;
+
+				/* The interval record, which gives the length of the interval
+				in ticks and in run time counts, and the number of task records
+				that follow. */
+				if( xBinary != pdFALSE )
+				{
+					cRecord[ 0 ] = cliINTERVAL_RECORD;
+					prvWriteLittleEndian( ( uint8_t * ) &( cRecord[ 1 ] ), ( uint32_t ) uxNumberOfTasks, 2 );
+					prvWriteLittleEndian( ( uint8_t * ) &( cRecord[ 3 ] ), ( uint32_t ) xIntervalTicks, 4 );
+					prvWriteLittleEndian( ( uint8_t * ) &( cRecord[ 7 ] ), ulIntervalRunTime, 4 );
+					xLength = cliBINARY_INTERVAL_RECORD_SIZE;
+				}
+				else
+				{
+					xLength = ( size_t ) snprintf( cRecord, sizeof( cRecord ), "%c,%u,%u,%u\r\n", cliINTERVAL_RECORD, ( unsigned int ) xIntervalTicks, ( unsigned int ) ulIntervalRunTime, ( unsigned int ) uxNumberOfTasks );
+				}
+
+				( void ) FreeRTOS_CLIWrite( pxSession, cRecord, xLength );
+
+				/* A record per task. */
+				for( x = 0; x < uxNumberOfTasks; x++ )
+				{
+					ulTaskRunTime = FreeRTOS_CLIGetTaskRunTime( &xTaskSnapshot, x );
+
+					/* The CPU use in tenths of a percent, without overflowing
+					32-bit arithmetic.  The second division is only used for
+					long intervals, where the rounding does not matter. */
+					if( ulIntervalRunTime == 0UL )
+					{
+						ulPermille = 0UL;
+					}
+					else if( ulTaskRunTime <= ( 0xffffffffUL / 1000UL ) )
+					{
+						ulPermille = ( ulTaskRunTime * 1000UL ) / ulIntervalRunTime;
+					}
+					else
+					{
+						ulPermille = ulTaskRunTime / ( ulIntervalRunTime / 1000UL );
+					}
+
+					if( xBinary != pdFALSE )
+					{
+						xNameLength = strlen( xTaskStatusArray[ x ].pcTaskName );
+						cRecord[ 0 ] = cliTASK_RECORD;
+						cRecord[ 1 ] = prvTaskStateCharacter( xTaskStatusArray[ x ].eCurrentState );
+						cRecord[ 2 ] = ( char ) xTaskStatusArray[ x ].uxCurrentPriority;
+						cRecord[ 3 ] = ( char ) xNameLength;
+						prvWriteLittleEndian( ( uint8_t * ) &( cRecord[ 4 ] ), ( uint32_t ) xTaskStatusArray[ x ].xTaskNumber, 4 );
+						prvWriteLittleEndian( ( uint8_t * ) &( cRecord[ 8 ] ), ( uint32_t ) xTaskStatusArray[ x ].usStackHighWaterMark, 2 );
+						prvWriteLittleEndian( ( uint8_t * ) &( cRecord[ 10 ] ), ulPermille, 2 );
+						prvWriteLittleEndian( ( uint8_t * ) &( cRecord[ 12 ] ), ulTaskRunTime, 4 );
+						memcpy( &( cRecord[ cliBINARY_TASK_RECORD_SIZE ] ), xTaskStatusArray[ x ].pcTaskName, xNameLength );
+						xLength = cliBINARY_TASK_RECORD_SIZE + xNameLength;
+					}
+					else
+					{
+						xLength = ( size_t ) snprintf( cRecord, sizeof( cRecord ), "%c,%u,%s,%c,%u,%u,%u,%u\r\n",
+														cliTASK_RECORD,
+														( unsigned int ) xTaskStatusArray[ x ].xTaskNumber,
+														xTaskStatusArray[ x ].pcTaskName,
+														prvTaskStateCharacter( xTaskStatusArray[ x ].eCurrentState ),
+														( unsigned int ) xTaskStatusArray[ x ].uxCurrentPriority,
+														( unsigned int ) xTaskStatusArray[ x ].usStackHighWaterMark,
+														( unsigned int ) ulTaskRunTime,
+														( unsigned int ) ulPermille );
+					}
+
+					if( FreeRTOS_CLIWrite( pxSession, cRecord, xLength ) != pdPASS )
+					{
+						/* The rest of the records cannot be output, but the
+						snapshot is still kept for the next interval. */
+						break;
+					}
+				}
+			}
+
+			xTaskRecordsInUse = pdFALSE;
+		}
+
+		if( pcMessage != NULL )
+		{
+			( void ) FreeRTOS_CLIWrite( pxSession, pcMessage, strlen( pcMessage ) );
+		}
+
+		/* All the records have been output, so return pdFALSE. */
+		return pdFALSE;
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvWriteLittleEndian( uint8_t *pucBuffer, uint32_t ulValue, UBaseType_t uxBytes )
+	{
+	UBaseType_t x;
+
+		for( x = 0; x < uxBytes; x++ )
+		{
+			pucBuffer[ x ] = ( uint8_t ) ( ulValue & 0xffUL );
+			ulValue >>= 8UL;
+		}
+	}
+
+#endif /* configINCLUDE_TASK_RECORDS_COMMAND */
+/*-----------------------------------------------------------*/
+
 #if( configINCLUDE_QUERY_HEAP_COMMAND == 1 )
 
 	static BaseType_t prvQueryHeapCommand( char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString )
@@ -292,11 +616,11 @@ BaseType_t xSpacePadding;
 #endif /* configGENERATE_RUN_TIME_STATS */
 /*-----------------------------------------------------------*/
 
-static BaseType_t prvThreeParameterEchoCommand( char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString )
+static BaseType_t prvThreeParameterEchoCommand( CLI_Session_t *pxSession, char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString )
 {
 const char *pcParameter;
 BaseType_t xParameterStringLength, xReturn;
-static UBaseType_t uxParameterNumber = 0;
+UBaseType_t uxParameterNumber;
 
 	/* Remove compile time warnings about unused parameters, and check the
 	write buffer is not NULL.  NOTE - for simplicity, this example assumes the
@@ -305,6 +629,11 @@ static UBaseType_t uxParameterNumber = 0;
 	( void ) xWriteBufferLen;
 	configASSERT( pcWriteBuffer );
 
+	/* The number of the next parameter to echo is kept in the session, which
+	sets it to 0 when the command is entered, so the command can be executed
+	by several sessions at once. */
+	uxParameterNumber = pxSession->uxCommandState;
+
 	if( uxParameterNumber == 0 )
 	{
 		/* The first time the function is called after the command has been
@@ -355,15 +684,17 @@ static UBaseType_t uxParameterNumber = 0;
 		}
 	}
 
+	pxSession->uxCommandState = uxParameterNumber;
+
 	return xReturn;
 }
 /*-----------------------------------------------------------*/
 
-static BaseType_t prvParameterEchoCommand( char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString )
+static BaseType_t prvParameterEchoCommand( CLI_Session_t *pxSession, char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString )
 {
 const char *pcParameter;
 BaseType_t xParameterStringLength, xReturn;
-static UBaseType_t uxParameterNumber = 0;
+UBaseType_t uxParameterNumber;
 
 	/* Remove compile time warnings about unused parameters, and check the
 	write buffer is not NULL.  NOTE - for simplicity, this example assumes the
@@ -372,6 +703,11 @@ static UBaseType_t uxParameterNumber = 0;
 	( void ) xWriteBufferLen;
 	configASSERT( pcWriteBuffer );
 
+	/* The number of the next parameter to echo is kept in the session, which
+	sets it to 0 when the command is entered, so the command can be executed
+	by several sessions at once. */
+	uxParameterNumber = pxSession->uxCommandState;
+
 	if( uxParameterNumber == 0 )
 	{
 		/* The first time the function is called after the command has been
@@ -422,6 +758,8 @@ static UBaseType_t uxParameterNumber = 0;
 		}
 	}
 
+	pxSession->uxCommandState = uxParameterNumber;
+
 	return xReturn;
 }
 /*-----------------------------------------------------------*/
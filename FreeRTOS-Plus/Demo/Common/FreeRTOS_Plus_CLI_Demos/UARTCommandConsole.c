@@ -68,6 +68,13 @@ available. */
  * The task that implements the command console processing.
  */
 static void prvUARTCommandConsoleTask( void *pvParameters );
+
+/*
+ * Passes the output of the commands straight to the UART.  pvPort points to
+ * the handle of the port.
+ */
+static BaseType_t prvUARTWrite( void *pvPort, const char *pcData, size_t xDataLength );
+
 void vUARTCommandConsoleStart( uint16_t usStackSize, UBaseType_t uxPriority );
 
 /*-----------------------------------------------------------*/
@@ -106,21 +113,22 @@ static void prvUARTCommandConsoleTask( void *pvParameters )
 {
 signed char cRxedChar;
 uint8_t ucInputIndex = 0;
-char *pcOutputString;
 static char cInputString[ cmdMAX_INPUT_SIZE ], cLastInputString[ cmdMAX_INPUT_SIZE ];
-BaseType_t xReturned;
+static CLI_Session_t xSession;
 xComPortHandle xPort;
 
 	( void ) pvParameters;
 
-	/* Obtain the address of the output buffer.  Note there is no mutual
-	exclusion on this buffer as it is assumed only one command console interface
-	will be used at any one time. */
-	pcOutputString = FreeRTOS_CLIGetOutputBuffer();
-
 	/* Initialise the UART. */
 	xPort = xSerialPortInitMinimal( configCLI_BAUD_RATE, cmdQUEUE_LENGTH );
 
+	/* Obtain the address of the output buffer, and use it for this console's
+	session.  Other command console interfaces must use their own session and
+	output buffer, so they can execute commands at the same time as this one.
+	The output of the commands is passed to the UART as it is generated. */
+	FreeRTOS_CLISessionInit( &xSession, FreeRTOS_CLIGetOutputBuffer(), configCOMMAND_INT_MAX_OUTPUT_SIZE );
+	FreeRTOS_CLISessionSetWriter( &xSession, prvUARTWrite, &xPort );
+
 	/* Send the welcome message. */
 	vSerialPutString( xPort, ( signed char * ) pcWelcomeMessage, ( unsigned short ) strlen( pcWelcomeMessage ) );
 
@@ -151,19 +159,10 @@ xComPortHandle xPort;
 					strcpy( cInputString, cLastInputString );
 				}
 
-				/* Pass the received command to the command interpreter.  The
-				command interpreter is called repeatedly until it returns
-				pdFALSE	(indicating there is no more output) as it might
-				generate more than one string. */
-				do
-				{
-					/* Get the next output string from the command interpreter. */
-					xReturned = FreeRTOS_CLIProcessCommand( cInputString, pcOutputString, configCOMMAND_INT_MAX_OUTPUT_SIZE );
-
-					/* Write the generated string to the UART. */
-					vSerialPutString( xPort, ( signed char * ) pcOutputString, ( unsigned short ) strlen( pcOutputString ) );
-
-				} while( xReturned != pdFALSE );
+				/* Pass the received command to the command interpreter, which
+				writes the output to the UART, through prvUARTWrite(), until
+				the command has completed. */
+				( void ) FreeRTOS_CLIExecuteCommand( &xSession, cInputString );
 
 				/* All the strings generated by the input command have been
 				sent.  Clear the input string ready to receive the next command.
@@ -214,6 +213,16 @@ xComPortHandle xPort;
 }
 /*-----------------------------------------------------------*/
 
+static BaseType_t prvUARTWrite( void *pvPort, const char *pcData, size_t xDataLength )
+{
+	/* The Tx mutex is already held by the console task, which is executing
+	the command. */
+	vSerialPutString( *( ( xComPortHandle * ) pvPort ), ( signed char * ) pcData, ( unsigned short ) xDataLength );
+
+	return pdPASS;
+}
+/*-----------------------------------------------------------*/
+
 void vOutputString( const char * const pcMessage )
 {
 	if( xSemaphoreTake( xTxMutex, cmdMAX_MUTEX_WAIT ) == pdPASS )
@@ -105,20 +105,30 @@ static const CLI_Command_Definition_t xIPConfig =
 
 void vRegisterUDPCLICommands( void )
 {
-	/* Register all the command line commands defined immediately above. */
-	FreeRTOS_CLIRegisterCommand( &xIPConfig );
+BaseType_t xStatus;
+
+	/* Register all the command line commands defined immediately above.  This
+	fails if configCOMMAND_INT_MAX_COMMANDS in FreeRTOSConfig.h is too low for
+	all the commands the application registers. */
+	xStatus = FreeRTOS_CLIRegisterCommand( &xIPConfig );
+	configASSERT( xStatus == pdPASS );
 
 	#if configINCLUDE_DEMO_DEBUG_STATS == 1
 	{
-		FreeRTOS_CLIRegisterCommand( &xIPDebugStats );
+		xStatus = FreeRTOS_CLIRegisterCommand( &xIPDebugStats );
+		configASSERT( xStatus == pdPASS );
 	}
 	#endif /* configINCLUDE_DEMO_DEBUG_STATS */
 
 	#if ipconfigSUPPORT_OUTGOING_PINGS == 1
 	{
-		FreeRTOS_CLIRegisterCommand( &xPing );
+		xStatus = FreeRTOS_CLIRegisterCommand( &xPing );
+		configASSERT( xStatus == pdPASS );
 	}
 	#endif /* ipconfigSUPPORT_OUTGOING_PINGS */
+
+	/* Prevent compiler warnings when configASSERT() is not defined. */
+	( void ) xStatus;
 }
 /*-----------------------------------------------------------*/
 
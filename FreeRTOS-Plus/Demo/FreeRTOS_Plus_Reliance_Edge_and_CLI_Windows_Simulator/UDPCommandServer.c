@@ -54,11 +54,25 @@
 /* DEL acts as a backspace. */
 #define cmdASCII_DEL		( 0x7F )
 
+/* The socket and address to which the output of the commands is sent. */
+typedef struct xUDP_CLIENT
+{
+	SOCKET xSocket;
+	struct sockaddr_in xAddress;
+	int iAddressLength;
+} UDPClient_t;
+
 /*
  * Open and configure the UDP socket.
  */
 static SOCKET prvOpenUDPSocket( void );
 
+/*
+ * Sends the output of the commands, as it is generated, to the client from
+ * which the command was received.  pvClient points to a UDPClient_t.
+ */
+static BaseType_t prvSendToClient( void *pvClient, const char *pcData, size_t xDataLength );
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -72,24 +86,29 @@ void vUDPCommandInterpreterTask( void *pvParameters )
 long lBytes, lByte;
 signed char cInChar, cInputIndex = 0;
 static signed char cInputString[ cmdMAX_INPUT_SIZE ], cOutputString[ cmdMAX_OUTPUT_SIZE ], cLocalBuffer[ cmdSOCKET_INPUT_BUFFER_SIZE ];
-BaseType_t xMoreDataToFollow;
+static CLI_Session_t xSession;
+static UDPClient_t xClient;
 volatile int iErrorCode = 0;
-struct sockaddr_in xClient;
-int xClientAddressLength = sizeof( struct sockaddr_in );
-SOCKET xSocket;
 
 	/* Just to prevent compiler warnings. */
 	( void ) pvParameters;
 
+	/* This server has its own session and output buffer, so it can execute
+	commands while another command console is executing a command too.  The
+	output of the commands is sent to the client as it is generated. */
+	FreeRTOS_CLISessionInit( &xSession, ( char * ) cOutputString, cmdMAX_OUTPUT_SIZE );
+	FreeRTOS_CLISessionSetWriter( &xSession, prvSendToClient, &xClient );
+
 	/* Attempt to open the socket. */
-	xSocket = prvOpenUDPSocket();
+	xClient.xSocket = prvOpenUDPSocket();
 
-	if( xSocket != INVALID_SOCKET )
+	if( xClient.xSocket != INVALID_SOCKET )
 	{
 		for( ;; )
 		{
 			/* Wait for incoming data on the opened socket. */
-			lBytes = recvfrom( xSocket, cLocalBuffer, sizeof( cLocalBuffer ), 0, ( struct sockaddr * ) &xClient, &xClientAddressLength );
+			xClient.iAddressLength = sizeof( struct sockaddr_in );
+			lBytes = recvfrom( xClient.xSocket, cLocalBuffer, sizeof( cLocalBuffer ), 0, ( struct sockaddr * ) &( xClient.xAddress ), &( xClient.iAddressLength ) );
 
 			if( lBytes == SOCKET_ERROR )
 			{
@@ -112,17 +131,9 @@ SOCKET xSocket;
 					if( cInChar == '\n' )
 					{
 						/* Process the input string received prior to the
-						newline. */
-						do
-						{
-							/* Pass the string to FreeRTOS+CLI. */
-							xMoreDataToFollow = FreeRTOS_CLIProcessCommand( cInputString, cOutputString, cmdMAX_OUTPUT_SIZE );
-
-							/* Send the output generated by the command's
-							implementation. */
-							sendto( xSocket, cOutputString,  strlen( cOutputString ), 0, ( SOCKADDR * ) &xClient, xClientAddressLength );
-
-						} while( xMoreDataToFollow != pdFALSE ); /* Until the command does not generate any more output. */
+						newline.  The output generated by the command's
+						implementation is sent by prvSendToClient(). */
+						( void ) FreeRTOS_CLIExecuteCommand( &xSession, ( const char * ) cInputString );
 
 						/* All the strings generated by the command processing
 						have been sent.  Clear the input string ready to receive
@@ -132,7 +143,7 @@ SOCKET xSocket;
 
 						/* Transmit a spacer, just to make the command console
 						easier to read. */
-						sendto( xSocket, "\r\n",  strlen( "\r\n" ), 0, ( SOCKADDR * ) &xClient, xClientAddressLength );
+						( void ) prvSendToClient( &xClient, "\r\n", strlen( "\r\n" ) );
 					}
 					else
 					{
@@ -175,6 +186,20 @@ SOCKET xSocket;
 }
 /*-----------------------------------------------------------*/
 
+static BaseType_t prvSendToClient( void *pvClient, const char *pcData, size_t xDataLength )
+{
+UDPClient_t *pxClient = ( UDPClient_t * ) pvClient;
+BaseType_t xReturn = pdPASS;
+
+	if( sendto( pxClient->xSocket, pcData, ( int ) xDataLength, 0, ( SOCKADDR * ) &( pxClient->xAddress ), pxClient->iAddressLength ) == SOCKET_ERROR )
+	{
+		xReturn = pdFAIL;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
 static SOCKET prvOpenUDPSocket( void )
 {
 WSADATA xWSAData;
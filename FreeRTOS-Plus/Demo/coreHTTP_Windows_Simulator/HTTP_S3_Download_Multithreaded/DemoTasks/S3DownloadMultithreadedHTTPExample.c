@@ -333,6 +333,17 @@ static size_t xFileSize = 0;
  */
 static size_t xResponseCount = 0;
 
+/**
+ * @brief The TLS configuration of the connections to the server, so the root
+ * CA certificate is parsed once rather than each time the demo connects.
+ */
+static TlsSharedConfig_t xTlsSharedConfig;
+
+/**
+ * @brief The credentials for establishing a TLS connection with the server.
+ */
+static NetworkCredentials_t xNetworkCredentials = { 0 };
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -493,6 +504,22 @@ static void prvHTTPDemoTask( void * pvParameters )
     /* Set the pParams member of the network context with desired transport. */
     xNetworkContext.pParams = &xTlsTransportParams;
 
+    /* Parse the credentials once for all the connection attempts. If this
+     * fails, each connection sets up its own configuration instead. */
+    xNetworkCredentials.disableSni = democonfigDISABLE_SNI;
+    xNetworkCredentials.pRootCa = ( const unsigned char * ) democonfigROOT_CA_PEM;
+    xNetworkCredentials.rootCaSize = sizeof( democonfigROOT_CA_PEM );
+
+    if( TLS_FreeRTOS_InitSharedConfig( &xTlsSharedConfig,
+                                       &xNetworkCredentials ) == TLS_TRANSPORT_SUCCESS )
+    {
+        xTlsTransportParams.pSharedConfig = &xTlsSharedConfig;
+    }
+    else
+    {
+        LogWarn( ( "Failed to set up the shared TLS configuration." ) );
+    }
+
     LogInfo( ( "HTTP Client S3 multi-threaded download demo using pre-signed URL:\n%s",
                democonfigS3_PRESIGNED_GET_URL ) );
 
@@ -639,6 +666,13 @@ static void prvHTTPDemoTask( void * pvParameters )
         }
     } while( xDemoStatus != pdPASS );
 
+    /* The configuration is freed now that the connection is closed. */
+    if( xTlsTransportParams.pSharedConfig != NULL )
+    {
+        TLS_FreeRTOS_ReleaseSharedConfig( xTlsTransportParams.pSharedConfig );
+        xTlsTransportParams.pSharedConfig = NULL;
+    }
+
     if( xDemoStatus == pdPASS )
     {
         LogInfo( ( "prvHTTPDemoTask() completed successfully. "
@@ -654,16 +688,10 @@ static void prvHTTPDemoTask( void * pvParameters )
 static BaseType_t prvConnectToServer( NetworkContext_t * pxNetworkContext )
 {
     TlsTransportStatus_t xNetworkStatus;
-    NetworkCredentials_t xNetworkCredentials = { 0 };
     BaseType_t xStatus = pdPASS;
 
     configASSERT( pxNetworkContext != NULL );
 
-    /* Set the credentials for establishing a TLS connection. */
-    xNetworkCredentials.disableSni = democonfigDISABLE_SNI;
-    xNetworkCredentials.pRootCa = ( const unsigned char * ) democonfigROOT_CA_PEM;
-    xNetworkCredentials.rootCaSize = sizeof( democonfigROOT_CA_PEM );
-
     /* Establish a TLS session with the HTTP server. This example connects to
      * the server host found in democonfigPRESIGNED_GET_URL on port
      * democonfigHTTPS_PORT in demo_config.h. */
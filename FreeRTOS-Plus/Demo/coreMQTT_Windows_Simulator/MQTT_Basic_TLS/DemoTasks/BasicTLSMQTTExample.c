@@ -67,6 +67,9 @@
 /* Transport interface implementation include header for TLS. */
 #include "using_mbedtls.h"
 
+/* mbed TLS memory pools, for the handshake benchmark. */
+#include "mbedtls_freertos_pool.h"
+
 /*-----------------------------------------------------------*/
 
 /* Compile time error for undefined configs. */
@@ -103,6 +106,45 @@
     #define democonfigMQTT_BROKER_PORT    ( 8883 )
 #endif
 
+#ifndef democonfigRECONNECT_BENCHMARK_ITERATIONS
+
+/**
+ * @brief The number of connections timed by prvBenchmarkReconnections(), 0
+ * to not run it.
+ */
+    #define democonfigRECONNECT_BENCHMARK_ITERATIONS    ( 0 )
+#endif
+
+#if ( democonfigRECONNECT_BENCHMARK_ITERATIONS > 0 ) && ( TLS_TRANSPORT_SESSION_CACHE_ENTRIES == 0 )
+    #error "The reconnection benchmark requires TLS_TRANSPORT_SESSION_CACHE_ENTRIES to be defined in FreeRTOSConfig.h."
+#endif
+
+#ifndef democonfigHANDSHAKE_BENCHMARK_ITERATIONS
+
+/**
+ * @brief The number of connections timed by prvBenchmarkHandshakes() with each
+ * allocator, 0 to not run it.
+ */
+    #define democonfigHANDSHAKE_BENCHMARK_ITERATIONS    ( 0 )
+#endif
+
+#if ( democonfigHANDSHAKE_BENCHMARK_ITERATIONS > 0 ) && !defined( MBEDTLS_FREERTOS_POOL_ALLOCATOR )
+    #error "The handshake benchmark requires MBEDTLS_FREERTOS_POOL_ALLOCATOR to be defined in mbedtls_config.h."
+#endif
+
+#ifndef democonfigPUBLISH_BENCHMARK_MESSAGES
+
+/**
+ * @brief The number of messages published by each run of
+ * prvBenchmarkPublishes(), 0 to not run it.
+ */
+    #define democonfigPUBLISH_BENCHMARK_MESSAGES    ( 0 )
+#endif
+
+#if ( democonfigPUBLISH_BENCHMARK_MESSAGES > 0 ) && ( TLS_TRANSPORT_SEND_BUFFER_SIZE == 0 )
+    #error "The publish benchmark requires TLS_TRANSPORT_SEND_BUFFER_SIZE to be defined in FreeRTOSConfig.h."
+#endif
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -230,6 +272,88 @@ static void prvMQTTDemoTask( void * pvParameters );
 static TlsTransportStatus_t prvConnectToServerWithBackoffRetries( NetworkCredentials_t * pxNetworkCredentials,
                                                                   NetworkContext_t * pNetworkContext );
 
+#if ( democonfigRECONNECT_BENCHMARK_ITERATIONS > 0 )
+
+/**
+ * @brief Time democonfigRECONNECT_BENCHMARK_ITERATIONS TLS connections to the
+ * broker with a full handshake, then as many with a resumed session, and log
+ * the average time of each and the counts of the TLS session cache.
+ *
+ * @param[in] pxNetworkCredentials The credentials of the connections.
+ * @param[in] pxNetworkContext The network context to connect with.
+ */
+    static void prvBenchmarkReconnections( NetworkCredentials_t * pxNetworkCredentials,
+                                           NetworkContext_t * pxNetworkContext );
+#endif
+
+#if ( democonfigHANDSHAKE_BENCHMARK_ITERATIONS > 0 )
+
+/**
+ * @brief Time democonfigHANDSHAKE_BENCHMARK_ITERATIONS TLS connections to the
+ * broker with a full handshake, with the memory of mbed TLS allocated from the
+ * FreeRTOS heap, then as many with the memory allocated from the mbed TLS
+ * memory pools. Log the average time and the peak memory use of each.
+ *
+ * @param[in] pxNetworkCredentials The credentials of the connections.
+ * @param[in] pxNetworkContext The network context to connect with.
+ */
+    static void prvBenchmarkHandshakes( NetworkCredentials_t * pxNetworkCredentials,
+                                        NetworkContext_t * pxNetworkContext );
+
+/**
+ * @brief Log the peak use of the mbed TLS memory pools and of the FreeRTOS
+ * heap by mbed TLS, since mbedtls_platform_pool_reset_high_water() was called.
+ */
+    static void prvLogPoolHighWater( void );
+#endif
+
+#if ( democonfigRECONNECT_BENCHMARK_ITERATIONS > 0 ) || ( democonfigHANDSHAKE_BENCHMARK_ITERATIONS > 0 )
+
+/**
+ * @brief Connect to the broker and disconnect ulIterations times.
+ *
+ * @param[in] pxNetworkCredentials The credentials of the connections.
+ * @param[in] pxNetworkContext The network context to connect with.
+ * @param[in] ulIterations The number of connections.
+ * @param[in] xFullHandshake pdTRUE to clear the TLS session cache before each
+ * connection.
+ *
+ * @return The average time of TLS_FreeRTOS_Connect(), in milliseconds.
+ */
+    static uint32_t prvTimeConnections( NetworkCredentials_t * pxNetworkCredentials,
+                                        NetworkContext_t * pxNetworkContext,
+                                        uint32_t ulIterations,
+                                        BaseType_t xFullHandshake );
+#endif
+
+#if ( democonfigPUBLISH_BENCHMARK_MESSAGES > 0 )
+
+/**
+ * @brief Publish democonfigPUBLISH_BENCHMARK_MESSAGES QoS 0 messages to the
+ * broker as coreMQTT sends them, then as many with each message corked into
+ * one TLS record, then as many corked together, and log the time of each run.
+ *
+ * @param[in] pxMQTTContext The MQTT context of the connection to the broker.
+ * @param[in] pxNetworkContext The network context of the connection.
+ */
+    static void prvBenchmarkPublishes( MQTTContext_t * pxMQTTContext,
+                                       NetworkContext_t * pxNetworkContext );
+
+/**
+ * @brief Publish democonfigPUBLISH_BENCHMARK_MESSAGES QoS 0 messages.
+ *
+ * @param[in] pxMQTTContext The MQTT context of the connection to the broker.
+ * @param[in] pxNetworkContext The network context of the connection.
+ * @param[in] ulMessagesPerFlush The number of messages corked together, 0 to
+ * not cork the connection.
+ *
+ * @return The time taken, in milliseconds.
+ */
+    static uint32_t prvTimePublishes( MQTTContext_t * pxMQTTContext,
+                                      NetworkContext_t * pxNetworkContext,
+                                      uint32_t ulMessagesPerFlush );
+#endif
+
 /**
  * @brief Sends an MQTT Connect packet over the already connected TLS over TCP connection.
  *
@@ -434,6 +558,14 @@ static void prvMQTTDemoTask( void * pvParameters )
      */
     ulGlobalEntryTimeMs = prvGetTimeMs();
 
+    #if ( democonfigHANDSHAKE_BENCHMARK_ITERATIONS > 0 )
+        prvBenchmarkHandshakes( &xNetworkCredentials, &xNetworkContext );
+    #endif
+
+    #if ( democonfigRECONNECT_BENCHMARK_ITERATIONS > 0 )
+        prvBenchmarkReconnections( &xNetworkCredentials, &xNetworkContext );
+    #endif
+
     for( ; ; )
     {
         /****************************** Connect. ******************************/
@@ -455,6 +587,10 @@ static void prvMQTTDemoTask( void * pvParameters )
         LogInfo( ( "Creating an MQTT connection to %s.\r\n", democonfigMQTT_BROKER_ENDPOINT ) );
         prvCreateMQTTConnectionWithBroker( &xMQTTContext, &xNetworkContext );
 
+        #if ( democonfigPUBLISH_BENCHMARK_MESSAGES > 0 )
+            prvBenchmarkPublishes( &xMQTTContext, &xNetworkContext );
+        #endif
+
         /**************************** Subscribe. ******************************/
 
         /* If the server rejected the subscription request, attempt to resubscribe to the
@@ -589,6 +725,231 @@ static TlsTransportStatus_t prvConnectToServerWithBackoffRetries( NetworkCredent
 }
 /*-----------------------------------------------------------*/
 
+#if ( democonfigRECONNECT_BENCHMARK_ITERATIONS > 0 )
+
+    static void prvBenchmarkReconnections( NetworkCredentials_t * pxNetworkCredentials,
+                                           NetworkContext_t * pxNetworkContext )
+    {
+        uint32_t ulFullMs, ulResumedMs;
+        TlsSessionCacheStats_t xStatsBefore, xStatsAfter;
+
+        pxNetworkCredentials->pRootCa = ( const unsigned char * ) democonfigROOT_CA_PEM;
+        pxNetworkCredentials->rootCaSize = sizeof( democonfigROOT_CA_PEM );
+        pxNetworkCredentials->disableSni = democonfigDISABLE_SNI;
+
+        LogInfo( ( "Timing %u TLS connections to %s:%u with a full handshake, then %u with a resumed session.\r\n",
+                   democonfigRECONNECT_BENCHMARK_ITERATIONS,
+                   democonfigMQTT_BROKER_ENDPOINT,
+                   democonfigMQTT_BROKER_PORT,
+                   democonfigRECONNECT_BENCHMARK_ITERATIONS ) );
+
+        ulFullMs = prvTimeConnections( pxNetworkCredentials,
+                                       pxNetworkContext,
+                                       democonfigRECONNECT_BENCHMARK_ITERATIONS,
+                                       pdTRUE );
+
+        /* The last connection left its session in the cache, so each of these
+         * connections should resume the session of the one before. */
+        TLS_FreeRTOS_GetSessionCacheStats( &xStatsBefore );
+        ulResumedMs = prvTimeConnections( pxNetworkCredentials,
+                                          pxNetworkContext,
+                                          democonfigRECONNECT_BENCHMARK_ITERATIONS,
+                                          pdFALSE );
+        TLS_FreeRTOS_GetSessionCacheStats( &xStatsAfter );
+
+        LogInfo( ( "Full handshake: %u ms on average. Resumed session: %u ms on average, "
+                   "%u of %u connections resumed it, %u were refused by the broker.\r\n",
+                   ulFullMs,
+                   ulResumedMs,
+                   xStatsAfter.hits - xStatsBefore.hits,
+                   democonfigRECONNECT_BENCHMARK_ITERATIONS,
+                   xStatsAfter.rejected - xStatsBefore.rejected ) );
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* if ( democonfigRECONNECT_BENCHMARK_ITERATIONS > 0 ) */
+
+#if ( democonfigHANDSHAKE_BENCHMARK_ITERATIONS > 0 )
+
+    static void prvBenchmarkHandshakes( NetworkCredentials_t * pxNetworkCredentials,
+                                        NetworkContext_t * pxNetworkContext )
+    {
+        uint32_t ulHeapMs, ulPoolMs;
+
+        pxNetworkCredentials->pRootCa = ( const unsigned char * ) democonfigROOT_CA_PEM;
+        pxNetworkCredentials->rootCaSize = sizeof( democonfigROOT_CA_PEM );
+        pxNetworkCredentials->disableSni = democonfigDISABLE_SNI;
+
+        LogInfo( ( "Timing %u TLS handshakes with %s:%u with the FreeRTOS heap, then %u with the mbed TLS memory pools.\r\n",
+                   democonfigHANDSHAKE_BENCHMARK_ITERATIONS,
+                   democonfigMQTT_BROKER_ENDPOINT,
+                   democonfigMQTT_BROKER_PORT,
+                   democonfigHANDSHAKE_BENCHMARK_ITERATIONS ) );
+
+        mbedtls_platform_pool_enable( pdFALSE );
+        mbedtls_platform_pool_reset_high_water();
+        ulHeapMs = prvTimeConnections( pxNetworkCredentials,
+                                       pxNetworkContext,
+                                       democonfigHANDSHAKE_BENCHMARK_ITERATIONS,
+                                       pdTRUE );
+        LogInfo( ( "FreeRTOS heap: %u ms per handshake on average.\r\n",
+                   ulHeapMs ) );
+        prvLogPoolHighWater();
+
+        mbedtls_platform_pool_enable( pdTRUE );
+        mbedtls_platform_pool_reset_high_water();
+        ulPoolMs = prvTimeConnections( pxNetworkCredentials,
+                                       pxNetworkContext,
+                                       democonfigHANDSHAKE_BENCHMARK_ITERATIONS,
+                                       pdTRUE );
+        LogInfo( ( "mbed TLS memory pools: %u ms per handshake on average.\r\n",
+                   ulPoolMs ) );
+        prvLogPoolHighWater();
+    }
+/*-----------------------------------------------------------*/
+
+    static void prvLogPoolHighWater( void )
+    {
+        size_t xClass;
+        mbedtls_platform_pool_stats_t xStats;
+
+        for( xClass = 0U; mbedtls_platform_pool_get_stats( xClass, &xStats ) == pdTRUE; xClass++ )
+        {
+            if( xStats.blockSize == 0U )
+            {
+                LogInfo( ( "FreeRTOS heap: peak %u blocks, %u allocations.\r\n",
+                           ( unsigned ) xStats.highWater,
+                           ( unsigned ) xStats.allocations ) );
+            }
+            else
+            {
+                LogInfo( ( "%u byte blocks: peak %u of %u, %u allocations, %u taken from the heap.\r\n",
+                           ( unsigned ) xStats.blockSize,
+                           ( unsigned ) xStats.highWater,
+                           ( unsigned ) xStats.blocks,
+                           ( unsigned ) xStats.allocations,
+                           ( unsigned ) xStats.fallbacks ) );
+            }
+        }
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* if ( democonfigHANDSHAKE_BENCHMARK_ITERATIONS > 0 ) */
+
+#if ( democonfigRECONNECT_BENCHMARK_ITERATIONS > 0 ) || ( democonfigHANDSHAKE_BENCHMARK_ITERATIONS > 0 )
+
+    static uint32_t prvTimeConnections( NetworkCredentials_t * pxNetworkCredentials,
+                                        NetworkContext_t * pxNetworkContext,
+                                        uint32_t ulIterations,
+                                        BaseType_t xFullHandshake )
+    {
+        uint32_t ulIteration, ulStartMs, ulTotalMs = 0U;
+        TlsTransportStatus_t xNetworkStatus;
+
+        for( ulIteration = 0U; ulIteration < ulIterations; ulIteration++ )
+        {
+            #if ( TLS_TRANSPORT_SESSION_CACHE_ENTRIES > 0 )
+                if( xFullHandshake == pdTRUE )
+                {
+                    TLS_FreeRTOS_ClearSessionCache();
+                }
+            #endif
+
+            ulStartMs = prvGetTimeMs();
+            xNetworkStatus = TLS_FreeRTOS_Connect( pxNetworkContext,
+                                                   democonfigMQTT_BROKER_ENDPOINT,
+                                                   democonfigMQTT_BROKER_PORT,
+                                                   pxNetworkCredentials,
+                                                   mqttexampleTRANSPORT_SEND_RECV_TIMEOUT_MS,
+                                                   mqttexampleTRANSPORT_SEND_RECV_TIMEOUT_MS );
+            ulTotalMs += prvGetTimeMs() - ulStartMs;
+            configASSERT( xNetworkStatus == TLS_TRANSPORT_SUCCESS );
+
+            TLS_FreeRTOS_Disconnect( pxNetworkContext );
+        }
+
+        /* Not used when the session cache is disabled. */
+        ( void ) xFullHandshake;
+
+        return ulTotalMs / ulIterations;
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* if ( democonfigRECONNECT_BENCHMARK_ITERATIONS > 0 ) || ( democonfigHANDSHAKE_BENCHMARK_ITERATIONS > 0 ) */
+
+#if ( democonfigPUBLISH_BENCHMARK_MESSAGES > 0 )
+
+    static void prvBenchmarkPublishes( MQTTContext_t * pxMQTTContext,
+                                       NetworkContext_t * pxNetworkContext )
+    {
+        uint32_t ulUncorkedMs, ulPerMessageMs, ulBatchedMs;
+
+        LogInfo( ( "Timing %u QoS 0 publishes to %s, uncorked, corked one by one, then corked together.\r\n",
+                   democonfigPUBLISH_BENCHMARK_MESSAGES,
+                   mqttexampleTOPIC ) );
+
+        ulUncorkedMs = prvTimePublishes( pxMQTTContext, pxNetworkContext, 0U );
+        ulPerMessageMs = prvTimePublishes( pxMQTTContext, pxNetworkContext, 1U );
+        ulBatchedMs = prvTimePublishes( pxMQTTContext, pxNetworkContext, democonfigPUBLISH_BENCHMARK_MESSAGES );
+
+        LogInfo( ( "Uncorked: %u ms. One TLS record per message: %u ms. Coalesced: %u ms.\r\n",
+                   ulUncorkedMs,
+                   ulPerMessageMs,
+                   ulBatchedMs ) );
+    }
+/*-----------------------------------------------------------*/
+
+    static uint32_t prvTimePublishes( MQTTContext_t * pxMQTTContext,
+                                      NetworkContext_t * pxNetworkContext,
+                                      uint32_t ulMessagesPerFlush )
+    {
+        uint32_t ulMessage, ulStartMs;
+        int32_t lFlushStatus;
+        MQTTStatus_t xResult;
+        MQTTPublishInfo_t xMQTTPublishInfo;
+
+        ( void ) memset( ( void * ) &xMQTTPublishInfo, 0x00, sizeof( xMQTTPublishInfo ) );
+
+        /* QoS 0 publishes have no acknowledgment, so this only measures the
+         * sending side. */
+        xMQTTPublishInfo.qos = MQTTQoS0;
+        xMQTTPublishInfo.pTopicName = mqttexampleTOPIC;
+        xMQTTPublishInfo.topicNameLength = ( uint16_t ) strlen( mqttexampleTOPIC );
+        xMQTTPublishInfo.pPayload = mqttexampleMESSAGE;
+        xMQTTPublishInfo.payloadLength = strlen( mqttexampleMESSAGE );
+
+        ulStartMs = prvGetTimeMs();
+
+        for( ulMessage = 0U; ulMessage < democonfigPUBLISH_BENCHMARK_MESSAGES; ulMessage++ )
+        {
+            if( ( ulMessagesPerFlush > 0U ) && ( ( ulMessage % ulMessagesPerFlush ) == 0U ) )
+            {
+                TLS_FreeRTOS_Cork( pxNetworkContext );
+            }
+
+            xResult = MQTT_Publish( pxMQTTContext, &xMQTTPublishInfo, 0U );
+            configASSERT( xResult == MQTTSuccess );
+
+            if( ( ulMessagesPerFlush > 0U ) &&
+                ( ( ( ( ulMessage + 1U ) % ulMessagesPerFlush ) == 0U ) ||
+                  ( ( ulMessage + 1U ) == democonfigPUBLISH_BENCHMARK_MESSAGES ) ) )
+            {
+                /* Retry until the socket has taken all the data. */
+                do
+                {
+                    lFlushStatus = TLS_FreeRTOS_Flush( pxNetworkContext );
+                } while( lFlushStatus > 0 );
+
+                configASSERT( lFlushStatus == 0 );
+            }
+        }
+
+        return prvGetTimeMs() - ulStartMs;
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* if ( democonfigPUBLISH_BENCHMARK_MESSAGES > 0 ) */
+
 static void prvCreateMQTTConnectionWithBroker( MQTTContext_t * pxMQTTContext,
                                                NetworkContext_t * pxNetworkContext )
 {
@@ -187,6 +187,15 @@
 /* The UDP port to which print messages are sent. */
 #define configPRINT_PORT                    ( 15000 )
 
+/* Keep the TLS session of the broker, so that the reconnections of the demo
+ * resume it rather than doing a full handshake. See mbedtls_transport_common.h. */
+#define TLS_TRANSPORT_SESSION_CACHE_ENTRIES    ( 1 )
+
+/* Give each TLS connection a buffer in which the sends between
+ * TLS_FreeRTOS_Cork() and TLS_FreeRTOS_Flush() are coalesced, as done by the
+ * publish benchmark of the demo. See mbedtls_transport_common.h. */
+#define TLS_TRANSPORT_SEND_BUFFER_SIZE         ( 1024 )
+
 
 #if ( defined( _MSC_VER ) && ( _MSC_VER <= 1600 ) && !defined( snprintf ) )
     /* Map to Windows names. */
@@ -143,4 +143,45 @@ extern void vLoggingPrintf( const char * pcFormatString,
  */
 #define democonfigNETWORK_BUFFER_SIZE    ( 1024U )
 
+/**
+ * @brief The number of connections to the broker to time, with a full TLS
+ * handshake and then with a resumed TLS session, before the demo starts.
+ *
+ * The average time of TLS_FreeRTOS_Connect() in each case is logged, which
+ * shows what the TLS session cache saves on each reconnection. The local
+ * Mosquitto broker of mqtt_broker_setup.txt resumes sessions by default.
+ * The benchmark is not run if this is 0, or not defined.
+ *
+ * #define democonfigRECONNECT_BENCHMARK_ITERATIONS    ( 20 )
+ */
+
+/**
+ * @brief The number of TLS connections to the broker to time with the memory
+ * of mbed TLS allocated from the FreeRTOS heap, and then from the mbed TLS
+ * memory pools (MBEDTLS_FREERTOS_POOL_ALLOCATOR in mbedtls_config.h), before
+ * the demo starts.
+ *
+ * Each connection does a full handshake. The average time of
+ * TLS_FreeRTOS_Connect() with each allocator is logged, with the peak use of
+ * each size class of the pools, which can be used to size the pools. The
+ * benchmark is not run if this is 0, or not defined.
+ *
+ * #define democonfigHANDSHAKE_BENCHMARK_ITERATIONS    ( 20 )
+ */
+
+/**
+ * @brief The number of QoS 0 messages to publish to the broker, one by one,
+ * then each in a TLS record of its own, then all together in as few TLS
+ * records as possible, before the demo subscribes to the topic.
+ *
+ * coreMQTT sends a publish as a header and a payload, so the first run costs
+ * two TLS records and TCP segments per message. The others cork the
+ * connection with TLS_FreeRTOS_Cork() and send the coalesced data with
+ * TLS_FreeRTOS_Flush(). The time of each run is logged. This requires
+ * TLS_TRANSPORT_SEND_BUFFER_SIZE in FreeRTOSConfig.h. The benchmark is not
+ * run if this is 0, or not defined.
+ *
+ * #define democonfigPUBLISH_BENCHMARK_MESSAGES    ( 1000 )
+ */
+
 #endif /* DEMO_CONFIG_H */
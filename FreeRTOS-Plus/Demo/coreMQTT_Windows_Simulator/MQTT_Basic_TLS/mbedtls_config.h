@@ -112,6 +112,10 @@ void mbedtls_platform_free( void * ptr );
 #define MBEDTLS_PLATFORM_CALLOC_MACRO    mbedtls_platform_calloc
 #define MBEDTLS_PLATFORM_FREE_MACRO      mbedtls_platform_free
 
+/* Allocate the small blocks of mbed TLS from pools rather than from the
+ * FreeRTOS heap. See mbedtls_freertos_pool.h. */
+#define MBEDTLS_FREERTOS_POOL_ALLOCATOR
+
 /* The network send and receive functions on FreeRTOS. */
 int mbedtls_platform_send( void * ctx,
                            const unsigned char * buf,
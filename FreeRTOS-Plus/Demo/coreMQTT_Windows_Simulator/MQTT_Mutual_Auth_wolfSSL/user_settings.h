@@ -31,6 +31,11 @@
 #define USE_WOLFSSL_IO
 #define WOLFSSL_IGNORE_FILE_WARN
 
+/* Receive and send the TLS records in static buffers of the maximum record
+ * size, in the WOLFSSL object, rather than in a buffer that is allocated,
+ * copied to and freed for each record. */
+#define LARGE_STATIC_BUFFERS
+
 /*-- Cipher related definitions  -----------------------------------------------
  *
  *
@@ -0,0 +1,502 @@
+/*
+ * FreeRTOS V202104.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file mbedtls_transport_common.c
+ * @brief TLS session cache and send buffer shared by the transport interface
+ * implementations that use mbedTLS.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* Shared mbed TLS transport header. */
+#include "mbedtls_transport_common.h"
+
+/* mbedTLS util includes. */
+#include "mbedtls_error.h"
+
+/*-----------------------------------------------------------*/
+
+#if ( TLS_TRANSPORT_SESSION_CACHE_ENTRIES > 0 )
+
+/**
+ * @brief Represents string to be logged when mbedTLS returned error
+ * does not contain a high-level code.
+ */
+    static const char * pNoHighLevelMbedTlsCodeStr = "<No-High-Level-Code>";
+
+/**
+ * @brief Represents string to be logged when mbedTLS returned error
+ * does not contain a low-level code.
+ */
+    static const char * pNoLowLevelMbedTlsCodeStr = "<No-Low-Level-Code>";
+
+/**
+ * @brief Utility for converting the high-level code in an mbedTLS error to string,
+ * if the code-contains a high-level code; otherwise, using a default string.
+ */
+    #define mbedtlsHighLevelCodeOrDefault( mbedTlsCode )        \
+        ( mbedtls_strerror_highlevel( mbedTlsCode ) != NULL ) ? \
+        mbedtls_strerror_highlevel( mbedTlsCode ) : pNoHighLevelMbedTlsCodeStr
+
+/**
+ * @brief Utility for converting the level-level code in an mbedTLS error to string,
+ * if the code-contains a level-level code; otherwise, using a default string.
+ */
+    #define mbedtlsLowLevelCodeOrDefault( mbedTlsCode )        \
+        ( mbedtls_strerror_lowlevel( mbedTlsCode ) != NULL ) ? \
+        mbedtls_strerror_lowlevel( mbedTlsCode ) : pNoLowLevelMbedTlsCodeStr
+
+/**
+ * @brief A TLS session kept for resumption, see #TLS_TRANSPORT_SESSION_CACHE_ENTRIES.
+ */
+    typedef struct SessionCacheEntry
+    {
+        char hostName[ TLS_TRANSPORT_SESSION_CACHE_HOST_NAME_LENGTH + 1 ]; /**< @brief Host name of the server, empty if the entry is not used. */
+        uint16_t port;                                                      /**< @brief Port of the server. */
+        uint32_t lastUsed;                                                  /**< @brief Value of #sessionCacheClock when the session was last offered or stored. */
+        mbedtls_ssl_session session;                                        /**< @brief The session negotiated with the server. */
+    } SessionCacheEntry_t;
+
+/**
+ * @brief The cached sessions.
+ */
+    static SessionCacheEntry_t sessionCache[ TLS_TRANSPORT_SESSION_CACHE_ENTRIES ];
+
+/**
+ * @brief Incremented each time an entry is used, to find the least recently
+ * used entry.
+ */
+    static uint32_t sessionCacheClock = 0U;
+
+/**
+ * @brief Counts of the handshakes, returned by #TLS_FreeRTOS_GetSessionCacheStats.
+ */
+    static TlsSessionCacheStats_t sessionCacheStats = { 0 };
+
+/**
+ * @brief Mutex protecting the cache, created when it is first locked.
+ */
+    static SemaphoreHandle_t sessionCacheMutex = NULL;
+
+    #if ( configSUPPORT_STATIC_ALLOCATION == 1 )
+
+/**
+ * @brief Storage for #sessionCacheMutex.
+ */
+        static StaticSemaphore_t sessionCacheMutexStorage;
+    #endif
+
+/**
+ * @brief Lock the session cache, creating its mutex the first time.
+ */
+    static void sessionCacheLock( void );
+
+/**
+ * @brief Unlock the session cache.
+ */
+    static void sessionCacheUnlock( void );
+
+/**
+ * @brief Find the entry of a server in the session cache. The cache must be
+ * locked.
+ *
+ * @param[in] pHostName Host name of the server.
+ * @param[in] port Port of the server.
+ *
+ * @return The entry, or NULL if no session is cached for the server.
+ */
+    static SessionCacheEntry_t * sessionCacheFind( const char * pHostName,
+                                                   uint16_t port );
+
+#endif /* if ( TLS_TRANSPORT_SESSION_CACHE_ENTRIES > 0 ) */
+
+/*-----------------------------------------------------------*/
+
+#if ( TLS_TRANSPORT_SESSION_CACHE_ENTRIES > 0 )
+
+    static void sessionCacheLock( void )
+    {
+        #if ( configSUPPORT_STATIC_ALLOCATION == 1 )
+            /* The mutex is created here so that the cache needs no
+             * initialization function. The critical section prevents two tasks
+             * from creating it. */
+            taskENTER_CRITICAL();
+            {
+                if( sessionCacheMutex == NULL )
+                {
+                    sessionCacheMutex = xSemaphoreCreateMutexStatic( &sessionCacheMutexStorage );
+                }
+            }
+            taskEXIT_CRITICAL();
+        #else
+            SemaphoreHandle_t newMutex = NULL;
+
+            /* The mutex is allocated outside the critical section, and only
+             * the first of the tasks that created one keeps it. */
+            if( sessionCacheMutex == NULL )
+            {
+                newMutex = xSemaphoreCreateMutex();
+
+                taskENTER_CRITICAL();
+                {
+                    if( sessionCacheMutex == NULL )
+                    {
+                        sessionCacheMutex = newMutex;
+                        newMutex = NULL;
+                    }
+                }
+                taskEXIT_CRITICAL();
+
+                if( newMutex != NULL )
+                {
+                    vSemaphoreDelete( newMutex );
+                }
+            }
+        #endif /* if ( configSUPPORT_STATIC_ALLOCATION == 1 ) */
+
+        configASSERT( sessionCacheMutex != NULL );
+        ( void ) xSemaphoreTake( sessionCacheMutex, portMAX_DELAY );
+    }
+/*-----------------------------------------------------------*/
+
+    static void sessionCacheUnlock( void )
+    {
+        ( void ) xSemaphoreGive( sessionCacheMutex );
+    }
+/*-----------------------------------------------------------*/
+
+    static SessionCacheEntry_t * sessionCacheFind( const char * pHostName,
+                                                   uint16_t port )
+    {
+        SessionCacheEntry_t * pEntry = NULL;
+        size_t i;
+
+        for( i = 0U; ( i < TLS_TRANSPORT_SESSION_CACHE_ENTRIES ) && ( pEntry == NULL ); i++ )
+        {
+            if( ( sessionCache[ i ].port == port ) &&
+                ( sessionCache[ i ].hostName[ 0 ] != '\0' ) &&
+                ( strcmp( sessionCache[ i ].hostName, pHostName ) == 0 ) )
+            {
+                pEntry = &( sessionCache[ i ] );
+            }
+        }
+
+        return pEntry;
+    }
+/*-----------------------------------------------------------*/
+
+    BaseType_t MbedtlsTransport_SessionCacheOffer( mbedtls_ssl_context * pSslContext,
+                                                   const char * pHostName,
+                                                   uint16_t port )
+    {
+        SessionCacheEntry_t * pEntry = NULL;
+        BaseType_t sessionOffered = pdFALSE;
+        int32_t mbedtlsError = 0;
+
+        configASSERT( pSslContext != NULL );
+        configASSERT( pHostName != NULL );
+
+        sessionCacheLock();
+
+        pEntry = sessionCacheFind( pHostName, port );
+
+        if( pEntry != NULL )
+        {
+            /* The session is copied into the SSL context. */
+            mbedtlsError = mbedtls_ssl_set_session( pSslContext,
+                                                    &( pEntry->session ) );
+
+            if( mbedtlsError != 0 )
+            {
+                LogWarn( ( "Failed to set the cached TLS session: mbedTLSError= %s : %s.",
+                           mbedtlsHighLevelCodeOrDefault( mbedtlsError ),
+                           mbedtlsLowLevelCodeOrDefault( mbedtlsError ) ) );
+            }
+            else
+            {
+                sessionCacheClock++;
+                pEntry->lastUsed = sessionCacheClock;
+                sessionOffered = pdTRUE;
+            }
+        }
+
+        sessionCacheUnlock();
+
+        return sessionOffered;
+    }
+/*-----------------------------------------------------------*/
+
+    void MbedtlsTransport_SessionCacheUpdate( const mbedtls_ssl_context * pSslContext,
+                                              const char * pHostName,
+                                              uint16_t port,
+                                              BaseType_t sessionOffered,
+                                              BaseType_t handshakeSucceeded )
+    {
+        SessionCacheEntry_t * pEntry = NULL;
+        const mbedtls_ssl_session * pSession = NULL;
+        BaseType_t resumable = pdFALSE;
+        size_t i;
+        int32_t mbedtlsError = 0;
+
+        configASSERT( pSslContext != NULL );
+        configASSERT( pHostName != NULL );
+
+        sessionCacheLock();
+
+        pEntry = sessionCacheFind( pHostName, port );
+
+        if( handshakeSucceeded == pdFALSE )
+        {
+            if( ( sessionOffered == pdTRUE ) && ( pEntry != NULL ) )
+            {
+                mbedtls_ssl_session_free( &( pEntry->session ) );
+                pEntry->hostName[ 0 ] = '\0';
+            }
+        }
+        else
+        {
+            pSession = pSslContext->session;
+
+            /* A resumed session keeps the master secret of the handshake
+             * that negotiated it, whether it was resumed by session ID or by
+             * session ticket. */
+            if( sessionOffered == pdFALSE )
+            {
+                sessionCacheStats.misses++;
+            }
+            else if( ( pEntry != NULL ) &&
+                     ( memcmp( pSession->master, pEntry->session.master, sizeof( pSession->master ) ) == 0 ) )
+            {
+                sessionCacheStats.hits++;
+            }
+            else
+            {
+                sessionCacheStats.rejected++;
+            }
+
+            /* Servers that support resumption give the session an ID or
+             * a ticket. */
+            resumable = ( pSession->id_len > 0U ) ? pdTRUE : pdFALSE;
+
+            #if defined( MBEDTLS_SSL_SESSION_TICKETS ) && defined( MBEDTLS_SSL_CLI_C )
+                if( pSession->ticket_len > 0U )
+                {
+                    resumable = pdTRUE;
+                }
+            #endif
+
+            if( ( resumable == pdFALSE ) ||
+                ( strlen( pHostName ) > TLS_TRANSPORT_SESSION_CACHE_HOST_NAME_LENGTH ) )
+            {
+                if( pEntry != NULL )
+                {
+                    mbedtls_ssl_session_free( &( pEntry->session ) );
+                    pEntry->hostName[ 0 ] = '\0';
+                }
+            }
+            else
+            {
+                if( pEntry == NULL )
+                {
+                    /* Replace an unused entry, or the least recently used. */
+                    pEntry = &( sessionCache[ 0 ] );
+
+                    for( i = 1U; ( i < TLS_TRANSPORT_SESSION_CACHE_ENTRIES ) && ( pEntry->hostName[ 0 ] != '\0' ); i++ )
+                    {
+                        if( ( sessionCache[ i ].hostName[ 0 ] == '\0' ) ||
+                            ( ( sessionCacheClock - sessionCache[ i ].lastUsed ) > ( sessionCacheClock - pEntry->lastUsed ) ) )
+                        {
+                            pEntry = &( sessionCache[ i ] );
+                        }
+                    }
+
+                    ( void ) strcpy( pEntry->hostName, pHostName );
+                    pEntry->port = port;
+                }
+
+                /* A resumed session can have a new ticket, so it is stored
+                 * as well. mbedtls_ssl_get_session copies into an initialized
+                 * session. */
+                mbedtls_ssl_session_free( &( pEntry->session ) );
+                mbedtls_ssl_session_init( &( pEntry->session ) );
+                mbedtlsError = mbedtls_ssl_get_session( pSslContext,
+                                                        &( pEntry->session ) );
+
+                if( mbedtlsError != 0 )
+                {
+                    LogWarn( ( "Failed to cache the TLS session: mbedTLSError= %s : %s.",
+                               mbedtlsHighLevelCodeOrDefault( mbedtlsError ),
+                               mbedtlsLowLevelCodeOrDefault( mbedtlsError ) ) );
+                    mbedtls_ssl_session_free( &( pEntry->session ) );
+                    pEntry->hostName[ 0 ] = '\0';
+                }
+                else
+                {
+                    sessionCacheClock++;
+                    pEntry->lastUsed = sessionCacheClock;
+                }
+            }
+        }
+
+        sessionCacheUnlock();
+    }
+/*-----------------------------------------------------------*/
+
+    void TLS_FreeRTOS_GetSessionCacheStats( TlsSessionCacheStats_t * pStats )
+    {
+        configASSERT( pStats != NULL );
+
+        sessionCacheLock();
+        *pStats = sessionCacheStats;
+        sessionCacheUnlock();
+    }
+/*-----------------------------------------------------------*/
+
+    void TLS_FreeRTOS_ClearSessionCache( void )
+    {
+        size_t i;
+
+        sessionCacheLock();
+
+        for( i = 0U; i < TLS_TRANSPORT_SESSION_CACHE_ENTRIES; i++ )
+        {
+            /* This also erases the master secret of the session. */
+            mbedtls_ssl_session_free( &( sessionCache[ i ].session ) );
+            sessionCache[ i ].hostName[ 0 ] = '\0';
+        }
+
+        sessionCacheUnlock();
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* if ( TLS_TRANSPORT_SESSION_CACHE_ENTRIES > 0 ) */
+
+#if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+
+    int32_t MbedtlsTransport_SendBufferFlush( mbedtls_ssl_context * pSslContext,
+                                              TlsSendBuffer_t * pSendBuffer )
+    {
+        int32_t tlsStatus = 0;
+        size_t bytesSent = 0U;
+        size_t bytesToWrite = 0U;
+
+        configASSERT( pSslContext != NULL );
+        configASSERT( pSendBuffer != NULL );
+
+        /* A record holds at most MBEDTLS_SSL_OUT_CONTENT_LEN bytes, so the
+         * buffer can take more than one write. */
+        while( ( bytesSent < pSendBuffer->length ) && ( tlsStatus >= 0 ) )
+        {
+            /* A write that timed out must be retried with the same length,
+             * even if data was added to the buffer since. */
+            bytesToWrite = pSendBuffer->retryLength;
+
+            if( bytesToWrite == 0U )
+            {
+                bytesToWrite = pSendBuffer->length - bytesSent;
+            }
+
+            tlsStatus = ( int32_t ) mbedtls_ssl_write( pSslContext,
+                                                       &( pSendBuffer->data[ bytesSent ] ),
+                                                       bytesToWrite );
+
+            if( tlsStatus > 0 )
+            {
+                bytesSent += ( size_t ) tlsStatus;
+                pSendBuffer->retryLength = 0U;
+            }
+            else if( ( tlsStatus == MBEDTLS_ERR_SSL_TIMEOUT ) ||
+                     ( tlsStatus == MBEDTLS_ERR_SSL_WANT_READ ) ||
+                     ( tlsStatus == MBEDTLS_ERR_SSL_WANT_WRITE ) )
+            {
+                pSendBuffer->retryLength = bytesToWrite;
+            }
+            else
+            {
+                /* Empty else for MISRA 15.7 compliance. */
+            }
+        }
+
+        if( bytesSent > 0U )
+        {
+            pSendBuffer->length -= bytesSent;
+            ( void ) memmove( pSendBuffer->data,
+                              &( pSendBuffer->data[ bytesSent ] ),
+                              pSendBuffer->length );
+        }
+
+        return tlsStatus;
+    }
+/*-----------------------------------------------------------*/
+
+    int32_t MbedtlsTransport_SendBufferAppend( mbedtls_ssl_context * pSslContext,
+                                               TlsSendBuffer_t * pSendBuffer,
+                                               const void * pBuffer,
+                                               size_t bytesToSend )
+    {
+        int32_t tlsStatus = 0;
+
+        configASSERT( pSslContext != NULL );
+        configASSERT( pSendBuffer != NULL );
+
+        if( bytesToSend > ( TLS_TRANSPORT_SEND_BUFFER_SIZE - pSendBuffer->length ) )
+        {
+            tlsStatus = MbedtlsTransport_SendBufferFlush( pSslContext, pSendBuffer );
+        }
+
+        if( tlsStatus < 0 )
+        {
+            /* The buffered data must be sent first, nothing is taken. */
+        }
+        else if( bytesToSend > TLS_TRANSPORT_SEND_BUFFER_SIZE )
+        {
+            /* Too large to be coalesced, the buffer is empty so it can be
+             * written as it is. */
+            tlsStatus = ( int32_t ) mbedtls_ssl_write( pSslContext,
+                                                       pBuffer,
+                                                       bytesToSend );
+        }
+        else
+        {
+            ( void ) memcpy( &( pSendBuffer->data[ pSendBuffer->length ] ),
+                             pBuffer,
+                             bytesToSend );
+            pSendBuffer->length += bytesToSend;
+            tlsStatus = ( int32_t ) bytesToSend;
+        }
+
+        return tlsStatus;
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 ) */
@@ -0,0 +1,247 @@
+/*
+ * FreeRTOS V202104.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file mbedtls_transport_common.h
+ * @brief TLS session cache and send buffer shared by the transport interface
+ * implementations that use mbedTLS.
+ */
+
+#ifndef MBEDTLS_TRANSPORT_COMMON_H
+#define MBEDTLS_TRANSPORT_COMMON_H
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the TLS transports. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "TlsTransport"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_ERROR
+#endif
+
+/* Prototype for the function used to print to console on Windows simulator
+ * of FreeRTOS.
+ * The function prints to the console before the network is connected;
+ * then a UDP port after the network has connected. */
+extern void vLoggingPrintf( const char * pcFormatString,
+                            ... );
+
+/* Map the SdkLog macro to the logging function to enable logging
+ * on Windows simulator. */
+#ifndef SdkLog
+    #define SdkLog( message )    vLoggingPrintf message
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* FreeRTOS include. */
+#include "FreeRTOS.h"
+
+/* mbed TLS include. */
+#include "mbedtls/ssl.h"
+
+/**
+ * @brief The number of servers whose TLS session is kept, so that the next
+ * connection to the same server can resume the session.
+ *
+ * When this is greater than 0, the session negotiated with a server is kept in
+ * a cache, keyed by the host name and port passed to #TLS_FreeRTOS_Connect,
+ * and offered in the handshake of the next connection to the same host name
+ * and port. If the server resumes the session, the handshake is abbreviated:
+ * there is no key exchange and no certificate verification, and it takes one
+ * round trip less. Session IDs are resumed, as are session tickets when
+ * MBEDTLS_SSL_SESSION_TICKETS is defined in the mbed TLS configuration. When
+ * the cache is full, the least recently used session is replaced.
+ *
+ * The cache is disabled by default. To enable it, define this in
+ * FreeRTOSConfig.h.
+ *
+ * The cache is protected by a mutex, created when the cache is first used.
+ * It is statically allocated if configSUPPORT_STATIC_ALLOCATION is 1, and
+ * allocated from the FreeRTOS heap otherwise.
+ *
+ * @note A resumed session was authenticated with the credentials of the
+ * connection that negotiated it, so all the connections to a host name and
+ * port must use the same credentials, whether they are passed to the
+ * transport or kept by PKCS #11. Each cached session holds a copy of the
+ * server certificate, unless MBEDTLS_SSL_KEEP_PEER_CERTIFICATE is disabled.
+ */
+#ifndef TLS_TRANSPORT_SESSION_CACHE_ENTRIES
+    #define TLS_TRANSPORT_SESSION_CACHE_ENTRIES    0
+#endif
+
+/**
+ * @brief The length of the longest host name sessions are cached for, see
+ * #TLS_TRANSPORT_SESSION_CACHE_ENTRIES.
+ */
+#ifndef TLS_TRANSPORT_SESSION_CACHE_HOST_NAME_LENGTH
+    #define TLS_TRANSPORT_SESSION_CACHE_HOST_NAME_LENGTH    64
+#endif
+
+/**
+ * @brief The size of the buffer in which the data sent on a corked connection
+ * is coalesced, see #TLS_FreeRTOS_Cork.
+ *
+ * When this is greater than 0, each connection has a buffer of this size, in
+ * its #TlsTransportParams_t, and the data of the sends between
+ * #TLS_FreeRTOS_Cork and #TLS_FreeRTOS_Flush is copied to it, and sent in as
+ * few TLS records as possible. For example an MQTT publish, which coreMQTT
+ * sends as a header and a payload, then costs one record, one MAC and one TCP
+ * segment rather than two. Up to the maximum record size of mbed TLS
+ * (MBEDTLS_SSL_OUT_CONTENT_LEN), a larger buffer coalesces more data.
+ *
+ * Corking is disabled by default. To enable it, define this in
+ * FreeRTOSConfig.h.
+ */
+#ifndef TLS_TRANSPORT_SEND_BUFFER_SIZE
+    #define TLS_TRANSPORT_SEND_BUFFER_SIZE    0
+#endif
+
+#if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+
+/**
+ * @brief The data sent on a corked connection and not yet written to TLS.
+ */
+    typedef struct TlsSendBuffer
+    {
+        uint8_t data[ TLS_TRANSPORT_SEND_BUFFER_SIZE ]; /**< @brief The data, from its start. */
+        size_t length;                                  /**< @brief The number of bytes in data. */
+        size_t retryLength;                             /**< @brief The length of the write of data that timed out and must be retried, else 0. */
+    } TlsSendBuffer_t;
+
+/**
+ * @brief Write the data in a send buffer to TLS.
+ *
+ * The data that could not be written, because the socket timed out or
+ * because of an error, is kept at the start of the buffer.
+ *
+ * @param[in] pSslContext SSL context of the connection.
+ * @param[in] pSendBuffer The send buffer of the connection.
+ *
+ * @return A value >= 0 if the buffer was emptied, else the mbed TLS error.
+ */
+    int32_t MbedtlsTransport_SendBufferFlush( mbedtls_ssl_context * pSslContext,
+                                              TlsSendBuffer_t * pSendBuffer );
+
+/**
+ * @brief Copy data to the send buffer of a corked connection, after making
+ * room for it by writing the buffer to TLS if needed.
+ *
+ * @param[in] pSslContext SSL context of the connection.
+ * @param[in] pSendBuffer The send buffer of the connection.
+ * @param[in] pBuffer Buffer containing the bytes to send.
+ * @param[in] bytesToSend Number of bytes to send from the buffer.
+ *
+ * @return Number of bytes (> 0) taken from pBuffer, else the mbed TLS error.
+ */
+    int32_t MbedtlsTransport_SendBufferAppend( mbedtls_ssl_context * pSslContext,
+                                               TlsSendBuffer_t * pSendBuffer,
+                                               const void * pBuffer,
+                                               size_t bytesToSend );
+
+#endif /* if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 ) */
+
+#if ( TLS_TRANSPORT_SESSION_CACHE_ENTRIES > 0 )
+
+/**
+ * @brief Counts of the handshakes of the connections to servers, depending on
+ * whether a cached TLS session was resumed.
+ */
+    typedef struct TlsSessionCacheStats
+    {
+        uint32_t hits;     /**< @brief Abbreviated handshakes, the server resumed the cached session. */
+        uint32_t misses;   /**< @brief Full handshakes, no session was cached for the server. */
+        uint32_t rejected; /**< @brief Full handshakes, the server did not resume the cached session. */
+    } TlsSessionCacheStats_t;
+
+/**
+ * @brief Offer the session cached for a server, if any, in the handshake of a
+ * connection to the server.
+ *
+ * @param[in] pSslContext SSL context of the connection, after mbedtls_ssl_setup.
+ * @param[in] pHostName Host name of the server.
+ * @param[in] port Port of the server.
+ *
+ * @return pdTRUE if a session was offered, pdFALSE otherwise.
+ */
+    BaseType_t MbedtlsTransport_SessionCacheOffer( mbedtls_ssl_context * pSslContext,
+                                                   const char * pHostName,
+                                                   uint16_t port );
+
+/**
+ * @brief Update the session cache and its counts after a handshake with a server.
+ *
+ * After a successful handshake, the session negotiated is stored, in place of
+ * the session cached for the server or of the least recently used session.
+ * After a failed handshake, the session offered is removed, in case the
+ * server did not accept it.
+ *
+ * @param[in] pSslContext SSL context of the connection.
+ * @param[in] pHostName Host name of the server.
+ * @param[in] port Port of the server.
+ * @param[in] sessionOffered The value #MbedtlsTransport_SessionCacheOffer returned.
+ * @param[in] handshakeSucceeded pdTRUE if the handshake succeeded.
+ */
+    void MbedtlsTransport_SessionCacheUpdate( const mbedtls_ssl_context * pSslContext,
+                                              const char * pHostName,
+                                              uint16_t port,
+                                              BaseType_t sessionOffered,
+                                              BaseType_t handshakeSucceeded );
+
+/**
+ * @brief Get the counts of the handshakes since the device started, to see
+ * how often the TLS session cache saves a full handshake.
+ *
+ * @param[out] pStats The counts.
+ */
+    void TLS_FreeRTOS_GetSessionCacheStats( TlsSessionCacheStats_t * pStats );
+
+/**
+ * @brief Remove all the sessions from the TLS session cache, so the next
+ * connection to each server does a full handshake.
+ *
+ * This can be used when the credentials change, or to measure the time of
+ * full handshakes.
+ */
+    void TLS_FreeRTOS_ClearSessionCache( void );
+
+#endif /* if ( TLS_TRANSPORT_SESSION_CACHE_ENTRIES > 0 ) */
+
+#endif /* ifndef MBEDTLS_TRANSPORT_COMMON_H */
@@ -34,6 +34,7 @@
 
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"
+#include "task.h"
 
 #include "sockets_wrapper.h"
 
@@ -49,6 +50,132 @@
 
 /*-----------------------------------------------------------*/
 
+#if ( ipconfigDNS_USE_CALLBACKS != 0 )
+
+/**
+ * @brief Called by the IP task when the DNS lookup of a connection started
+ * with #Sockets_ConnectStart is complete.
+ *
+ * @param[in] pcName The host name that was looked up.
+ * @param[in] pvSearchID The #SocketsConnectContext_t of the connection.
+ * @param[in] ulIPAddress The IP address of the host, or 0 if the lookup
+ * failed or timed out.
+ */
+    static void connectLookupComplete( const char * pcName,
+                                       void * pvSearchID,
+                                       uint32_t ulIPAddress );
+#endif
+
+/**
+ * @brief Create the socket of a connection started with #Sockets_ConnectStart
+ * once the address of the server is known, and send the TCP SYN.
+ *
+ * @param[in] pConnectContext The connection.
+ *
+ * @return #SOCKETS_CONNECT_CONNECTING, or #SOCKETS_CONNECT_FAILED.
+ */
+static SocketsConnectState_t connectStartTcp( SocketsConnectContext_t * pConnectContext );
+
+/**
+ * @brief Check whether a connection started with #Sockets_ConnectStart took
+ * longer than its timeout.
+ *
+ * @param[in] pConnectContext The connection.
+ *
+ * @return pdTRUE if the connection timed out, else pdFALSE.
+ */
+static BaseType_t connectTimedOut( const SocketsConnectContext_t * pConnectContext );
+
+/*-----------------------------------------------------------*/
+
+#if ( ipconfigDNS_USE_CALLBACKS != 0 )
+
+    static void connectLookupComplete( const char * pcName,
+                                       void * pvSearchID,
+                                       uint32_t ulIPAddress )
+    {
+        SocketsConnectContext_t * pConnectContext = ( SocketsConnectContext_t * ) pvSearchID;
+
+        ( void ) pcName;
+
+        /* The address is read by the task once the lookup is flagged complete. */
+        pConnectContext->serverAddress = ulIPAddress;
+        pConnectContext->addressLookedUp = pdTRUE;
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* if ( ipconfigDNS_USE_CALLBACKS != 0 ) */
+
+static SocketsConnectState_t connectStartTcp( SocketsConnectContext_t * pConnectContext )
+{
+    SocketsConnectState_t connectState = SOCKETS_CONNECT_CONNECTING;
+    BaseType_t socketStatus = 0;
+    struct freertos_sockaddr serverAddress = { 0 };
+
+    if( pConnectContext->serverAddress == 0U )
+    {
+        LogError( ( "Failed to connect to server: DNS resolution failed: Hostname=%s.",
+                    pConnectContext->pHostName ) );
+        connectState = SOCKETS_CONNECT_FAILED;
+    }
+    else
+    {
+        pConnectContext->tcpSocket = FreeRTOS_socket( FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP );
+
+        if( pConnectContext->tcpSocket == FREERTOS_INVALID_SOCKET )
+        {
+            LogError( ( "Failed to create new socket." ) );
+            connectState = SOCKETS_CONNECT_FAILED;
+        }
+    }
+
+    if( connectState == SOCKETS_CONNECT_CONNECTING )
+    {
+        /* With a receive timeout of 0, FreeRTOS_connect() only sends the SYN,
+         * and the IP task completes the connection. */
+        Sockets_SetTimeouts( pConnectContext->tcpSocket, 0U, 0U );
+
+        serverAddress.sin_family = FREERTOS_AF_INET;
+        serverAddress.sin_port = FreeRTOS_htons( pConnectContext->port );
+        serverAddress.sin_addr = pConnectContext->serverAddress;
+        serverAddress.sin_len = ( uint8_t ) sizeof( serverAddress );
+
+        LogDebug( ( "Creating TCP Connection to %s.", pConnectContext->pHostName ) );
+        socketStatus = FreeRTOS_connect( pConnectContext->tcpSocket, &serverAddress, sizeof( serverAddress ) );
+
+        if( ( socketStatus != 0 ) && ( socketStatus != -pdFREERTOS_ERRNO_EWOULDBLOCK ) )
+        {
+            LogError( ( "Failed to connect to server: FreeRTOS_Connect failed: ReturnCode=%d,"
+                        " Hostname=%s, Port=%u.",
+                        socketStatus,
+                        pConnectContext->pHostName,
+                        pConnectContext->port ) );
+            ( void ) FreeRTOS_closesocket( pConnectContext->tcpSocket );
+            pConnectContext->tcpSocket = FREERTOS_INVALID_SOCKET;
+            connectState = SOCKETS_CONNECT_FAILED;
+        }
+    }
+
+    return connectState;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t connectTimedOut( const SocketsConnectContext_t * pConnectContext )
+{
+    BaseType_t timedOut = pdFALSE;
+
+    if( ( xTaskGetTickCount() - pConnectContext->startTime ) >= pConnectContext->connectTimeout )
+    {
+        LogError( ( "Failed to connect to server: Timed out: Hostname=%s, Port=%u.",
+                    pConnectContext->pHostName,
+                    pConnectContext->port ) );
+        timedOut = pdTRUE;
+    }
+
+    return timedOut;
+}
+/*-----------------------------------------------------------*/
+
 BaseType_t Sockets_Connect( Socket_t * pTcpSocket,
                             const char * pHostName,
                             uint16_t port,
@@ -58,7 +185,6 @@ BaseType_t Sockets_Connect( Socket_t * pTcpSocket,
     Socket_t tcpSocket = FREERTOS_INVALID_SOCKET;
     BaseType_t socketStatus = 0;
     struct freertos_sockaddr serverAddress = { 0 };
-    TickType_t transportTimeout = 0;
 
     /* Create a new TCP socket. */
     tcpSocket = FreeRTOS_socket( FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP );
@@ -105,23 +231,7 @@ BaseType_t Sockets_Connect( Socket_t * pTcpSocket,
 
     if( socketStatus == 0 )
     {
-        /* Set socket receive timeout. */
-        transportTimeout = pdMS_TO_TICKS( receiveTimeoutMs );
-        /* Setting the receive block time cannot fail. */
-        ( void ) FreeRTOS_setsockopt( tcpSocket,
-                                      0,
-                                      FREERTOS_SO_RCVTIMEO,
-                                      &transportTimeout,
-                                      sizeof( TickType_t ) );
-
-        /* Set socket send timeout. */
-        transportTimeout = pdMS_TO_TICKS( sendTimeoutMs );
-        /* Setting the send block time cannot fail. */
-        ( void ) FreeRTOS_setsockopt( tcpSocket,
-                                      0,
-                                      FREERTOS_SO_SNDTIMEO,
-                                      &transportTimeout,
-                                      sizeof( TickType_t ) );
+        Sockets_SetTimeouts( tcpSocket, receiveTimeoutMs, sendTimeoutMs );
     }
 
     /* Clean up on failure. */
@@ -144,6 +254,284 @@ BaseType_t Sockets_Connect( Socket_t * pTcpSocket,
 
 /*-----------------------------------------------------------*/
 
+BaseType_t Sockets_ConnectStart( SocketsConnectContext_t * pConnectContext,
+                                 const char * pHostName,
+                                 uint16_t port,
+                                 uint32_t connectTimeoutMs )
+{
+    BaseType_t socketStatus = 0;
+    uint32_t serverAddress = 0U;
+
+    configASSERT( pConnectContext != NULL );
+    configASSERT( pHostName != NULL );
+    configASSERT( connectTimeoutMs > 0U );
+
+    pConnectContext->tcpSocket = FREERTOS_INVALID_SOCKET;
+    pConnectContext->state = SOCKETS_CONNECT_RESOLVING;
+    pConnectContext->pHostName = pHostName;
+    pConnectContext->port = port;
+    pConnectContext->startTime = xTaskGetTickCount();
+    pConnectContext->connectTimeout = pdMS_TO_TICKS( connectTimeoutMs );
+    pConnectContext->serverAddress = 0U;
+    pConnectContext->addressLookedUp = pdFALSE;
+
+    #if ( ipconfigDNS_USE_CALLBACKS != 0 )
+        /* The address is returned straight away if it is known, else
+         * connectLookupComplete() is called when the lookup completes. */
+        serverAddress = FreeRTOS_gethostbyname_a( pHostName,
+                                                  connectLookupComplete,
+                                                  ( void * ) pConnectContext,
+                                                  pConnectContext->connectTimeout );
+
+        if( serverAddress != 0U )
+        {
+            FreeRTOS_gethostbyname_cancel( ( void * ) pConnectContext );
+            pConnectContext->serverAddress = serverAddress;
+            pConnectContext->state = connectStartTcp( pConnectContext );
+        }
+    #else
+        serverAddress = FreeRTOS_gethostbyname( pHostName );
+        pConnectContext->serverAddress = serverAddress;
+        pConnectContext->state = connectStartTcp( pConnectContext );
+    #endif /* if ( ipconfigDNS_USE_CALLBACKS != 0 ) */
+
+    if( pConnectContext->state == SOCKETS_CONNECT_FAILED )
+    {
+        socketStatus = FREERTOS_SOCKETS_WRAPPER_NETWORK_ERROR;
+    }
+
+    return socketStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+SocketsConnectState_t Sockets_ConnectPoll( SocketsConnectContext_t * pConnectContext )
+{
+    uint8_t peekBuffer = 0U;
+    BaseType_t recvStatus = 0;
+
+    configASSERT( pConnectContext != NULL );
+
+    if( pConnectContext->state == SOCKETS_CONNECT_RESOLVING )
+    {
+        if( pConnectContext->addressLookedUp == pdTRUE )
+        {
+            pConnectContext->state = connectStartTcp( pConnectContext );
+        }
+        else if( connectTimedOut( pConnectContext ) == pdTRUE )
+        {
+            Sockets_ConnectCancel( pConnectContext );
+        }
+        else
+        {
+            /* Empty else for MISRA 15.7 compliance. */
+        }
+    }
+    else if( pConnectContext->state == SOCKETS_CONNECT_CONNECTING )
+    {
+        /* A connection that was refused or reset, or whose SYN was not
+         * answered, is closed by the IP task, and then FreeRTOS_recv()
+         * returns an error. Peeking cannot consume data, should the
+         * connection be established after the check. */
+        recvStatus = FreeRTOS_recv( pConnectContext->tcpSocket,
+                                    &peekBuffer,
+                                    sizeof( peekBuffer ),
+                                    FREERTOS_MSG_PEEK | FREERTOS_MSG_DONTWAIT );
+
+        if( FreeRTOS_issocketconnected( pConnectContext->tcpSocket ) == pdTRUE )
+        {
+            LogInfo( ( "Established TCP connection with %s.", pConnectContext->pHostName ) );
+            pConnectContext->state = SOCKETS_CONNECT_CONNECTED;
+        }
+        else if( ( recvStatus < 0 ) && ( recvStatus != -pdFREERTOS_ERRNO_EWOULDBLOCK ) )
+        {
+            LogError( ( "Failed to connect to server: Connection closed: ReturnCode=%d,"
+                        " Hostname=%s, Port=%u.",
+                        recvStatus,
+                        pConnectContext->pHostName,
+                        pConnectContext->port ) );
+            Sockets_ConnectCancel( pConnectContext );
+        }
+        else if( connectTimedOut( pConnectContext ) == pdTRUE )
+        {
+            Sockets_ConnectCancel( pConnectContext );
+        }
+        else
+        {
+            /* Empty else for MISRA 15.7 compliance. */
+        }
+    }
+    else
+    {
+        /* Empty else for MISRA 15.7 compliance. */
+    }
+
+    return pConnectContext->state;
+}
+
+/*-----------------------------------------------------------*/
+
+void Sockets_ConnectCancel( SocketsConnectContext_t * pConnectContext )
+{
+    configASSERT( pConnectContext != NULL );
+
+    if( pConnectContext->state == SOCKETS_CONNECT_RESOLVING )
+    {
+        #if ( ipconfigDNS_USE_CALLBACKS != 0 )
+            /* After this, connectLookupComplete() is no longer called. */
+            FreeRTOS_gethostbyname_cancel( ( void * ) pConnectContext );
+        #endif
+        pConnectContext->state = SOCKETS_CONNECT_FAILED;
+    }
+    else if( pConnectContext->state == SOCKETS_CONNECT_CONNECTING )
+    {
+        ( void ) FreeRTOS_closesocket( pConnectContext->tcpSocket );
+        pConnectContext->tcpSocket = FREERTOS_INVALID_SOCKET;
+        pConnectContext->state = SOCKETS_CONNECT_FAILED;
+    }
+    else
+    {
+        /* Empty else for MISRA 15.7 compliance. */
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void Sockets_SetTimeouts( Socket_t tcpSocket,
+                          uint32_t receiveTimeoutMs,
+                          uint32_t sendTimeoutMs )
+{
+    TickType_t transportTimeout = 0;
+
+    /* Set socket receive timeout. */
+    transportTimeout = pdMS_TO_TICKS( receiveTimeoutMs );
+    /* Setting the receive block time cannot fail. */
+    ( void ) FreeRTOS_setsockopt( tcpSocket,
+                                  0,
+                                  FREERTOS_SO_RCVTIMEO,
+                                  &transportTimeout,
+                                  sizeof( TickType_t ) );
+
+    /* Set socket send timeout. */
+    transportTimeout = pdMS_TO_TICKS( sendTimeoutMs );
+    /* Setting the send block time cannot fail. */
+    ( void ) FreeRTOS_setsockopt( tcpSocket,
+                                  0,
+                                  FREERTOS_SO_SNDTIMEO,
+                                  &transportTimeout,
+                                  sizeof( TickType_t ) );
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t Sockets_Writev( Socket_t tcpSocket,
+                        const SocketsOutVector_t * pIoVec,
+                        size_t ioVecCount )
+{
+    int32_t socketStatus = 0;
+    int32_t bytesQueued = 0;
+    size_t vectorIndex = 0U;
+    size_t offset = 0U;
+    size_t bytesToCopy = 0U;
+    size_t bytesCopied = 0U;
+    BaseType_t spaceAvailable = 0;
+    uint8_t * pTxHead = NULL;
+    const uint8_t * pVectorBuffer = NULL;
+
+    configASSERT( ( pIoVec != NULL ) || ( ioVecCount == 0U ) );
+
+    /* Skip the leading empty buffers. */
+    while( ( vectorIndex < ioVecCount ) && ( pIoVec[ vectorIndex ].bufferLength == 0U ) )
+    {
+        vectorIndex++;
+    }
+
+    while( ( vectorIndex < ioVecCount ) && ( socketStatus >= 0 ) )
+    {
+        pTxHead = FreeRTOS_get_tx_head( tcpSocket, &spaceAvailable );
+
+        if( ( pTxHead != NULL ) && ( spaceAvailable > 0 ) )
+        {
+            /* Gather as much as fits before the end of the stream buffer. */
+            bytesCopied = 0U;
+
+            while( ( vectorIndex < ioVecCount ) && ( bytesCopied < ( size_t ) spaceAvailable ) )
+            {
+                pVectorBuffer = ( const uint8_t * ) pIoVec[ vectorIndex ].pBuffer;
+                bytesToCopy = pIoVec[ vectorIndex ].bufferLength - offset;
+
+                if( bytesToCopy > ( ( size_t ) spaceAvailable - bytesCopied ) )
+                {
+                    bytesToCopy = ( size_t ) spaceAvailable - bytesCopied;
+                }
+
+                if( bytesToCopy > 0U )
+                {
+                    ( void ) memcpy( &( pTxHead[ bytesCopied ] ), &( pVectorBuffer[ offset ] ), bytesToCopy );
+                    bytesCopied += bytesToCopy;
+                    offset += bytesToCopy;
+                }
+
+                if( offset == pIoVec[ vectorIndex ].bufferLength )
+                {
+                    vectorIndex++;
+                    offset = 0U;
+                }
+            }
+
+            /* With a NULL buffer, FreeRTOS_send() only adds the bytes already
+             * written at the head of the stream buffer. */
+            socketStatus = ( int32_t ) FreeRTOS_send( tcpSocket, NULL, bytesCopied, 0 );
+        }
+        else if( bytesQueued > 0 )
+        {
+            /* The stream buffer is full, return what was queued. */
+            break;
+        }
+        else
+        {
+            /* Let FreeRTOS_send() create the stream buffer, or wait for space
+             * in it, and report the errors. */
+            pVectorBuffer = ( const uint8_t * ) pIoVec[ vectorIndex ].pBuffer;
+            socketStatus = ( int32_t ) FreeRTOS_send( tcpSocket,
+                                                      &( pVectorBuffer[ offset ] ),
+                                                      pIoVec[ vectorIndex ].bufferLength - offset,
+                                                      0 );
+
+            if( socketStatus > 0 )
+            {
+                offset += ( size_t ) socketStatus;
+
+                if( offset == pIoVec[ vectorIndex ].bufferLength )
+                {
+                    vectorIndex++;
+                    offset = 0U;
+                }
+            }
+        }
+
+        if( socketStatus > 0 )
+        {
+            bytesQueued += socketStatus;
+        }
+
+        /* Skip the empty buffers. */
+        while( ( vectorIndex < ioVecCount ) && ( pIoVec[ vectorIndex ].bufferLength == 0U ) )
+        {
+            vectorIndex++;
+        }
+    }
+
+    if( bytesQueued > 0 )
+    {
+        socketStatus = bytesQueued;
+    }
+
+    return socketStatus;
+}
+
+/*-----------------------------------------------------------*/
+
 void Sockets_Disconnect( Socket_t tcpSocket )
 {
     BaseType_t waitForShutdownLoopCount = 0;
@@ -75,6 +75,42 @@ extern void vLoggingPrintf( const char * pcFormatString,
 
 /************ End of logging configuration ****************/
 
+/**
+ * @brief A buffer of data to send with #Sockets_Writev.
+ */
+typedef struct SocketsOutVector
+{
+    const void * pBuffer; /**< @brief The data to send. */
+    size_t bufferLength;  /**< @brief The number of bytes to send from pBuffer. */
+} SocketsOutVector_t;
+
+/**
+ * @brief The progress of a connection started with #Sockets_ConnectStart.
+ */
+typedef enum SocketsConnectState
+{
+    SOCKETS_CONNECT_RESOLVING = 0, /**< Waiting for the DNS lookup of the host name. */
+    SOCKETS_CONNECT_CONNECTING,    /**< Waiting for the TCP handshake. */
+    SOCKETS_CONNECT_CONNECTED,     /**< The connection is established. */
+    SOCKETS_CONNECT_FAILED         /**< The connection failed or timed out, or was cancelled. */
+} SocketsConnectState_t;
+
+/**
+ * @brief A connection that is established without blocking the task, see
+ * #Sockets_ConnectStart. The members are only modified by the socket wrapper.
+ */
+typedef struct SocketsConnectContext
+{
+    Socket_t tcpSocket;                  /**< @brief The socket, once the host name is resolved. */
+    SocketsConnectState_t state;         /**< @brief The progress of the connection. */
+    const char * pHostName;              /**< @brief The host name of the server. */
+    uint16_t port;                       /**< @brief The port of the server. */
+    TickType_t startTime;                /**< @brief The tick count when the connection was started. */
+    TickType_t connectTimeout;           /**< @brief The time, in ticks, the connection may take. */
+    volatile uint32_t serverAddress;     /**< @brief The IP address of the server, set by the DNS lookup. */
+    volatile BaseType_t addressLookedUp; /**< @brief pdTRUE once the DNS lookup is complete. */
+} SocketsConnectContext_t;
+
 /**
  * @brief Establish a connection to server.
  *
@@ -94,6 +130,94 @@ BaseType_t Sockets_Connect( Socket_t * pTcpSocket,
                             uint32_t receiveTimeoutMs,
                             uint32_t sendTimeoutMs );
 
+/**
+ * @brief Start to establish a connection to a server, without waiting for it.
+ *
+ * The connection is established by the IP task, while the application calls
+ * #Sockets_ConnectPoll until it is connected or failed, so one task can
+ * establish several connections at the same time, for example from a loop
+ * that polls each of them, then blocks for a tick or in FreeRTOS_select().
+ *
+ * When ipconfigDNS_USE_CALLBACKS is 1, the host name is looked up without
+ * blocking as well. Otherwise the lookup blocks, unless the address is in the
+ * DNS cache or the host name is an IP address.
+ *
+ * @param[out] pConnectContext The connection to start.
+ * @param[in] pHostName Server hostname to connect to. It must remain valid
+ * until the connection is established or failed.
+ * @param[in] port Server port to connect to.
+ * @param[in] connectTimeoutMs Time (in milliseconds, > 0) from this call after
+ * which the connection fails if it is not established.
+ *
+ * @return Non-zero value on error, 0 if the connection was started.
+ */
+BaseType_t Sockets_ConnectStart( SocketsConnectContext_t * pConnectContext,
+                                 const char * pHostName,
+                                 uint16_t port,
+                                 uint32_t connectTimeoutMs );
+
+/**
+ * @brief Advance a connection started with #Sockets_ConnectStart, without
+ * blocking.
+ *
+ * Once connected, the socket is in the tcpSocket member of pConnectContext.
+ * Its receive and send timeouts are 0, so it does not block either, until
+ * they are set with #Sockets_SetTimeouts. It is closed with
+ * #Sockets_Disconnect. A connection that failed has no socket.
+ *
+ * @param[in] pConnectContext The connection.
+ *
+ * @return #SOCKETS_CONNECT_RESOLVING or #SOCKETS_CONNECT_CONNECTING while the
+ * connection is in progress; else #SOCKETS_CONNECT_CONNECTED or
+ * #SOCKETS_CONNECT_FAILED.
+ */
+SocketsConnectState_t Sockets_ConnectPoll( SocketsConnectContext_t * pConnectContext );
+
+/**
+ * @brief Stop a connection started with #Sockets_ConnectStart that is still
+ * in progress, and close its socket. This does nothing if the connection was
+ * established or failed.
+ *
+ * This must be called before a connection in progress is discarded, so the
+ * DNS lookup does not complete into memory that was reused.
+ *
+ * @param[in] pConnectContext The connection.
+ */
+void Sockets_ConnectCancel( SocketsConnectContext_t * pConnectContext );
+
+/**
+ * @brief Set the receive and send timeouts of a socket.
+ *
+ * @param[in] tcpSocket The socket descriptor.
+ * @param[in] receiveTimeoutMs Timeout (in milliseconds) for transport receive.
+ * @param[in] sendTimeoutMs Timeout (in milliseconds) for transport send.
+ */
+void Sockets_SetTimeouts( Socket_t tcpSocket,
+                          uint32_t receiveTimeoutMs,
+                          uint32_t sendTimeoutMs );
+
+/**
+ * @brief Send the data of several buffers over a TCP connection, as if they
+ * were one buffer.
+ *
+ * The buffers are copied straight into the TX stream buffer of the socket,
+ * from FreeRTOS_get_tx_head(), so a protocol header, body and trailer can be
+ * sent without first being copied to a staging buffer, and are queued for
+ * transmission together. If the stream buffer is full, or not created yet,
+ * this blocks for the send timeout of the socket like FreeRTOS_send().
+ *
+ * @param[in] tcpSocket The socket descriptor.
+ * @param[in] pIoVec The buffers to send, in order.
+ * @param[in] ioVecCount The number of buffers in pIoVec.
+ *
+ * @return The number of bytes (> 0) queued, counted from the start of the
+ * first buffer; else the negative error returned by FreeRTOS_send(), which is
+ * -pdFREERTOS_ERRNO_ENOSPC if the socket timed out.
+ */
+int32_t Sockets_Writev( Socket_t tcpSocket,
+                        const SocketsOutVector_t * pIoVec,
+                        size_t ioVecCount );
+
 /**
  * @brief End connection to server.
  *
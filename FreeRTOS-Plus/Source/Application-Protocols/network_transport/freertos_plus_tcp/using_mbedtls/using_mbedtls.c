@@ -35,6 +35,7 @@
 
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"
+#include "task.h"
 
 /* FreeRTOS+TCP includes. */
 #include "FreeRTOS_IP.h"
@@ -78,6 +79,12 @@ static const char * pNoHighLevelMbedTlsCodeStr = "<No-High-Level-Code>";
  */
 static const char * pNoLowLevelMbedTlsCodeStr = "<No-Low-Level-Code>";
 
+/**
+ * @brief The number of references to the mbed TLS threading functions, see
+ * #threadingAcquire.
+ */
+static UBaseType_t threadingUsers = 0U;
+
 /**
  * @brief Utility for converting the high-level code in an mbedTLS error to string,
  * if the code-contains a high-level code; otherwise, using a default string.
@@ -171,16 +178,45 @@ static int32_t setCredentials( SSLContext_t * pSslContext,
 /**
  * @brief Set optional configurations for the TLS connection.
  *
- * This function is used to set SNI and ALPN protocols.
+ * This function is used to set ALPN protocols and the maximum fragment length.
  *
  * @param[in] pSslContext SSL context to which the optional configurations are to be set.
- * @param[in] pHostName Remote host name, used for server name indication.
  * @param[in] pNetworkCredentials TLS setup parameters.
  */
 static void setOptionalConfigurations( SSLContext_t * pSslContext,
-                                       const char * pHostName,
                                        const NetworkCredentials_t * pNetworkCredentials );
 
+/**
+ * @brief Set the server name of a TLS connection, for server name indication,
+ * unless SNI is disabled.
+ *
+ * @param[in] pSslContext SSL context of the connection.
+ * @param[in] pHostName Remote host name, used for server name indication.
+ * @param[in] pNetworkCredentials TLS setup parameters.
+ */
+static void setServerName( SSLContext_t * pSslContext,
+                           const char * pHostName,
+                           const NetworkCredentials_t * pNetworkCredentials );
+
+/**
+ * @brief Set up the TLS configuration and credentials in an SSL context.
+ *
+ * @param[in] pSslContext SSL context whose configuration is to be set up.
+ * @param[in] pNetworkCredentials TLS setup parameters.
+ *
+ * @return #TLS_TRANSPORT_SUCCESS, #TLS_TRANSPORT_INSUFFICIENT_MEMORY, or
+ * #TLS_TRANSPORT_INVALID_CREDENTIALS.
+ */
+static TlsTransportStatus_t configSetup( SSLContext_t * pSslContext,
+                                         const NetworkCredentials_t * pNetworkCredentials );
+
+/**
+ * @brief Take a reference to a shared TLS configuration for a connection.
+ *
+ * @param[in] pSharedConfig The configuration of the connection.
+ */
+static void sharedConfigAcquire( TlsSharedConfig_t * pSharedConfig );
+
 /**
  * @brief Setup TLS by initializing contexts and setting configurations.
  *
@@ -199,13 +235,58 @@ static TlsTransportStatus_t tlsSetup( NetworkContext_t * pNetworkContext,
  * @brief Perform the TLS handshake on a TCP connection.
  *
  * @param[in] pNetworkContext Network context.
+ * @param[in] pHostName Remote host name, used to look up the cached session.
+ * @param[in] port Remote port, used to look up the cached session.
  * @param[in] pNetworkCredentials TLS setup parameters.
  *
  * @return #TLS_TRANSPORT_SUCCESS, #TLS_TRANSPORT_HANDSHAKE_FAILED, or #TLS_TRANSPORT_INTERNAL_ERROR.
  */
 static TlsTransportStatus_t tlsHandshake( NetworkContext_t * pNetworkContext,
+                                          const char * pHostName,
+                                          uint16_t port,
                                           const NetworkCredentials_t * pNetworkCredentials );
 
+/**
+ * @brief Set up the TLS connection context on a TCP connection, before the
+ * first step of the handshake.
+ *
+ * @param[in] pNetworkContext Network context.
+ * @param[in] pHostName Remote host name, used to look up the cached session.
+ * @param[in] port Remote port, used to look up the cached session.
+ * @param[out] pSessionOffered Set to pdTRUE if a cached session is offered.
+ *
+ * @return #TLS_TRANSPORT_SUCCESS, or #TLS_TRANSPORT_INTERNAL_ERROR.
+ */
+static TlsTransportStatus_t tlsHandshakeStart( NetworkContext_t * pNetworkContext,
+                                               const char * pHostName,
+                                               uint16_t port,
+                                               BaseType_t * pSessionOffered );
+
+/**
+ * @brief Report the result of a TLS handshake, and update the session cache.
+ *
+ * @param[in] pNetworkContext Network context.
+ * @param[in] pHostName Remote host name, used to look up the cached session.
+ * @param[in] port Remote port, used to look up the cached session.
+ * @param[in] sessionOffered pdTRUE if a cached session was offered.
+ * @param[in] mbedtlsError The final value returned by mbedtls_ssl_handshake().
+ *
+ * @return #TLS_TRANSPORT_SUCCESS, or #TLS_TRANSPORT_HANDSHAKE_FAILED.
+ */
+static TlsTransportStatus_t tlsHandshakeEnd( NetworkContext_t * pNetworkContext,
+                                             const char * pHostName,
+                                             uint16_t port,
+                                             BaseType_t sessionOffered,
+                                             int32_t mbedtlsError );
+
+/**
+ * @brief Free the TLS contexts of a connection that could not be established,
+ * release its shared configuration and close its socket.
+ *
+ * @param[in] pTlsTransportParams The parameters of the connection.
+ */
+static void connectCleanup( TlsTransportParams_t * pTlsTransportParams );
+
 /**
  * @brief Initialize mbedTLS.
  *
@@ -217,6 +298,23 @@ static TlsTransportStatus_t tlsHandshake( NetworkContext_t * pNetworkContext,
 static TlsTransportStatus_t initMbedtls( mbedtls_entropy_context * pEntropyContext,
                                          mbedtls_ctr_drbg_context * pCtrDrgbContext );
 
+/**
+ * @brief Take a reference to the mbed TLS threading functions, which the first
+ * reference sets.
+ *
+ * Each connection, from its connect to its disconnect, and each shared
+ * configuration, until it is freed, holds a reference. The functions are only
+ * cleared when the last is released, as the connections that use a shared
+ * configuration lock its random number generator.
+ */
+static void threadingAcquire( void );
+
+/**
+ * @brief Release a reference taken by #threadingAcquire, and clear the mbed
+ * TLS threading functions if it was the last.
+ */
+static void threadingRelease( void );
+
 /*-----------------------------------------------------------*/
 
 static void sslContextInit( SSLContext_t * pSslContext )
@@ -382,13 +480,11 @@ static int32_t setCredentials( SSLContext_t * pSslContext,
 /*-----------------------------------------------------------*/
 
 static void setOptionalConfigurations( SSLContext_t * pSslContext,
-                                       const char * pHostName,
                                        const NetworkCredentials_t * pNetworkCredentials )
 {
     int32_t mbedtlsError = -1;
 
     configASSERT( pSslContext != NULL );
-    configASSERT( pHostName != NULL );
     configASSERT( pNetworkCredentials != NULL );
 
     if( pNetworkCredentials->pAlpnProtos != NULL )
@@ -406,20 +502,6 @@ static void setOptionalConfigurations( SSLContext_t * pSslContext,
         }
     }
 
-    /* Enable SNI if requested. */
-    if( pNetworkCredentials->disableSni == pdFALSE )
-    {
-        mbedtlsError = mbedtls_ssl_set_hostname( &( pSslContext->context ),
-                                                 pHostName );
-
-        if( mbedtlsError != 0 )
-        {
-            LogError( ( "Failed to set server name: mbedTLSError= %s : %s.",
-                        mbedtlsHighLevelCodeOrDefault( mbedtlsError ),
-                        mbedtlsLowLevelCodeOrDefault( mbedtlsError ) ) );
-        }
-    }
-
     /* Set Maximum Fragment Length if enabled. */
     #ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
 
@@ -440,25 +522,43 @@ static void setOptionalConfigurations( SSLContext_t * pSslContext,
 }
 /*-----------------------------------------------------------*/
 
-static TlsTransportStatus_t tlsSetup( NetworkContext_t * pNetworkContext,
-                                      const char * pHostName,
-                                      const NetworkCredentials_t * pNetworkCredentials )
+static void setServerName( SSLContext_t * pSslContext,
+                           const char * pHostName,
+                           const NetworkCredentials_t * pNetworkCredentials )
+{
+    int32_t mbedtlsError = -1;
+
+    configASSERT( pSslContext != NULL );
+    configASSERT( pHostName != NULL );
+    configASSERT( pNetworkCredentials != NULL );
+
+    /* Enable SNI if requested. */
+    if( pNetworkCredentials->disableSni == pdFALSE )
+    {
+        mbedtlsError = mbedtls_ssl_set_hostname( &( pSslContext->context ),
+                                                 pHostName );
+
+        if( mbedtlsError != 0 )
+        {
+            LogError( ( "Failed to set server name: mbedTLSError= %s : %s.",
+                        mbedtlsHighLevelCodeOrDefault( mbedtlsError ),
+                        mbedtlsLowLevelCodeOrDefault( mbedtlsError ) ) );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+static TlsTransportStatus_t configSetup( SSLContext_t * pSslContext,
+                                         const NetworkCredentials_t * pNetworkCredentials )
 {
-    TlsTransportParams_t * pTlsTransportParams = NULL;
     TlsTransportStatus_t returnStatus = TLS_TRANSPORT_SUCCESS;
     int32_t mbedtlsError = 0;
 
-    configASSERT( pNetworkContext != NULL );
-    configASSERT( pNetworkContext->pParams != NULL );
-    configASSERT( pHostName != NULL );
+    configASSERT( pSslContext != NULL );
     configASSERT( pNetworkCredentials != NULL );
     configASSERT( pNetworkCredentials->pRootCa != NULL );
 
-    pTlsTransportParams = pNetworkContext->pParams;
-    /* Initialize the mbed TLS context structures. */
-    sslContextInit( &( pTlsTransportParams->sslContext ) );
-
-    mbedtlsError = mbedtls_ssl_config_defaults( &( pTlsTransportParams->sslContext.config ),
+    mbedtlsError = mbedtls_ssl_config_defaults( &( pSslContext->config ),
                                                 MBEDTLS_SSL_IS_CLIENT,
                                                 MBEDTLS_SSL_TRANSPORT_STREAM,
                                                 MBEDTLS_SSL_PRESET_DEFAULT );
@@ -475,7 +575,7 @@ static TlsTransportStatus_t tlsSetup( NetworkContext_t * pNetworkContext,
 
     if( returnStatus == TLS_TRANSPORT_SUCCESS )
     {
-        mbedtlsError = setCredentials( &( pTlsTransportParams->sslContext ),
+        mbedtlsError = setCredentials( pSslContext,
                                        pNetworkCredentials );
 
         if( mbedtlsError != 0 )
@@ -484,9 +584,8 @@ static TlsTransportStatus_t tlsSetup( NetworkContext_t * pNetworkContext,
         }
         else
         {
-            /* Optionally set SNI and ALPN protocols. */
-            setOptionalConfigurations( &( pTlsTransportParams->sslContext ),
-                                       pHostName,
+            /* Optionally set ALPN protocols. */
+            setOptionalConfigurations( pSslContext,
                                        pNetworkCredentials );
         }
     }
@@ -495,21 +594,123 @@ static TlsTransportStatus_t tlsSetup( NetworkContext_t * pNetworkContext,
 }
 /*-----------------------------------------------------------*/
 
+static void sharedConfigAcquire( TlsSharedConfig_t * pSharedConfig )
+{
+    configASSERT( pSharedConfig != NULL );
+
+    taskENTER_CRITICAL();
+    {
+        /* The configuration must not have been freed. */
+        configASSERT( pSharedConfig->references > 0U );
+        pSharedConfig->references++;
+    }
+    taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+static TlsTransportStatus_t tlsSetup( NetworkContext_t * pNetworkContext,
+                                      const char * pHostName,
+                                      const NetworkCredentials_t * pNetworkCredentials )
+{
+    TlsTransportParams_t * pTlsTransportParams = NULL;
+    TlsTransportStatus_t returnStatus = TLS_TRANSPORT_SUCCESS;
+
+    configASSERT( pNetworkContext != NULL );
+    configASSERT( pNetworkContext->pParams != NULL );
+    configASSERT( pHostName != NULL );
+    configASSERT( pNetworkCredentials != NULL );
+
+    pTlsTransportParams = pNetworkContext->pParams;
+
+    if( pTlsTransportParams->pSharedConfig != NULL )
+    {
+        /* The configuration and credentials are those of the shared
+         * configuration, only the connection context is needed. */
+        mbedtls_ssl_init( &( pTlsTransportParams->sslContext.context ) );
+    }
+    else
+    {
+        /* Initialize the mbed TLS context structures. */
+        sslContextInit( &( pTlsTransportParams->sslContext ) );
+
+        returnStatus = configSetup( &( pTlsTransportParams->sslContext ),
+                                    pNetworkCredentials );
+    }
+
+    if( returnStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        /* Optionally set SNI. */
+        setServerName( &( pTlsTransportParams->sslContext ),
+                       pHostName,
+                       pNetworkCredentials );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
 static TlsTransportStatus_t tlsHandshake( NetworkContext_t * pNetworkContext,
+                                          const char * pHostName,
+                                          uint16_t port,
                                           const NetworkCredentials_t * pNetworkCredentials )
 {
-    TlsTransportParams_t * pTlsTransportParams = NULL;
     TlsTransportStatus_t returnStatus = TLS_TRANSPORT_SUCCESS;
     int32_t mbedtlsError = 0;
+    BaseType_t sessionOffered = pdFALSE;
 
     configASSERT( pNetworkContext != NULL );
     configASSERT( pNetworkContext->pParams != NULL );
+    configASSERT( pHostName != NULL );
     configASSERT( pNetworkCredentials != NULL );
 
+    returnStatus = tlsHandshakeStart( pNetworkContext, pHostName, port, &sessionOffered );
+
+    if( returnStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        /* Perform the TLS handshake. */
+        do
+        {
+            mbedtlsError = mbedtls_ssl_handshake( &( pNetworkContext->pParams->sslContext.context ) );
+        } while( ( mbedtlsError == MBEDTLS_ERR_SSL_WANT_READ ) ||
+                 ( mbedtlsError == MBEDTLS_ERR_SSL_WANT_WRITE ) );
+
+        returnStatus = tlsHandshakeEnd( pNetworkContext, pHostName, port, sessionOffered, mbedtlsError );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static TlsTransportStatus_t tlsHandshakeStart( NetworkContext_t * pNetworkContext,
+                                               const char * pHostName,
+                                               uint16_t port,
+                                               BaseType_t * pSessionOffered )
+{
+    TlsTransportParams_t * pTlsTransportParams = NULL;
+    const mbedtls_ssl_config * pSslConfig = NULL;
+    TlsTransportStatus_t returnStatus = TLS_TRANSPORT_SUCCESS;
+    int32_t mbedtlsError = 0;
+
+    configASSERT( pNetworkContext != NULL );
+    configASSERT( pNetworkContext->pParams != NULL );
+    configASSERT( pHostName != NULL );
+    configASSERT( pSessionOffered != NULL );
+
     pTlsTransportParams = pNetworkContext->pParams;
+    *pSessionOffered = pdFALSE;
+
+    if( pTlsTransportParams->pSharedConfig != NULL )
+    {
+        pSslConfig = &( pTlsTransportParams->pSharedConfig->sslContext.config );
+    }
+    else
+    {
+        pSslConfig = &( pTlsTransportParams->sslContext.config );
+    }
+
     /* Initialize the mbed TLS secured connection context. */
     mbedtlsError = mbedtls_ssl_setup( &( pTlsTransportParams->sslContext.context ),
-                                      &( pTlsTransportParams->sslContext.config ) );
+                                      pSslConfig );
 
     if( mbedtlsError != 0 )
     {
@@ -533,47 +734,94 @@ static TlsTransportStatus_t tlsHandshake( NetworkContext_t * pNetworkContext,
                              mbedtls_platform_send,
                              mbedtls_platform_recv,
                              NULL );
+
+        #if ( TLS_TRANSPORT_SESSION_CACHE_ENTRIES > 0 )
+            /* Offer the session of the last connection to the server. */
+            *pSessionOffered = MbedtlsTransport_SessionCacheOffer( &( pTlsTransportParams->sslContext.context ),
+                                                                   pHostName,
+                                                                   port );
+        #endif
     }
 
-    if( returnStatus == TLS_TRANSPORT_SUCCESS )
-    {
-        /* Perform the TLS handshake. */
-        do
-        {
-            mbedtlsError = mbedtls_ssl_handshake( &( pTlsTransportParams->sslContext.context ) );
-        } while( ( mbedtlsError == MBEDTLS_ERR_SSL_WANT_READ ) ||
-                 ( mbedtlsError == MBEDTLS_ERR_SSL_WANT_WRITE ) );
+    /* Not used when the session cache is disabled. */
+    ( void ) port;
 
-        if( mbedtlsError != 0 )
-        {
-            LogError( ( "Failed to perform TLS handshake: mbedTLSError= %s : %s.",
-                        mbedtlsHighLevelCodeOrDefault( mbedtlsError ),
-                        mbedtlsLowLevelCodeOrDefault( mbedtlsError ) ) );
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
 
-            returnStatus = TLS_TRANSPORT_HANDSHAKE_FAILED;
-        }
-        else
-        {
-            LogInfo( ( "(Network connection %p) TLS handshake successful.",
-                       pNetworkContext ) );
-        }
+static TlsTransportStatus_t tlsHandshakeEnd( NetworkContext_t * pNetworkContext,
+                                             const char * pHostName,
+                                             uint16_t port,
+                                             BaseType_t sessionOffered,
+                                             int32_t mbedtlsError )
+{
+    TlsTransportStatus_t returnStatus = TLS_TRANSPORT_SUCCESS;
+
+    configASSERT( pNetworkContext != NULL );
+    configASSERT( pNetworkContext->pParams != NULL );
+    configASSERT( pHostName != NULL );
+
+    if( mbedtlsError != 0 )
+    {
+        LogError( ( "Failed to perform TLS handshake: mbedTLSError= %s : %s.",
+                    mbedtlsHighLevelCodeOrDefault( mbedtlsError ),
+                    mbedtlsLowLevelCodeOrDefault( mbedtlsError ) ) );
+
+        returnStatus = TLS_TRANSPORT_HANDSHAKE_FAILED;
     }
+    else
+    {
+        LogInfo( ( "(Network connection %p) TLS handshake successful.",
+                   pNetworkContext ) );
+    }
+
+    #if ( TLS_TRANSPORT_SESSION_CACHE_ENTRIES > 0 )
+        MbedtlsTransport_SessionCacheUpdate( &( pNetworkContext->pParams->sslContext.context ),
+                                             pHostName,
+                                             port,
+                                             sessionOffered,
+                                             ( returnStatus == TLS_TRANSPORT_SUCCESS ) ? pdTRUE : pdFALSE );
+    #endif
+
+    /* Not used when the session cache is disabled. */
+    ( void ) sessionOffered;
+    ( void ) port;
 
     return returnStatus;
 }
 /*-----------------------------------------------------------*/
 
+static void connectCleanup( TlsTransportParams_t * pTlsTransportParams )
+{
+    configASSERT( pTlsTransportParams != NULL );
+
+    if( pTlsTransportParams->pSharedConfig != NULL )
+    {
+        mbedtls_ssl_free( &( pTlsTransportParams->sslContext.context ) );
+        TLS_FreeRTOS_ReleaseSharedConfig( pTlsTransportParams->pSharedConfig );
+    }
+    else
+    {
+        sslContextFree( &( pTlsTransportParams->sslContext ) );
+    }
+
+    if( pTlsTransportParams->tcpSocket != FREERTOS_INVALID_SOCKET )
+    {
+        ( void ) FreeRTOS_closesocket( pTlsTransportParams->tcpSocket );
+    }
+
+    threadingRelease();
+}
+/*-----------------------------------------------------------*/
+
 static TlsTransportStatus_t initMbedtls( mbedtls_entropy_context * pEntropyContext,
                                          mbedtls_ctr_drbg_context * pCtrDrgbContext )
 {
     TlsTransportStatus_t returnStatus = TLS_TRANSPORT_SUCCESS;
     int32_t mbedtlsError = 0;
 
-    /* Set the mutex functions for mbed TLS thread safety. */
-    mbedtls_threading_set_alt( mbedtls_platform_mutex_init,
-                               mbedtls_platform_mutex_free,
-                               mbedtls_platform_mutex_lock,
-                               mbedtls_platform_mutex_unlock );
+    /* The mutex functions were set by threadingAcquire(). */
 
     /* Initialize contexts for random number generation. */
     mbedtls_entropy_init( pEntropyContext );
@@ -621,6 +869,44 @@ static TlsTransportStatus_t initMbedtls( mbedtls_entropy_context * pEntropyConte
 }
 /*-----------------------------------------------------------*/
 
+static void threadingAcquire( void )
+{
+    /* The scheduler is suspended rather than interrupts disabled, as setting
+     * the functions creates the mutexes of mbed TLS. */
+    vTaskSuspendAll();
+    {
+        if( threadingUsers == 0U )
+        {
+            /* Set the mutex functions for mbed TLS thread safety. */
+            mbedtls_threading_set_alt( mbedtls_platform_mutex_init,
+                                       mbedtls_platform_mutex_free,
+                                       mbedtls_platform_mutex_lock,
+                                       mbedtls_platform_mutex_unlock );
+        }
+
+        threadingUsers++;
+    }
+    ( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+static void threadingRelease( void )
+{
+    vTaskSuspendAll();
+    {
+        configASSERT( threadingUsers > 0U );
+        threadingUsers--;
+
+        if( threadingUsers == 0U )
+        {
+            /* Clear the mutex functions for mbed TLS thread safety. */
+            mbedtls_threading_free_alt();
+        }
+    }
+    ( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
 TlsTransportStatus_t TLS_FreeRTOS_Connect( NetworkContext_t * pNetworkContext,
                                            const char * pHostName,
                                            uint16_t port,
@@ -631,6 +917,7 @@ TlsTransportStatus_t TLS_FreeRTOS_Connect( NetworkContext_t * pNetworkContext,
     TlsTransportParams_t * pTlsTransportParams = NULL;
     TlsTransportStatus_t returnStatus = TLS_TRANSPORT_SUCCESS;
     BaseType_t socketStatus = 0;
+    BaseType_t sharedConfigAcquired = pdFALSE;
 
     if( ( pNetworkContext == NULL ) ||
         ( pNetworkContext->pParams == NULL ) ||
@@ -644,7 +931,8 @@ TlsTransportStatus_t TLS_FreeRTOS_Connect( NetworkContext_t * pNetworkContext,
                     pNetworkCredentials ) );
         returnStatus = TLS_TRANSPORT_INVALID_PARAMETER;
     }
-    else if( ( pNetworkCredentials->pRootCa == NULL ) )
+    else if( ( pNetworkCredentials->pRootCa == NULL ) &&
+             ( pNetworkContext->pParams->pSharedConfig == NULL ) )
     {
         LogError( ( "pRootCa cannot be NULL." ) );
         returnStatus = TLS_TRANSPORT_INVALID_PARAMETER;
@@ -654,10 +942,26 @@ TlsTransportStatus_t TLS_FreeRTOS_Connect( NetworkContext_t * pNetworkContext,
         /* Empty else for MISRA 15.7 compliance. */
     }
 
+    /* Keep the shared configuration until the connection is closed. */
+    if( ( returnStatus == TLS_TRANSPORT_SUCCESS ) &&
+        ( pNetworkContext->pParams->pSharedConfig != NULL ) )
+    {
+        sharedConfigAcquire( pNetworkContext->pParams->pSharedConfig );
+        sharedConfigAcquired = pdTRUE;
+    }
+
     /* Establish a TCP connection with the server. */
     if( returnStatus == TLS_TRANSPORT_SUCCESS )
     {
         pTlsTransportParams = pNetworkContext->pParams;
+        threadingAcquire();
+
+        #if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+            pTlsTransportParams->sendBuffer.length = 0U;
+            pTlsTransportParams->sendBuffer.retryLength = 0U;
+            pTlsTransportParams->corked = pdFALSE;
+        #endif
+
         socketStatus = Sockets_Connect( &( pTlsTransportParams->tcpSocket ),
                                         pHostName,
                                         port,
@@ -673,8 +977,9 @@ TlsTransportStatus_t TLS_FreeRTOS_Connect( NetworkContext_t * pNetworkContext,
         }
     }
 
-    /* Initialize mbedtls. */
-    if( returnStatus == TLS_TRANSPORT_SUCCESS )
+    /* Initialize mbedtls, unless the shared configuration was initialized. */
+    if( ( returnStatus == TLS_TRANSPORT_SUCCESS ) &&
+        ( sharedConfigAcquired == pdFALSE ) )
     {
         returnStatus = initMbedtls( &( pTlsTransportParams->sslContext.entropyContext ),
                                     &( pTlsTransportParams->sslContext.ctrDrgbContext ) );
@@ -689,20 +994,16 @@ TlsTransportStatus_t TLS_FreeRTOS_Connect( NetworkContext_t * pNetworkContext,
     /* Perform TLS handshake. */
     if( returnStatus == TLS_TRANSPORT_SUCCESS )
     {
-        returnStatus = tlsHandshake( pNetworkContext, pNetworkCredentials );
+        returnStatus = tlsHandshake( pNetworkContext, pHostName, port, pNetworkCredentials );
     }
 
     /* Clean up on failure. */
     if( returnStatus != TLS_TRANSPORT_SUCCESS )
     {
-        if( ( pNetworkContext != NULL ) && ( pNetworkContext->pParams != NULL ) )
+        /* The parameters are only set once the arguments were validated. */
+        if( pTlsTransportParams != NULL )
         {
-            sslContextFree( &( pTlsTransportParams->sslContext ) );
-
-            if( pTlsTransportParams->tcpSocket != FREERTOS_INVALID_SOCKET )
-            {
-                ( void ) FreeRTOS_closesocket( pTlsTransportParams->tcpSocket );
-            }
+            connectCleanup( pTlsTransportParams );
         }
     }
     else
@@ -716,6 +1017,237 @@ TlsTransportStatus_t TLS_FreeRTOS_Connect( NetworkContext_t * pNetworkContext,
 }
 /*-----------------------------------------------------------*/
 
+TlsTransportStatus_t TLS_FreeRTOS_ConnectStart( NetworkContext_t * pNetworkContext,
+                                                const char * pHostName,
+                                                uint16_t port,
+                                                const NetworkCredentials_t * pNetworkCredentials,
+                                                uint32_t connectTimeoutMs,
+                                                uint32_t receiveTimeoutMs,
+                                                uint32_t sendTimeoutMs )
+{
+    TlsTransportParams_t * pTlsTransportParams = NULL;
+    TlsTransportStatus_t returnStatus = TLS_TRANSPORT_SUCCESS;
+    BaseType_t socketStatus = 0;
+
+    if( ( pNetworkContext == NULL ) ||
+        ( pNetworkContext->pParams == NULL ) ||
+        ( pHostName == NULL ) ||
+        ( pNetworkCredentials == NULL ) ||
+        ( connectTimeoutMs == 0U ) )
+    {
+        LogError( ( "Invalid input parameter(s): Arguments cannot be NULL or 0. pNetworkContext=%p, "
+                    "pHostName=%p, pNetworkCredentials=%p, connectTimeoutMs=%u.",
+                    pNetworkContext,
+                    pHostName,
+                    pNetworkCredentials,
+                    connectTimeoutMs ) );
+        returnStatus = TLS_TRANSPORT_INVALID_PARAMETER;
+    }
+    else if( ( pNetworkCredentials->pRootCa == NULL ) &&
+             ( pNetworkContext->pParams->pSharedConfig == NULL ) )
+    {
+        LogError( ( "pRootCa cannot be NULL." ) );
+        returnStatus = TLS_TRANSPORT_INVALID_PARAMETER;
+    }
+    else
+    {
+        pTlsTransportParams = pNetworkContext->pParams;
+        pTlsTransportParams->tcpSocket = FREERTOS_INVALID_SOCKET;
+        threadingAcquire();
+        pTlsTransportParams->pNetworkCredentials = pNetworkCredentials;
+        pTlsTransportParams->receiveTimeoutMs = receiveTimeoutMs;
+        pTlsTransportParams->sendTimeoutMs = sendTimeoutMs;
+        pTlsTransportParams->handshakeStarted = pdFALSE;
+        pTlsTransportParams->sessionOffered = pdFALSE;
+
+        #if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+            pTlsTransportParams->sendBuffer.length = 0U;
+            pTlsTransportParams->sendBuffer.retryLength = 0U;
+            pTlsTransportParams->corked = pdFALSE;
+        #endif
+
+        /* The TLS contexts are set up while the connection is in progress,
+         * as by TLS_FreeRTOS_Connect(), so the polls only do I/O. */
+        if( pTlsTransportParams->pSharedConfig != NULL )
+        {
+            sharedConfigAcquire( pTlsTransportParams->pSharedConfig );
+        }
+        else
+        {
+            returnStatus = initMbedtls( &( pTlsTransportParams->sslContext.entropyContext ),
+                                        &( pTlsTransportParams->sslContext.ctrDrgbContext ) );
+        }
+    }
+
+    if( returnStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        returnStatus = tlsSetup( pNetworkContext, pHostName, pNetworkCredentials );
+    }
+
+    if( returnStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        socketStatus = Sockets_ConnectStart( &( pTlsTransportParams->connectContext ),
+                                             pHostName,
+                                             port,
+                                             connectTimeoutMs );
+
+        if( socketStatus != 0 )
+        {
+            LogError( ( "Failed to connect to %s with error %d.",
+                        pHostName,
+                        socketStatus ) );
+            returnStatus = TLS_TRANSPORT_CONNECT_FAILURE;
+        }
+    }
+
+    if( returnStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        pTlsTransportParams->connectPending = pdTRUE;
+    }
+    else if( pTlsTransportParams != NULL )
+    {
+        connectCleanup( pTlsTransportParams );
+        pTlsTransportParams->connectPending = pdFALSE;
+    }
+    else
+    {
+        /* Empty else for MISRA 15.7 compliance. */
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+TlsTransportStatus_t TLS_FreeRTOS_ConnectPoll( NetworkContext_t * pNetworkContext )
+{
+    TlsTransportParams_t * pTlsTransportParams = NULL;
+    TlsTransportStatus_t returnStatus = TLS_TRANSPORT_IN_PROGRESS;
+    SocketsConnectState_t connectState = SOCKETS_CONNECT_CONNECTING;
+    int32_t mbedtlsError = 0;
+
+    if( ( pNetworkContext == NULL ) ||
+        ( pNetworkContext->pParams == NULL ) ||
+        ( pNetworkContext->pParams->connectPending != pdTRUE ) )
+    {
+        LogError( ( "Invalid input parameter(s): No connection in progress. pNetworkContext=%p.",
+                    pNetworkContext ) );
+        returnStatus = TLS_TRANSPORT_INVALID_PARAMETER;
+    }
+    else
+    {
+        pTlsTransportParams = pNetworkContext->pParams;
+
+        if( pTlsTransportParams->handshakeStarted == pdFALSE )
+        {
+            connectState = Sockets_ConnectPoll( &( pTlsTransportParams->connectContext ) );
+
+            if( connectState == SOCKETS_CONNECT_CONNECTED )
+            {
+                /* The socket does not block until the connection is
+                 * established, so the handshake returns when it waits. */
+                pTlsTransportParams->tcpSocket = pTlsTransportParams->connectContext.tcpSocket;
+                returnStatus = tlsHandshakeStart( pNetworkContext,
+                                                  pTlsTransportParams->connectContext.pHostName,
+                                                  pTlsTransportParams->connectContext.port,
+                                                  &( pTlsTransportParams->sessionOffered ) );
+
+                if( returnStatus == TLS_TRANSPORT_SUCCESS )
+                {
+                    pTlsTransportParams->handshakeStarted = pdTRUE;
+                    returnStatus = TLS_TRANSPORT_IN_PROGRESS;
+                }
+            }
+            else if( connectState == SOCKETS_CONNECT_FAILED )
+            {
+                LogError( ( "Failed to connect to %s.",
+                            pTlsTransportParams->connectContext.pHostName ) );
+                returnStatus = TLS_TRANSPORT_CONNECT_FAILURE;
+            }
+            else
+            {
+                /* Empty else for MISRA 15.7 compliance. */
+            }
+        }
+
+        if( pTlsTransportParams->handshakeStarted == pdTRUE )
+        {
+            mbedtlsError = mbedtls_ssl_handshake( &( pTlsTransportParams->sslContext.context ) );
+
+            /* The handshake waits for the server, or for space in the TX
+             * stream of the socket, which times out straight away. */
+            if( ( mbedtlsError == MBEDTLS_ERR_SSL_WANT_READ ) ||
+                ( mbedtlsError == MBEDTLS_ERR_SSL_WANT_WRITE ) ||
+                ( mbedtlsError == MBEDTLS_ERR_SSL_TIMEOUT ) )
+            {
+                if( ( xTaskGetTickCount() - pTlsTransportParams->connectContext.startTime ) >=
+                    pTlsTransportParams->connectContext.connectTimeout )
+                {
+                    returnStatus = tlsHandshakeEnd( pNetworkContext,
+                                                    pTlsTransportParams->connectContext.pHostName,
+                                                    pTlsTransportParams->connectContext.port,
+                                                    pTlsTransportParams->sessionOffered,
+                                                    MBEDTLS_ERR_SSL_TIMEOUT );
+                }
+            }
+            else
+            {
+                returnStatus = tlsHandshakeEnd( pNetworkContext,
+                                                pTlsTransportParams->connectContext.pHostName,
+                                                pTlsTransportParams->connectContext.port,
+                                                pTlsTransportParams->sessionOffered,
+                                                mbedtlsError );
+            }
+        }
+
+        if( returnStatus == TLS_TRANSPORT_SUCCESS )
+        {
+            Sockets_SetTimeouts( pTlsTransportParams->tcpSocket,
+                                 pTlsTransportParams->receiveTimeoutMs,
+                                 pTlsTransportParams->sendTimeoutMs );
+            pTlsTransportParams->connectPending = pdFALSE;
+
+            LogInfo( ( "(Network connection %p) Connection to %s established.",
+                       pNetworkContext,
+                       pTlsTransportParams->connectContext.pHostName ) );
+        }
+        else if( returnStatus != TLS_TRANSPORT_IN_PROGRESS )
+        {
+            connectCleanup( pTlsTransportParams );
+            pTlsTransportParams->connectPending = pdFALSE;
+        }
+        else
+        {
+            /* Empty else for MISRA 15.7 compliance. */
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+void TLS_FreeRTOS_ConnectCancel( NetworkContext_t * pNetworkContext )
+{
+    TlsTransportParams_t * pTlsTransportParams = NULL;
+
+    if( ( pNetworkContext != NULL ) &&
+        ( pNetworkContext->pParams != NULL ) &&
+        ( pNetworkContext->pParams->connectPending == pdTRUE ) )
+    {
+        pTlsTransportParams = pNetworkContext->pParams;
+
+        /* Closes the socket if the TCP connection is in progress, else it is
+         * closed with the TLS contexts. */
+        Sockets_ConnectCancel( &( pTlsTransportParams->connectContext ) );
+        connectCleanup( pTlsTransportParams );
+        pTlsTransportParams->connectPending = pdFALSE;
+
+        LogInfo( ( "(Network connection %p) Connection to %s cancelled.",
+                   pNetworkContext,
+                   pTlsTransportParams->connectContext.pHostName ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
 void TLS_FreeRTOS_Disconnect( NetworkContext_t * pNetworkContext )
 {
     TlsTransportParams_t * pTlsTransportParams = NULL;
@@ -724,6 +1256,13 @@ void TLS_FreeRTOS_Disconnect( NetworkContext_t * pNetworkContext )
     if( ( pNetworkContext != NULL ) && ( pNetworkContext->pParams != NULL ) )
     {
         pTlsTransportParams = pNetworkContext->pParams;
+
+        #if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+            /* Send the data left corked, if possible. */
+            ( void ) MbedtlsTransport_SendBufferFlush( &( pTlsTransportParams->sslContext.context ),
+                                                       &( pTlsTransportParams->sendBuffer ) );
+        #endif
+
         /* Attempting to terminate TLS connection. */
         tlsStatus = ( BaseType_t ) mbedtls_ssl_close_notify( &( pTlsTransportParams->sslContext.context ) );
 
@@ -757,11 +1296,18 @@ void TLS_FreeRTOS_Disconnect( NetworkContext_t * pNetworkContext )
         Sockets_Disconnect( pTlsTransportParams->tcpSocket );
 
         /* Free mbed TLS contexts. */
-        sslContextFree( &( pTlsTransportParams->sslContext ) );
-    }
+        if( pTlsTransportParams->pSharedConfig != NULL )
+        {
+            mbedtls_ssl_free( &( pTlsTransportParams->sslContext.context ) );
+            TLS_FreeRTOS_ReleaseSharedConfig( pTlsTransportParams->pSharedConfig );
+        }
+        else
+        {
+            sslContextFree( &( pTlsTransportParams->sslContext ) );
+        }
 
-    /* Clear the mutex functions for mbed TLS thread safety. */
-    mbedtls_threading_free_alt();
+        threadingRelease();
+    }
 }
 /*-----------------------------------------------------------*/
 
@@ -775,6 +1321,14 @@ int32_t TLS_FreeRTOS_recv( NetworkContext_t * pNetworkContext,
     configASSERT( ( pNetworkContext != NULL ) && ( pNetworkContext->pParams != NULL ) );
 
     pTlsTransportParams = pNetworkContext->pParams;
+
+    #if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+        /* The peer may be waiting for the data left corked before it
+         * responds. A failure is reported by the next send or flush. */
+        ( void ) MbedtlsTransport_SendBufferFlush( &( pTlsTransportParams->sslContext.context ),
+                                                   &( pTlsTransportParams->sendBuffer ) );
+    #endif
+
     tlsStatus = ( int32_t ) mbedtls_ssl_read( &( pTlsTransportParams->sslContext.context ),
                                               pBuffer,
                                               bytesToRecv );
@@ -817,9 +1371,33 @@ int32_t TLS_FreeRTOS_send( NetworkContext_t * pNetworkContext,
     configASSERT( ( pNetworkContext != NULL ) && ( pNetworkContext->pParams != NULL ) );
 
     pTlsTransportParams = pNetworkContext->pParams;
-    tlsStatus = ( int32_t ) mbedtls_ssl_write( &( pTlsTransportParams->sslContext.context ),
-                                               pBuffer,
-                                               bytesToSend );
+
+    #if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+        if( pTlsTransportParams->corked == pdTRUE )
+        {
+            tlsStatus = MbedtlsTransport_SendBufferAppend( &( pTlsTransportParams->sslContext.context ),
+                                                           &( pTlsTransportParams->sendBuffer ),
+                                                           pBuffer,
+                                                           bytesToSend );
+        }
+        else
+        {
+            /* The data a vectored send left in the send buffer goes first. */
+            tlsStatus = MbedtlsTransport_SendBufferFlush( &( pTlsTransportParams->sslContext.context ),
+                                                          &( pTlsTransportParams->sendBuffer ) );
+
+            if( tlsStatus >= 0 )
+            {
+                tlsStatus = ( int32_t ) mbedtls_ssl_write( &( pTlsTransportParams->sslContext.context ),
+                                                           pBuffer,
+                                                           bytesToSend );
+            }
+        }
+    #else
+        tlsStatus = ( int32_t ) mbedtls_ssl_write( &( pTlsTransportParams->sslContext.context ),
+                                                   pBuffer,
+                                                   bytesToSend );
+    #endif
 
     if( ( tlsStatus == MBEDTLS_ERR_SSL_TIMEOUT ) ||
         ( tlsStatus == MBEDTLS_ERR_SSL_WANT_READ ) ||
@@ -848,3 +1426,208 @@ int32_t TLS_FreeRTOS_send( NetworkContext_t * pNetworkContext,
     return tlsStatus;
 }
 /*-----------------------------------------------------------*/
+
+int32_t TLS_FreeRTOS_writev( NetworkContext_t * pNetworkContext,
+                             const SocketsOutVector_t * pIoVec,
+                             size_t ioVecCount )
+{
+    TlsTransportParams_t * pTlsTransportParams = NULL;
+    int32_t tlsStatus = 0;
+    int32_t bytesSent = 0;
+    size_t vectorIndex = 0U;
+    size_t offset = 0U;
+    const uint8_t * pVectorBuffer = NULL;
+
+    configASSERT( ( pNetworkContext != NULL ) && ( pNetworkContext->pParams != NULL ) );
+    configASSERT( ( pIoVec != NULL ) || ( ioVecCount == 0U ) );
+
+    pTlsTransportParams = pNetworkContext->pParams;
+
+    while( ( vectorIndex < ioVecCount ) && ( tlsStatus >= 0 ) )
+    {
+        pVectorBuffer = ( const uint8_t * ) pIoVec[ vectorIndex ].pBuffer;
+
+        if( offset < pIoVec[ vectorIndex ].bufferLength )
+        {
+            #if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+                tlsStatus = MbedtlsTransport_SendBufferAppend( &( pTlsTransportParams->sslContext.context ),
+                                                               &( pTlsTransportParams->sendBuffer ),
+                                                               &( pVectorBuffer[ offset ] ),
+                                                               pIoVec[ vectorIndex ].bufferLength - offset );
+            #else
+                tlsStatus = ( int32_t ) mbedtls_ssl_write( &( pTlsTransportParams->sslContext.context ),
+                                                           &( pVectorBuffer[ offset ] ),
+                                                           pIoVec[ vectorIndex ].bufferLength - offset );
+            #endif
+
+            if( tlsStatus > 0 )
+            {
+                offset += ( size_t ) tlsStatus;
+                bytesSent += tlsStatus;
+            }
+        }
+        else
+        {
+            vectorIndex++;
+            offset = 0U;
+        }
+    }
+
+    #if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+        /* Send the gathered data, unless the connection is corked. */
+        if( ( tlsStatus >= 0 ) && ( pTlsTransportParams->corked == pdFALSE ) )
+        {
+            tlsStatus = MbedtlsTransport_SendBufferFlush( &( pTlsTransportParams->sslContext.context ),
+                                                          &( pTlsTransportParams->sendBuffer ) );
+        }
+    #endif
+
+    if( ( tlsStatus == MBEDTLS_ERR_SSL_TIMEOUT ) ||
+        ( tlsStatus == MBEDTLS_ERR_SSL_WANT_READ ) ||
+        ( tlsStatus == MBEDTLS_ERR_SSL_WANT_WRITE ) )
+    {
+        LogDebug( ( "Failed to send data. However, send can be retried on this error. "
+                    "mbedTLSError= %s : %s.",
+                    mbedtlsHighLevelCodeOrDefault( tlsStatus ),
+                    mbedtlsLowLevelCodeOrDefault( tlsStatus ) ) );
+
+        /* The bytes taken before the timeout, if any, are sent. */
+        tlsStatus = bytesSent;
+    }
+    else if( tlsStatus < 0 )
+    {
+        LogError( ( "Failed to send data:  mbedTLSError= %s : %s.",
+                    mbedtlsHighLevelCodeOrDefault( tlsStatus ),
+                    mbedtlsLowLevelCodeOrDefault( tlsStatus ) ) );
+    }
+    else
+    {
+        tlsStatus = bytesSent;
+    }
+
+    return tlsStatus;
+}
+/*-----------------------------------------------------------*/
+
+#if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+
+    void TLS_FreeRTOS_Cork( NetworkContext_t * pNetworkContext )
+    {
+        configASSERT( ( pNetworkContext != NULL ) && ( pNetworkContext->pParams != NULL ) );
+
+        pNetworkContext->pParams->corked = pdTRUE;
+    }
+/*-----------------------------------------------------------*/
+
+    int32_t TLS_FreeRTOS_Flush( NetworkContext_t * pNetworkContext )
+    {
+        TlsTransportParams_t * pTlsTransportParams = NULL;
+        int32_t tlsStatus = 0;
+
+        configASSERT( ( pNetworkContext != NULL ) && ( pNetworkContext->pParams != NULL ) );
+
+        pTlsTransportParams = pNetworkContext->pParams;
+        tlsStatus = MbedtlsTransport_SendBufferFlush( &( pTlsTransportParams->sslContext.context ),
+                                                      &( pTlsTransportParams->sendBuffer ) );
+
+        if( tlsStatus >= 0 )
+        {
+            pTlsTransportParams->corked = pdFALSE;
+            tlsStatus = 0;
+        }
+        else if( ( tlsStatus == MBEDTLS_ERR_SSL_TIMEOUT ) ||
+                 ( tlsStatus == MBEDTLS_ERR_SSL_WANT_READ ) ||
+                 ( tlsStatus == MBEDTLS_ERR_SSL_WANT_WRITE ) )
+        {
+            /* The rest can be sent by retrying the flush. */
+            tlsStatus = ( int32_t ) pTlsTransportParams->sendBuffer.length;
+        }
+        else
+        {
+            LogError( ( "Failed to send data:  mbedTLSError= %s : %s.",
+                        mbedtlsHighLevelCodeOrDefault( tlsStatus ),
+                        mbedtlsLowLevelCodeOrDefault( tlsStatus ) ) );
+        }
+
+        return tlsStatus;
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 ) */
+
+TlsTransportStatus_t TLS_FreeRTOS_InitSharedConfig( TlsSharedConfig_t * pSharedConfig,
+                                                    const NetworkCredentials_t * pNetworkCredentials )
+{
+    TlsTransportStatus_t returnStatus = TLS_TRANSPORT_SUCCESS;
+
+    if( ( pSharedConfig == NULL ) ||
+        ( pNetworkCredentials == NULL ) )
+    {
+        LogError( ( "Invalid input parameter(s): Arguments cannot be NULL. pSharedConfig=%p, "
+                    "pNetworkCredentials=%p.",
+                    pSharedConfig,
+                    pNetworkCredentials ) );
+        returnStatus = TLS_TRANSPORT_INVALID_PARAMETER;
+    }
+    else if( ( pNetworkCredentials->pRootCa == NULL ) )
+    {
+        LogError( ( "pRootCa cannot be NULL." ) );
+        returnStatus = TLS_TRANSPORT_INVALID_PARAMETER;
+    }
+    else
+    {
+        /* Initialize the mbed TLS context structures first, so they can all
+         * be freed if any of the following steps fails. The configuration
+         * holds a reference to the threading functions until it is freed. */
+        threadingAcquire();
+        sslContextInit( &( pSharedConfig->sslContext ) );
+
+        returnStatus = initMbedtls( &( pSharedConfig->sslContext.entropyContext ),
+                                    &( pSharedConfig->sslContext.ctrDrgbContext ) );
+
+        if( returnStatus == TLS_TRANSPORT_SUCCESS )
+        {
+            returnStatus = configSetup( &( pSharedConfig->sslContext ),
+                                        pNetworkCredentials );
+        }
+
+        if( returnStatus == TLS_TRANSPORT_SUCCESS )
+        {
+            /* The reference of the caller. */
+            pSharedConfig->references = 1U;
+        }
+        else
+        {
+            sslContextFree( &( pSharedConfig->sslContext ) );
+            threadingRelease();
+            pSharedConfig->references = 0U;
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+void TLS_FreeRTOS_ReleaseSharedConfig( TlsSharedConfig_t * pSharedConfig )
+{
+    UBaseType_t references = 0U;
+
+    configASSERT( pSharedConfig != NULL );
+
+    taskENTER_CRITICAL();
+    {
+        configASSERT( pSharedConfig->references > 0U );
+        pSharedConfig->references--;
+        references = pSharedConfig->references;
+    }
+    taskEXIT_CRITICAL();
+
+    /* Free the configuration when the last connection that uses it is
+     * closed, after the caller of TLS_FreeRTOS_InitSharedConfig released it. */
+    if( references == 0U )
+    {
+        sslContextFree( &( pSharedConfig->sslContext ) );
+        threadingRelease();
+    }
+}
+/*-----------------------------------------------------------*/
@@ -76,6 +76,10 @@ extern void vLoggingPrintf( const char * pcFormatString,
 /* Transport interface include. */
 #include "transport_interface.h"
 
+/* FreeRTOS Socket wrapper include, for the buffers of the vectored send and
+ * the connections established without blocking. */
+#include "sockets_wrapper.h"
+
 /* mbed TLS includes. */
 #include "mbedtls/ctr_drbg.h"
 #include "mbedtls/entropy.h"
@@ -83,6 +87,9 @@ extern void vLoggingPrintf( const char * pcFormatString,
 #include "mbedtls/threading.h"
 #include "mbedtls/x509.h"
 
+/* Session cache and send buffer shared by the mbed TLS transports. */
+#include "mbedtls_transport_common.h"
+
 /**
  * @brief Secured connection context.
  */
@@ -98,6 +105,20 @@ typedef struct SSLContext
     mbedtls_ctr_drbg_context ctrDrgbContext; /**< @brief CTR DRBG context for random number generation. */
 } SSLContext_t;
 
+/**
+ * @brief A TLS configuration, with its parsed credentials, that is shared by
+ * the connections that use the same credentials.
+ *
+ * Initialize with #TLS_FreeRTOS_InitSharedConfig, then set the pSharedConfig
+ * member of the #TlsTransportParams_t of each connection before calling
+ * #TLS_FreeRTOS_Connect. The members are private to the transport.
+ */
+typedef struct TlsSharedConfig
+{
+    SSLContext_t sslContext; /**< @brief Configuration, credentials and random number generator. The SSL connection context is not used. */
+    UBaseType_t references;  /**< @brief The number of users of the configuration: its creator and the open connections. */
+} TlsSharedConfig_t;
+
 /**
  * @brief Parameters for the network context of the transport interface
  * implementation that uses mbedTLS and FreeRTOS+TCP sockets.
@@ -106,6 +127,18 @@ typedef struct TlsTransportParams
 {
     Socket_t tcpSocket;
     SSLContext_t sslContext;
+    TlsSharedConfig_t * pSharedConfig;                     /**< @brief The configuration of the connection, or NULL to set up a configuration for this connection only. */
+    SocketsConnectContext_t connectContext;                /**< @brief The TCP connection started by #TLS_FreeRTOS_ConnectStart. */
+    const struct NetworkCredentials * pNetworkCredentials; /**< @brief The credentials of the connection started by #TLS_FreeRTOS_ConnectStart. */
+    uint32_t receiveTimeoutMs;                             /**< @brief The receive timeout set when the connection started by #TLS_FreeRTOS_ConnectStart is established. */
+    uint32_t sendTimeoutMs;                                /**< @brief The send timeout set when the connection started by #TLS_FreeRTOS_ConnectStart is established. */
+    BaseType_t connectPending;                             /**< @brief pdTRUE from #TLS_FreeRTOS_ConnectStart until the connection is established or failed. */
+    BaseType_t handshakeStarted;                           /**< @brief pdTRUE once the TCP connection is established and the TLS handshake started. */
+    BaseType_t sessionOffered;                             /**< @brief pdTRUE if a cached session was offered in the handshake. */
+    #if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+        TlsSendBuffer_t sendBuffer; /**< @brief The data sent since the connection was corked and not yet written to TLS. */
+        BaseType_t corked;          /**< @brief pdTRUE from #TLS_FreeRTOS_Cork to #TLS_FreeRTOS_Flush. */
+    #endif
 } TlsTransportParams_t;
 
 /**
@@ -147,12 +180,18 @@ typedef enum TlsTransportStatus
     TLS_TRANSPORT_INVALID_CREDENTIALS, /**< Provided credentials were invalid. */
     TLS_TRANSPORT_HANDSHAKE_FAILED,    /**< Performing TLS handshake with server failed. */
     TLS_TRANSPORT_INTERNAL_ERROR,      /**< A call to a system API resulted in an internal error. */
-    TLS_TRANSPORT_CONNECT_FAILURE      /**< Initial connection to the server failed. */
+    TLS_TRANSPORT_CONNECT_FAILURE,     /**< Initial connection to the server failed. */
+    TLS_TRANSPORT_IN_PROGRESS          /**< The connection started by #TLS_FreeRTOS_ConnectStart is not established yet. */
 } TlsTransportStatus_t;
 
 /**
  * @brief Create a TLS connection with FreeRTOS sockets.
  *
+ * If the pSharedConfig member of the #TlsTransportParams_t is not NULL, the
+ * connection uses that configuration and its credentials, which are not
+ * parsed again. Only the disableSni member of pNetworkCredentials is used in
+ * that case.
+ *
  * @param[out] pNetworkContext Pointer to a network context to contain the
  * initialized socket handle.
  * @param[in] pHostName The hostname of the remote endpoint.
@@ -171,6 +210,67 @@ TlsTransportStatus_t TLS_FreeRTOS_Connect( NetworkContext_t * pNetworkContext,
                                            uint32_t receiveTimeoutMs,
                                            uint32_t sendTimeoutMs );
 
+/**
+ * @brief Start to create a TLS connection with FreeRTOS sockets, without
+ * waiting for the TCP connection and the TLS handshake.
+ *
+ * The connection is then advanced by #TLS_FreeRTOS_ConnectPoll, which does
+ * not block, so one task can establish several connections at the same time,
+ * with the round trips of their TCP and TLS handshakes overlapping. The
+ * socket does not block until the connection is established, see
+ * #Sockets_ConnectStart for the DNS lookup. The connection is otherwise set
+ * up as by #TLS_FreeRTOS_Connect, with the same parameters.
+ *
+ * @param[out] pNetworkContext Pointer to a network context to contain the
+ * initialized socket handle.
+ * @param[in] pHostName The hostname of the remote endpoint. It must remain
+ * valid until the connection is established or failed.
+ * @param[in] port The destination port.
+ * @param[in] pNetworkCredentials Credentials for the TLS connection. They must
+ * remain valid until the connection is established or failed.
+ * @param[in] connectTimeoutMs Time (in milliseconds, > 0) after which the
+ * connection fails if the TCP connection and TLS handshake are not complete.
+ * @param[in] receiveTimeoutMs Receive socket timeout, once connected.
+ * @param[in] sendTimeoutMs Send socket timeout, once connected.
+ *
+ * @return #TLS_TRANSPORT_SUCCESS if the connection was started, then it must be
+ * polled with #TLS_FreeRTOS_ConnectPoll; else #TLS_TRANSPORT_INVALID_PARAMETER
+ * or #TLS_TRANSPORT_CONNECT_FAILURE.
+ */
+TlsTransportStatus_t TLS_FreeRTOS_ConnectStart( NetworkContext_t * pNetworkContext,
+                                                const char * pHostName,
+                                                uint16_t port,
+                                                const NetworkCredentials_t * pNetworkCredentials,
+                                                uint32_t connectTimeoutMs,
+                                                uint32_t receiveTimeoutMs,
+                                                uint32_t sendTimeoutMs );
+
+/**
+ * @brief Advance a connection started with #TLS_FreeRTOS_ConnectStart, as far
+ * as possible without blocking.
+ *
+ * Call this until it returns another value than #TLS_TRANSPORT_IN_PROGRESS,
+ * for example for each connection in progress, each tick. Once it returns
+ * #TLS_TRANSPORT_SUCCESS, the connection is used and closed as one created by
+ * #TLS_FreeRTOS_Connect. When it returns an error, the connection was cleaned
+ * up.
+ *
+ * @param[in] pNetworkContext The network context of the connection.
+ *
+ * @return #TLS_TRANSPORT_IN_PROGRESS, #TLS_TRANSPORT_SUCCESS, or an error as
+ * returned by #TLS_FreeRTOS_Connect.
+ */
+TlsTransportStatus_t TLS_FreeRTOS_ConnectPoll( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Abandon a connection started with #TLS_FreeRTOS_ConnectStart that
+ * is still in progress, and clean it up. This does nothing if the connection
+ * was established or failed.
+ *
+ * @param[in] pNetworkContext The network context of the connection.
+ */
+void TLS_FreeRTOS_ConnectCancel( NetworkContext_t * pNetworkContext );
+
 /**
  * @brief Gracefully disconnect an established TLS connection.
  *
@@ -214,4 +314,98 @@ int32_t TLS_FreeRTOS_send( NetworkContext_t * pNetworkContext,
                            const void * pBuffer,
                            size_t bytesToSend );
 
+/**
+ * @brief Sends the data of several buffers over an established TLS
+ * connection, as if they were one buffer.
+ *
+ * When #TLS_TRANSPORT_SEND_BUFFER_SIZE is greater than 0, the buffers are
+ * gathered into the send buffer of the connection, so a protocol header, body
+ * and trailer that fit in it are sent in one TLS record. If the connection is
+ * corked, see #TLS_FreeRTOS_Cork, they are only gathered. The data gathered
+ * when the socket times out stays in the send buffer, and is sent before the
+ * data of the next send. When #TLS_TRANSPORT_SEND_BUFFER_SIZE is 0, each
+ * buffer is sent in records of its own.
+ *
+ * @param[in] pNetworkContext The network context.
+ * @param[in] pIoVec The buffers to send, in order.
+ * @param[in] ioVecCount The number of buffers in pIoVec.
+ *
+ * @return Number of bytes (> 0) sent on success, counted from the start of the
+ * first buffer; 0 if the socket times out without sending any bytes;
+ * else a negative value to represent error.
+ */
+int32_t TLS_FreeRTOS_writev( NetworkContext_t * pNetworkContext,
+                             const SocketsOutVector_t * pIoVec,
+                             size_t ioVecCount );
+
+#if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+
+/**
+ * @brief Start coalescing the data sent on a TLS connection.
+ *
+ * Until #TLS_FreeRTOS_Flush is called, #TLS_FreeRTOS_send copies the data to
+ * the send buffer of the connection, see #TLS_TRANSPORT_SEND_BUFFER_SIZE, and
+ * only writes it to TLS when the buffer is full. Data that is larger than the
+ * buffer is written as it is. #TLS_FreeRTOS_recv flushes the buffer before it
+ * reads, so a request that was sent corked is not held back while waiting for
+ * the response.
+ *
+ * @param[in] pNetworkContext The network context of the connection.
+ */
+    void TLS_FreeRTOS_Cork( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Write the data coalesced since #TLS_FreeRTOS_Cork to TLS, and stop
+ * coalescing.
+ *
+ * @param[in] pNetworkContext The network context of the connection.
+ *
+ * @return 0 if all the data was sent, and the connection is no longer corked;
+ * the number of bytes (> 0) still buffered if the socket timed out, in which
+ * case the connection stays corked and the flush can be retried;
+ * else a negative value to represent error.
+ */
+    int32_t TLS_FreeRTOS_Flush( NetworkContext_t * pNetworkContext );
+
+#endif /* if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 ) */
+
+/**
+ * @brief Set up a TLS configuration that several connections can share.
+ *
+ * The credentials are parsed, and the random number generator seeded, once
+ * for all the connections that use the configuration, rather than by each
+ * #TLS_FreeRTOS_Connect. This saves the time to set up each connection, and
+ * the heap used by a copy of the parsed credentials per connection. The
+ * configuration can be used by connections to different servers, as long as
+ * they all use these credentials.
+ *
+ * The root CA, client certificate and private key are copied, but the ALPN
+ * protocol list is referenced, so it must remain valid until the
+ * configuration is freed.
+ *
+ * @param[out] pSharedConfig The configuration to set up.
+ * @param[in] pNetworkCredentials The credentials and ALPN protocols of the
+ * connections. The disableSni member is not used, SNI is set by each
+ * connection.
+ *
+ * @return #TLS_TRANSPORT_SUCCESS, #TLS_TRANSPORT_INVALID_PARAMETER,
+ * #TLS_TRANSPORT_INSUFFICIENT_MEMORY, #TLS_TRANSPORT_INVALID_CREDENTIALS, or
+ * #TLS_TRANSPORT_INTERNAL_ERROR.
+ */
+TlsTransportStatus_t TLS_FreeRTOS_InitSharedConfig( TlsSharedConfig_t * pSharedConfig,
+                                                    const NetworkCredentials_t * pNetworkCredentials );
+
+/**
+ * @brief Release the reference to a shared TLS configuration taken by
+ * #TLS_FreeRTOS_InitSharedConfig.
+ *
+ * Each connection holds a reference to its configuration until it is
+ * disconnected, so the configuration is freed when it is released and all
+ * the connections that use it are disconnected. It must not be used for new
+ * connections after it is released.
+ *
+ * @param[in] pSharedConfig The configuration to release.
+ */
+void TLS_FreeRTOS_ReleaseSharedConfig( TlsSharedConfig_t * pSharedConfig );
+
 #endif /* ifndef USING_MBEDTLS */
@@ -124,6 +124,7 @@ static void sslContextFree( SSLContext_t * pSslContext );
  *
  * @param[in] pNetworkContext Network context.
  * @param[in] pHostName Remote host name, used for server name indication.
+ * @param[in] port Remote port, used with the host name to look up the cached session.
  * @param[in] pNetworkCredentials TLS setup parameters.
  *
  * @return #TLS_TRANSPORT_SUCCESS, #TLS_TRANSPORT_INSUFFICIENT_MEMORY, #TLS_TRANSPORT_INVALID_CREDENTIALS,
@@ -131,6 +132,7 @@ static void sslContextFree( SSLContext_t * pSslContext );
  */
 static TlsTransportStatus_t tlsSetup( NetworkContext_t * pNetworkContext,
                                       const char * pHostName,
+                                      uint16_t port,
                                       const NetworkCredentials_t * pNetworkCredentials );
 
 /**
@@ -239,12 +241,14 @@ static void sslContextFree( SSLContext_t * pSslContext )
 
 static TlsTransportStatus_t tlsSetup( NetworkContext_t * pNetworkContext,
                                       const char * pHostName,
+                                      uint16_t port,
                                       const NetworkCredentials_t * pNetworkCredentials )
 {
     TlsTransportParams_t * pTlsTransportParams = NULL;
     TlsTransportStatus_t returnStatus = TLS_TRANSPORT_SUCCESS;
     int32_t mbedtlsError = 0;
     CK_RV xResult = CKR_OK;
+    BaseType_t sessionOffered = pdFALSE;
 
     configASSERT( pNetworkContext != NULL );
     configASSERT( pNetworkContext->pParams != NULL );
@@ -440,6 +444,13 @@ static TlsTransportStatus_t tlsSetup( NetworkContext_t * pNetworkContext,
 
     if( returnStatus == TLS_TRANSPORT_SUCCESS )
     {
+        #if ( TLS_TRANSPORT_SESSION_CACHE_ENTRIES > 0 )
+            /* Offer the session of the last connection to the server. */
+            sessionOffered = MbedtlsTransport_SessionCacheOffer( &( pTlsTransportParams->sslContext.context ),
+                                                                 pHostName,
+                                                                 port );
+        #endif
+
         /* Perform the TLS handshake. */
         do
         {
@@ -455,8 +466,20 @@ static TlsTransportStatus_t tlsSetup( NetworkContext_t * pNetworkContext,
 
             returnStatus = TLS_TRANSPORT_HANDSHAKE_FAILED;
         }
+
+        #if ( TLS_TRANSPORT_SESSION_CACHE_ENTRIES > 0 )
+            MbedtlsTransport_SessionCacheUpdate( &( pTlsTransportParams->sslContext.context ),
+                                                 pHostName,
+                                                 port,
+                                                 sessionOffered,
+                                                 ( returnStatus == TLS_TRANSPORT_SUCCESS ) ? pdTRUE : pdFALSE );
+        #endif
     }
 
+    /* Not used when the session cache is disabled. */
+    ( void ) sessionOffered;
+    ( void ) port;
+
     if( returnStatus != TLS_TRANSPORT_SUCCESS )
     {
         sslContextFree( &( pTlsTransportParams->sslContext ) );
@@ -830,6 +853,13 @@ TlsTransportStatus_t TLS_FreeRTOS_Connect( NetworkContext_t * pNetworkContext,
     if( returnStatus == TLS_TRANSPORT_SUCCESS )
     {
         pTlsTransportParams = pNetworkContext->pParams;
+
+        #if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+            pTlsTransportParams->sendBuffer.length = 0U;
+            pTlsTransportParams->sendBuffer.retryLength = 0U;
+            pTlsTransportParams->corked = pdFALSE;
+        #endif
+
         socketStatus = Sockets_Connect( &( pTlsTransportParams->tcpSocket ),
                                         pHostName,
                                         port,
@@ -854,7 +884,7 @@ TlsTransportStatus_t TLS_FreeRTOS_Connect( NetworkContext_t * pNetworkContext,
     /* Perform TLS handshake. */
     if( returnStatus == TLS_TRANSPORT_SUCCESS )
     {
-        returnStatus = tlsSetup( pNetworkContext, pHostName, pNetworkCredentials );
+        returnStatus = tlsSetup( pNetworkContext, pHostName, port, pNetworkCredentials );
     }
 
     /* Clean up on failure. */
@@ -886,6 +916,13 @@ void TLS_FreeRTOS_Disconnect( NetworkContext_t * pNetworkContext )
     if( pNetworkContext != NULL && pNetworkContext->pParams != NULL )
     {
         pTlsTransportParams = pNetworkContext->pParams;
+
+        #if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+            /* Send the data left corked, if possible. */
+            ( void ) MbedtlsTransport_SendBufferFlush( &( pTlsTransportParams->sslContext.context ),
+                                                       &( pTlsTransportParams->sendBuffer ) );
+        #endif
+
         /* Attempting to terminate TLS connection. */
         tlsStatus = ( BaseType_t ) mbedtls_ssl_close_notify( &( pTlsTransportParams->sslContext.context ) );
 
@@ -938,6 +975,14 @@ int32_t TLS_FreeRTOS_recv( NetworkContext_t * pNetworkContext,
     configASSERT( ( pNetworkContext != NULL ) && ( pNetworkContext->pParams != NULL ) );
 
     pTlsTransportParams = pNetworkContext->pParams;
+
+    #if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+        /* The peer may be waiting for the data left corked before it
+         * responds. A failure is reported by the next send or flush. */
+        ( void ) MbedtlsTransport_SendBufferFlush( &( pTlsTransportParams->sslContext.context ),
+                                                   &( pTlsTransportParams->sendBuffer ) );
+    #endif
+
     tlsStatus = ( int32_t ) mbedtls_ssl_read( &( pTlsTransportParams->sslContext.context ),
                                               pBuffer,
                                               bytesToRecv );
@@ -981,9 +1026,33 @@ int32_t TLS_FreeRTOS_send( NetworkContext_t * pNetworkContext,
     configASSERT( ( pNetworkContext != NULL ) && ( pNetworkContext->pParams != NULL ) );
 
     pTlsTransportParams = pNetworkContext->pParams;
-    tlsStatus = ( int32_t ) mbedtls_ssl_write( &( pTlsTransportParams->sslContext.context ),
-                                               pBuffer,
-                                               bytesToSend );
+
+    #if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+        if( pTlsTransportParams->corked == pdTRUE )
+        {
+            tlsStatus = MbedtlsTransport_SendBufferAppend( &( pTlsTransportParams->sslContext.context ),
+                                                           &( pTlsTransportParams->sendBuffer ),
+                                                           pBuffer,
+                                                           bytesToSend );
+        }
+        else
+        {
+            /* The data a vectored send left in the send buffer goes first. */
+            tlsStatus = MbedtlsTransport_SendBufferFlush( &( pTlsTransportParams->sslContext.context ),
+                                                          &( pTlsTransportParams->sendBuffer ) );
+
+            if( tlsStatus >= 0 )
+            {
+                tlsStatus = ( int32_t ) mbedtls_ssl_write( &( pTlsTransportParams->sslContext.context ),
+                                                           pBuffer,
+                                                           bytesToSend );
+            }
+        }
+    #else
+        tlsStatus = ( int32_t ) mbedtls_ssl_write( &( pTlsTransportParams->sslContext.context ),
+                                                   pBuffer,
+                                                   bytesToSend );
+    #endif
 
     if( ( tlsStatus == MBEDTLS_ERR_SSL_TIMEOUT ) ||
         ( tlsStatus == MBEDTLS_ERR_SSL_WANT_READ ) ||
@@ -1012,3 +1081,131 @@ int32_t TLS_FreeRTOS_send( NetworkContext_t * pNetworkContext,
     return tlsStatus;
 }
 /*-----------------------------------------------------------*/
+
+int32_t TLS_FreeRTOS_writev( NetworkContext_t * pNetworkContext,
+                             const SocketsOutVector_t * pIoVec,
+                             size_t ioVecCount )
+{
+    TlsTransportParams_t * pTlsTransportParams = NULL;
+    int32_t tlsStatus = 0;
+    int32_t bytesSent = 0;
+    size_t vectorIndex = 0U;
+    size_t offset = 0U;
+    const uint8_t * pVectorBuffer = NULL;
+
+    configASSERT( ( pNetworkContext != NULL ) && ( pNetworkContext->pParams != NULL ) );
+    configASSERT( ( pIoVec != NULL ) || ( ioVecCount == 0U ) );
+
+    pTlsTransportParams = pNetworkContext->pParams;
+
+    while( ( vectorIndex < ioVecCount ) && ( tlsStatus >= 0 ) )
+    {
+        pVectorBuffer = ( const uint8_t * ) pIoVec[ vectorIndex ].pBuffer;
+
+        if( offset < pIoVec[ vectorIndex ].bufferLength )
+        {
+            #if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+                tlsStatus = MbedtlsTransport_SendBufferAppend( &( pTlsTransportParams->sslContext.context ),
+                                                               &( pTlsTransportParams->sendBuffer ),
+                                                               &( pVectorBuffer[ offset ] ),
+                                                               pIoVec[ vectorIndex ].bufferLength - offset );
+            #else
+                tlsStatus = ( int32_t ) mbedtls_ssl_write( &( pTlsTransportParams->sslContext.context ),
+                                                           &( pVectorBuffer[ offset ] ),
+                                                           pIoVec[ vectorIndex ].bufferLength - offset );
+            #endif
+
+            if( tlsStatus > 0 )
+            {
+                offset += ( size_t ) tlsStatus;
+                bytesSent += tlsStatus;
+            }
+        }
+        else
+        {
+            vectorIndex++;
+            offset = 0U;
+        }
+    }
+
+    #if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+        /* Send the gathered data, unless the connection is corked. */
+        if( ( tlsStatus >= 0 ) && ( pTlsTransportParams->corked == pdFALSE ) )
+        {
+            tlsStatus = MbedtlsTransport_SendBufferFlush( &( pTlsTransportParams->sslContext.context ),
+                                                          &( pTlsTransportParams->sendBuffer ) );
+        }
+    #endif
+
+    if( ( tlsStatus == MBEDTLS_ERR_SSL_TIMEOUT ) ||
+        ( tlsStatus == MBEDTLS_ERR_SSL_WANT_READ ) ||
+        ( tlsStatus == MBEDTLS_ERR_SSL_WANT_WRITE ) )
+    {
+        LogDebug( ( "Failed to send data. However, send can be retried on this error. "
+                    "mbedTLSError= %s : %s.",
+                    mbedtlsHighLevelCodeOrDefault( tlsStatus ),
+                    mbedtlsLowLevelCodeOrDefault( tlsStatus ) ) );
+
+        /* The bytes taken before the timeout, if any, are sent. */
+        tlsStatus = bytesSent;
+    }
+    else if( tlsStatus < 0 )
+    {
+        LogError( ( "Failed to send data:  mbedTLSError= %s : %s.",
+                    mbedtlsHighLevelCodeOrDefault( tlsStatus ),
+                    mbedtlsLowLevelCodeOrDefault( tlsStatus ) ) );
+    }
+    else
+    {
+        tlsStatus = bytesSent;
+    }
+
+    return tlsStatus;
+}
+/*-----------------------------------------------------------*/
+
+#if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+
+    void TLS_FreeRTOS_Cork( NetworkContext_t * pNetworkContext )
+    {
+        configASSERT( ( pNetworkContext != NULL ) && ( pNetworkContext->pParams != NULL ) );
+
+        pNetworkContext->pParams->corked = pdTRUE;
+    }
+/*-----------------------------------------------------------*/
+
+    int32_t TLS_FreeRTOS_Flush( NetworkContext_t * pNetworkContext )
+    {
+        TlsTransportParams_t * pTlsTransportParams = NULL;
+        int32_t tlsStatus = 0;
+
+        configASSERT( ( pNetworkContext != NULL ) && ( pNetworkContext->pParams != NULL ) );
+
+        pTlsTransportParams = pNetworkContext->pParams;
+        tlsStatus = MbedtlsTransport_SendBufferFlush( &( pTlsTransportParams->sslContext.context ),
+                                                      &( pTlsTransportParams->sendBuffer ) );
+
+        if( tlsStatus >= 0 )
+        {
+            pTlsTransportParams->corked = pdFALSE;
+            tlsStatus = 0;
+        }
+        else if( ( tlsStatus == MBEDTLS_ERR_SSL_TIMEOUT ) ||
+                 ( tlsStatus == MBEDTLS_ERR_SSL_WANT_READ ) ||
+                 ( tlsStatus == MBEDTLS_ERR_SSL_WANT_WRITE ) )
+        {
+            /* The rest can be sent by retrying the flush. */
+            tlsStatus = ( int32_t ) pTlsTransportParams->sendBuffer.length;
+        }
+        else
+        {
+            LogError( ( "Failed to send data:  mbedTLSError= %s : %s.",
+                        mbedtlsHighLevelCodeOrDefault( tlsStatus ),
+                        mbedtlsLowLevelCodeOrDefault( tlsStatus ) ) );
+        }
+
+        return tlsStatus;
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 ) */
@@ -79,6 +79,9 @@ extern void vLoggingPrintf( const char * pcFormatString,
 /* Transport interface include. */
 #include "transport_interface.h"
 
+/* FreeRTOS Socket wrapper include, for the buffers of the vectored send. */
+#include "sockets_wrapper.h"
+
 /* mbed TLS includes. */
 #include "mbedtls/ctr_drbg.h"
 #include "mbedtls/entropy.h"
@@ -88,6 +91,9 @@ extern void vLoggingPrintf( const char * pcFormatString,
 #include "mbedtls/pk.h"
 #include "mbedtls/pk_internal.h"
 
+/* Session cache and send buffer shared by the mbed TLS transports. */
+#include "mbedtls_transport_common.h"
+
 /* PKCS #11 includes. */
 #include "core_pkcs11.h"
 
@@ -119,6 +125,10 @@ typedef struct TlsTransportParams
 {
     Socket_t tcpSocket;
     SSLContext_t sslContext;
+    #if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+        TlsSendBuffer_t sendBuffer; /**< @brief The data sent since the connection was corked and not yet written to TLS. */
+        BaseType_t corked;          /**< @brief pdTRUE from #TLS_FreeRTOS_Cork to #TLS_FreeRTOS_Flush. */
+    #endif
 } TlsTransportParams_t;
 
 /**
@@ -227,4 +237,59 @@ int32_t TLS_FreeRTOS_send( NetworkContext_t * pNetworkContext,
                            const void * pBuffer,
                            size_t bytesToSend );
 
+/**
+ * @brief Sends the data of several buffers over an established TLS
+ * connection, as if they were one buffer.
+ *
+ * When #TLS_TRANSPORT_SEND_BUFFER_SIZE is greater than 0, the buffers are
+ * gathered into the send buffer of the connection, so a protocol header, body
+ * and trailer that fit in it are sent in one TLS record. If the connection is
+ * corked, see #TLS_FreeRTOS_Cork, they are only gathered. The data gathered
+ * when the socket times out stays in the send buffer, and is sent before the
+ * data of the next send. When #TLS_TRANSPORT_SEND_BUFFER_SIZE is 0, each
+ * buffer is sent in records of its own.
+ *
+ * @param[in] pNetworkContext The network context.
+ * @param[in] pIoVec The buffers to send, in order.
+ * @param[in] ioVecCount The number of buffers in pIoVec.
+ *
+ * @return Number of bytes (> 0) sent on success, counted from the start of the
+ * first buffer; 0 if the socket times out without sending any bytes;
+ * else a negative value to represent error.
+ */
+int32_t TLS_FreeRTOS_writev( NetworkContext_t * pNetworkContext,
+                             const SocketsOutVector_t * pIoVec,
+                             size_t ioVecCount );
+
+#if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+
+/**
+ * @brief Start coalescing the data sent on a TLS connection.
+ *
+ * Until #TLS_FreeRTOS_Flush is called, #TLS_FreeRTOS_send copies the data to
+ * the send buffer of the connection, see #TLS_TRANSPORT_SEND_BUFFER_SIZE, and
+ * only writes it to TLS when the buffer is full. Data that is larger than the
+ * buffer is written as it is. #TLS_FreeRTOS_recv flushes the buffer before it
+ * reads, so a request that was sent corked is not held back while waiting for
+ * the response.
+ *
+ * @param[in] pNetworkContext The network context of the connection.
+ */
+    void TLS_FreeRTOS_Cork( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Write the data coalesced since #TLS_FreeRTOS_Cork to TLS, and stop
+ * coalescing.
+ *
+ * @param[in] pNetworkContext The network context of the connection.
+ *
+ * @return 0 if all the data was sent, and the connection is no longer corked;
+ * the number of bytes (> 0) still buffered if the socket timed out, in which
+ * case the connection stays corked and the flush can be retried;
+ * else a negative value to represent error.
+ */
+    int32_t TLS_FreeRTOS_Flush( NetworkContext_t * pNetworkContext );
+
+#endif /* if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 ) */
+
 #endif /* ifndef USING_MBEDTLS_PKCS11 */
@@ -197,3 +197,34 @@ int32_t Plaintext_FreeRTOS_send( NetworkContext_t * pNetworkContext,
 
     return socketStatus;
 }
+
+int32_t Plaintext_FreeRTOS_writev( NetworkContext_t * pNetworkContext,
+                                   const SocketsOutVector_t * pIoVec,
+                                   size_t ioVecCount )
+{
+    PlaintextTransportParams_t * pPlaintextTransportParams = NULL;
+    int32_t socketStatus = 0;
+
+    configASSERT( ( pNetworkContext != NULL ) && ( pNetworkContext->pParams != NULL ) );
+
+    pPlaintextTransportParams = pNetworkContext->pParams;
+    socketStatus = Sockets_Writev( pPlaintextTransportParams->tcpSocket,
+                                   pIoVec,
+                                   ioVecCount );
+
+    if( socketStatus == -pdFREERTOS_ERRNO_ENOSPC )
+    {
+        /* As in Plaintext_FreeRTOS_send, zero bytes were sent. */
+        socketStatus = 0;
+    }
+
+    #if ( configUSE_PREEMPTION == 0 )
+        {
+            /* Give the IP task a chance to send the data, see
+             * Plaintext_FreeRTOS_send. */
+            taskYIELD();
+        }
+    #endif
+
+    return socketStatus;
+}
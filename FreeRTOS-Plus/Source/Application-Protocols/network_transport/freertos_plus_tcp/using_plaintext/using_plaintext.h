@@ -71,6 +71,9 @@ extern void vLoggingPrintf( const char * pcFormatString,
 /* Transport interface include. */
 #include "transport_interface.h"
 
+/* FreeRTOS Socket wrapper include, for the buffers of the vectored send. */
+#include "sockets_wrapper.h"
+
 /**
  * @brief Parameters for the network context that uses FreeRTOS+TCP sockets.
  */
@@ -149,4 +152,24 @@ int32_t Plaintext_FreeRTOS_send( NetworkContext_t * pNetworkContext,
                                  const void * pBuffer,
                                  size_t bytesToSend );
 
+/**
+ * @brief Sends the data of several buffers over an established TCP
+ * connection, as if they were one buffer.
+ *
+ * The buffers are copied straight into the TX stream buffer of the socket,
+ * see #Sockets_Writev, so a protocol header, body and trailer do not need to
+ * be copied to a staging buffer first, or sent with one call each.
+ *
+ * @param[in] pNetworkContext The network context containing the TCP socket
+ * handle.
+ * @param[in] pIoVec The buffers to send, in order.
+ * @param[in] ioVecCount The number of buffers in pIoVec.
+ *
+ * @return Number of bytes sent on success, counted from the start of the
+ * first buffer; 0 if the socket times out; else a negative value.
+ */
+int32_t Plaintext_FreeRTOS_writev( NetworkContext_t * pNetworkContext,
+                                   const SocketsOutVector_t * pIoVec,
+                                   size_t ioVecCount );
+
 #endif /* ifndef USING_PLAINTEXT_H */
@@ -35,6 +35,7 @@
 
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"
+#include "semphr.h"
 
 /* FreeRTOS+TCP includes. */
 #include "FreeRTOS_IP.h"
@@ -72,6 +73,7 @@ static void sslContextFree( SSLContext_t * pSslContext );
  *
  * @param[in] pNetworkContext Network context.
  * @param[in] pHostName Remote host name, used for server name indication.
+ * @param[in] port Remote port, used with the host name to look up the cached session.
  * @param[in] pNetworkCredentials TLS setup parameters.
  *
  * @return #TLS_TRANSPORT_SUCCESS, #TLS_TRANSPORT_INSUFFICIENT_MEMORY, #TLS_TRANSPORT_INVALID_CREDENTIALS,
@@ -79,6 +81,7 @@ static void sslContextFree( SSLContext_t * pSslContext );
  */
 static TlsTransportStatus_t tlsSetup( NetworkContext_t * pNetworkContext,
                                       const char * pHostName,
+                                      uint16_t port,
                                       const NetworkCredentials_t * pNetworkCredentials );
 
 /**
@@ -91,6 +94,10 @@ static TlsTransportStatus_t initTLS( void );
 /*
  *  @brief  Receive date from the socket passed as the context
  *
+ *  wolfSSL decrypts the records in place in its input buffer, which is passed
+ *  as buf, so the data is copied once, from the RX stream of the socket.
+ *  Reading it with FREERTOS_ZERO_COPY would not save that copy.
+ *
  *  @param[in] ssl WOLFSSL object.
  *  @param[in] buf Buffer for received data
  *  @param[in] sz  Size to receive
@@ -106,6 +113,9 @@ static int wolfSSL_IORecvGlue( WOLFSSL * ssl,
 /*
  *  @brief  Send date to the socket passed as the context
  *
+ *  wolfSSL encrypts the records in place in its output buffer, which is passed
+ *  as buf, so the data is copied once, to the TX stream of the socket.
+ *
  *  @param[in] ssl WOLFSSL object.
  *  @param[in] buf Buffer for data to be sent
  *  @param[in] sz  Size to send
@@ -129,6 +139,146 @@ static int wolfSSL_IOSendGlue( WOLFSSL * ssl,
 static TlsTransportStatus_t loadCredentials( NetworkContext_t * pNetCtx,
                                              const NetworkCredentials_t * pNetCred );
 
+#if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+
+/**
+ * @brief Write the data in the send buffer of a connection to TLS.
+ *
+ * The data that could not be written, because the socket timed out or
+ * because of an error, is kept at the start of the buffer. wolfSSL_want_write
+ * tells the two apart.
+ *
+ * @param[in] pNetworkContext The network context of the connection.
+ *
+ * @return pdPASS if the buffer was emptied, else pdFAIL.
+ */
+    static BaseType_t sendBufferFlush( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Copy data to the send buffer of a corked connection, after making
+ * room for it by writing the buffer to TLS if needed.
+ *
+ * @param[in] pNetworkContext The network context of the connection.
+ * @param[in] pBuffer Buffer containing the bytes to send.
+ * @param[in] bytesToSend Number of bytes to send from the buffer.
+ *
+ * @return Number of bytes (> 0) taken from pBuffer, else 0 or a negative
+ * value, as wolfSSL_write.
+ */
+    static int sendBufferAppend( NetworkContext_t * pNetworkContext,
+                                 const void * pBuffer,
+                                 size_t bytesToSend );
+
+#endif /* if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 ) */
+
+#if ( TLS_TRANSPORT_SESSION_CACHE_ENTRIES > 0 )
+
+/**
+ * @brief A TLS session kept for resumption, see #TLS_TRANSPORT_SESSION_CACHE_ENTRIES.
+ */
+    typedef struct SessionCacheEntry
+    {
+        char hostName[ TLS_TRANSPORT_SESSION_CACHE_HOST_NAME_LENGTH + 1 ]; /**< @brief Host name of the server, empty if the entry is not used. */
+        uint16_t port;                                                      /**< @brief Port of the server. */
+        uint32_t lastUsed;                                                  /**< @brief Value of #sessionCacheClock when the session was last offered or stored. */
+        WOLFSSL_SESSION * pSession;                                         /**< @brief The session negotiated with the server, from wolfSSL_get1_session. */
+    } SessionCacheEntry_t;
+
+/**
+ * @brief The cached sessions.
+ */
+    static SessionCacheEntry_t sessionCache[ TLS_TRANSPORT_SESSION_CACHE_ENTRIES ];
+
+/**
+ * @brief Incremented each time an entry is used, to find the least recently
+ * used entry.
+ */
+    static uint32_t sessionCacheClock = 0U;
+
+/**
+ * @brief Counts of the handshakes, returned by #TLS_FreeRTOS_GetSessionCacheStats.
+ */
+    static TlsSessionCacheStats_t sessionCacheStats = { 0 };
+
+/**
+ * @brief Mutex protecting the cache, created when it is first locked.
+ */
+    static SemaphoreHandle_t sessionCacheMutex = NULL;
+
+    #if ( configSUPPORT_STATIC_ALLOCATION == 1 )
+
+/**
+ * @brief Storage for #sessionCacheMutex.
+ */
+        static StaticSemaphore_t sessionCacheMutexStorage;
+    #endif
+
+/**
+ * @brief Lock the session cache, creating its mutex the first time.
+ */
+    static void sessionCacheLock( void );
+
+/**
+ * @brief Unlock the session cache.
+ */
+    static void sessionCacheUnlock( void );
+
+/**
+ * @brief Find the entry of a server in the session cache. The cache must be
+ * locked.
+ *
+ * @param[in] pHostName Host name of the server.
+ * @param[in] port Port of the server.
+ *
+ * @return The entry, or NULL if no session is cached for the server.
+ */
+    static SessionCacheEntry_t * sessionCacheFind( const char * pHostName,
+                                                   uint16_t port );
+
+/**
+ * @brief Release the session of an entry and mark the entry unused. The cache
+ * must be locked.
+ *
+ * @param[in] pEntry The entry.
+ */
+    static void sessionCacheRemove( SessionCacheEntry_t * pEntry );
+
+/**
+ * @brief Offer the session cached for a server, if any, in the handshake of a
+ * connection to the server.
+ *
+ * @param[in] pSsl WOLFSSL object of the connection.
+ * @param[in] pHostName Host name of the server.
+ * @param[in] port Port of the server.
+ *
+ * @return pdTRUE if a session was offered, pdFALSE otherwise.
+ */
+    static BaseType_t sessionCacheOffer( WOLFSSL * pSsl,
+                                         const char * pHostName,
+                                         uint16_t port );
+
+/**
+ * @brief Update the session cache and its counts after a handshake with a server.
+ *
+ * After a successful handshake, the session negotiated is stored, in place of
+ * the session cached for the server or of the least recently used session.
+ * After a failed handshake, the session offered is removed, in case the
+ * server did not accept it.
+ *
+ * @param[in] pSsl WOLFSSL object of the connection.
+ * @param[in] pHostName Host name of the server.
+ * @param[in] port Port of the server.
+ * @param[in] sessionOffered The value #sessionCacheOffer returned.
+ * @param[in] handshakeStatus #TLS_TRANSPORT_SUCCESS if the handshake succeeded.
+ */
+    static void sessionCacheUpdate( WOLFSSL * pSsl,
+                                    const char * pHostName,
+                                    uint16_t port,
+                                    BaseType_t sessionOffered,
+                                    TlsTransportStatus_t handshakeStatus );
+
+#endif /* if ( TLS_TRANSPORT_SESSION_CACHE_ENTRIES > 0 ) */
+
 /*-----------------------------------------------------------*/
 static int wolfSSL_IORecvGlue( WOLFSSL * ssl,
                                char * buf,
@@ -170,7 +320,11 @@ static int wolfSSL_IOSendGlue( WOLFSSL * ssl,
     Socket_t xSocket = ( Socket_t ) context;
     BaseType_t sent = FreeRTOS_send( xSocket, ( void * ) buf, ( size_t ) sz, 0 );
 
-    if( sent == -pdFREERTOS_ERRNO_EWOULDBLOCK )
+    /* FreeRTOS_send() returns -pdFREERTOS_ERRNO_ENOSPC when it times out
+     * before any data could be queued. wolfSSL retries the write of the
+     * record when it is asked again, rather than failing the connection. */
+    if( ( sent == -pdFREERTOS_ERRNO_EWOULDBLOCK ) ||
+        ( sent == -pdFREERTOS_ERRNO_ENOSPC ) )
     {
         sent = WOLFSSL_CBIO_ERR_WANT_WRITE;
     }
@@ -281,10 +435,12 @@ static TlsTransportStatus_t loadCredentials( NetworkContext_t * pNetCtx,
 
 static TlsTransportStatus_t tlsSetup( NetworkContext_t * pNetCtx,
                                       const char * pHostName,
+                                      uint16_t port,
                                       const NetworkCredentials_t * pNetCred )
 {
     TlsTransportStatus_t returnStatus = TLS_TRANSPORT_SUCCESS;
     Socket_t xSocket = { 0 };
+    BaseType_t sessionOffered = pdFALSE;
 
     configASSERT( pNetCtx != NULL );
     configASSERT( pHostName != NULL );
@@ -322,6 +478,13 @@ static TlsTransportStatus_t tlsSetup( NetworkContext_t * pNetCtx,
                 wolfSSL_SetIOReadCtx( pNetCtx->sslContext.ssl, xSocket );
                 wolfSSL_SetIOWriteCtx( pNetCtx->sslContext.ssl, xSocket );
 
+                #if ( TLS_TRANSPORT_SESSION_CACHE_ENTRIES > 0 )
+                    /* Offer the session of the last connection to the server. */
+                    sessionOffered = sessionCacheOffer( pNetCtx->sslContext.ssl,
+                                                        pHostName,
+                                                        port );
+                #endif
+
                 /* let wolfSSL perform tls handshake */
                 if( wolfSSL_connect( pNetCtx->sslContext.ssl )
                     == SSL_SUCCESS )
@@ -329,6 +492,19 @@ static TlsTransportStatus_t tlsSetup( NetworkContext_t * pNetCtx,
                     returnStatus = TLS_TRANSPORT_SUCCESS;
                 }
                 else
+                {
+                    returnStatus = TLS_TRANSPORT_HANDSHAKE_FAILED;
+                }
+
+                #if ( TLS_TRANSPORT_SESSION_CACHE_ENTRIES > 0 )
+                    sessionCacheUpdate( pNetCtx->sslContext.ssl,
+                                        pHostName,
+                                        port,
+                                        sessionOffered,
+                                        returnStatus );
+                #endif
+
+                if( returnStatus != TLS_TRANSPORT_SUCCESS )
                 {
                     wolfSSL_shutdown( pNetCtx->sslContext.ssl );
                     wolfSSL_free( pNetCtx->sslContext.ssl );
@@ -337,7 +513,6 @@ static TlsTransportStatus_t tlsSetup( NetworkContext_t * pNetCtx,
                     pNetCtx->sslContext.ctx = NULL;
 
                     LogError( ( "Failed to establish a TLS connection" ) );
-                    returnStatus = TLS_TRANSPORT_HANDSHAKE_FAILED;
                 }
             }
             else
@@ -364,14 +539,333 @@ static TlsTransportStatus_t tlsSetup( NetworkContext_t * pNetCtx,
         returnStatus = TLS_TRANSPORT_CONNECT_FAILURE;
     }
 
+    /* Not used when the session cache is disabled. */
+    ( void ) sessionOffered;
+    ( void ) port;
+
     return returnStatus;
 }
 
 /*-----------------------------------------------------------*/
 
+#if ( TLS_TRANSPORT_SESSION_CACHE_ENTRIES > 0 )
+
+    static void sessionCacheLock( void )
+    {
+        #if ( configSUPPORT_STATIC_ALLOCATION == 1 )
+            /* The mutex is created here so that the cache needs no
+             * initialization function. The critical section prevents two tasks
+             * from creating it. */
+            taskENTER_CRITICAL();
+            {
+                if( sessionCacheMutex == NULL )
+                {
+                    sessionCacheMutex = xSemaphoreCreateMutexStatic( &sessionCacheMutexStorage );
+                }
+            }
+            taskEXIT_CRITICAL();
+        #else
+            SemaphoreHandle_t newMutex = NULL;
+
+            /* The mutex is allocated outside the critical section, and only
+             * the first of the tasks that created one keeps it. */
+            if( sessionCacheMutex == NULL )
+            {
+                newMutex = xSemaphoreCreateMutex();
+
+                taskENTER_CRITICAL();
+                {
+                    if( sessionCacheMutex == NULL )
+                    {
+                        sessionCacheMutex = newMutex;
+                        newMutex = NULL;
+                    }
+                }
+                taskEXIT_CRITICAL();
+
+                if( newMutex != NULL )
+                {
+                    vSemaphoreDelete( newMutex );
+                }
+            }
+        #endif /* if ( configSUPPORT_STATIC_ALLOCATION == 1 ) */
+
+        configASSERT( sessionCacheMutex != NULL );
+        ( void ) xSemaphoreTake( sessionCacheMutex, portMAX_DELAY );
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void sessionCacheUnlock( void )
+    {
+        ( void ) xSemaphoreGive( sessionCacheMutex );
+    }
+
+/*-----------------------------------------------------------*/
+
+    static SessionCacheEntry_t * sessionCacheFind( const char * pHostName,
+                                                   uint16_t port )
+    {
+        SessionCacheEntry_t * pEntry = NULL;
+        size_t i;
+
+        for( i = 0U; ( i < TLS_TRANSPORT_SESSION_CACHE_ENTRIES ) && ( pEntry == NULL ); i++ )
+        {
+            if( ( sessionCache[ i ].port == port ) &&
+                ( sessionCache[ i ].hostName[ 0 ] != '\0' ) &&
+                ( strcmp( sessionCache[ i ].hostName, pHostName ) == 0 ) )
+            {
+                pEntry = &( sessionCache[ i ] );
+            }
+        }
+
+        return pEntry;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void sessionCacheRemove( SessionCacheEntry_t * pEntry )
+    {
+        if( pEntry->pSession != NULL )
+        {
+            wolfSSL_SESSION_free( pEntry->pSession );
+            pEntry->pSession = NULL;
+        }
+
+        pEntry->hostName[ 0 ] = '\0';
+    }
+
+/*-----------------------------------------------------------*/
+
+    static BaseType_t sessionCacheOffer( WOLFSSL * pSsl,
+                                         const char * pHostName,
+                                         uint16_t port )
+    {
+        SessionCacheEntry_t * pEntry = NULL;
+        BaseType_t sessionOffered = pdFALSE;
+
+        configASSERT( pSsl != NULL );
+        configASSERT( pHostName != NULL );
+
+        #ifdef HAVE_SESSION_TICKET
+            /* Ask TLS 1.2 servers for a session ticket too. */
+            ( void ) wolfSSL_UseSessionTicket( pSsl );
+        #endif
+
+        sessionCacheLock();
+
+        pEntry = sessionCacheFind( pHostName, port );
+
+        if( pEntry != NULL )
+        {
+            if( wolfSSL_set_session( pSsl, pEntry->pSession ) != SSL_SUCCESS )
+            {
+                /* For example, the session has expired. */
+                LogDebug( ( "The cached TLS session cannot be resumed." ) );
+                sessionCacheRemove( pEntry );
+            }
+            else
+            {
+                sessionCacheClock++;
+                pEntry->lastUsed = sessionCacheClock;
+                sessionOffered = pdTRUE;
+            }
+        }
+
+        sessionCacheUnlock();
+
+        return sessionOffered;
+    }
 
 /*-----------------------------------------------------------*/
 
+    static void sessionCacheUpdate( WOLFSSL * pSsl,
+                                    const char * pHostName,
+                                    uint16_t port,
+                                    BaseType_t sessionOffered,
+                                    TlsTransportStatus_t handshakeStatus )
+    {
+        SessionCacheEntry_t * pEntry = NULL;
+        WOLFSSL_SESSION * pSession = NULL;
+        size_t i;
+
+        configASSERT( pSsl != NULL );
+        configASSERT( pHostName != NULL );
+
+        sessionCacheLock();
+
+        pEntry = sessionCacheFind( pHostName, port );
+
+        if( handshakeStatus != TLS_TRANSPORT_SUCCESS )
+        {
+            if( ( sessionOffered == pdTRUE ) && ( pEntry != NULL ) )
+            {
+                sessionCacheRemove( pEntry );
+            }
+        }
+        else
+        {
+            if( sessionOffered == pdFALSE )
+            {
+                sessionCacheStats.misses++;
+            }
+            else if( wolfSSL_session_reused( pSsl ) == 1 )
+            {
+                sessionCacheStats.hits++;
+            }
+            else
+            {
+                sessionCacheStats.rejected++;
+            }
+
+            /* This is NULL if the server does not support resumption. */
+            if( strlen( pHostName ) <= TLS_TRANSPORT_SESSION_CACHE_HOST_NAME_LENGTH )
+            {
+                pSession = wolfSSL_get1_session( pSsl );
+            }
+
+            if( pSession == NULL )
+            {
+                if( pEntry != NULL )
+                {
+                    sessionCacheRemove( pEntry );
+                }
+            }
+            else
+            {
+                if( pEntry == NULL )
+                {
+                    /* Replace an unused entry, or the least recently used. */
+                    pEntry = &( sessionCache[ 0 ] );
+
+                    for( i = 1U; ( i < TLS_TRANSPORT_SESSION_CACHE_ENTRIES ) && ( pEntry->hostName[ 0 ] != '\0' ); i++ )
+                    {
+                        if( ( sessionCache[ i ].hostName[ 0 ] == '\0' ) ||
+                            ( ( sessionCacheClock - sessionCache[ i ].lastUsed ) > ( sessionCacheClock - pEntry->lastUsed ) ) )
+                        {
+                            pEntry = &( sessionCache[ i ] );
+                        }
+                    }
+
+                    sessionCacheRemove( pEntry );
+                    ( void ) strcpy( pEntry->hostName, pHostName );
+                    pEntry->port = port;
+                }
+                else if( pEntry->pSession != NULL )
+                {
+                    /* A resumed session can have a new ticket, so it is
+                     * stored as well. */
+                    wolfSSL_SESSION_free( pEntry->pSession );
+                }
+                else
+                {
+                    /* Empty else for MISRA 15.7 compliance. */
+                }
+
+                pEntry->pSession = pSession;
+                sessionCacheClock++;
+                pEntry->lastUsed = sessionCacheClock;
+            }
+        }
+
+        sessionCacheUnlock();
+    }
+
+/*-----------------------------------------------------------*/
+
+#endif /* if ( TLS_TRANSPORT_SESSION_CACHE_ENTRIES > 0 ) */
+
+#if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+
+    static BaseType_t sendBufferFlush( NetworkContext_t * pNetworkContext )
+    {
+        int iResult = 1;
+        size_t bytesSent = 0U;
+        size_t bytesToWrite = 0U;
+
+        /* A record holds at most MAX_RECORD_SIZE bytes, so the buffer can
+         * take more than one write. */
+        while( ( bytesSent < pNetworkContext->sendBufferLength ) && ( iResult > 0 ) )
+        {
+            /* A write that timed out must be retried with the same length,
+             * even if data was added to the buffer since. */
+            bytesToWrite = pNetworkContext->sendBufferRetryLength;
+
+            if( bytesToWrite == 0U )
+            {
+                bytesToWrite = pNetworkContext->sendBufferLength - bytesSent;
+            }
+
+            iResult = wolfSSL_write( pNetworkContext->sslContext.ssl,
+                                     &( pNetworkContext->sendBuffer[ bytesSent ] ),
+                                     ( int ) bytesToWrite );
+
+            if( iResult > 0 )
+            {
+                bytesSent += ( size_t ) iResult;
+                pNetworkContext->sendBufferRetryLength = 0U;
+            }
+            else if( wolfSSL_want_write( pNetworkContext->sslContext.ssl ) == 1 )
+            {
+                pNetworkContext->sendBufferRetryLength = bytesToWrite;
+            }
+            else
+            {
+                /* Empty else for MISRA 15.7 compliance. */
+            }
+        }
+
+        if( bytesSent > 0U )
+        {
+            pNetworkContext->sendBufferLength -= bytesSent;
+            ( void ) memmove( pNetworkContext->sendBuffer,
+                              &( pNetworkContext->sendBuffer[ bytesSent ] ),
+                              pNetworkContext->sendBufferLength );
+        }
+
+        return ( pNetworkContext->sendBufferLength == 0U ) ? pdPASS : pdFAIL;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static int sendBufferAppend( NetworkContext_t * pNetworkContext,
+                                 const void * pBuffer,
+                                 size_t bytesToSend )
+    {
+        int iResult = 0;
+        BaseType_t flushStatus = pdPASS;
+
+        if( bytesToSend > ( TLS_TRANSPORT_SEND_BUFFER_SIZE - pNetworkContext->sendBufferLength ) )
+        {
+            flushStatus = sendBufferFlush( pNetworkContext );
+        }
+
+        if( flushStatus != pdPASS )
+        {
+            /* The buffered data must be sent first, nothing is taken. */
+        }
+        else if( bytesToSend > TLS_TRANSPORT_SEND_BUFFER_SIZE )
+        {
+            /* Too large to be coalesced, the buffer is empty so it can be
+             * written as it is. */
+            iResult = wolfSSL_write( pNetworkContext->sslContext.ssl, pBuffer, ( int ) bytesToSend );
+        }
+        else
+        {
+            ( void ) memcpy( &( pNetworkContext->sendBuffer[ pNetworkContext->sendBufferLength ] ),
+                             pBuffer,
+                             bytesToSend );
+            pNetworkContext->sendBufferLength += bytesToSend;
+            iResult = ( int ) bytesToSend;
+        }
+
+        return iResult;
+    }
+
+/*-----------------------------------------------------------*/
+
+#endif /* if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 ) */
+
 TlsTransportStatus_t TLS_FreeRTOS_Connect( NetworkContext_t * pNetworkContext,
                                            const char * pHostName,
                                            uint16_t port,
@@ -403,6 +897,12 @@ TlsTransportStatus_t TLS_FreeRTOS_Connect( NetworkContext_t * pNetworkContext,
     /* Establish a TCP connection with the server. */
     if( returnStatus == TLS_TRANSPORT_SUCCESS )
     {
+        #if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+            pNetworkContext->sendBufferLength = 0U;
+            pNetworkContext->sendBufferRetryLength = 0U;
+            pNetworkContext->corked = pdFALSE;
+        #endif
+
         socketStatus = Sockets_Connect( &( pNetworkContext->tcpSocket ),
                                         pHostName,
                                         port,
@@ -427,7 +927,7 @@ TlsTransportStatus_t TLS_FreeRTOS_Connect( NetworkContext_t * pNetworkContext,
     /* Perform TLS handshake. */
     if( returnStatus == TLS_TRANSPORT_SUCCESS )
     {
-        returnStatus = tlsSetup( pNetworkContext, pHostName, pNetworkCredentials );
+        returnStatus = tlsSetup( pNetworkContext, pHostName, port, pNetworkCredentials );
     }
 
     /* Clean up on failure. */
@@ -455,6 +955,11 @@ void TLS_FreeRTOS_Disconnect( NetworkContext_t * pNetworkContext )
     WOLFSSL * pSsl = pNetworkContext->sslContext.ssl;
     WOLFSSL_CTX * pCtx = NULL;
 
+    #if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+        /* Send the data left corked, if possible. */
+        ( void ) sendBufferFlush( pNetworkContext );
+    #endif
+
     /* shutdown an active TLS connection */
     wolfSSL_shutdown( pSsl );
 
@@ -484,6 +989,12 @@ int32_t TLS_FreeRTOS_recv( NetworkContext_t * pNetworkContext,
     int iResult = 0;
     WOLFSSL * pSsl = pNetworkContext->sslContext.ssl;
 
+    #if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+        /* The peer may be waiting for the data left corked before it
+         * responds. A failure is reported by the next send or flush. */
+        ( void ) sendBufferFlush( pNetworkContext );
+    #endif
+
     iResult = wolfSSL_read( pSsl, pBuffer, bytesToRecv );
 
     if( iResult > 0 )
@@ -514,7 +1025,24 @@ int32_t TLS_FreeRTOS_send( NetworkContext_t * pNetworkContext,
     int iResult = 0;
     WOLFSSL * pSsl = pNetworkContext->sslContext.ssl;
 
-    iResult = wolfSSL_write( pSsl, pBuffer, bytesToSend );
+    #if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+        if( pNetworkContext->corked == pdTRUE )
+        {
+            iResult = sendBufferAppend( pNetworkContext, pBuffer, bytesToSend );
+        }
+        else if( sendBufferFlush( pNetworkContext ) == pdPASS )
+        {
+            /* The data a vectored send left in the send buffer went first. */
+            iResult = wolfSSL_write( pSsl, pBuffer, bytesToSend );
+        }
+        else
+        {
+            /* The send buffer could not be emptied. */
+            iResult = 0;
+        }
+    #else
+        iResult = wolfSSL_write( pSsl, pBuffer, bytesToSend );
+    #endif
 
     if( iResult > 0 )
     {
@@ -534,3 +1062,148 @@ int32_t TLS_FreeRTOS_send( NetworkContext_t * pNetworkContext,
     return tlsStatus;
 }
 /*-----------------------------------------------------------*/
+
+int32_t TLS_FreeRTOS_writev( NetworkContext_t * pNetworkContext,
+                             const SocketsOutVector_t * pIoVec,
+                             size_t ioVecCount )
+{
+    int32_t tlsStatus = 0;
+    int32_t bytesSent = 0;
+    int iResult = 1;
+    size_t vectorIndex = 0U;
+    size_t offset = 0U;
+    const uint8_t * pVectorBuffer = NULL;
+    WOLFSSL * pSsl = pNetworkContext->sslContext.ssl;
+
+    configASSERT( ( pIoVec != NULL ) || ( ioVecCount == 0U ) );
+
+    while( ( vectorIndex < ioVecCount ) && ( iResult > 0 ) )
+    {
+        pVectorBuffer = ( const uint8_t * ) pIoVec[ vectorIndex ].pBuffer;
+
+        if( offset < pIoVec[ vectorIndex ].bufferLength )
+        {
+            #if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+                iResult = sendBufferAppend( pNetworkContext,
+                                            &( pVectorBuffer[ offset ] ),
+                                            pIoVec[ vectorIndex ].bufferLength - offset );
+            #else
+                iResult = wolfSSL_write( pSsl,
+                                         &( pVectorBuffer[ offset ] ),
+                                         ( int ) ( pIoVec[ vectorIndex ].bufferLength - offset ) );
+            #endif
+
+            if( iResult > 0 )
+            {
+                offset += ( size_t ) iResult;
+                bytesSent += ( int32_t ) iResult;
+            }
+        }
+        else
+        {
+            vectorIndex++;
+            offset = 0U;
+        }
+    }
+
+    #if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+        /* Send the gathered data, unless the connection is corked. */
+        if( ( iResult > 0 ) && ( pNetworkContext->corked == pdFALSE ) )
+        {
+            iResult = ( sendBufferFlush( pNetworkContext ) == pdPASS ) ? 1 : 0;
+        }
+    #endif
+
+    if( iResult > 0 )
+    {
+        tlsStatus = bytesSent;
+    }
+    else if( wolfSSL_want_write( pSsl ) == 1 )
+    {
+        /* The bytes taken before the timeout, if any, are sent. */
+        tlsStatus = bytesSent;
+    }
+    else
+    {
+        tlsStatus = wolfSSL_state( pSsl );
+        LogError( ( "Error from wolfSSL_write %d : %s ",
+                    iResult, wolfSSL_ERR_reason_error_string( tlsStatus ) ) );
+    }
+
+    return tlsStatus;
+}
+/*-----------------------------------------------------------*/
+
+#if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+
+    void TLS_FreeRTOS_Cork( NetworkContext_t * pNetworkContext )
+    {
+        configASSERT( pNetworkContext != NULL );
+
+        pNetworkContext->corked = pdTRUE;
+    }
+
+/*-----------------------------------------------------------*/
+
+    int32_t TLS_FreeRTOS_Flush( NetworkContext_t * pNetworkContext )
+    {
+        int32_t tlsStatus = 0;
+        WOLFSSL * pSsl = NULL;
+
+        configASSERT( pNetworkContext != NULL );
+
+        pSsl = pNetworkContext->sslContext.ssl;
+
+        if( sendBufferFlush( pNetworkContext ) == pdPASS )
+        {
+            pNetworkContext->corked = pdFALSE;
+        }
+        else if( wolfSSL_want_write( pSsl ) == 1 )
+        {
+            /* The rest can be sent by retrying the flush. */
+            tlsStatus = ( int32_t ) pNetworkContext->sendBufferLength;
+        }
+        else
+        {
+            tlsStatus = wolfSSL_state( pSsl );
+            LogError( ( "Error from wolfSSL_write %d : %s ",
+                        tlsStatus, wolfSSL_ERR_reason_error_string( tlsStatus ) ) );
+        }
+
+        return tlsStatus;
+    }
+
+/*-----------------------------------------------------------*/
+
+#endif /* if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 ) */
+
+#if ( TLS_TRANSPORT_SESSION_CACHE_ENTRIES > 0 )
+
+    void TLS_FreeRTOS_GetSessionCacheStats( TlsSessionCacheStats_t * pStats )
+    {
+        configASSERT( pStats != NULL );
+
+        sessionCacheLock();
+        *pStats = sessionCacheStats;
+        sessionCacheUnlock();
+    }
+
+/*-----------------------------------------------------------*/
+
+    void TLS_FreeRTOS_ClearSessionCache( void )
+    {
+        size_t i;
+
+        sessionCacheLock();
+
+        for( i = 0U; i < TLS_TRANSPORT_SESSION_CACHE_ENTRIES; i++ )
+        {
+            sessionCacheRemove( &( sessionCache[ i ] ) );
+        }
+
+        sessionCacheUnlock();
+    }
+
+/*-----------------------------------------------------------*/
+
+#endif /* if ( TLS_TRANSPORT_SESSION_CACHE_ENTRIES > 0 ) */
@@ -63,9 +63,68 @@
 /* Transport interface include. */
 #include "transport_interface.h"
 
+/* FreeRTOS Socket wrapper include, for the buffers of the vectored send. */
+#include "sockets_wrapper.h"
+
 /* wolfSSL interface include. */
 #include "wolfssl/ssl.h"
 
+/**
+ * @brief The number of servers whose TLS session is kept, so that the next
+ * connection to the same server can resume the session.
+ *
+ * When this is greater than 0, a reference to the session negotiated with a
+ * server is kept, keyed by the host name and port passed to
+ * #TLS_FreeRTOS_Connect, and the session is offered with wolfSSL_set_session
+ * in the handshake of the next connection to the same host name and port. If
+ * the server resumes it, the handshake is abbreviated, without key exchange
+ * or certificate verification. When HAVE_SESSION_TICKET is defined in the
+ * wolfSSL settings, session tickets are requested and resumed as well. When
+ * all the entries are used, the least recently used session is replaced.
+ *
+ * The sessions are kept by wolfSSL, so its session cache must not be disabled
+ * with NO_SESSION_CACHE. The cache is disabled by default. To enable it,
+ * define this in FreeRTOSConfig.h.
+ *
+ * The cache is protected by a mutex, created when the cache is first used.
+ * It is statically allocated if configSUPPORT_STATIC_ALLOCATION is 1, and
+ * allocated from the FreeRTOS heap otherwise.
+ *
+ * @note A resumed session was authenticated with the credentials of the
+ * connection that negotiated it, so all the connections to a host name and
+ * port must use the same credentials.
+ */
+#ifndef TLS_TRANSPORT_SESSION_CACHE_ENTRIES
+    #define TLS_TRANSPORT_SESSION_CACHE_ENTRIES    0
+#endif
+
+/**
+ * @brief The length of the longest host name sessions are cached for, see
+ * #TLS_TRANSPORT_SESSION_CACHE_ENTRIES.
+ */
+#ifndef TLS_TRANSPORT_SESSION_CACHE_HOST_NAME_LENGTH
+    #define TLS_TRANSPORT_SESSION_CACHE_HOST_NAME_LENGTH    64
+#endif
+
+/**
+ * @brief The size of the buffer in which the data sent on a corked connection
+ * is coalesced, see #TLS_FreeRTOS_Cork.
+ *
+ * When this is greater than 0, each connection has a buffer of this size, in
+ * its network context, and the data of the sends between #TLS_FreeRTOS_Cork
+ * and #TLS_FreeRTOS_Flush is copied to it, and sent in as few TLS records as
+ * possible. For example an MQTT publish, which coreMQTT sends as a header and
+ * a payload, then costs one record, one MAC and one TCP segment rather than
+ * two. Up to the maximum record size of wolfSSL (MAX_RECORD_SIZE, or the
+ * negotiated maximum fragment length), a larger buffer coalesces more data.
+ *
+ * Corking is disabled by default. To enable it, define this in
+ * FreeRTOSConfig.h.
+ */
+#ifndef TLS_TRANSPORT_SEND_BUFFER_SIZE
+    #define TLS_TRANSPORT_SEND_BUFFER_SIZE    0
+#endif
+
 /**
  * @brief Secured connection context.
  */
@@ -83,6 +142,12 @@ struct NetworkContext
 {
     Socket_t tcpSocket;
     SSLContext_t sslContext;
+    #if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+        uint8_t sendBuffer[ TLS_TRANSPORT_SEND_BUFFER_SIZE ]; /**< @brief The data sent since the connection was corked and not yet written to TLS. */
+        size_t sendBufferLength;                              /**< @brief The number of bytes in sendBuffer. */
+        size_t sendBufferRetryLength;                         /**< @brief The length of the write of sendBuffer that timed out and must be retried, else 0. */
+        BaseType_t corked;                                    /**< @brief pdTRUE from #TLS_FreeRTOS_Cork to #TLS_FreeRTOS_Flush. */
+    #endif
 };
 
 /**
@@ -196,4 +261,91 @@ int32_t TLS_FreeRTOS_send( NetworkContext_t * pNetworkContext,
                            const void * pBuffer,
                            size_t bytesToSend );
 
+/**
+ * @brief Sends the data of several buffers over an established TLS
+ * connection, as if they were one buffer.
+ *
+ * When #TLS_TRANSPORT_SEND_BUFFER_SIZE is greater than 0, the buffers are
+ * gathered into the send buffer of the connection, so a protocol header, body
+ * and trailer that fit in it are sent in one TLS record. If the connection is
+ * corked, see #TLS_FreeRTOS_Cork, they are only gathered. The data gathered
+ * when the socket times out stays in the send buffer, and is sent before the
+ * data of the next send. When #TLS_TRANSPORT_SEND_BUFFER_SIZE is 0, each
+ * buffer is sent in records of its own.
+ *
+ * @param[in] pNetworkContext The network context.
+ * @param[in] pIoVec The buffers to send, in order.
+ * @param[in] ioVecCount The number of buffers in pIoVec.
+ *
+ * @return Number of bytes (> 0) sent on success, counted from the start of the
+ * first buffer; 0 if the socket times out without sending any bytes;
+ * else a negative value to represent error.
+ */
+int32_t TLS_FreeRTOS_writev( NetworkContext_t * pNetworkContext,
+                             const SocketsOutVector_t * pIoVec,
+                             size_t ioVecCount );
+
+#if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 )
+
+/**
+ * @brief Start coalescing the data sent on a TLS connection.
+ *
+ * Until #TLS_FreeRTOS_Flush is called, #TLS_FreeRTOS_send copies the data to
+ * the send buffer of the connection, see #TLS_TRANSPORT_SEND_BUFFER_SIZE, and
+ * only writes it to TLS when the buffer is full. Data that is larger than the
+ * buffer is written as it is. #TLS_FreeRTOS_recv flushes the buffer before it
+ * reads, so a request that was sent corked is not held back while waiting for
+ * the response.
+ *
+ * @param[in] pNetworkContext The network context of the connection.
+ */
+    void TLS_FreeRTOS_Cork( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Write the data coalesced since #TLS_FreeRTOS_Cork to TLS, and stop
+ * coalescing.
+ *
+ * @param[in] pNetworkContext The network context of the connection.
+ *
+ * @return 0 if all the data was sent, and the connection is no longer corked;
+ * the number of bytes (> 0) still buffered if the socket timed out, in which
+ * case the connection stays corked and the flush can be retried;
+ * else a negative value to represent error.
+ */
+    int32_t TLS_FreeRTOS_Flush( NetworkContext_t * pNetworkContext );
+
+#endif /* if ( TLS_TRANSPORT_SEND_BUFFER_SIZE > 0 ) */
+
+#if ( TLS_TRANSPORT_SESSION_CACHE_ENTRIES > 0 )
+
+/**
+ * @brief Counts of the handshakes of the connections to servers, depending on
+ * whether a cached TLS session was resumed.
+ */
+    typedef struct TlsSessionCacheStats
+    {
+        uint32_t hits;     /**< @brief Abbreviated handshakes, the server resumed the cached session. */
+        uint32_t misses;   /**< @brief Full handshakes, no session was cached for the server. */
+        uint32_t rejected; /**< @brief Full handshakes, the server did not resume the cached session. */
+    } TlsSessionCacheStats_t;
+
+/**
+ * @brief Get the counts of the handshakes since the device started, to see
+ * how often the TLS session cache saves a full handshake.
+ *
+ * @param[out] pStats The counts.
+ */
+    void TLS_FreeRTOS_GetSessionCacheStats( TlsSessionCacheStats_t * pStats );
+
+/**
+ * @brief Remove all the sessions from the TLS session cache, so the next
+ * connection to each server does a full handshake.
+ *
+ * This can be used when the credentials change, or to measure the time of
+ * full handshakes.
+ */
+    void TLS_FreeRTOS_ClearSessionCache( void );
+
+#endif /* if ( TLS_TRANSPORT_SESSION_CACHE_ENTRIES > 0 ) */
+
 #endif /* ifndef USING_WOLFSSL_H */
@@ -46,40 +46,74 @@ one of the application files:
 	#define configAPPLICATION_PROVIDES_cOutputBuffer 0
 #endif
 
-typedef struct xCOMMAND_INPUT_LIST
-{
-	const CLI_Command_Definition_t *pxCommandLineDefinition;
-	struct xCOMMAND_INPUT_LIST *pxNext;
-} CLI_Definition_List_Item_t;
+/* The maximum number of commands that can be registered, including the "help"
+command.  Registered commands are referenced from a fixed size array, so
+registering a command does not allocate any memory.  Each command uses the
+size of a pointer plus two bytes of RAM.  Set configCOMMAND_INT_MAX_COMMANDS in
+FreeRTOSConfig.h to change the default. */
+#ifndef configCOMMAND_INT_MAX_COMMANDS
+	#define configCOMMAND_INT_MAX_COMMANDS 64
+#endif
+
+#if( configCOMMAND_INT_MAX_COMMANDS > 0xffff )
+	#error configCOMMAND_INT_MAX_COMMANDS must be less than 65536
+#endif
 
 /*
  * The callback function that is executed when "help" is entered.  This is the
  * only default command that is always present.
  */
-static BaseType_t prvHelpCommand( char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString );
+static BaseType_t prvHelpCommand( CLI_Session_t *pxSession, char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString );
 
 /*
  * Return the number of parameters that follow the command name.
  */
 static int8_t prvGetNumberOfParameters( const char *pcCommandString );
 
-/* The definition of the "help" command.  This command is always at the front
-of the list of registered commands. */
+/*
+ * Compare the first word of pcCommandInput (up to the first space or the end
+ * of the string) with the command name pcCommand, in the manner of strcmp().
+ */
+static BaseType_t prvCompareCommand( const char *pcCommandInput, const char *pcCommand );
+
+/*
+ * Return the index in usSortedCommands[] of the command named by the first word
+ * of pcCommandInput, or, if there is no such command, the index at which it
+ * would be inserted.  pxFound is set to pdTRUE if the command was found.
+ */
+static UBaseType_t prvFindCommand( const char *pcCommandInput, BaseType_t *pxFound );
+
+/*
+ * Add a single command to the registered commands.  Must be called from a
+ * critical section.
+ */
+static BaseType_t prvRegisterCommand( const CLI_Command_Definition_t * const pxCommandToRegister );
+
+/* The definition of the "help" command.  This command is always the first of
+the registered commands. */
 static const CLI_Command_Definition_t xHelpCommand =
 {
 	"help",
 	"\r\nhelp:\r\n Lists all the registered commands\r\n\r\n",
-	prvHelpCommand,
-	0
+	NULL,
+	0,
+	prvHelpCommand
 };
 
-/* The definition of the list of commands.  Commands that are registered are
-added to this list. */
-static CLI_Definition_List_Item_t xRegisteredCommands =
-{
-	&xHelpCommand,	/* The first command in the list is always the help command, defined in this file. */
-	NULL			/* The next pointer is initialised to NULL, as there are no other registered commands yet. */
-};
+/* The registered commands, in the order in which they were registered, which
+is the order in which "help" lists them.  The first command is always the help
+command, defined in this file. */
+static const CLI_Command_Definition_t *pxRegisteredCommands[ configCOMMAND_INT_MAX_COMMANDS ] = { &xHelpCommand };
+static UBaseType_t uxNumberOfRegisteredCommands = 1;
+
+/* Indexes into pxRegisteredCommands[], sorted by command name, so a command
+can be found with a binary search rather than by comparing the input with
+every registered command. */
+static uint16_t usSortedCommands[ configCOMMAND_INT_MAX_COMMANDS ] = { 0 };
+
+/* The session used by FreeRTOS_CLIProcessCommand(), which writes the output to
+the buffer passed in by its caller. */
+static CLI_Session_t xDefaultSession = { NULL, NULL, 0, 0, NULL, NULL, NULL, 0, pdPASS };
 
 /* A buffer into which command outputs can be written is declared here, rather
 than in the command console implementation, to allow multiple command consoles
@@ -104,37 +138,73 @@ buffer needs to be placed at a fixed address (rather than by the linker). */
 
 BaseType_t FreeRTOS_CLIRegisterCommand( const CLI_Command_Definition_t * const pxCommandToRegister )
 {
-static CLI_Definition_List_Item_t *pxLastCommandInList = &xRegisteredCommands;
-CLI_Definition_List_Item_t *pxNewListItem;
-BaseType_t xReturn = pdFAIL;
+BaseType_t xReturn;
 
 	/* Check the parameter is not NULL. */
 	configASSERT( pxCommandToRegister );
 
-	/* Create a new list item that will reference the command being registered. */
-	pxNewListItem = ( CLI_Definition_List_Item_t * ) pvPortMalloc( sizeof( CLI_Definition_List_Item_t ) );
-	configASSERT( pxNewListItem );
+	taskENTER_CRITICAL();
+	{
+		xReturn = prvRegisterCommand( pxCommandToRegister );
+	}
+	taskEXIT_CRITICAL();
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t FreeRTOS_CLIRegisterCommandTable( const CLI_Command_Definition_t * const pxCommandTable, UBaseType_t uxNumberOfCommands )
+{
+UBaseType_t ux;
+BaseType_t xReturn = pdPASS;
+
+	/* Check the parameter is not NULL. */
+	configASSERT( pxCommandTable );
 
-	if( pxNewListItem != NULL )
+	for( ux = 0; ux < uxNumberOfCommands; ux++ )
 	{
+		/* One command per critical section, as each insertion has to move the
+		sorted index entries that follow it. */
 		taskENTER_CRITICAL();
 		{
-			/* Reference the command being registered from the newly created
-			list item. */
-			pxNewListItem->pxCommandLineDefinition = pxCommandToRegister;
+			if( prvRegisterCommand( &( pxCommandTable[ ux ] ) ) != pdPASS )
+			{
+				xReturn = pdFAIL;
+			}
+		}
+		taskEXIT_CRITICAL();
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvRegisterCommand( const CLI_Command_Definition_t * const pxCommandToRegister )
+{
+UBaseType_t uxPosition, ux;
+BaseType_t xFound;
+BaseType_t xReturn = pdFAIL;
 
-			/* The new list item will get added to the end of the list, so
-			pxNext has nowhere to point. */
-			pxNewListItem->pxNext = NULL;
+	/* The command must have a function to execute. */
+	configASSERT( ( pxCommandToRegister->pxCommandInterpreter != NULL ) || ( pxCommandToRegister->pxSessionCommandInterpreter != NULL ) );
 
-			/* Add the newly created list item to the end of the already existing
-			list. */
-			pxLastCommandInList->pxNext = pxNewListItem;
+	/* There must be space for the command, and a command of the same name must
+	not already be registered, as only one of them could ever be executed. */
+	configASSERT( uxNumberOfRegisteredCommands < ( UBaseType_t ) configCOMMAND_INT_MAX_COMMANDS );
+	uxPosition = prvFindCommand( pxCommandToRegister->pcCommand, &xFound );
+	configASSERT( xFound == pdFALSE );
 
-			/* Set the end of list marker to the new list item. */
-			pxLastCommandInList = pxNewListItem;
+	if( ( uxNumberOfRegisteredCommands < ( UBaseType_t ) configCOMMAND_INT_MAX_COMMANDS ) && ( xFound == pdFALSE ) )
+	{
+		/* Make room for the new command in the sorted index. */
+		for( ux = uxNumberOfRegisteredCommands; ux > uxPosition; ux-- )
+		{
+			usSortedCommands[ ux ] = usSortedCommands[ ux - 1 ];
 		}
-		taskEXIT_CRITICAL();
+
+		usSortedCommands[ uxPosition ] = ( uint16_t ) uxNumberOfRegisteredCommands;
+		pxRegisteredCommands[ uxNumberOfRegisteredCommands ] = pxCommandToRegister;
+		uxNumberOfRegisteredCommands++;
 
 		xReturn = pdPASS;
 	}
@@ -145,45 +215,89 @@ BaseType_t xReturn = pdFAIL;
 
 BaseType_t FreeRTOS_CLIProcessCommand( const char * const pcCommandInput, char * pcWriteBuffer, size_t xWriteBufferLen  )
 {
-static const CLI_Definition_List_Item_t *pxCommand = NULL;
-BaseType_t xReturn = pdTRUE;
-const char *pcRegisteredCommandString;
-size_t xCommandStringLength;
-
 	/* Note:  This function is not re-entrant.  It must not be called from more
 	thank one task. */
+	xDefaultSession.pcOutputBuffer = pcWriteBuffer;
+	xDefaultSession.xOutputBufferLength = xWriteBufferLen;
+
+	return FreeRTOS_CLIProcessCommandCtx( &xDefaultSession, pcCommandInput );
+}
+/*-----------------------------------------------------------*/
+
+void FreeRTOS_CLISessionInit( CLI_Session_t *pxSession, char *pcOutputBuffer, size_t xOutputBufferLength )
+{
+	configASSERT( pxSession );
+	configASSERT( pcOutputBuffer );
+
+	pxSession->pxCommand = NULL;
+	pxSession->pcOutputBuffer = pcOutputBuffer;
+	pxSession->xOutputBufferLength = xOutputBufferLength;
+	pxSession->uxCommandState = 0;
+	pxSession->pvCommandState = NULL;
+	pxSession->pxWriter = NULL;
+	pxSession->pvWriterContext = NULL;
+	pxSession->xOutputLength = 0;
+	pxSession->xWriteStatus = pdPASS;
+}
+/*-----------------------------------------------------------*/
+
+void FreeRTOS_CLISessionSetWriter( CLI_Session_t *pxSession, pdCOMMAND_LINE_OUTPUT_WRITER pxWriter, void *pvWriterContext )
+{
+	configASSERT( pxSession );
+
+	pxSession->pxWriter = pxWriter;
+	pxSession->pvWriterContext = pvWriterContext;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t FreeRTOS_CLIProcessCommandCtx( CLI_Session_t *pxSession, const char * const pcCommandInput )
+{
+const CLI_Command_Definition_t *pxCommand;
+char *pcWriteBuffer;
+size_t xWriteBufferLen;
+BaseType_t xReturn = pdTRUE;
+BaseType_t xFound;
+UBaseType_t uxPosition;
+
+	configASSERT( pxSession );
+	pxCommand = pxSession->pxCommand;
+	pcWriteBuffer = pxSession->pcOutputBuffer;
+	xWriteBufferLen = pxSession->xOutputBufferLength;
+
+	configASSERT( pcWriteBuffer );
+
+	/* Note:  Only the session is modified, so different sessions can be used
+	from different tasks at the same time. */
 
 	if( pxCommand == NULL )
 	{
-		/* Search for the command string in the list of registered commands. */
-		for( pxCommand = &xRegisteredCommands; pxCommand != NULL; pxCommand = pxCommand->pxNext )
+		/* No output of the new command has been lost yet. */
+		pxSession->xWriteStatus = pdPASS;
+
+		/* Search for the command string in the registered commands.  The
+		comparison stops at the first space in the input, so as not to pick up
+		a sub-string of a longer command, or a command followed by parameters
+		as a longer command. */
+		uxPosition = prvFindCommand( pcCommandInput, &xFound );
+
+		if( xFound != pdFALSE )
 		{
-			pcRegisteredCommandString = pxCommand->pxCommandLineDefinition->pcCommand;
-			xCommandStringLength = strlen( pcRegisteredCommandString );
-
-			/* To ensure the string lengths match exactly, so as not to pick up
-			a sub-string of a longer command, check the byte after the expected
-			end of the string is either the end of the string or a space before
-			a parameter. */
-			if( strncmp( pcCommandInput, pcRegisteredCommandString, xCommandStringLength ) == 0 )
+			pxCommand = pxRegisteredCommands[ usSortedCommands[ uxPosition ] ];
+
+			/* The command has been found.  Check it has the expected number
+			of parameters.  If cExpectedNumberOfParameters is -1, then there
+			could be a variable number of parameters and no check is made. */
+			if( pxCommand->cExpectedNumberOfParameters >= 0 )
 			{
-				if( ( pcCommandInput[ xCommandStringLength ] == ' ' ) || ( pcCommandInput[ xCommandStringLength ] == 0x00 ) )
+				if( prvGetNumberOfParameters( pcCommandInput ) != pxCommand->cExpectedNumberOfParameters )
 				{
-					/* The command has been found.  Check it has the expected
-					number of parameters.  If cExpectedNumberOfParameters is -1,
-					then there could be a variable number of parameters and no
-					check is made. */
-					if( pxCommand->pxCommandLineDefinition->cExpectedNumberOfParameters >= 0 )
-					{
-						if( prvGetNumberOfParameters( pcCommandInput ) != pxCommand->pxCommandLineDefinition->cExpectedNumberOfParameters )
-						{
-							xReturn = pdFALSE;
-						}
-					}
-
-					break;
+					xReturn = pdFALSE;
 				}
 			}
+
+			/* The command starts with a clean state. */
+			pxSession->uxCommandState = 0;
+			pxSession->pvCommandState = NULL;
 		}
 	}
 
@@ -196,8 +310,21 @@ size_t xCommandStringLength;
 	}
 	else if( pxCommand != NULL )
 	{
+		/* Output written with FreeRTOS_CLIWrite() when the session has no
+		writer starts from the beginning of the buffer each time the command is
+		called. */
+		pxSession->xOutputLength = 0;
+		pcWriteBuffer[ 0 ] = 0x00;
+
 		/* Call the callback function that is registered to this command. */
-		xReturn = pxCommand->pxCommandLineDefinition->pxCommandInterpreter( pcWriteBuffer, xWriteBufferLen, pcCommandInput );
+		if( pxCommand->pxSessionCommandInterpreter != NULL )
+		{
+			xReturn = pxCommand->pxSessionCommandInterpreter( pxSession, pcWriteBuffer, xWriteBufferLen, pcCommandInput );
+		}
+		else
+		{
+			xReturn = pxCommand->pxCommandInterpreter( pcWriteBuffer, xWriteBufferLen, pcCommandInput );
+		}
 
 		/* If xReturn is pdFALSE, then no further strings will be returned
 		after this one, and	pxCommand can be reset to NULL ready to search
@@ -214,10 +341,175 @@ size_t xCommandStringLength;
 		xReturn = pdFALSE;
 	}
 
+	pxSession->pxCommand = pxCommand;
+
 	return xReturn;
 }
 /*-----------------------------------------------------------*/
 
+BaseType_t FreeRTOS_CLIExecuteCommand( CLI_Session_t *pxSession, const char * const pcCommandInput )
+{
+BaseType_t xMoreDataToFollow;
+size_t xLength;
+
+	configASSERT( pxSession );
+	configASSERT( pxSession->pxWriter );
+
+	/* The command is run to completion even if the writer fails, so it gets
+	the chance to free any resources it holds. */
+	do
+	{
+		xMoreDataToFollow = FreeRTOS_CLIProcessCommandCtx( pxSession, pcCommandInput );
+
+		/* Pass on anything the command wrote into the output buffer.  The
+		buffer is empty if the command wrote its output with
+		FreeRTOS_CLIWrite(), as that has already been passed to the writer. */
+		xLength = strlen( pxSession->pcOutputBuffer );
+
+		if( xLength > ( size_t ) 0 )
+		{
+			( void ) FreeRTOS_CLIWrite( pxSession, pxSession->pcOutputBuffer, xLength );
+		}
+	} while( xMoreDataToFollow != pdFALSE );
+
+	return pxSession->xWriteStatus;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t FreeRTOS_CLIWrite( CLI_Session_t *pxSession, const char *pcData, size_t xDataLength )
+{
+size_t xSpace;
+
+	configASSERT( pxSession );
+	configASSERT( pcData );
+
+	if( pxSession->xWriteStatus != pdFAIL )
+	{
+		if( pxSession->pxWriter != NULL )
+		{
+			/* Straight to the transport, without copying the data. */
+			if( pxSession->pxWriter( pxSession->pvWriterContext, pcData, xDataLength ) != pdPASS )
+			{
+				pxSession->xWriteStatus = pdFAIL;
+			}
+		}
+		else
+		{
+			/* Append the data to the output buffer, leaving space for the null
+			terminator. */
+			configASSERT( pxSession->xOutputLength < pxSession->xOutputBufferLength );
+			xSpace = pxSession->xOutputBufferLength - pxSession->xOutputLength - ( size_t ) 1;
+
+			if( xDataLength > xSpace )
+			{
+				xDataLength = xSpace;
+				pxSession->xWriteStatus = pdFAIL;
+			}
+
+			memcpy( &( pxSession->pcOutputBuffer[ pxSession->xOutputLength ] ), pcData, xDataLength );
+			pxSession->xOutputLength += xDataLength;
+			pxSession->pcOutputBuffer[ pxSession->xOutputLength ] = 0x00;
+		}
+	}
+
+	return pxSession->xWriteStatus;
+}
+/*-----------------------------------------------------------*/
+
+#if( configUSE_TRACE_FACILITY == 1 )
+
+	void FreeRTOS_CLITaskSnapshotInit( CLI_TaskSnapshot_t *pxSnapshot, struct xTASK_STATUS *pxTaskStatusArray, CLI_TaskRunTime_t *pxPreviousRunTimes, UBaseType_t uxArraySize )
+	{
+		configASSERT( pxSnapshot );
+		configASSERT( pxTaskStatusArray );
+		configASSERT( pxPreviousRunTimes );
+
+		pxSnapshot->pxTaskStatusArray = pxTaskStatusArray;
+		pxSnapshot->pxPreviousRunTimes = pxPreviousRunTimes;
+		pxSnapshot->uxArraySize = uxArraySize;
+		pxSnapshot->uxNumberOfTasks = 0;
+		pxSnapshot->uxPreviousNumberOfTasks = 0;
+		pxSnapshot->ulTotalRunTime = 0UL;
+		pxSnapshot->ulPreviousTotalRunTime = 0UL;
+		pxSnapshot->xTickCount = 0;
+		pxSnapshot->xPreviousTickCount = 0;
+	}
+	/*-----------------------------------------------------------*/
+
+	UBaseType_t FreeRTOS_CLITakeTaskSnapshot( CLI_TaskSnapshot_t *pxSnapshot )
+	{
+	UBaseType_t x, uxNumberOfTasks;
+	uint32_t ulTotalRunTime = 0UL;
+
+		configASSERT( pxSnapshot );
+
+		/* The current snapshot becomes the previous one.  Only the run times
+		are kept, as that is all FreeRTOS_CLIGetTaskRunTime() needs.  After a
+		snapshot that failed there is no current snapshot, and the previous
+		one is kept. */
+		if( pxSnapshot->uxNumberOfTasks > 0 )
+		{
+			for( x = 0; x < pxSnapshot->uxNumberOfTasks; x++ )
+			{
+				pxSnapshot->pxPreviousRunTimes[ x ].uxTaskNumber = pxSnapshot->pxTaskStatusArray[ x ].xTaskNumber;
+				pxSnapshot->pxPreviousRunTimes[ x ].ulRunTimeCounter = pxSnapshot->pxTaskStatusArray[ x ].ulRunTimeCounter;
+			}
+
+			pxSnapshot->uxPreviousNumberOfTasks = pxSnapshot->uxNumberOfTasks;
+			pxSnapshot->ulPreviousTotalRunTime = pxSnapshot->ulTotalRunTime;
+			pxSnapshot->xPreviousTickCount = pxSnapshot->xTickCount;
+		}
+
+		/* uxTaskGetSystemState() returns 0 if the array is too small to hold
+		all the tasks. */
+		uxNumberOfTasks = uxTaskGetSystemState( pxSnapshot->pxTaskStatusArray, pxSnapshot->uxArraySize, &ulTotalRunTime );
+		pxSnapshot->uxNumberOfTasks = uxNumberOfTasks;
+
+		if( uxNumberOfTasks > 0 )
+		{
+			pxSnapshot->ulTotalRunTime = ulTotalRunTime;
+			pxSnapshot->xTickCount = xTaskGetTickCount();
+		}
+
+		return uxNumberOfTasks;
+	}
+	/*-----------------------------------------------------------*/
+
+	uint32_t FreeRTOS_CLIGetTaskRunTime( const CLI_TaskSnapshot_t *pxSnapshot, UBaseType_t uxIndex )
+	{
+	UBaseType_t x, uxTaskNumber;
+	uint32_t ulPreviousRunTime = 0UL;
+
+		configASSERT( pxSnapshot );
+		configASSERT( uxIndex < pxSnapshot->uxNumberOfTasks );
+
+		uxTaskNumber = pxSnapshot->pxTaskStatusArray[ uxIndex ].xTaskNumber;
+
+		/* The tasks are often in the same position as in the previous snapshot,
+		so look there first before searching all of them. */
+		if( ( uxIndex < pxSnapshot->uxPreviousNumberOfTasks ) && ( pxSnapshot->pxPreviousRunTimes[ uxIndex ].uxTaskNumber == uxTaskNumber ) )
+		{
+			ulPreviousRunTime = pxSnapshot->pxPreviousRunTimes[ uxIndex ].ulRunTimeCounter;
+		}
+		else
+		{
+			for( x = 0; x < pxSnapshot->uxPreviousNumberOfTasks; x++ )
+			{
+				if( pxSnapshot->pxPreviousRunTimes[ x ].uxTaskNumber == uxTaskNumber )
+				{
+					ulPreviousRunTime = pxSnapshot->pxPreviousRunTimes[ x ].ulRunTimeCounter;
+					break;
+				}
+			}
+		}
+
+		/* Unsigned arithmetic handles the counter wrapping. */
+		return pxSnapshot->pxTaskStatusArray[ uxIndex ].ulRunTimeCounter - ulPreviousRunTime;
+	}
+
+#endif /* configUSE_TRACE_FACILITY */
+/*-----------------------------------------------------------*/
+
 char *FreeRTOS_CLIGetOutputBuffer( void )
 {
 	return cOutputBuffer;
@@ -280,28 +572,41 @@ const char *pcReturn = NULL;
 }
 /*-----------------------------------------------------------*/
 
-static BaseType_t prvHelpCommand( char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString )
+static BaseType_t prvHelpCommand( CLI_Session_t *pxSession, char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString )
 {
-static const CLI_Definition_List_Item_t * pxCommand = NULL;
 BaseType_t xReturn;
 
 	( void ) pcCommandString;
 
-	if( pxCommand == NULL )
+	if( pxSession->pxWriter != NULL )
 	{
-		/* Reset the pxCommand pointer back to the start of the list. */
-		pxCommand = &xRegisteredCommands;
-	}
+		/* The help strings can be passed to the transport directly, so all
+		of them are written in this call, without being copied. */
+		while( pxSession->uxCommandState < uxNumberOfRegisteredCommands )
+		{
+			if( FreeRTOS_CLIWrite( pxSession, pxRegisteredCommands[ pxSession->uxCommandState ]->pcHelpString, strlen( pxRegisteredCommands[ pxSession->uxCommandState ]->pcHelpString ) ) != pdPASS )
+			{
+				break;
+			}
 
-	/* Return the next command help string, before moving the pointer on to
-	the next command in the list. */
-	strncpy( pcWriteBuffer, pxCommand->pxCommandLineDefinition->pcHelpString, xWriteBufferLen );
-	pxCommand = pxCommand->pxNext;
+			pxSession->uxCommandState++;
+		}
 
-	if( pxCommand == NULL )
+		pxSession->uxCommandState = uxNumberOfRegisteredCommands;
+	}
+	else
+	{
+		/* Return the next command help string, before moving the session's
+		index on to the next command.  The index starts at 0 for each help
+		command. */
+		strncpy( pcWriteBuffer, pxRegisteredCommands[ pxSession->uxCommandState ]->pcHelpString, xWriteBufferLen );
+		pxSession->uxCommandState++;
+	}
+
+	if( pxSession->uxCommandState >= uxNumberOfRegisteredCommands )
 	{
-		/* There are no more commands in the list, so there will be no more
-		strings to return after this one and pdFALSE should be returned. */
+		/* There are no more commands, so there will be no more strings to
+		return after this one and pdFALSE should be returned. */
 		xReturn = pdFALSE;
 	}
 	else
@@ -313,6 +618,65 @@ BaseType_t xReturn;
 }
 /*-----------------------------------------------------------*/
 
+static BaseType_t prvCompareCommand( const char *pcCommandInput, const char *pcCommand )
+{
+unsigned char ucInput, ucCommand;
+
+	do
+	{
+		/* The end of the first word of the input counts as the end of the
+		string.  Command names cannot contain spaces. */
+		ucInput = ( unsigned char ) *pcCommandInput;
+		if( ucInput == ( unsigned char ) ' ' )
+		{
+			ucInput = 0x00;
+		}
+
+		ucCommand = ( unsigned char ) *pcCommand;
+
+		pcCommandInput++;
+		pcCommand++;
+
+	} while( ( ucInput == ucCommand ) && ( ucInput != 0x00 ) );
+
+	return ( BaseType_t ) ucInput - ( BaseType_t ) ucCommand;
+}
+/*-----------------------------------------------------------*/
+
+static UBaseType_t prvFindCommand( const char *pcCommandInput, BaseType_t *pxFound )
+{
+UBaseType_t uxLow = 0, uxHigh = uxNumberOfRegisteredCommands, uxMiddle;
+BaseType_t xDifference;
+
+	*pxFound = pdFALSE;
+
+	/* Binary search of the sorted index, for the first command that is not
+	less than the input. */
+	while( uxLow < uxHigh )
+	{
+		uxMiddle = uxLow + ( ( uxHigh - uxLow ) / 2 );
+		xDifference = prvCompareCommand( pcCommandInput, pxRegisteredCommands[ usSortedCommands[ uxMiddle ] ]->pcCommand );
+
+		if( xDifference == 0 )
+		{
+			*pxFound = pdTRUE;
+			uxLow = uxMiddle;
+			break;
+		}
+		else if( xDifference > 0 )
+		{
+			uxLow = uxMiddle + 1;
+		}
+		else
+		{
+			uxHigh = uxMiddle;
+		}
+	}
+
+	return uxLow;
+}
+/*-----------------------------------------------------------*/
+
 static int8_t prvGetNumberOfParameters( const char *pcCommandString )
 {
 int8_t cParameters = 0;
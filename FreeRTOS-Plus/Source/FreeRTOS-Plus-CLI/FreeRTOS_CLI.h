@@ -28,6 +28,9 @@
 #ifndef COMMAND_INTERPRETER_H
 #define COMMAND_INTERPRETER_H
 
+struct xCLI_SESSION;
+struct xTASK_STATUS;
+
 /* The prototype to which callback functions used to process command line
 commands must comply.  pcWriteBuffer is a buffer into which the output from
 executing the command can be written, xWriteBufferLen is the length, in bytes of
@@ -35,6 +38,21 @@ the pcWriteBuffer buffer, and pcCommandString is the entire string as input by
 the user (from which parameters can be extracted).*/
 typedef BaseType_t (*pdCOMMAND_LINE_CALLBACK)( char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString );
 
+/* The prototype of callback functions that keep the state they need between
+calls (when they return pdTRUE) in the session that executes the command,
+rather than in static variables, so the command can be executed by several
+sessions at the same time.  The other parameters are as for
+pdCOMMAND_LINE_CALLBACK. */
+typedef BaseType_t (*pdCOMMAND_LINE_SESSION_CALLBACK)( struct xCLI_SESSION *pxSession, char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString );
+
+/* The prototype of functions that pass the output of a session's commands
+directly to the transport, for example a UART or a socket.  xDataLength bytes
+from pcData must be sent - pcData is not necessarily null terminated.  Return
+pdPASS if the data was sent, or pdFAIL if it could not be sent, for example
+because the connection was closed.  pvWriterContext is the value passed to
+FreeRTOS_CLISessionSetWriter(). */
+typedef BaseType_t (*pdCOMMAND_LINE_OUTPUT_WRITER)( void *pvWriterContext, const char *pcData, size_t xDataLength );
+
 /* The structure that defines command line commands.  A command line command
 should be defined by declaring a const structure of this type. */
 typedef struct xCOMMAND_LINE_INPUT
@@ -43,8 +61,51 @@ typedef struct xCOMMAND_LINE_INPUT
 	const char * const pcHelpString;			/* String that describes how to use the command.  Should start with the command itself, and end with "\r\n".  For example "help: Returns a list of all the commands\r\n". */
 	const pdCOMMAND_LINE_CALLBACK pxCommandInterpreter;	/* A pointer to the callback function that will return the output generated by the command. */
 	int8_t cExpectedNumberOfParameters;			/* Commands expect a fixed number of parameters, which may be zero. */
+	const pdCOMMAND_LINE_SESSION_CALLBACK pxSessionCommandInterpreter;	/* Optional, used instead of pxCommandInterpreter if not NULL.  Can be left out of the initialiser. */
 } CLI_Command_Definition_t;
 
+/* The state of one command console session, such as a UART console or a
+network connection.  Each session has its own output buffer and executes
+commands independently of the other sessions.  Initialise with
+FreeRTOS_CLISessionInit(). */
+typedef struct xCLI_SESSION
+{
+	const CLI_Command_Definition_t *pxCommand;	/* The command being executed, or NULL.  Private to FreeRTOS_CLI.c. */
+	char *pcOutputBuffer;						/* The buffer FreeRTOS_CLIProcessCommandCtx() writes the output to. */
+	size_t xOutputBufferLength;					/* The size, in bytes, of pcOutputBuffer. */
+	UBaseType_t uxCommandState;					/* For use by pdCOMMAND_LINE_SESSION_CALLBACK commands, set to 0 when a command starts. */
+	void *pvCommandState;						/* For use by pdCOMMAND_LINE_SESSION_CALLBACK commands, set to NULL when a command starts. */
+	pdCOMMAND_LINE_OUTPUT_WRITER pxWriter;		/* Passes output to the transport, or NULL if the output is only written to pcOutputBuffer.  Set with FreeRTOS_CLISessionSetWriter(). */
+	void *pvWriterContext;						/* The value passed to pxWriter. */
+	size_t xOutputLength;						/* The number of bytes FreeRTOS_CLIWrite() has placed in pcOutputBuffer.  Private to FreeRTOS_CLI.c. */
+	BaseType_t xWriteStatus;					/* pdFAIL if output of the current command was lost.  Private to FreeRTOS_CLI.c. */
+} CLI_Session_t;
+
+/* The run time of a task when the previous snapshot was taken by
+FreeRTOS_CLITakeTaskSnapshot(). */
+typedef struct xCLI_TASK_RUN_TIME
+{
+	UBaseType_t uxTaskNumber;					/* The task's number, which, unlike its handle, is not reused when a task is deleted and another created. */
+	uint32_t ulRunTimeCounter;					/* The run time counter of the task. */
+} CLI_TaskRunTime_t;
+
+/* Consecutive snapshots of the tasks, for commands that report the processing
+time each task used between two executions of the command.  The arrays are
+provided by the caller, so taking a snapshot does not allocate any memory.
+Initialise with FreeRTOS_CLITaskSnapshotInit(). */
+typedef struct xCLI_TASK_SNAPSHOT
+{
+	struct xTASK_STATUS *pxTaskStatusArray;		/* The tasks in the current snapshot, as returned by uxTaskGetSystemState(). */
+	CLI_TaskRunTime_t *pxPreviousRunTimes;		/* The run times of the tasks in the previous snapshot.  Private to FreeRTOS_CLI.c. */
+	UBaseType_t uxArraySize;					/* The number of entries in each of the arrays. */
+	UBaseType_t uxNumberOfTasks;				/* The number of tasks in the current snapshot. */
+	UBaseType_t uxPreviousNumberOfTasks;		/* The number of tasks in the previous snapshot.  Private to FreeRTOS_CLI.c. */
+	uint32_t ulTotalRunTime;					/* The total run time when the current snapshot was taken. */
+	uint32_t ulPreviousTotalRunTime;			/* The total run time when the previous snapshot was taken. */
+	TickType_t xTickCount;						/* The tick count when the current snapshot was taken. */
+	TickType_t xPreviousTickCount;				/* The tick count when the previous snapshot was taken. */
+} CLI_TaskSnapshot_t;
+
 /* For backward compatibility. */
 #define xCommandLineInput CLI_Command_Definition_t
 
@@ -53,9 +114,32 @@ typedef struct xCOMMAND_LINE_INPUT
  * Registering a command adds the command to the list of commands that are
  * handled by the command interpreter.  Once a command has been registered it
  * can be executed from the command line.
+ *
+ * No memory is allocated.  The command is referenced, not copied, so the
+ * structure must remain valid for as long as the command is registered.  At
+ * most configCOMMAND_INT_MAX_COMMANDS commands (including "help") can be
+ * registered, and each command name can only be registered once - pdFAIL is
+ * returned otherwise.
  */
 BaseType_t FreeRTOS_CLIRegisterCommand( const CLI_Command_Definition_t * const pxCommandToRegister );
 
+/*
+ * Register all uxNumberOfCommands commands of the array pxCommandTable, which
+ * would normally be declared const, so a whole set of commands is defined at
+ * compile time and registered with a single call.  The commands are handled
+ * as if they were registered one by one with FreeRTOS_CLIRegisterCommand(),
+ * in array order.  pdFAIL is returned if any of them could not be registered.
+ *
+ * The limit on the number of commands also applies to tables: at most
+ * configCOMMAND_INT_MAX_COMMANDS commands (64 by default), including "help"
+ * and the commands registered by other calls, can be registered.  Define
+ * configCOMMAND_INT_MAX_COMMANDS in FreeRTOSConfig.h to register more.  The
+ * commands of the table that do not fit are not registered, and, if
+ * configASSERT() is not defined, the only indication of that is the return
+ * value, so check it.
+ */
+BaseType_t FreeRTOS_CLIRegisterCommandTable( const CLI_Command_Definition_t * const pxCommandTable, UBaseType_t uxNumberOfCommands );
+
 /*
  * Runs the command interpreter for the command string "pcCommandInput".  Any
  * output generated by running the command will be placed into pcWriteBuffer.
@@ -65,10 +149,99 @@ BaseType_t FreeRTOS_CLIRegisterCommand( const CLI_Command_Definition_t * const p
  * FreeRTOS_CLIProcessCommand should be called repeatedly until it returns pdFALSE.
  *
  * pcCmdIntProcessCommand is not reentrant.  It must not be called from more
- * than one task - or at least - by more than one task at a time.
+ * than one task - or at least - by more than one task at a time.  It uses a
+ * single session internally, use FreeRTOS_CLIProcessCommandCtx() to provide
+ * access to the command interpreter from more than one interface.
  */
 BaseType_t FreeRTOS_CLIProcessCommand( const char * const pcCommandInput, char * pcWriteBuffer, size_t xWriteBufferLen  );
 
+/*
+ * Prepare pxSession for use with FreeRTOS_CLIProcessCommandCtx().  The output
+ * of the commands executed by the session is written to pcOutputBuffer, which
+ * is xOutputBufferLength bytes long.
+ */
+void FreeRTOS_CLISessionInit( CLI_Session_t *pxSession, char *pcOutputBuffer, size_t xOutputBufferLength );
+
+/*
+ * As FreeRTOS_CLIProcessCommand(), but the progress of the command and its
+ * output are kept in pxSession, and the output is written to the session's
+ * output buffer.  Like FreeRTOS_CLIProcessCommand(), it should be called
+ * repeatedly until it returns pdFALSE.
+ *
+ * Different sessions can be used by different tasks at the same time, as long
+ * as all the commands are registered before the sessions start.  Commands that
+ * only implement pxCommandInterpreter, and keep state in static variables, can
+ * still be executed by one session at a time only.
+ */
+BaseType_t FreeRTOS_CLIProcessCommandCtx( CLI_Session_t *pxSession, const char * const pcCommandInput );
+
+/*
+ * Set the function that passes the output of the commands executed by
+ * pxSession to the transport, such as a UART or a socket.  pvWriterContext is
+ * passed to pxWriter each time it is called.  The session's output buffer is
+ * still required, by commands that write their output into pcWriteBuffer.
+ */
+void FreeRTOS_CLISessionSetWriter( CLI_Session_t *pxSession, pdCOMMAND_LINE_OUTPUT_WRITER pxWriter, void *pvWriterContext );
+
+/*
+ * Execute the command string "pcCommandInput" to completion, with all of its
+ * output passed to the session's writer (see FreeRTOS_CLISessionSetWriter())
+ * as it is generated, so there is no need to call this function repeatedly.
+ * Output that a command writes into pcWriteBuffer is passed to the writer
+ * each time the command returns.
+ *
+ * Returns pdPASS if all the output was written, or pdFAIL if the writer
+ * failed, in which case the command is still run to completion, but the rest
+ * of its output is discarded.
+ */
+BaseType_t FreeRTOS_CLIExecuteCommand( CLI_Session_t *pxSession, const char * const pcCommandInput );
+
+/*
+ * For use by pdCOMMAND_LINE_SESSION_CALLBACK commands, to output xDataLength
+ * bytes from pcData as they are generated, rather than by returning pdTRUE to
+ * be called again each time pcWriteBuffer is full.  This allows a command to
+ * output a large listing with only one line of it in RAM at any time.
+ *
+ * If the session has a writer the data is passed straight to the writer,
+ * otherwise it is appended to the session's output buffer, in which case the
+ * data that does not fit in the buffer is lost.  A command that uses this
+ * function must not write its output into pcWriteBuffer as well.
+ *
+ * Returns pdPASS if the data was written.  pdFAIL is returned if it was not,
+ * and from then on until the command completes, so the command can stop
+ * generating output no one will see.
+ */
+BaseType_t FreeRTOS_CLIWrite( CLI_Session_t *pxSession, const char *pcData, size_t xDataLength );
+
+/*
+ * Prepare pxSnapshot for use with FreeRTOS_CLITakeTaskSnapshot().
+ * pxTaskStatusArray and pxPreviousRunTimes are arrays of uxArraySize entries
+ * each, which must remain valid for as long as pxSnapshot is used.  The first
+ * snapshot is compared with the start of the scheduler.
+ *
+ * The task snapshot functions are only available if configUSE_TRACE_FACILITY
+ * is set to 1 in FreeRTOSConfig.h.  A snapshot must not be used by more than
+ * one task at a time.
+ */
+void FreeRTOS_CLITaskSnapshotInit( CLI_TaskSnapshot_t *pxSnapshot, struct xTASK_STATUS *pxTaskStatusArray, CLI_TaskRunTime_t *pxPreviousRunTimes, UBaseType_t uxArraySize );
+
+/*
+ * Keep the run times of the current snapshot as the previous snapshot, then
+ * take a new snapshot of all the tasks with uxTaskGetSystemState().  Returns
+ * the number of tasks in the new snapshot, or 0 if there are more tasks than
+ * entries in the arrays, in which case the next snapshot is compared with the
+ * last one that succeeded.
+ */
+UBaseType_t FreeRTOS_CLITakeTaskSnapshot( CLI_TaskSnapshot_t *pxSnapshot );
+
+/*
+ * Return the run time the task in entry uxIndex of the current snapshot used
+ * since the previous snapshot.  Tasks are matched between the snapshots by
+ * task number, and a task that did not exist in the previous snapshot used
+ * all of its run time since then.
+ */
+uint32_t FreeRTOS_CLIGetTaskRunTime( const CLI_TaskSnapshot_t *pxSnapshot, UBaseType_t uxIndex );
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -76,9 +249,10 @@ BaseType_t FreeRTOS_CLIProcessCommand( const char * const pcCommandInput, char *
  * main command interpreter, rather than in the command console implementation,
  * to allow application that provide access to the command console via multiple
  * interfaces to share a buffer, and therefore save RAM.  Note, however, that
- * the command interpreter itself is not re-entrant, so only one command
- * console interface can be used at any one time.  For that reason, no attempt
- * is made to provide any mutual exclusion mechanism on the output buffer.
+ * FreeRTOS_CLIProcessCommand() is not re-entrant, so only one command console
+ * interface can be used at any one time.  For that reason, no attempt is made
+ * to provide any mutual exclusion mechanism on the output buffer.  Interfaces
+ * that use FreeRTOS_CLIProcessCommandCtx() need a buffer each.
  *
  * FreeRTOS_CLIGetOutputBuffer() returns the address of the output buffer.
  */
@@ -137,6 +137,11 @@
 
 	#define TRC_PORT_SPECIFIC_INIT()
 
+	/* Sampling mode only. Like ulGetRunTimeCounterValue, this is provided by
+	the application, e.g. with a SIGPROF timer in the POSIX simulator. */
+	void vConfigureTimerForTraceSampling(uint32_t ulRateHz);
+	#define TRC_PORT_SAMPLING_TIMER_INIT(_rateHz) vConfigureTimerForTraceSampling(_rateHz)
+
 #elif (TRC_CFG_HARDWARE_PORT == TRC_HARDWARE_PORT_HWIndependent)
 	/* Timestamping by OS tick only (typically 1 ms resolution) */
 	#define TRC_HWTC_TYPE TRC_OS_TIMER_INCR
@@ -500,6 +505,42 @@
 	#define TRC_PORT_SPECIFIC_INIT() 
 #endif
 
+/*******************************************************************************
+ * TRC_PORT_SAMPLING_TIMER_INIT
+ *
+ * Only used in sampling mode (TRC_RECORDER_MODE_SAMPLING in trcConfig.h).
+ * Starts a periodic timer interrupt at _rateHz (TRC_CFG_SAMPLING_RATE_HZ),
+ * whose handler calls vTraceSample with the program counter of the
+ * interrupted code. Called once, by the first call of vTraceEnable.
+ *
+ * The Win32 port calls vConfigureTimerForTraceSampling, to be provided by the
+ * application (see FreeRTOS/Demo/Posix_GCC_Trace_Sampling). For the other
+ * ports this is empty by default, and the application starts a suitable timer
+ * itself. The timer should have a higher priority than the interrupts to be
+ * sampled, or those will never be seen.
+ ******************************************************************************/
+#ifndef TRC_PORT_SAMPLING_TIMER_INIT
+	#define TRC_PORT_SAMPLING_TIMER_INIT(_rateHz)
+#endif
+
+/*******************************************************************************
+ * TRC_PORT_ATOMIC_CAS32
+ *
+ * Atomic 32-bit compare-and-swap, only needed for the lock-free paged event
+ * buffer (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE in trcStreamingConfig.h).
+ * Replaces *_ptr with _desired if it equals _expected, and returns non-zero
+ * if the swap was made.
+ *
+ * The GCC builtin maps to LDREX/STREX on ARMv7-M and similar. On cores without
+ * such instructions (e.g. Cortex-M0), define this to a suitable implementation
+ * in your processor header or keep the lock-free buffer disabled.
+ ******************************************************************************/
+#ifndef TRC_PORT_ATOMIC_CAS32
+	#if defined(__GNUC__)
+		#define TRC_PORT_ATOMIC_CAS32(_ptr, _expected, _desired) __sync_bool_compare_and_swap((_ptr), (_expected), (_desired))
+	#endif
+#endif
+
 /* If Win32 port */
 #ifdef WIN32
 
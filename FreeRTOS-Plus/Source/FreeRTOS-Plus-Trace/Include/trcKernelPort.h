@@ -109,8 +109,18 @@ extern "C" {
 	/* Required for this feature */
 #undef INCLUDE_uxTaskGetStackHighWaterMark
 #define INCLUDE_uxTaskGetStackHighWaterMark 1
+
+#ifndef TRC_CFG_STACK_MONITOR_SCAN_WORDS
+/* Not set in trcConfig.h */
+#define TRC_CFG_STACK_MONITOR_SCAN_WORDS 512
+#endif /* TRC_CFG_STACK_MONITOR_SCAN_WORDS */
 #endif /* defined(TRC_CFG_ENABLE_STACK_MONITOR) && (TRC_CFG_ENABLE_STACK_MONITOR == 1) && (TRC_CFG_SCHEDULING_ONLY == 0) */
 
+#ifndef TRC_CFG_EVENT_CLASS_MASK
+/* Not set in trcConfig.h, so include all event classes (as before) */
+#define TRC_CFG_EVENT_CLASS_MASK TRC_EVENT_CLASS_ALL
+#endif /* TRC_CFG_EVENT_CLASS_MASK */
+
 /*******************************************************************************
  * INCLUDE_xTaskGetCurrentTaskHandle must be set to 1 for tracing to work properly
  ******************************************************************************/
@@ -982,6 +992,8 @@ extern volatile uint32_t uiTraceSystemState;
 
 #if (TRC_CFG_SCHEDULING_ONLY == 0)
 
+#if ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_TASK)
+
 #if defined(configUSE_TICKLESS_IDLE)
 #if (configUSE_TICKLESS_IDLE != 0)
 
@@ -1033,6 +1045,8 @@ extern volatile uint32_t uiTraceSystemState;
 	trcKERNEL_HOOKS_SET_TASK_INSTANCE_FINISHED();
 #endif /* TRC_CFG_FREERTOS_VERSION >= TRC_FREERTOS_VERSION_9_0_0 */
 
+#endif /* ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_TASK) */
+
 /* Called in xQueueCreate, and thereby for all other object based on queues, such as semaphores. */
 #undef traceQUEUE_CREATE
 #define traceQUEUE_CREATE( pxNewQueue ) \
@@ -1064,6 +1078,8 @@ extern volatile uint32_t uiTraceSystemState;
 	trcKERNEL_HOOKS_KERNEL_SERVICE_WITH_NUMERIC_PARAM_ONLY(TRACE_GET_CLASS_EVENT_CODE(CREATE_OBJ, TRCFAILED, QUEUE, queueQUEUE_TYPE_MUTEX), 0);
 #endif /* (TRC_CFG_FREERTOS_VERSION < TRC_FREERTOS_VERSION_9_0_0) */
 
+#if ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_QUEUE)
+
 /* Called when the Mutex can not be given, since not holder */
 #undef traceGIVE_MUTEX_RECURSIVE_FAILED
 #define traceGIVE_MUTEX_RECURSIVE_FAILED( pxMutex ) \
@@ -1173,9 +1189,13 @@ extern volatile uint32_t uiTraceSystemState;
 #define traceQUEUE_RECEIVE_FROM_ISR_FAILED( pxQueue ) \
 	trcKERNEL_HOOKS_KERNEL_SERVICE_FROM_ISR(TRACE_GET_OBJECT_EVENT_CODE(RECEIVE_FROM_ISR, TRCFAILED, QUEUE, pxQueue), QUEUE, pxQueue);
 
+#endif /* ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_QUEUE) */
+
 #undef traceQUEUE_REGISTRY_ADD
 #define traceQUEUE_REGISTRY_ADD(object, name) prvTraceSetObjectName(TRACE_GET_OBJECT_TRACE_CLASS(QUEUE, object), TRACE_GET_OBJECT_NUMBER(QUEUE, object), name);
 
+#if ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_TASK)
+
 /* Called in vTaskPrioritySet */
 #undef traceTASK_PRIORITY_SET
 #define traceTASK_PRIORITY_SET( pxTask, uxNewPriority ) \
@@ -1201,10 +1221,19 @@ extern volatile uint32_t uiTraceSystemState;
 #define traceTASK_RESUME_FROM_ISR( pxTaskToResume ) \
 	trcKERNEL_HOOKS_TASK_RESUME_FROM_ISR(TASK_RESUME_FROM_ISR, pxTaskToResume);
 
+#else /* ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_TASK) */
+
+/* The priority is still needed for the object property table */
+#undef traceTASK_PRIORITY_SET
+#define traceTASK_PRIORITY_SET( pxTask, uxNewPriority ) \
+	prvTraceSetPriorityProperty(TRACE_CLASS_TASK, TRACE_GET_TASK_NUMBER(pxTask), (uint8_t)uxNewPriority);
+
+#endif /* ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_TASK) */
+
 
 #if (TRC_CFG_FREERTOS_VERSION >= TRC_FREERTOS_VERSION_8_X_X)
 
-#if (TRC_CFG_INCLUDE_MEMMANG_EVENTS == 1)
+#if (TRC_CFG_INCLUDE_MEMMANG_EVENTS == 1) && ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_MEMMANG)
 
 extern void vTraceStoreMemMangEvent(uint32_t ecode, uint32_t address, int32_t size);
 
@@ -1224,9 +1253,9 @@ extern void vTraceStoreMemMangEvent(uint32_t ecode, uint32_t address, int32_t si
 #define traceFREE( pvAddress, uiSize ) \
 	vTraceStoreMemMangEvent(MEM_FREE_SIZE, ( uint32_t ) pvAddress, -((int32_t)uiSize));
 
-#endif /* (TRC_CFG_INCLUDE_MEMMANG_EVENTS == 1) */
+#endif /* (TRC_CFG_INCLUDE_MEMMANG_EVENTS == 1) && ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_MEMMANG) */
 
-#if (TRC_CFG_INCLUDE_TIMER_EVENTS == 1)
+#if (TRC_CFG_INCLUDE_TIMER_EVENTS == 1) && ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_TIMER)
 
 /* Called in timer.c - xTimerCreate */
 #undef traceTIMER_CREATE
@@ -1266,9 +1295,9 @@ extern void vTraceStoreMemMangEvent(uint32_t ecode, uint32_t address, int32_t si
 #define traceTIMER_EXPIRED(tmr) \
 	trcKERNEL_HOOKS_KERNEL_SERVICE(TIMER_EXPIRED, TIMER, tmr);
 
-#endif /* (TRC_CFG_INCLUDE_TIMER_EVENTS == 1) */
+#endif /* (TRC_CFG_INCLUDE_TIMER_EVENTS == 1) && ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_TIMER) */
 
-#if (TRC_CFG_INCLUDE_PEND_FUNC_CALL_EVENTS == 1)
+#if (TRC_CFG_INCLUDE_PEND_FUNC_CALL_EVENTS == 1) && ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_PEND_FUNC_CALL)
 
 #undef tracePEND_FUNC_CALL
 #define tracePEND_FUNC_CALL(func, arg1, arg2, ret) \
@@ -1286,11 +1315,11 @@ extern void vTraceStoreMemMangEvent(uint32_t ecode, uint32_t address, int32_t si
 		prvTraceStoreKernelCall(PEND_FUNC_CALL_FROM_ISR, TRACE_CLASS_TASK, TRACE_GET_TASK_NUMBER(xTimerGetTimerDaemonTaskHandle()) ); \
 	uiInEventGroupSetBitsFromISR = 0;
 
-#endif /* (TRC_CFG_INCLUDE_PEND_FUNC_CALL_EVENTS == 1) */
+#endif /* (TRC_CFG_INCLUDE_PEND_FUNC_CALL_EVENTS == 1) && ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_PEND_FUNC_CALL) */
 
 #endif /* (TRC_CFG_FREERTOS_VERSION >= TRC_FREERTOS_VERSION_8_X_X) */
 
-#if (TRC_CFG_INCLUDE_EVENT_GROUP_EVENTS == 1)
+#if (TRC_CFG_INCLUDE_EVENT_GROUP_EVENTS == 1) && ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_EVENT_GROUP)
 
 #undef traceEVENT_GROUP_CREATE
 #define traceEVENT_GROUP_CREATE(eg) \
@@ -1355,7 +1384,9 @@ extern void vTraceStoreMemMangEvent(uint32_t ecode, uint32_t address, int32_t si
 	trcKERNEL_HOOKS_KERNEL_SERVICE_WITH_PARAM_FROM_ISR(EVENT_GROUP_SET_BITS_FROM_ISR, EVENTGROUP, eg, bitsToSet); \
 	uiInEventGroupSetBitsFromISR = 1;
 
-#endif /* (TRC_CFG_INCLUDE_EVENT_GROUP_EVENTS == 1) */
+#endif /* (TRC_CFG_INCLUDE_EVENT_GROUP_EVENTS == 1) && ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_EVENT_GROUP) */
+
+#if ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_NOTIFY)
 
 #undef traceTASK_NOTIFY_TAKE
 #if (TRC_CFG_FREERTOS_VERSION < TRC_FREERTOS_VERSION_9_0_0)
@@ -1469,7 +1500,9 @@ extern void vTraceStoreMemMangEvent(uint32_t ecode, uint32_t address, int32_t si
 		prvTraceStoreKernelCall(TRACE_TASK_NOTIFY_GIVE_FROM_ISR, TRACE_CLASS_TASK, TRACE_GET_TASK_NUMBER(xTaskToNotify));
 #endif /* TRC_CFG_FREERTOS_VERSION < TRC_FREERTOS_VERSION_10_4_0 */
 
-#if (TRC_CFG_INCLUDE_STREAM_BUFFER_EVENTS == 1)
+#endif /* ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_NOTIFY) */
+
+#if (TRC_CFG_INCLUDE_STREAM_BUFFER_EVENTS == 1) && ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_STREAM_BUFFER)
 
 #undef traceSTREAM_BUFFER_CREATE
 #define traceSTREAM_BUFFER_CREATE( pxStreamBuffer, xIsMessageBuffer ) \
@@ -1543,7 +1576,7 @@ extern void vTraceStoreMemMangEvent(uint32_t ecode, uint32_t address, int32_t si
 		trcKERNEL_HOOKS_KERNEL_SERVICE_FROM_ISR(TRACE_GET_OBJECT_EVENT_CODE(RECEIVE_FROM_ISR, TRCFAILED, STREAMBUFFER, xStreamBuffer), STREAMBUFFER, xStreamBuffer); \
 	}
 
-#endif /* (TRC_CFG_INCLUDE_STREAM_BUFFER_EVENTS == 1) */
+#endif /* (TRC_CFG_INCLUDE_STREAM_BUFFER_EVENTS == 1) && ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_STREAM_BUFFER) */
 
 #endif /* (TRC_CFG_SCHEDULING_ONLY == 0) */
 
@@ -1780,6 +1813,10 @@ uint32_t prvIsNewTCB(void* pNewTCB);
 
 #define PSF_EVENT_UNUSED_STACK								0xEA
 
+/* Sampling mode (TRC_RECORDER_MODE_SAMPLING), see vTraceSample */
+#define PSF_EVENT_SAMPLING_CONFIG							0xEB
+#define PSF_EVENT_PC_SAMPLES								0xEC
+
 /*** The trace macros for streaming ******************************************/
 
 /* A macro that will update the tick count when returning from tickless idle */
@@ -1885,6 +1922,8 @@ extern volatile uint32_t uiTraceSystemState;
 
 #if (TRC_CFG_SCHEDULING_ONLY == 0)
 
+#if ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_TASK)
+
 #if (defined(configUSE_TICKLESS_IDLE) && configUSE_TICKLESS_IDLE != 0)
 
 #undef traceLOW_POWER_IDLE_BEGIN
@@ -1926,6 +1965,8 @@ extern volatile uint32_t uiTraceSystemState;
 		prvTraceStoreEvent1(PSF_EVENT_TASK_DELAY_UNTIL, (uint32_t)xTimeToWake);
 #endif /* TRC_CFG_FREERTOS_VERSION >= TRC_FREERTOS_VERSION_9_0_0 */
 
+#endif /* ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_TASK) */
+
 #if (TRC_CFG_FREERTOS_VERSION >= TRC_FREERTOS_VERSION_9_0_0)
 #define traceQUEUE_CREATE_HELPER() \
 		case queueQUEUE_TYPE_MUTEX: \
@@ -2089,6 +2130,8 @@ extern volatile uint32_t uiTraceSystemState;
 		prvTraceStoreEvent1(PSF_EVENT_MUTEX_CREATE_FAILED, 0);
 #endif /* (TRC_CFG_FREERTOS_VERSION < TRC_FREERTOS_VERSION_9_0_0) */
 
+#if ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_QUEUE)
+
 /* Called when a message is sent to a queue */	/* CS IS NEW ! */
 #undef traceQUEUE_SEND
 #define traceQUEUE_SEND( pxQueue ) \
@@ -2347,6 +2390,10 @@ extern volatile uint32_t uiTraceSystemState;
 					break; \
 			}
 
+#endif /* ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_QUEUE) */
+
+#if ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_TASK)
+
 /* Called in vTaskPrioritySet */
 #undef traceTASK_PRIORITY_SET
 #define traceTASK_PRIORITY_SET( pxTask, uxNewPriority ) \
@@ -2382,7 +2429,16 @@ extern volatile uint32_t uiTraceSystemState;
 	if (TRACE_GET_OBJECT_FILTER(TASK, pxTaskToResume) & CurrentFilterMask) \
 		prvTraceStoreEvent1(PSF_EVENT_TASK_RESUME_FROMISR, (uint32_t)pxTaskToResume);
 
-#if (TRC_CFG_INCLUDE_MEMMANG_EVENTS == 1)
+#else /* ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_TASK) */
+
+/* The priority is still needed for the object data table */
+#undef traceTASK_PRIORITY_SET
+#define traceTASK_PRIORITY_SET( pxTask, uxNewPriority ) \
+	prvTraceSaveObjectData(pxTask, uxNewPriority);
+
+#endif /* ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_TASK) */
+
+#if (TRC_CFG_INCLUDE_MEMMANG_EVENTS == 1) && ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_MEMMANG)
 
 extern uint32_t trcHeapCounter;
 
@@ -2410,9 +2466,9 @@ extern uint32_t trcHeapCounter;
 	if (TRACE_GET_OBJECT_FILTER(TASK, TRACE_GET_CURRENT_TASK()) & CurrentFilterMask) \
 		prvTraceStoreEvent2(PSF_EVENT_FREE, (uint32_t)pvAddress, (uint32_t)(0 - uiSize)); /* "0 -" instead of just "-" to get rid of a warning... */
 
-#endif /* (TRC_CFG_INCLUDE_MEMMANG_EVENTS == 1) */
+#endif /* (TRC_CFG_INCLUDE_MEMMANG_EVENTS == 1) && ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_MEMMANG) */
 
-#if (TRC_CFG_INCLUDE_TIMER_EVENTS == 1)
+#if (TRC_CFG_INCLUDE_TIMER_EVENTS == 1) && ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_TIMER)
 
 /* Called in timer.c - xTimerCreate */
 #undef traceTIMER_CREATE
@@ -2478,10 +2534,10 @@ extern uint32_t trcHeapCounter;
 		if (TRACE_GET_OBJECT_FILTER(TIMER, tmr) & CurrentFilterMask) \
 			prvTraceStoreEvent2(PSF_EVENT_TIMER_EXPIRED, (uint32_t)tmr->pxCallbackFunction, (uint32_t)tmr->pvTimerID);
 
-#endif /* #if (TRC_CFG_INCLUDE_TIMER_EVENTS == 1) */
+#endif /* (TRC_CFG_INCLUDE_TIMER_EVENTS == 1) && ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_TIMER) */
 
 
-#if (TRC_CFG_INCLUDE_PEND_FUNC_CALL_EVENTS == 1)
+#if (TRC_CFG_INCLUDE_PEND_FUNC_CALL_EVENTS == 1) && ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_PEND_FUNC_CALL)
 
 #undef tracePEND_FUNC_CALL
 #define tracePEND_FUNC_CALL(func, arg1, arg2, ret) \
@@ -2491,9 +2547,9 @@ extern uint32_t trcHeapCounter;
 #define tracePEND_FUNC_CALL_FROM_ISR(func, arg1, arg2, ret) \
 	prvTraceStoreEvent1((ret == pdPASS) ? PSF_EVENT_TIMER_PENDFUNCCALL_FROMISR : PSF_EVENT_TIMER_PENDFUNCCALL_FROMISR_FAILED, (uint32_t)func);
 
-#endif /* (TRC_CFG_INCLUDE_PEND_FUNC_CALL_EVENTS == 1) */
+#endif /* (TRC_CFG_INCLUDE_PEND_FUNC_CALL_EVENTS == 1) && ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_PEND_FUNC_CALL) */
 
-#if (TRC_CFG_INCLUDE_EVENT_GROUP_EVENTS == 1)
+#if (TRC_CFG_INCLUDE_EVENT_GROUP_EVENTS == 1) && ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_EVENT_GROUP)
 
 #undef traceEVENT_GROUP_CREATE
 #define traceEVENT_GROUP_CREATE(eg) \
@@ -2560,7 +2616,9 @@ extern uint32_t trcHeapCounter;
 	if (TRACE_GET_OBJECT_FILTER(EVENTGROUP, eg) & CurrentFilterMask) \
 		prvTraceStoreEvent2(PSF_EVENT_EVENTGROUP_SETBITS_FROMISR, (uint32_t)eg, bitsToSet);
 
-#endif /* (TRC_CFG_INCLUDE_EVENT_GROUP_EVENTS == 1) */
+#endif /* (TRC_CFG_INCLUDE_EVENT_GROUP_EVENTS == 1) && ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_EVENT_GROUP) */
+
+#if ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_NOTIFY)
 
 #undef traceTASK_NOTIFY_TAKE
 #if (TRC_CFG_FREERTOS_VERSION >= TRC_FREERTOS_VERSION_10_4_0)
@@ -2667,12 +2725,14 @@ extern uint32_t trcHeapCounter;
 		prvTraceStoreEvent1(PSF_EVENT_TASK_NOTIFY_GIVE_FROM_ISR, (uint32_t)xTaskToNotify);
 #endif /* TRC_CFG_FREERTOS_VERSION >= TRC_FREERTOS_VERSION_10_4_0 */
 
+#endif /* ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_NOTIFY) */
+
 #undef traceQUEUE_REGISTRY_ADD
 #define traceQUEUE_REGISTRY_ADD(object, name) \
 	prvTraceSaveObjectSymbol(object, (const char*)name); \
 	prvTraceStoreStringEvent(1, PSF_EVENT_OBJ_NAME, name, object);
 
-#if (TRC_CFG_INCLUDE_STREAM_BUFFER_EVENTS == 1)
+#if (TRC_CFG_INCLUDE_STREAM_BUFFER_EVENTS == 1) && ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_STREAM_BUFFER)
 
 #undef traceSTREAM_BUFFER_CREATE
 #define traceSTREAM_BUFFER_CREATE( pxStreamBuffer, xIsMessageBuffer ) \
@@ -2767,7 +2827,7 @@ if (TRACE_GET_OBJECT_FILTER(STREAMBUFFER, xStreamBuffer) & CurrentFilterMask) \
 		} \
 	}
 
-#endif /* (TRC_CFG_INCLUDE_STREAM_BUFFER_EVENTS == 1) */
+#endif /* (TRC_CFG_INCLUDE_STREAM_BUFFER_EVENTS == 1) && ((TRC_CFG_EVENT_CLASS_MASK) & TRC_EVENT_CLASS_STREAM_BUFFER) */
 
 #endif /* (TRC_CFG_SCHEDULING_ONLY == 0) */
 
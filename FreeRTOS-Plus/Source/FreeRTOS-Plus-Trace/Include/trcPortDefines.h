@@ -65,6 +65,7 @@
 
 #define TRC_RECORDER_MODE_SNAPSHOT		0
 #define TRC_RECORDER_MODE_STREAMING		1
+#define TRC_RECORDER_MODE_SAMPLING		2
 
 #define TRC_RECORDER_BUFFER_ALLOCATION_STATIC   (0x00)
 #define TRC_RECORDER_BUFFER_ALLOCATION_DYNAMIC  (0x01)
@@ -88,6 +89,18 @@
 #define FilterGroup14 (uint16_t)0x4000
 #define FilterGroup15 (uint16_t)0x8000
 
+/* Event classes for TRC_CFG_EVENT_CLASS_MASK. Scheduling and ISR events, and
+   task and queue create, delete and naming events are always included. */
+#define TRC_EVENT_CLASS_TASK			0x0001	/* Delay, suspend, resume, priority changes */
+#define TRC_EVENT_CLASS_QUEUE			0x0002	/* Queue, semaphore and mutex operations */
+#define TRC_EVENT_CLASS_NOTIFY			0x0004	/* Task notifications */
+#define TRC_EVENT_CLASS_MEMMANG			0x0008	/* Heap allocations and frees */
+#define TRC_EVENT_CLASS_TIMER			0x0010	/* Software timer operations */
+#define TRC_EVENT_CLASS_EVENT_GROUP		0x0020	/* Event group operations */
+#define TRC_EVENT_CLASS_STREAM_BUFFER	0x0040	/* Stream and message buffer operations */
+#define TRC_EVENT_CLASS_PEND_FUNC_CALL	0x0080	/* Pended function calls */
+#define TRC_EVENT_CLASS_ALL				0x00FF
+
 /******************************************************************************
  * Supported ports
  *
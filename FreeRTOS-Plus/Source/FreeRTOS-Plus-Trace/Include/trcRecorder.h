@@ -58,10 +58,22 @@ extern "C" {
 #include "trcConfig.h"
 #include "trcPortDefines.h"
 
+/* The sampling mode is the streaming recorder, with the kernel events replaced
+by samples of the execution (see vTraceSample). TRC_SAMPLING_MODE tells the
+sampling mode apart where needed. */
+#if (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_SAMPLING)
+#undef TRC_CFG_RECORDER_MODE
+#define TRC_CFG_RECORDER_MODE TRC_RECORDER_MODE_STREAMING
+#define TRC_SAMPLING_MODE 1
+#else
+#define TRC_SAMPLING_MODE 0
+#endif /* (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_SAMPLING) */
+
 #if (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_SNAPSHOT)
 
 typedef uint16_t traceString;
 typedef uint8_t traceUBChannel;
+typedef uint32_t traceFormat;
 typedef uint8_t traceObjectClass;
 
 #if (TRC_CFG_USE_16BIT_OBJECT_HANDLES == 1)
@@ -252,6 +264,41 @@ void vTraceVPrintF(traceString eventLabel, const char* formatStr, va_list vl);
 #define vTraceVPrintF(chn, formatStr, vl) (void)(chn), (void)(formatStr), (void)(vl) /* Comma operator is used to avoid "unused variable" compiler warnings in a single statement */
 #endif
 
+/******************************************************************************
+ * vTracePrintFCached
+ *
+ * A faster version of vTracePrintF for frequent events, e.g. in loops or ISRs.
+ * In snapshot mode, the format string is registered once, on the first call,
+ * using xTraceRegisterFormat. After that, each call only stores the timestamp,
+ * a reference to the format string and the arguments. The format string is
+ * not parsed on the target, this is done on the host side as for vTracePrintF.
+ *
+ * The arguments must be 32-bit integers (%d, %u, %x and %X), up to eight, and
+ * at least one. The channel and format must be the same on every call from
+ * the same place, since they are only used on the first call. In streaming
+ * mode, this is the same as vTracePrintF.
+ *
+ * Example:
+ *
+ *	 traceString chn = xTraceRegisterString("ADC");
+ *	 ...
+ *	 vTracePrintFCached(chn, "ADC channel %d: %d mV", ch, adc_reading);
+ ******************************************************************************/
+#if (TRC_CFG_SCHEDULING_ONLY == 0) && (TRC_CFG_INCLUDE_USER_EVENTS == 1) && (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_SNAPSHOT)
+#define vTracePrintFCached(chn, fmt, ...) \
+	do \
+	{ \
+		static traceFormat trcCachedFormat = 0; \
+		if (trcCachedFormat == 0) \
+		{ \
+			trcCachedFormat = xTraceRegisterFormat(chn, fmt); \
+		} \
+		vTracePrintFormat(trcCachedFormat, __VA_ARGS__); \
+	} while (0)
+#else
+#define vTracePrintFCached(chn, fmt, ...) vTracePrintF(chn, fmt, __VA_ARGS__)
+#endif
+
 /******************************************************************************
 * vTracePrint
 *
@@ -380,6 +427,34 @@ void vTraceStoreISRBegin(traceHandle handle);
  ******************************************************************************/
 void vTraceStoreISREnd(int isTaskSwitchRequired);
 
+/*******************************************************************************
+ * vTraceSample
+ *
+ * Records a sample of the execution in sampling mode (TRC_CFG_RECORDER_MODE
+ * set to TRC_RECORDER_MODE_SAMPLING), and does nothing in the other modes.
+ * Call this from a periodic timer interrupt at TRC_CFG_SAMPLING_RATE_HZ,
+ * started by TRC_PORT_SAMPLING_TIMER_INIT (see trcHardwarePort.h) or by the
+ * application. The parameter pc is the program counter of the interrupted
+ * code, e.g. the return address stacked on exception entry.
+ *
+ * The sample is counted in a histogram of the running task or ISR (as given
+ * by vTraceStoreISRBegin) and the program counter, which the TzCtrl task
+ * stores in the trace periodically. Don't trace the timer interrupt itself
+ * with vTraceStoreISRBegin/vTraceStoreISREnd, or all samples will show it.
+ *
+ * Example:
+ *	 void SamplingTimer_IRQHandler()
+ *	 {
+ *		 vTraceSample(interruptedPC);
+ *		 ...
+ *	 }
+ ******************************************************************************/
+#if (TRC_SAMPLING_MODE == 1)
+void vTraceSample(uint32_t pc);
+#else
+#define vTraceSample(pc) (void)(pc)
+#endif /* (TRC_SAMPLING_MODE == 1) */
+
 /*******************************************************************************
  * vTraceInstanceFinishNow
  *
@@ -675,6 +750,10 @@ void vTraceClear(void);
 #define TRC_CFG_INCLUDE_OSTICK_EVENTS 0
 #endif
 
+#ifndef TRC_CFG_SYMBOL_TABLE_HASH_BITS
+#define TRC_CFG_SYMBOL_TABLE_HASH_BITS 6
+#endif
+
 /* This macro will create a task in the object table */
 #undef trcKERNEL_HOOKS_TASK_CREATE
 #define trcKERNEL_HOOKS_TASK_CREATE(SERVICE, CLASS, pxTCB) \
@@ -964,6 +1043,16 @@ uint32_t uiTraceGetTraceBufferSize(void);
 
 #if ((TRC_CFG_INCLUDE_USER_EVENTS == 1) && (TRC_CFG_SCHEDULING_ONLY == 0))
 
+/* A traceFormat holds the format string symbol, the number of arguments and,
+if using the separate user event buffer, the channel */
+#define TRACE_FORMAT_CREATE(channel, nargs, label) (((traceFormat)(channel) << 24) | ((traceFormat)(nargs) << 16) | (traceFormat)(label))
+#define TRACE_FORMAT_CHANNEL(fmt) ((traceUBChannel)((fmt) >> 24))
+#define TRACE_FORMAT_NARGS(fmt) ((uint8_t)((fmt) >> 16))
+#define TRACE_FORMAT_LABEL(fmt) ((traceString)(fmt))
+
+traceFormat xTraceRegisterFormat(traceString chn, const char* formatStr);
+void vTracePrintFormat(traceFormat fmt, ...);
+
 #if (TRC_CFG_USE_SEPARATE_USER_EVENT_BUFFER == 1)
 traceUBChannel xTraceRegisterUBChannel(traceString channel, traceString formatStr);
 void vTraceUBData(traceUBChannel channel, ...);
@@ -984,6 +1073,10 @@ void vTraceUBEvent(traceUBChannel channel);
 #define xTraceRegisterChannelFormat(eventLabel, formatStr) ((void)(eventLabel), (void)(formatStr), 0) /* Comma operator in parenthesis is used to avoid "unused variable" compiler warnings and return 0 in a single statement */
 #undef vTraceUBData
 #define vTraceUBData(label, ...) (void)(label)
+#undef vTracePrintFCached
+#define vTracePrintFCached(chn, fmt, ...) (void)(chn), (void)(fmt) /* Comma operator is used to avoid "unused variable" compiler warnings in a single statement */
+#define xTraceRegisterFormat(chn, formatStr) ((void)(chn), (void)(formatStr), (traceFormat)0) /* Comma operator in parenthesis is used to avoid "unused variable" compiler warnings and return 0 in a single statement */
+#define vTracePrintFormat(fmt, ...) (void)(fmt)
 #undef vTraceChannelPrint
 #define vTraceChannelPrint(label) (void)(label)
 
@@ -1107,7 +1200,9 @@ typedef struct
 
 	/* Used for lookups - Up to 64 linked lists within the symbol table
 	connecting all entries with the same 6 bit checksum.
-	This field holds the current list heads. Should be initiated to zeros */
+	This field holds the current list heads. Should be initiated to zeros.
+	Not used if TRC_CFG_SYMBOL_TABLE_HASH_BITS is larger than 6, then the list
+	heads are kept outside the recorder data (see trcSnapshotRecorder.c) */
 	uint16_t latestEntryOfChecksum[64];
 } symbolTableType;
 
@@ -1468,6 +1563,46 @@ if (!(eval)) \
  ******************************************************************************/
 #ifndef TRC_STREAM_PORT_USE_INTERNAL_BUFFER
 #define TRC_STREAM_PORT_USE_INTERNAL_BUFFER 1
+#endif
+
+#ifndef TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE
+#define TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE 0
+#endif
+
+#ifndef TRC_CFG_PAGED_EVENT_BUFFER_ALLOW_UNORDERED
+#define TRC_CFG_PAGED_EVENT_BUFFER_ALLOW_UNORDERED 0
+#endif
+
+#ifndef TRC_CFG_COMPACT_EVENT_FORMAT
+#define TRC_CFG_COMPACT_EVENT_FORMAT 0
+#endif
+
+#ifndef TRC_CFG_COMPACT_SYNC_INTERVAL
+#define TRC_CFG_COMPACT_SYNC_INTERVAL 100
+#endif
+
+#ifndef TRC_CFG_BACKPRESSURE_SAMPLING
+#define TRC_CFG_BACKPRESSURE_SAMPLING 4
+#endif
+
+#ifndef TRC_CFG_SAMPLING_RATE_HZ
+#define TRC_CFG_SAMPLING_RATE_HZ 1000
+#endif
+
+#ifndef TRC_CFG_SAMPLING_HISTOGRAM_SLOTS
+#define TRC_CFG_SAMPLING_HISTOGRAM_SLOTS 64
+#endif
+
+#ifndef TRC_CFG_SAMPLING_PC_SHIFT
+#define TRC_CFG_SAMPLING_PC_SHIFT 4
+#endif
+
+#ifndef TRC_CFG_SAMPLING_REPORT_INTERVAL
+#define TRC_CFG_SAMPLING_REPORT_INTERVAL (TRC_CFG_SAMPLING_RATE_HZ)
+#endif
+
+#ifndef TRC_CFG_SAMPLING_KERNEL_EVENT_INTERVAL
+#define TRC_CFG_SAMPLING_KERNEL_EVENT_INTERVAL 0
 #endif
 
  /******************************************************************************
@@ -1487,6 +1622,41 @@ if (!(eval)) \
  *******************************************************************************/
 #ifndef TRC_STREAM_PORT_ON_TRACE_END
 #define TRC_STREAM_PORT_ON_TRACE_END() /* Do nothing */
+#endif
+
+ /******************************************************************************
+ * TRC_STREAM_PORT_MAX_BURST_SIZE
+ *
+ * Stream port capability: the largest number of bytes the TzCtrl task may
+ * pass to TRC_STREAM_PORT_WRITE_DATA in one call. When several buffer pages
+ * are ready, they are gathered into one write of up to this size, which saves
+ * the per-call overhead in stream ports like TCP/IP or USB.
+ *
+ * The stream port may still accept fewer bytes in each call, as reported by
+ * _ptrBytesWritten. Only used if TRC_STREAM_PORT_USE_INTERNAL_BUFFER is 1.
+ * Default is one page (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE), i.e. one page
+ * per call.
+ *******************************************************************************/
+#ifndef TRC_STREAM_PORT_MAX_BURST_SIZE
+#define TRC_STREAM_PORT_MAX_BURST_SIZE (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE)
+#endif
+
+ /******************************************************************************
+ * TRC_STREAM_PORT_BACKPRESSURE
+ *
+ * Stream port capability: returns non-zero while the streaming interface can't
+ * keep up with the trace data, e.g. while the stream port's own transmit
+ * buffer is nearly full. While this is the case:
+ * - a transfer that TRC_STREAM_PORT_WRITE_DATA did not accept any data of is
+ *   continued in the next execution of TzCtrl, instead of being retried
+ *   immediately,
+ * - the kernel service calls are sampled as set by TRC_CFG_BACKPRESSURE_SAMPLING,
+ *   so the internal buffer lasts longer for the scheduling events.
+ * Only used if TRC_STREAM_PORT_USE_INTERNAL_BUFFER is 1. Default is 0, i.e.
+ * no backpressure is reported.
+ *******************************************************************************/
+#ifndef TRC_STREAM_PORT_BACKPRESSURE
+#define TRC_STREAM_PORT_BACKPRESSURE() 0
 #endif
 
  /******************************************************************************
@@ -1569,11 +1739,19 @@ if (!(eval)) \
  * In ports using the internal buffer, this macro has no purpose as the events
  * are written to the internal buffer instead. They are then flushed to the
  * streaming interface in the TzCtrl task using TRC_STREAM_PORT_WRITE_DATA.
+ * The exception is TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE, where the COMMIT
+ * macro tells the buffer that the event is written in full, so the page can be
+ * handed over to the TzCtrl task once all writers on that page are done.
  ******************************************************************************/
 #ifndef TRC_STREAM_PORT_COMMIT_EVENT
 #if (TRC_STREAM_PORT_USE_INTERNAL_BUFFER == 1)
+#if (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1)
+	#define TRC_STREAM_PORT_COMMIT_EVENT(_ptrData, _size) prvPagedEventBufferCommit(_ptrData, _size)
+	#define TRC_STREAM_PORT_COMMIT_EVENT_BLOCKING(_ptrData, _size) prvPagedEventBufferCommit(_ptrData, _size)
+#else
 	#define TRC_STREAM_PORT_COMMIT_EVENT(_ptrData, _size) /* Not used */
 	#define TRC_STREAM_PORT_COMMIT_EVENT_BLOCKING(_ptrData, _size) /* Not used */
+#endif
 #else
 	#define TRC_STREAM_PORT_COMMIT_EVENT(_ptrData, _size) \
 	{ \
@@ -1691,7 +1869,8 @@ if (!(eval)) \
  * can't swallow all data at once.
  *
  * Assuming TRC_STREAM_PORT_USE_INTERNAL_BUFFER is 1 (default), the TzCtrl task
- * will use this macro to send one buffer page at a time. In case all data can't
+ * will use this macro to send one or more buffer pages at a time, see
+ * TRC_STREAM_PORT_MAX_BURST_SIZE. In case all data can't
  * be written at once (if _ptrBytesWritten is less than _size), the TzCtrl task
  * is smart enough to make repeated calls (with updated parameters) in order to 
  * send the remaining data.
@@ -1778,6 +1957,7 @@ void prvTraceWarning(int errCode);
 #define PSF_WARNING_STREAM_PORT_WRITE 12
 #define PSF_WARNING_STREAM_PORT_INITIAL_BLOCKING 13
 #define PSF_WARNING_STACKMON_NO_SLOTS 14
+#define PSF_WARNING_STREAM_PORT_BACKPRESSURE 15
 
 /******************************************************************************/
 /*** INTERNAL STREAMING FUNCTIONS *********************************************/
@@ -1828,6 +2008,9 @@ void prvPagedEventBufferInit(char* buffer);
 /* Retrieve a pointer to the paged event buffer */
 void* prvPagedEventBufferGetWritePointer(int sizeOfEvent);
 
+/* Marks an event in the paged event buffer as written (lock-free mode only) */
+void prvPagedEventBufferCommit(void* ptrData, int sizeOfEvent);
+
 /* Transfer a full buffer page */
 uint32_t prvPagedEventBufferTransfer(void);
 
@@ -1850,6 +2033,11 @@ int prvIsValidCommand(TracealyzerCommandType* cmd);
 /* Executed the received command (Start or Stop) */
 void prvProcessCommand(TracealyzerCommandType* cmd);
 
+#if (TRC_SAMPLING_MODE == 1)
+/* Stores the histogram of samples, if due. Called by the TzCtrl task. */
+void prvTraceReportSamples(void);
+#endif /* (TRC_SAMPLING_MODE == 1) */
+
 #define vTraceSetStopHook(x) (void)(x)
 
 #endif /*(TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING)*/
@@ -1861,10 +2049,12 @@ void prvProcessCommand(TracealyzerCommandType* cmd);
 #define vTracePrint(chn, ...) (void)(chn)
 #define vTracePrintF(chn, fmt, ...) (void)(chn), (void)(fmt) /* Comma operator is used to avoid "unused variable" compiler warnings in a single statement */
 #define vTraceVPrintF(chn, formatStr, vl) (void)(chn), (void)(formatStr), (void)(vl) /* Comma operator is used to avoid "unused variable" compiler warnings in a single statement */
+#define vTracePrintFCached(chn, fmt, ...) (void)(chn), (void)(fmt) /* Comma operator is used to avoid "unused variable" compiler warnings in a single statement */
 #define vTraceInstanceFinishedNow()
 #define vTraceInstanceFinishedNext()
 #define vTraceStoreISRBegin(x) (void)(x)
 #define vTraceStoreISREnd(x) (void)(x)
+#define vTraceSample(x) (void)(x)
 #define xTraceSetISRProperties(a, b) ((void)(a), (void)(b), (traceHandle)0) /* Comma operator in parenthesis is used to avoid "unused variable" compiler warnings and return 0 in a single statement */
 #define vTraceStoreKernelObjectName(a, b) (void)(a), (void)(b) /* Comma operator is used to avoid "unused variable" compiler warnings in a single statement */
 #define xTraceRegisterChannelFormat(eventLabel, formatStr) ((void)(eventLabel), (void)(formatStr), 0) /* Comma operator in parenthesis is used to avoid "unused variable" compiler warnings and return 0 in a single statement */
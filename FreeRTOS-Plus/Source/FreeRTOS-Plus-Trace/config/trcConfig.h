@@ -90,12 +90,19 @@ extern "C" {
  * an internal RAM buffer, for later upload. Streaming means that the data is
  * transferred continuously to the host PC.
  *
+ * Sampling is streaming with the kernel events replaced by a histogram of the
+ * running task or ISR and program counter, sampled by a periodic timer
+ * interrupt (see vTraceSample and TRC_CFG_SAMPLING_RATE_HZ). This gives a
+ * continuous CPU profile at a small fraction of the bandwidth. It uses the
+ * stream ports and trcStreamingConfig.h of the streaming mode.
+ *
  * For more information, see http://percepio.com/2016/10/05/rtos-tracing/
  * and the Tracealyzer User Manual.
  *
  * Values:
  * TRC_RECORDER_MODE_SNAPSHOT
  * TRC_RECORDER_MODE_STREAMING
+ * TRC_RECORDER_MODE_SAMPLING
  ******************************************************************************/
 #define TRC_CFG_RECORDER_MODE TRC_RECORDER_MODE_SNAPSHOT
 
@@ -271,6 +278,33 @@ extern "C" {
  ******************************************************************************/
 #define TRC_CFG_INCLUDE_STREAM_BUFFER_EVENTS 0
 
+/*******************************************************************************
+ * Configuration Macro: TRC_CFG_EVENT_CLASS_MASK
+ *
+ * Macro which should be defined as a bitwise OR of TRC_EVENT_CLASS_* values
+ * (see trcPortDefines.h), or 0.
+ *
+ * Selects the event classes recorded by the kernel trace hooks. The hooks of
+ * classes not in the mask expand to nothing, so they cost neither code space
+ * nor execution time. Scheduling and ISR events, as well as the creation,
+ * deletion and naming of tasks, queues, semaphores and mutexes, are always
+ * included. Excluding the timer, event group or stream buffer class excludes
+ * all of their events, like the corresponding TRC_CFG_INCLUDE_*_EVENTS setting.
+ *
+ * The mask is combined with the TRC_CFG_INCLUDE_*_EVENTS settings above, i.e.
+ * a class is only recorded if it is both in the mask and included there.
+ * Unlike vTraceSetFilterGroup and vTraceSetFilterMask, which filter events at
+ * run-time after the hook has been called, this can't be changed at run-time.
+ *
+ * For example, 0 records the scheduling and ISRs only, like
+ * TRC_CFG_SCHEDULING_ONLY, but still with the names of queues, semaphores etc.
+ * Adding (TRC_EVENT_CLASS_QUEUE | TRC_EVENT_CLASS_NOTIFY) includes the
+ * inter-task communication as well.
+ *
+ * Default value is TRC_EVENT_CLASS_ALL.
+ ******************************************************************************/
+#define TRC_CFG_EVENT_CLASS_MASK TRC_EVENT_CLASS_ALL
+
  /******************************************************************************
  * TRC_CFG_ENABLE_STACK_MONITOR
  *
@@ -316,6 +350,26 @@ extern "C" {
  *****************************************************************************/
 #define TRC_CFG_STACK_MONITOR_MAX_REPORTS 1
 
+ /******************************************************************************
+ * TRC_CFG_STACK_MONITOR_SCAN_WORDS
+ *
+ * Macro which should be defined as a non-zero integer value.
+ *
+ * The maximum number of stack words (StackType_t) that the stack monitor
+ * checks for each execution of TzCtrl. Each task stack is only checked up to
+ * the lowest amount of unused stack found earlier, and a task whose check does
+ * not complete within this limit is continued in the next execution of TzCtrl.
+ * This bounds the time spent in the stack analysis also for large stacks, but
+ * the unused stack of such tasks is reported less often.
+ *
+ * This applies to FreeRTOS v9.0.0 and later on ports where the stack grows
+ * downwards. Otherwise, uxTaskGetStackHighWaterMark is used, which checks the
+ * whole unused part of the stack in one go.
+ *
+ * Default value is 512.
+ *****************************************************************************/
+#define TRC_CFG_STACK_MONITOR_SCAN_WORDS 512
+
  /*******************************************************************************
  * Configuration Macro: TRC_CFG_CTRL_TASK_PRIORITY
  *
@@ -401,7 +455,7 @@ extern "C" {
 /* Specific configuration, depending on Streaming/Snapshot mode */
 #if (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_SNAPSHOT)
 #include "trcSnapshotConfig.h"
-#elif (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING)
+#elif (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING) || (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_SAMPLING)
 #include "trcStreamingConfig.h"
 #endif
 
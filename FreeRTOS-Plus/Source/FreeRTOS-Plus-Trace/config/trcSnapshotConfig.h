@@ -154,6 +154,25 @@
 #error "TRC_CFG_SYMBOL_TABLE_SIZE may not be zero!"
 #endif
 
+/*******************************************************************************
+ * TRC_CFG_SYMBOL_TABLE_HASH_BITS
+ *
+ * Macro which should be defined as an integer value between 6 and 12.
+ *
+ * The width of the hash used for looking up strings in the symbol table, e.g.
+ * User Event labels and channel names in vTracePrintF. The symbol table entries
+ * are linked in 2^TRC_CFG_SYMBOL_TABLE_HASH_BITS lists, so a wider hash gives
+ * shorter lists to search, if many different strings are used.
+ *
+ * With 6 bits, the list heads are kept in the recorder data structure. Wider
+ * hashes use a separate static table of 2 * 2^TRC_CFG_SYMBOL_TABLE_HASH_BITS
+ * bytes, e.g. 512 bytes for 8 bits. If the application uses many different
+ * strings and has the RAM for this table, 8 to 12 bits are recommended.
+ *
+ * Default value is 6.
+ ******************************************************************************/
+#define TRC_CFG_SYMBOL_TABLE_HASH_BITS 6
+
 /******************************************************************************
  * TRC_CFG_NAME_LEN_TASK, TRC_CFG_NAME_LEN_QUEUE, ...
  *
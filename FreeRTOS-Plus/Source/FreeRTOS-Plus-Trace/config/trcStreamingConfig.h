@@ -62,6 +62,10 @@ extern "C" {
  * If this value is too small, not all symbol names will be stored and the
  * trace display will be affected. In that case, there will be warnings
  * (as User Events) from TzCtrl task, that monitors this.
+ *
+ * Only the symbols in use at the same time count, since the slots of deleted
+ * objects are reused. The symbols are found using a hash index, which takes
+ * 4 bytes of RAM per slot in addition to the table.
  ******************************************************************************/
 #define TRC_CFG_SYMBOL_TABLE_SLOTS 40
 
@@ -112,6 +116,161 @@ extern "C" {
  ******************************************************************************/
 #define TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE 500
 
+/*******************************************************************************
+ * Configuration Macro: TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE
+ *
+ * Macro which should be defined as either zero (0) or one (1).
+ *
+ * If this is one (1), events are stored in the paged event buffer without
+ * a critical section. Each writer reserves its space in the current page using
+ * an atomic compare-and-swap and marks it as written when done. A page is
+ * handed over to the TzCtrl task once it is full and all its writers are done,
+ * so interrupts are never disabled while storing events (except for the ISR
+ * begin/end events, that maintain the ISR stack).
+ *
+ * This requires TRC_PORT_ATOMIC_CAS32 (see trcHardwarePort.h) and a stream
+ * port using the internal buffer. Since a writer may be preempted between
+ * taking its event count and reserving its space, events from nested contexts
+ * are then stored out of order, see TRC_CFG_PAGED_EVENT_BUFFER_ALLOW_UNORDERED.
+ *
+ * Default value is 0.
+ *
+ * Note: not used by the J-Link RTT stream port (see trcStreamingPort.h instead)
+ ******************************************************************************/
+#define TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE 0
+
+/*******************************************************************************
+ * Configuration Macro: TRC_CFG_PAGED_EVENT_BUFFER_ALLOW_UNORDERED
+ *
+ * Macro which should be defined as either zero (0) or one (1).
+ *
+ * Must be set to one (1) to use TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE, to
+ * confirm that the trace may contain events out of order. An event is given
+ * its EventCount before its space is reserved and its timestamp after, so if
+ * an ISR or higher priority task stores events in between, the EventCount
+ * or the timestamp of the stored events is not increasing. Tracealyzer and the
+ * tools in tools/trace_recorder then see the events out of order, and may
+ * report the EventCount gaps as dropped events.
+ *
+ * Default value is 0.
+ ******************************************************************************/
+#define TRC_CFG_PAGED_EVENT_BUFFER_ALLOW_UNORDERED 0
+
+/*******************************************************************************
+ * Configuration Macro: TRC_CFG_COMPACT_EVENT_FORMAT
+ *
+ * Macro which should be defined as either zero (0) or one (1).
+ *
+ * If this is one (1), the events are stored in a compact format, where the
+ * timestamp is stored as a variable-length delta to the previous event and the
+ * parameters as variable-length integers (varints). Typical events then take
+ * about half the space, so more events can be streamed over slow interfaces
+ * (e.g. ARM ITM, USB CDC or TCP/IP) before events are dropped.
+ *
+ * Tracealyzer can't read this format directly. The trace must first be
+ * converted using tools/trace_recorder/psf_compact_decode.py, which restores
+ * the regular PSF format. Can't be combined with
+ * TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE.
+ *
+ * Default value is 0.
+ ******************************************************************************/
+#define TRC_CFG_COMPACT_EVENT_FORMAT 0
+
+/*******************************************************************************
+ * Configuration Macro: TRC_CFG_COMPACT_SYNC_INTERVAL
+ *
+ * Only used if TRC_CFG_COMPACT_EVENT_FORMAT is one (1). The number of events
+ * between sync records, that contain the full timestamp and event count. These
+ * allow the decoder to verify the reconstructed timestamps. Each sync record
+ * takes 7 bytes.
+ *
+ * Default value is 100.
+ ******************************************************************************/
+#define TRC_CFG_COMPACT_SYNC_INTERVAL 100
+
+/*******************************************************************************
+ * Configuration Macro: TRC_CFG_BACKPRESSURE_SAMPLING
+ *
+ * Only used with stream ports that report backpressure, i.e. that define
+ * TRC_STREAM_PORT_BACKPRESSURE (e.g. the TCPIP stream port). While the stream
+ * port reports backpressure, only one of every TRC_CFG_BACKPRESSURE_SAMPLING
+ * kernel service call events (queue, semaphore and mutex operations, delays,
+ * etc.) is stored. Task scheduling, ISR and object creation events, as well
+ * as user events, are always stored. This lets the recorder degrade to
+ * sampling of the kernel service calls, instead of dropping all events once
+ * the paged event buffer is full. The number of events sampled out is
+ * reported by the warning "Stream port backpressure".
+ *
+ * Set this to 1 to disable the sampling.
+ *
+ * Default value is 4.
+ ******************************************************************************/
+#define TRC_CFG_BACKPRESSURE_SAMPLING 4
+
+/*******************************************************************************
+ * Configuration Macro: TRC_CFG_SAMPLING_RATE_HZ
+ *
+ * Only used in sampling mode (TRC_RECORDER_MODE_SAMPLING in trcConfig.h). The
+ * rate of the timer interrupt that calls vTraceSample, passed to
+ * TRC_PORT_SAMPLING_TIMER_INIT (see trcHardwarePort.h). Each sample costs a
+ * few hundred cycles, so this is a trade-off between the overhead and how
+ * quickly the profile converges.
+ *
+ * Default value is 1000.
+ ******************************************************************************/
+#define TRC_CFG_SAMPLING_RATE_HZ 1000
+
+/*******************************************************************************
+ * Configuration Macro: TRC_CFG_SAMPLING_HISTOGRAM_SLOTS
+ *
+ * Only used in sampling mode. The number of (task or ISR, program counter)
+ * pairs counted between two reports by the TzCtrl task. Each slot takes 12
+ * bytes of RAM. Samples that find no free slot are still counted, as samples
+ * of an unknown context, and make TzCtrl report the histogram right away.
+ *
+ * Default value is 64.
+ ******************************************************************************/
+#define TRC_CFG_SAMPLING_HISTOGRAM_SLOTS 64
+
+/*******************************************************************************
+ * Configuration Macro: TRC_CFG_SAMPLING_PC_SHIFT
+ *
+ * Only used in sampling mode. The resolution of the program counter histogram,
+ * as a power of two. The program counter of each sample is rounded down to a
+ * multiple of 2^TRC_CFG_SAMPLING_PC_SHIFT bytes, so samples within a small
+ * piece of code share a histogram slot. Set this to 0 to count the exact
+ * addresses.
+ *
+ * Default value is 4 (16 bytes).
+ ******************************************************************************/
+#define TRC_CFG_SAMPLING_PC_SHIFT 4
+
+/*******************************************************************************
+ * Configuration Macro: TRC_CFG_SAMPLING_REPORT_INTERVAL
+ *
+ * Only used in sampling mode. The number of samples after which the TzCtrl
+ * task stores the histogram in the trace and clears it, as one event per
+ * histogram slot in use. It is stored earlier if the slots run out. Note that
+ * the events are only sent to the host when a buffer page is full, so with
+ * no other trace data, smaller pages give more timely reports.
+ *
+ * Default value is TRC_CFG_SAMPLING_RATE_HZ, i.e. about once per second.
+ ******************************************************************************/
+#define TRC_CFG_SAMPLING_REPORT_INTERVAL (TRC_CFG_SAMPLING_RATE_HZ)
+
+/*******************************************************************************
+ * Configuration Macro: TRC_CFG_SAMPLING_KERNEL_EVENT_INTERVAL
+ *
+ * Only used in sampling mode. The kernel events (scheduling, ISRs and kernel
+ * service calls) are not stored in sampling mode. If this is non-zero, one of
+ * every TRC_CFG_SAMPLING_KERNEL_EVENT_INTERVAL kernel events is stored anyway,
+ * to give an idea of the kernel activity. Object creation and names, user
+ * events and the recorder's own events are always stored.
+ *
+ * Default value is 0 (no kernel events).
+ ******************************************************************************/
+#define TRC_CFG_SAMPLING_KERNEL_EVENT_INTERVAL 0
+
 /*******************************************************************************
  * TRC_CFG_ISR_TAILCHAINING_THRESHOLD
  *
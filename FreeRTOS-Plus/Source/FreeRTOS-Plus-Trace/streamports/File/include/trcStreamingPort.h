@@ -52,6 +52,81 @@
 extern "C" {
 #endif
 
+/*******************************************************************************
+ * Configuration Macro: TRC_CFG_STREAM_PORT_FILE_ASYNC
+ *
+ * If this is one (1), the trace data is handed over to a host thread that
+ * writes the file, so the TzCtrl task only copies the data and never waits
+ * for the disk or the stdio locks. Requires POSIX threads. If zero (0), the
+ * data is written with fwrite directly from the TzCtrl task.
+ *
+ * Default value is 1, except on Windows.
+ ******************************************************************************/
+#ifndef TRC_CFG_STREAM_PORT_FILE_ASYNC
+#ifdef _WIN32
+#define TRC_CFG_STREAM_PORT_FILE_ASYNC 0
+#else
+#define TRC_CFG_STREAM_PORT_FILE_ASYNC 1
+#endif
+#endif
+
+/*******************************************************************************
+ * Configuration Macro: TRC_CFG_STREAM_PORT_FILE_CHUNK_SIZE
+ *
+ * Only used if TRC_CFG_STREAM_PORT_FILE_ASYNC is 1. The writer thread writes
+ * the file in chunks of this many bytes, at offsets aligned to this size. Must
+ * be a power of two, and at least the block size of the file system if
+ * TRC_CFG_STREAM_PORT_FILE_DIRECT_IO is used.
+ *
+ * Default value is 64 KB.
+ ******************************************************************************/
+#ifndef TRC_CFG_STREAM_PORT_FILE_CHUNK_SIZE
+#define TRC_CFG_STREAM_PORT_FILE_CHUNK_SIZE (64 * 1024)
+#endif
+
+/*******************************************************************************
+ * Configuration Macro: TRC_CFG_STREAM_PORT_FILE_BUFFER_CHUNKS
+ *
+ * Only used if TRC_CFG_STREAM_PORT_FILE_ASYNC is 1. The number of chunks in
+ * the buffer between the TzCtrl task and the writer thread. When the buffer
+ * is full, the stream port reports backpressure to the recorder (see
+ * TRC_STREAM_PORT_BACKPRESSURE) until the writer thread has caught up.
+ *
+ * Default value is 16, i.e. 1 MB with the default chunk size.
+ ******************************************************************************/
+#ifndef TRC_CFG_STREAM_PORT_FILE_BUFFER_CHUNKS
+#define TRC_CFG_STREAM_PORT_FILE_BUFFER_CHUNKS 16
+#endif
+
+/*******************************************************************************
+ * Configuration Macro: TRC_CFG_STREAM_PORT_FILE_DIRECT_IO
+ *
+ * Only used if TRC_CFG_STREAM_PORT_FILE_ASYNC is 1. If this is one (1), the
+ * file is opened with O_DIRECT (where supported), so the trace data bypasses
+ * the page cache of the host. Partial chunks are then only written when the
+ * recording ends. If the file system doesn't support O_DIRECT, the file is
+ * written normally.
+ *
+ * Default value is 0.
+ ******************************************************************************/
+#ifndef TRC_CFG_STREAM_PORT_FILE_DIRECT_IO
+#define TRC_CFG_STREAM_PORT_FILE_DIRECT_IO 0
+#endif
+
+/*******************************************************************************
+ * Configuration Macro: TRC_CFG_STREAM_PORT_FILE_SYNC_INTERVAL
+ *
+ * Only used if TRC_CFG_STREAM_PORT_FILE_ASYNC is 1. If non-zero, the writer
+ * thread calls fdatasync after every this many bytes written, so that at
+ * most this much of the trace is lost if the host crashes. Zero (0) leaves
+ * this to the operating system.
+ *
+ * Default value is 0.
+ ******************************************************************************/
+#ifndef TRC_CFG_STREAM_PORT_FILE_SYNC_INTERVAL
+#define TRC_CFG_STREAM_PORT_FILE_SYNC_INTERVAL 0
+#endif
+
 int32_t writeToFile(void* data, uint32_t size, int32_t *ptrBytesWritten);
 
 void closeFile(void);
@@ -67,6 +142,16 @@ then the paged event buffer must be enabled to avoid infinite recursion. */
 
 #define TRC_STREAM_PORT_WRITE_DATA(_ptrData, _size, _ptrBytesSent) writeToFile(_ptrData, _size, _ptrBytesSent)
 
+/* The TzCtrl task may write all buffer pages that are ready in one call */
+#define TRC_STREAM_PORT_MAX_BURST_SIZE ((TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT) * (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE))
+
+#if (TRC_CFG_STREAM_PORT_FILE_ASYNC == 1)
+int32_t fileWriterBackpressure(void);
+
+/* Non-zero while the writer thread's buffer is full */
+#define TRC_STREAM_PORT_BACKPRESSURE() fileWriterBackpressure()
+#endif /* (TRC_CFG_STREAM_PORT_FILE_ASYNC == 1) */
+
 #if (TRC_CFG_RECORDER_BUFFER_ALLOCATION == TRC_RECORDER_BUFFER_ALLOCATION_DYNAMIC)
 #define TRC_STREAM_PORT_MALLOC() \
 			_TzTraceData = TRC_PORT_MALLOC((TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT) * (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE));
@@ -45,18 +45,351 @@
  * www.percepio.com
  ******************************************************************************/
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+/* For O_DIRECT, must be defined before any system header is included */
+#define _GNU_SOURCE
+#endif
+
 #include "trcRecorder.h"
 
 #if (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING)  
 #if (TRC_USE_TRACEALYZER_RECORDER == 1)
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#if (TRC_CFG_STREAM_PORT_FILE_ASYNC == 1)
+
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if ((TRC_CFG_STREAM_PORT_FILE_CHUNK_SIZE) & ((TRC_CFG_STREAM_PORT_FILE_CHUNK_SIZE) - 1)) != 0
+#error "TRC_CFG_STREAM_PORT_FILE_CHUNK_SIZE must be a power of two"
+#endif
+
+#if ((TRC_CFG_STREAM_PORT_FILE_BUFFER_CHUNKS) & ((TRC_CFG_STREAM_PORT_FILE_BUFFER_CHUNKS) - 1)) != 0
+#error "TRC_CFG_STREAM_PORT_FILE_BUFFER_CHUNKS must be a power of two"
+#endif
+
+#define TRC_FILE_BUFFER_SIZE ((uint32_t)(TRC_CFG_STREAM_PORT_FILE_CHUNK_SIZE) * (TRC_CFG_STREAM_PORT_FILE_BUFFER_CHUNKS))
+
+/* How long a partial chunk may wait before it is written, unless O_DIRECT */
+#define TRC_FILE_PARTIAL_WRITE_MS 100
+
+#ifdef __APPLE__
+#define fdatasync(fd) fsync(fd)
+#endif
+
+/* The buffer between the TzCtrl task and the writer thread. The head and tail
+are the number of bytes put into the buffer and written to the file since it
+was opened, so the data to write is (head - tail) bytes, starting at
+(tail & (TRC_FILE_BUFFER_SIZE - 1)). They are protected by fileWriterLock, but
+the data itself is copied and written outside of the lock. */
+static uint8_t* fileBuffer = NULL;
+static uint32_t fileBufferHead = 0;
+static uint32_t fileBufferTail = 0;
+static int32_t fileBufferFull = 0;
+
+static int traceFd = -1;
+static int fileDirectIO = 0;
+static int fileWriterStop = 0;
+static int fileWriterError = 0;
+static pthread_t fileWriterThread;
+static pthread_mutex_t fileWriterLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t fileWriterWakeup = PTHREAD_COND_INITIALIZER;
+
+/* Writes all of the data, returns 0 or the error code */
+static int prvWriteAll(uint8_t* data, uint32_t size)
+{
+	ssize_t written;
+
+	while (size > 0)
+	{
+		written = write(traceFd, data, size);
+		if (written < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return errno;
+		}
+		data += written;
+		size -= (uint32_t)written;
+	}
+
+	return 0;
+}
+
+static void* prvFileWriterThread(void* arg)
+{
+	struct timespec timeout;
+	uint32_t offset;
+	uint32_t length;
+#if (TRC_CFG_STREAM_PORT_FILE_SYNC_INTERVAL > 0)
+	uint32_t unsynced = 0;
+#endif /* (TRC_CFG_STREAM_PORT_FILE_SYNC_INTERVAL > 0) */
+	int timedOut = 0;
+	int err;
+
+	(void)arg;
+
+	pthread_mutex_lock(&fileWriterLock);
+
+	while (1)
+	{
+		length = fileBufferHead - fileBufferTail;
+
+		if (length >= (TRC_CFG_STREAM_PORT_FILE_CHUNK_SIZE))
+		{
+			length = (TRC_CFG_STREAM_PORT_FILE_CHUNK_SIZE);
+		}
+		else if ((length == 0) || ((! fileWriterStop) && (fileDirectIO || (! timedOut))))
+		{
+			if (fileWriterStop)
+			{
+				break;
+			}
+
+			/* Wait for a full chunk, or for a while before writing a partial one */
+			clock_gettime(CLOCK_REALTIME, &timeout);
+			timeout.tv_nsec += TRC_FILE_PARTIAL_WRITE_MS * 1000000L;
+			if (timeout.tv_nsec >= 1000000000L)
+			{
+				timeout.tv_sec++;
+				timeout.tv_nsec -= 1000000000L;
+			}
+			timedOut = (pthread_cond_timedwait(&fileWriterWakeup, &fileWriterLock, &timeout) == ETIMEDOUT);
+			continue;
+		}
+
+		/* Up to the end of the buffer. Without partial writes, the chunks are
+		aligned in both the buffer and the file, as needed for O_DIRECT. */
+		offset = fileBufferTail & (TRC_FILE_BUFFER_SIZE - 1);
+		if (length > TRC_FILE_BUFFER_SIZE - offset)
+		{
+			length = TRC_FILE_BUFFER_SIZE - offset;
+		}
+
+		pthread_mutex_unlock(&fileWriterLock);
+
+#if defined(O_DIRECT)
+		if (fileDirectIO && ((length & ((TRC_CFG_STREAM_PORT_FILE_CHUNK_SIZE) - 1)) != 0))
+		{
+			/* The last partial chunk, when closing, can't be written directly */
+			fcntl(traceFd, F_SETFL, fcntl(traceFd, F_GETFL) & ~O_DIRECT);
+			fileDirectIO = 0;
+		}
+#endif /* defined(O_DIRECT) */
+
+		err = prvWriteAll(&fileBuffer[offset], length);
+
+#if (TRC_CFG_STREAM_PORT_FILE_SYNC_INTERVAL > 0)
+		unsynced += length;
+		if ((err == 0) && (unsynced >= (TRC_CFG_STREAM_PORT_FILE_SYNC_INTERVAL)))
+		{
+			fdatasync(traceFd);
+			unsynced = 0;
+		}
+#endif /* (TRC_CFG_STREAM_PORT_FILE_SYNC_INTERVAL > 0) */
+
+		pthread_mutex_lock(&fileWriterLock);
+
+		if (err != 0)
+		{
+			/* Reported by writeToFile, so that the recorder stops */
+			fileWriterError = err;
+			fileBufferTail = fileBufferHead;
+		}
+		else
+		{
+			fileBufferTail += length;
+		}
+		timedOut = 0;
+	}
+
+	pthread_mutex_unlock(&fileWriterLock);
+
+	return NULL;
+}
+
+void openFile(char* fileName)
+{
+	int flags = O_WRONLY | O_CREAT | O_TRUNC;
+	sigset_t allSignals;
+	sigset_t oldSignals;
+	static int exitHandlerRegistered = 0;
+
+	if (traceFd != -1)
+	{
+		return;
+	}
+
+#if (TRC_CFG_STREAM_PORT_FILE_DIRECT_IO == 1) && defined(O_DIRECT)
+	traceFd = open(fileName, flags | O_DIRECT, 0644);
+	fileDirectIO = (traceFd != -1);
+	/* If the file system doesn't support O_DIRECT, the file is written normally */
+#endif /* (TRC_CFG_STREAM_PORT_FILE_DIRECT_IO == 1) && defined(O_DIRECT) */
+
+	if (traceFd == -1)
+	{
+		traceFd = open(fileName, flags, 0644);
+	}
+
+	if ((traceFd == -1) ||
+		(posix_memalign((void**)&fileBuffer, (TRC_CFG_STREAM_PORT_FILE_CHUNK_SIZE), TRC_FILE_BUFFER_SIZE) != 0))
+	{
+		printf("Could not open trace file, error code %d.\n", errno);
+		exit(-1);
+	}
+
+	fileBufferHead = 0;
+	fileBufferTail = 0;
+	fileBufferFull = 0;
+	fileWriterStop = 0;
+	fileWriterError = 0;
+
+	/* The writer thread must not receive the signals that the FreeRTOS POSIX
+	port uses for its tick and context switches */
+	sigfillset(&allSignals);
+	pthread_sigmask(SIG_SETMASK, &allSignals, &oldSignals);
+	if (pthread_create(&fileWriterThread, NULL, prvFileWriterThread, NULL) != 0)
+	{
+		printf("Could not create the trace file writer thread.\n");
+		exit(-1);
+	}
+	pthread_sigmask(SIG_SETMASK, &oldSignals, NULL);
+
+	if (! exitHandlerRegistered)
+	{
+		/* Writes what is left if the application exits while recording */
+		atexit(closeFile);
+		exitHandlerRegistered = 1;
+	}
+
+	printf("Trace file created%s.\n", fileDirectIO ? " (O_DIRECT)" : "");
+}
+
+int32_t writeToFile(void* data, uint32_t size, int32_t *ptrBytesWritten)
+{
+	uint32_t head;
+	uint32_t offset;
+	uint32_t length;
+	uint32_t first;
+	int err;
+
+	if (ptrBytesWritten != 0)
+		*ptrBytesWritten = 0;
+
+	if (fileBuffer == NULL)
+		return -1;
+
+	pthread_mutex_lock(&fileWriterLock);
+	head = fileBufferHead;
+	length = TRC_FILE_BUFFER_SIZE - (head - fileBufferTail);
+	err = fileWriterError;
+	pthread_mutex_unlock(&fileWriterLock);
+
+	if (err != 0)
+	{
+		printf("Could not write trace file, error code %d.\n", err);
+		return -1;
+	}
+
+	if (length > size)
+	{
+		length = size;
+	}
+
+	/* Only the writer thread reads this part of the buffer, once the head
+	has been moved past it */
+	offset = head & (TRC_FILE_BUFFER_SIZE - 1);
+	first = TRC_FILE_BUFFER_SIZE - offset;
+	if (first > length)
+	{
+		first = length;
+	}
+	memcpy(&fileBuffer[offset], data, first);
+	memcpy(&fileBuffer[0], (uint8_t*)data + first, length - first);
+
+	pthread_mutex_lock(&fileWriterLock);
+	fileBufferHead = head + length;
+	if ((fileBufferHead - fileBufferTail) >= (TRC_CFG_STREAM_PORT_FILE_CHUNK_SIZE))
+	{
+		pthread_cond_signal(&fileWriterWakeup);
+	}
+
+	/* Backpressure with hysteresis, from three quarters to one quarter full */
+	if ((length < size) || ((fileBufferHead - fileBufferTail) >= (TRC_FILE_BUFFER_SIZE / 4) * 3))
+	{
+		fileBufferFull = 1;
+	}
+	pthread_mutex_unlock(&fileWriterLock);
+
+	if (ptrBytesWritten != 0)
+		*ptrBytesWritten = (int32_t)length;
+
+	return 0;
+}
+
+int32_t fileWriterBackpressure(void)
+{
+	int32_t full;
+
+	pthread_mutex_lock(&fileWriterLock);
+	if (fileBufferFull && ((fileBufferHead - fileBufferTail) <= TRC_FILE_BUFFER_SIZE / 4))
+	{
+		fileBufferFull = 0;
+	}
+	full = fileBufferFull;
+	pthread_mutex_unlock(&fileWriterLock);
+
+	return full;
+}
+
+void closeFile(void)
+{
+	if (traceFd != -1)
+	{
+		/* The writer thread writes what is left before it exits */
+		pthread_mutex_lock(&fileWriterLock);
+		fileWriterStop = 1;
+		pthread_cond_signal(&fileWriterWakeup);
+		pthread_mutex_unlock(&fileWriterLock);
+
+		pthread_join(fileWriterThread, NULL);
+
+		close(traceFd);
+		traceFd = -1;
+		free(fileBuffer);
+		fileBuffer = NULL;
+		printf("Trace file closed.\n");
+	}
+}
+
+#else /* (TRC_CFG_STREAM_PORT_FILE_ASYNC == 1) */
+
 FILE* traceFile = NULL;
 
 void openFile(char* fileName)
 {
 	if (traceFile == NULL)
 	{
+#ifdef _MSC_VER
 		errno_t err = fopen_s(&traceFile, fileName, "wb");
+#else
+		int err = 0;
+		traceFile = fopen(fileName, "wb");
+		if (traceFile == NULL)
+		{
+			err = errno;
+		}
+#endif
 		if (err != 0)
 		{
 			printf("Could not open trace file, error code %d.\n", err);
@@ -99,5 +432,7 @@ void closeFile(void)
 	}
 }
 
+#endif /* (TRC_CFG_STREAM_PORT_FILE_ASYNC == 1) */
+
 #endif /*(TRC_USE_TRACEALYZER_RECORDER == 1)*/
 #endif /*(TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING)*/
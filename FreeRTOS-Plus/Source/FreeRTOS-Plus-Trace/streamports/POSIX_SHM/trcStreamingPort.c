@@ -0,0 +1,255 @@
+/*******************************************************************************
+ * Trace Recorder Library for Tracealyzer v4.4.0
+ * Percepio AB, www.percepio.com
+ *
+ * trcStreamingPort.c
+ *
+ * Supporting functions for trace streaming, used by the "stream ports" 
+ * for reading and writing data to the interface.
+ * Existing ports can easily be modified to fit another setup, e.g., a 
+ * different TCP/IP stack, or to define your own stream port.
+ *
+  * Terms of Use
+ * This file is part of the trace recorder library (RECORDER), which is the 
+ * intellectual property of Percepio AB (PERCEPIO) and provided under a
+ * license as follows.
+ * The RECORDER may be used free of charge for the purpose of recording data
+ * intended for analysis in PERCEPIO products. It may not be used or modified
+ * for other purposes without explicit permission from PERCEPIO.
+ * You may distribute the RECORDER in its original source code form, assuming
+ * this text (terms of use, disclaimer, copyright notice) is unchanged. You are
+ * allowed to distribute the RECORDER with minor modifications intended for
+ * configuration or porting of the RECORDER, e.g., to allow using it on a 
+ * specific processor, processor family or with a specific communication
+ * interface. Any such modifications should be documented directly below
+ * this comment block.  
+ *
+ * Disclaimer
+ * The RECORDER is being delivered to you AS IS and PERCEPIO makes no warranty
+ * as to its use or performance. PERCEPIO does not and cannot warrant the 
+ * performance or results you may obtain by using the RECORDER or documentation.
+ * PERCEPIO make no warranties, express or implied, as to noninfringement of
+ * third party rights, merchantability, or fitness for any particular purpose.
+ * In no event will PERCEPIO, its technology partners, or distributors be liable
+ * to you for any consequential, incidental or special damages, including any
+ * lost profits or lost savings, even if a representative of PERCEPIO has been
+ * advised of the possibility of such damages, or for any claim by any third
+ * party. Some jurisdictions do not allow the exclusion or limitation of
+ * incidental, consequential or special damages, or the exclusion of implied
+ * warranties or limitations on how long an implied warranty may last, so the
+ * above limitations may not apply to you.
+ *
+ * Tabs are used for indent in this file (1 tab = 4 spaces)
+ *
+ * Copyright Percepio AB, 2018.
+ * www.percepio.com
+ ******************************************************************************/
+#include "trcRecorder.h"
+
+#if (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING)  
+#if (TRC_USE_TRACEALYZER_RECORDER == 1)
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#if ((TRC_CFG_STREAM_PORT_SHM_SIZE) & ((TRC_CFG_STREAM_PORT_SHM_SIZE) - 1)) != 0
+#error "TRC_CFG_STREAM_PORT_SHM_SIZE must be a power of two."
+#endif
+
+#define TRC_SHM_MAGIC 0x48535254 /* "TRSH" */
+#define TRC_SHM_VERSION 1
+
+#define TRC_SHM_STATE_IDLE 0
+#define TRC_SHM_STATE_TRACING 1
+#define TRC_SHM_STATE_STOPPED 2
+
+/* The layout of the shared memory object. The recorder is the only writer of
+head and the host reader is the only writer of tail, both are free running byte
+counters. The reader relies on the field offsets, so only append new fields at
+the end of the reserved area and bump TRC_SHM_VERSION. */
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;					/* Ring size in bytes */
+	uint32_t dataOffset;			/* Offset of the ring data from the start of the object */
+	volatile uint32_t head;			/* Bytes published by the recorder */
+	volatile uint32_t writerState;	/* TRC_SHM_STATE_* */
+	volatile uint32_t writerPid;
+	volatile uint32_t session;		/* Incremented each time the recording is started */
+	volatile uint32_t droppedBytes;	/* Bytes discarded while no reader was attached */
+	volatile uint32_t fullWaits;	/* Number of times the recorder waited for the reader */
+	uint32_t reserved1[6];
+	volatile uint32_t tail;			/* Bytes consumed by the reader, on its own cache line */
+	volatile uint32_t readerPid;	/* Set by the reader while attached, 0 otherwise */
+	uint32_t reserved2[14];
+} TraceShmRing;
+
+static TraceShmRing* shmRing = NULL;
+static uint8_t* shmData = NULL;
+
+/* Returns 1 if a host reader is attached to the ring. A reader that exited
+without detaching (e.g. was killed) is detached here, so the recorder doesn't
+wait for it forever. */
+static int prvReaderAttached(void)
+{
+	uint32_t pid = shmRing->readerPid;
+
+	if (pid == 0)
+	{
+		return 0;
+	}
+
+	if ((kill((pid_t)pid, 0) != 0) && (errno == ESRCH))
+	{
+		shmRing->readerPid = 0;
+		return 0;
+	}
+
+	return 1;
+}
+
+void trcShmOpen(const char* name)
+{
+	int fd;
+	void* mem;
+	size_t totalSize = sizeof(TraceShmRing) + (TRC_CFG_STREAM_PORT_SHM_SIZE);
+
+	if (shmRing != NULL)
+	{
+		return;
+	}
+
+	/* Always start from a fresh object, a reader still mapping an old one will
+	see that the old writer is gone. */
+	shm_unlink(name);
+
+	fd = shm_open(name, O_CREAT | O_RDWR, 0600);
+	if (fd < 0)
+	{
+		printf("Could not create trace shared memory %s, error code %d.\n", name, errno);
+		return;
+	}
+
+	if (ftruncate(fd, (off_t)totalSize) != 0)
+	{
+		printf("Could not size trace shared memory %s, error code %d.\n", name, errno);
+		close(fd);
+		shm_unlink(name);
+		return;
+	}
+
+	mem = mmap(NULL, totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (mem == MAP_FAILED)
+	{
+		printf("Could not map trace shared memory %s, error code %d.\n", name, errno);
+		shm_unlink(name);
+		return;
+	}
+
+	shmRing = (TraceShmRing*)mem;
+	shmData = (uint8_t*)mem + sizeof(TraceShmRing);
+
+	/* ftruncate gives a zero filled object, the magic is written last so that
+	a waiting reader sees a fully initialized header. */
+	shmRing->version = TRC_SHM_VERSION;
+	shmRing->size = TRC_CFG_STREAM_PORT_SHM_SIZE;
+	shmRing->dataOffset = sizeof(TraceShmRing);
+	shmRing->writerPid = (uint32_t)getpid();
+	__sync_synchronize();
+	shmRing->magic = TRC_SHM_MAGIC;
+
+	printf("Trace shared memory %s created.\n", name);
+}
+
+void trcShmBegin(void)
+{
+	if (shmRing != NULL)
+	{
+		shmRing->session++;
+		__sync_synchronize();
+		shmRing->writerState = TRC_SHM_STATE_TRACING;
+	}
+}
+
+void trcShmEnd(void)
+{
+	if (shmRing != NULL)
+	{
+		__sync_synchronize();
+		shmRing->writerState = TRC_SHM_STATE_STOPPED;
+	}
+}
+
+int32_t trcShmWrite(void* data, uint32_t size, int32_t *ptrBytesWritten)
+{
+	uint32_t head;
+	uint32_t space;
+	uint32_t offset;
+	uint32_t first;
+
+	if (ptrBytesWritten != 0)
+		*ptrBytesWritten = 0;
+
+	if (shmRing == NULL)
+		return -1;
+
+	head = shmRing->head;
+	__sync_synchronize(); /* Read tail after head, pairs with the reader updating tail */
+	space = (TRC_CFG_STREAM_PORT_SHM_SIZE) - (head - shmRing->tail);
+
+	if (size > space)
+	{
+		if (!prvReaderAttached())
+		{
+			/* Nobody is draining the ring. Drop the data rather than stalling,
+			and drop all of it so that the ring only holds whole events. */
+			shmRing->droppedBytes += size;
+			if (ptrBytesWritten != 0)
+				*ptrBytesWritten = (int32_t)size;
+			return 0;
+		}
+
+		if (space == 0)
+		{
+			/* The reader is behind by the whole ring. Report nothing written,
+			prvPagedEventBufferTransfer keeps the page and calls again. */
+			struct timespec delay = { 0, (TRC_CFG_STREAM_PORT_SHM_POLL_US) * 1000 };
+			shmRing->fullWaits++;
+			nanosleep(&delay, NULL);
+			return 0;
+		}
+
+		size = space;
+	}
+
+	offset = head & ((TRC_CFG_STREAM_PORT_SHM_SIZE) - 1);
+	first = (TRC_CFG_STREAM_PORT_SHM_SIZE) - offset;
+	if (first > size)
+	{
+		first = size;
+	}
+
+	memcpy(&shmData[offset], data, first);
+	memcpy(&shmData[0], (uint8_t*)data + first, size - first);
+
+	/* Publish the data before moving head */
+	__sync_synchronize();
+	shmRing->head = head + size;
+
+	if (ptrBytesWritten != 0)
+		*ptrBytesWritten = (int32_t)size;
+
+	return 0;
+}
+
+#endif /*(TRC_USE_TRACEALYZER_RECORDER == 1)*/
+#endif /*(TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING)*/
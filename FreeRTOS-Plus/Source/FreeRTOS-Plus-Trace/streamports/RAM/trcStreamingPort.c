@@ -0,0 +1,100 @@
+/*******************************************************************************
+ * Trace Recorder Library for Tracealyzer v4.4.0
+ * Percepio AB, www.percepio.com
+ *
+ * trcStreamingPort.c
+ *
+ * Supporting functions for trace streaming, used by the "stream ports" 
+ * for reading and writing data to the interface.
+ * Existing ports can easily be modified to fit another setup, e.g., a 
+ * different TCP/IP stack, or to define your own stream port.
+ *
+  * Terms of Use
+ * This file is part of the trace recorder library (RECORDER), which is the 
+ * intellectual property of Percepio AB (PERCEPIO) and provided under a
+ * license as follows.
+ * The RECORDER may be used free of charge for the purpose of recording data
+ * intended for analysis in PERCEPIO products. It may not be used or modified
+ * for other purposes without explicit permission from PERCEPIO.
+ * You may distribute the RECORDER in its original source code form, assuming
+ * this text (terms of use, disclaimer, copyright notice) is unchanged. You are
+ * allowed to distribute the RECORDER with minor modifications intended for
+ * configuration or porting of the RECORDER, e.g., to allow using it on a 
+ * specific processor, processor family or with a specific communication
+ * interface. Any such modifications should be documented directly below
+ * this comment block.  
+ *
+ * Disclaimer
+ * The RECORDER is being delivered to you AS IS and PERCEPIO makes no warranty
+ * as to its use or performance. PERCEPIO does not and cannot warrant the 
+ * performance or results you may obtain by using the RECORDER or documentation.
+ * PERCEPIO make no warranties, express or implied, as to noninfringement of
+ * third party rights, merchantability, or fitness for any particular purpose.
+ * In no event will PERCEPIO, its technology partners, or distributors be liable
+ * to you for any consequential, incidental or special damages, including any
+ * lost profits or lost savings, even if a representative of PERCEPIO has been
+ * advised of the possibility of such damages, or for any claim by any third
+ * party. Some jurisdictions do not allow the exclusion or limitation of
+ * incidental, consequential or special damages, or the exclusion of implied
+ * warranties or limitations on how long an implied warranty may last, so the
+ * above limitations may not apply to you.
+ *
+ * Tabs are used for indent in this file (1 tab = 4 spaces)
+ *
+ * Copyright Percepio AB, 2018.
+ * www.percepio.com
+ ******************************************************************************/
+#include "trcRecorder.h"
+
+#if (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING)  
+#if (TRC_USE_TRACEALYZER_RECORDER == 1)
+
+#include <string.h>
+
+#if ((TRC_CFG_STREAM_PORT_RAM_SIZE) & ((TRC_CFG_STREAM_PORT_RAM_SIZE) - 1)) != 0
+#error "TRC_CFG_STREAM_PORT_RAM_SIZE must be a power of two."
+#endif
+
+uint8_t trcRamStreamBuffer[TRC_CFG_STREAM_PORT_RAM_SIZE];
+
+volatile uint32_t trcRamStreamHead = 0;
+
+void trcRamBegin(void)
+{
+	trcRamStreamHead = 0;
+}
+
+int32_t trcRamWrite(void* data, uint32_t size, int32_t *ptrBytesWritten)
+{
+	uint32_t head = trcRamStreamHead;
+	uint32_t offset;
+	uint32_t first;
+
+	if (ptrBytesWritten != 0)
+		*ptrBytesWritten = (int32_t)size;
+
+	/* Only the last part of a write larger than the ring is kept */
+	if (size > (TRC_CFG_STREAM_PORT_RAM_SIZE))
+	{
+		head += size - (TRC_CFG_STREAM_PORT_RAM_SIZE);
+		data = (uint8_t*)data + size - (TRC_CFG_STREAM_PORT_RAM_SIZE);
+		size = TRC_CFG_STREAM_PORT_RAM_SIZE;
+	}
+
+	offset = head & ((TRC_CFG_STREAM_PORT_RAM_SIZE) - 1);
+	first = (TRC_CFG_STREAM_PORT_RAM_SIZE) - offset;
+	if (first > size)
+	{
+		first = size;
+	}
+
+	memcpy(&trcRamStreamBuffer[offset], data, first);
+	memcpy(&trcRamStreamBuffer[0], (uint8_t*)data + first, size - first);
+
+	trcRamStreamHead = head + size;
+
+	return 0;
+}
+
+#endif /*(TRC_USE_TRACEALYZER_RECORDER == 1)*/
+#endif /*(TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING)*/
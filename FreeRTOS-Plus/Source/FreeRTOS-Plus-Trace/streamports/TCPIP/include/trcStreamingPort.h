@@ -6,7 +6,8 @@
  *
  * The interface definitions for trace streaming ("stream ports").
  * This "stream port" sets up the recorder to use TCP/IP as streaming channel.
- * The example is for lwIP.
+ * The example is for lwIP, or the BSD socket API of the host (see
+ * TRC_CFG_STREAM_PORT_TCP_BSD_SOCKETS).
  *
  * Terms of Use
  * This file is part of the trace recorder library (RECORDER), which is the 
@@ -51,16 +52,73 @@
 extern "C" {
 #endif
 
+/*******************************************************************************
+ * Configuration Macro: TRC_CFG_STREAM_PORT_TCP_BSD_SOCKETS
+ *
+ * Set this to 1 to use the BSD/POSIX socket API of the host instead of lwIP,
+ * e.g. when running the FreeRTOS POSIX (Linux) simulator.
+ *
+ * Default value is 0 (lwIP).
+ ******************************************************************************/
+#ifndef TRC_CFG_STREAM_PORT_TCP_BSD_SOCKETS
+#define TRC_CFG_STREAM_PORT_TCP_BSD_SOCKETS 0
+#endif
+
+/*******************************************************************************
+ * Configuration Macro: TRC_CFG_STREAM_PORT_TCP_STAGING_SIZE
+ *
+ * The size of the staging ring in bytes, that holds the trace data written by
+ * the recorder until the TCP stack accepts it. Must be a power of two. The
+ * recorder is told to back off (see TRC_STREAM_PORT_BACKPRESSURE) when the
+ * ring is three quarters full, until it has drained to one quarter.
+ *
+ * Default value is 8 KB.
+ ******************************************************************************/
+#ifndef TRC_CFG_STREAM_PORT_TCP_STAGING_SIZE
+#define TRC_CFG_STREAM_PORT_TCP_STAGING_SIZE (8 * 1024)
+#endif
+
+/*******************************************************************************
+ * Configuration Macro: TRC_CFG_STREAM_PORT_TCP_SEND_SIZE
+ *
+ * The largest number of bytes given to send() in one call. This should match
+ * the send window of the TCP stack (e.g. TCP_SND_BUF in lwIP), so that each
+ * call fills the window without the stack having to refuse most of the data.
+ *
+ * Default value is 2 KB.
+ ******************************************************************************/
+#ifndef TRC_CFG_STREAM_PORT_TCP_SEND_SIZE
+#define TRC_CFG_STREAM_PORT_TCP_SEND_SIZE (2 * 1024)
+#endif
+
+/* The TCP port to listen to */
+#ifndef TRC_TCPIP_PORT
+#define TRC_TCPIP_PORT 12000
+#endif
+
 #define TRC_STREAM_PORT_USE_INTERNAL_BUFFER 1
 
 int32_t trcTcpRead(void* data, uint32_t size, int32_t *ptrBytesRead);
 
 int32_t trcTcpWrite(void* data, uint32_t size, int32_t *ptrBytesWritten);
 
+int32_t trcTcpBackpressure(void);
+
+void trcTcpBegin(void);
+
 #define TRC_STREAM_PORT_READ_DATA(_ptrData, _size, _ptrBytesRead) trcTcpRead(_ptrData, _size, _ptrBytesRead)
 
 #define TRC_STREAM_PORT_WRITE_DATA(_ptrData, _size, _ptrBytesSent) trcTcpWrite(_ptrData, _size, _ptrBytesSent)
 
+/* The TzCtrl task may write all buffer pages that are ready in one call */
+#define TRC_STREAM_PORT_MAX_BURST_SIZE ((TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT) * (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE))
+
+/* Non-zero while the staging ring is nearly full, see trcTcpBackpressure */
+#define TRC_STREAM_PORT_BACKPRESSURE() trcTcpBackpressure()
+
+/* Drops any data staged from a previous recording */
+#define TRC_STREAM_PORT_ON_TRACE_BEGIN() trcTcpBegin()
+
 #ifdef __cplusplus
 }
 #endif
@@ -50,38 +50,79 @@
 #if (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING)  
 #if (TRC_USE_TRACEALYZER_RECORDER == 1)
 	
+#include <string.h>
+
+#if (TRC_CFG_STREAM_PORT_TCP_BSD_SOCKETS == 1)
+
+/* TCP/IP includes - the BSD/POSIX socket API of the host */
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define closesocket(s) close(s)
+
+#ifdef MSG_NOSIGNAL
+/* A closed connection gives EPIPE instead of killing the process */
+#define TRC_TCP_SEND_FLAGS MSG_NOSIGNAL
+#endif
+
+#else
+
 /* TCP/IP includes - for lwIP in this case */
 #include "lwip/tcpip.h"
 #include "lwip/sockets.h"
 #include "lwip/errno.h"
 
-#define TRC_TCPIP_PORT 12000
+#endif /* (TRC_CFG_STREAM_PORT_TCP_BSD_SOCKETS == 1) */
+
+#ifndef TRC_TCP_SEND_FLAGS
+#define TRC_TCP_SEND_FLAGS 0
+#endif
+
+#if ((TRC_CFG_STREAM_PORT_TCP_STAGING_SIZE) & ((TRC_CFG_STREAM_PORT_TCP_STAGING_SIZE) - 1)) != 0
+#error "TRC_CFG_STREAM_PORT_TCP_STAGING_SIZE must be a power of two"
+#endif
 
 int sock = -1, new_sd = -1;
 int flags = 0;
 int remoteSize;
 struct sockaddr_in address, remote;
 
+/* Errors that only mean that the TCP stack can't take (or give) any data
+right now. ENOMEM is given by lwIP when it is out of buffers. */
+#define TRC_TCP_IS_TRANSIENT(err) \
+	(((err) == EWOULDBLOCK) || ((err) == EAGAIN) || ((err) == EINTR) || \
+	((err) == ENOBUFS) || ((err) == ENOMEM))
+
 int32_t trcSocketSend( void* data, int32_t size, int32_t* bytesWritten )
 {
+  int result;
+
   if (new_sd < 0)
     return -1;
   
   if (bytesWritten == NULL)
 	return -1;
   
-  *bytesWritten = send( new_sd, data, size, 0 );
-  if (*bytesWritten < 0)
+  *bytesWritten = 0;
+
+  result = send( new_sd, data, size, TRC_TCP_SEND_FLAGS );
+  if (result < 0)
   {
-    /* EWOULDBLOCK may be expected when buffers are full */
-    if ((errno != 0) && (errno != EWOULDBLOCK))
+    /* Full buffers are expected, since the socket is non-blocking */
+    if (! TRC_TCP_IS_TRANSIENT(errno))
 	{
 		closesocket(new_sd);
 		new_sd = -1;
 		return -1;
 	}
-    else
-        *bytesWritten = 0;
+  }
+  else
+  {
+    *bytesWritten = result;
   }
   
   return 0;
@@ -89,13 +130,21 @@ int32_t trcSocketSend( void* data, int32_t size, int32_t* bytesWritten )
 
 int32_t trcSocketReceive( void* data, int32_t size, int32_t* bytesRead )
 {
+  int result;
+
   if (new_sd < 0)
     return -1;
 
-  *bytesRead = recv( new_sd, data, size, 0 );
-  /* EWOULDBLOCK may be expected when there is no data to receive */
-  if (errno != 0 && errno != EWOULDBLOCK)
+  *bytesRead = 0;
+
+  result = recv( new_sd, data, size, 0 );
+  if (result > 0)
+  {
+    *bytesRead = result;
+  }
+  else if ((result == 0) || (! TRC_TCP_IS_TRANSIENT(errno)))
   {
+    /* Closed by the host, or a failed connection */
     closesocket(new_sd);
     new_sd = -1;
     return -1;
@@ -109,11 +158,18 @@ int32_t trcSocketInitializeListener()
   if (sock >= 0)
 	return 0;
   
-  sock = lwip_socket(AF_INET, SOCK_STREAM, 0);
+  sock = socket(AF_INET, SOCK_STREAM, 0);
   
   if (sock < 0)
     return -1;
 
+#if (TRC_CFG_STREAM_PORT_TCP_BSD_SOCKETS == 1)
+  /* Allows the port to be reused directly when restarting the application */
+  flags = 1;
+  setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &flags, sizeof(flags));
+#endif /* (TRC_CFG_STREAM_PORT_TCP_BSD_SOCKETS == 1) */
+
+  memset(&address, 0, sizeof(address));
   address.sin_family = AF_INET;
   address.sin_port = htons( TRC_TCPIP_PORT );
   address.sin_addr.s_addr = INADDR_ANY;
@@ -125,7 +181,7 @@ int32_t trcSocketInitializeListener()
     return -1;
   }
 
-  if (lwip_listen(sock, 5) < 0)
+  if (listen(sock, 5) < 0)
   {
     closesocket(sock);
     sock = -1;
@@ -135,7 +191,9 @@ int32_t trcSocketInitializeListener()
   return 0;
 }
 
-int32_t trcSocketAccept()
+/* Accepts a connection from the host. Blocks until the host connects, unless
+blocking is 0, in which case it returns 1 if no host is waiting. */
+int32_t trcSocketAccept(int blocking)
 {
   if (sock < 0)
       return -1;
@@ -143,13 +201,19 @@ int32_t trcSocketAccept()
   if (new_sd >= 0)
       return 0;
   
+  flags = fcntl( sock, F_GETFL, 0 );
+  fcntl( sock, F_SETFL, blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK) );
+
   remoteSize = sizeof( remote );
   new_sd = accept( sock, (struct sockaddr *)&remote, (socklen_t*)&remoteSize );
 
   if( new_sd < 0 )
   {
-   	closesocket(new_sd);
     new_sd = -1;
+
+    if ((! blocking) && TRC_TCP_IS_TRANSIENT(errno))
+      return 1;
+
    	closesocket(sock);
     sock = -1;
     return -1;
@@ -162,19 +226,153 @@ int32_t trcSocketAccept()
 }
 /************** MODIFY THE ABOVE PART TO USE YOUR TPC/IP STACK ****************/
 
+/* The staging ring. The head and tail are the number of bytes written to and
+sent from the ring since the recording was started, so the staged data is
+(head - tail) bytes, starting at (tail & (TRC_CFG_STREAM_PORT_TCP_STAGING_SIZE - 1)).
+Only accessed from the TzCtrl task (and from vTraceEnable, before it runs). */
+static uint8_t trcTcpStagingRing[TRC_CFG_STREAM_PORT_TCP_STAGING_SIZE];
+static uint32_t trcTcpStagingHead = 0;
+static uint32_t trcTcpStagingTail = 0;
+static int32_t trcTcpStagingFull = 0;
+
+#define TRC_TCP_STAGED() (trcTcpStagingHead - trcTcpStagingTail)
+
+/* Sends the staged data, as much as the TCP stack accepts without blocking.
+The data stays in the ring until a host has connected. */
+static int32_t prvTcpFlush(void)
+{
+	uint32_t offset;
+	uint32_t length;
+	int32_t bytesSent;
+
+	while ((TRC_TCP_STAGED() > 0) && (new_sd >= 0))
+	{
+		offset = trcTcpStagingTail & ((TRC_CFG_STREAM_PORT_TCP_STAGING_SIZE) - 1);
+		length = TRC_TCP_STAGED();
+
+		/* Up to the end of the ring, and at most one send window */
+		if (length > (TRC_CFG_STREAM_PORT_TCP_STAGING_SIZE) - offset)
+		{
+			length = (TRC_CFG_STREAM_PORT_TCP_STAGING_SIZE) - offset;
+		}
+		if (length > (TRC_CFG_STREAM_PORT_TCP_SEND_SIZE))
+		{
+			length = (TRC_CFG_STREAM_PORT_TCP_SEND_SIZE);
+		}
+
+		if (trcSocketSend(&trcTcpStagingRing[offset], (int32_t)length, &bytesSent) != 0)
+		{
+			return -1;
+		}
+
+		if (bytesSent == 0)
+		{
+			break; /* The send window is full */
+		}
+
+		trcTcpStagingTail += (uint32_t)bytesSent;
+	}
+
+	/* Hysteresis, so that the recorder doesn't switch between sampling and
+	storing all events on every transfer */
+	if (TRC_TCP_STAGED() >= ((TRC_CFG_STREAM_PORT_TCP_STAGING_SIZE) / 4) * 3)
+	{
+		trcTcpStagingFull = 1;
+	}
+	else if (TRC_TCP_STAGED() <= (TRC_CFG_STREAM_PORT_TCP_STAGING_SIZE) / 4)
+	{
+		trcTcpStagingFull = 0;
+	}
+
+	return 0;
+}
+
 int32_t trcTcpWrite(void* data, uint32_t size, int32_t *ptrBytesWritten)
 {
-    return trcSocketSend(data, size, ptrBytesWritten);
+	uint32_t offset;
+	uint32_t length;
+	uint32_t first;
+
+	*ptrBytesWritten = 0;
+
+	/* Make room first, so that the data is sent in the order written */
+	if (prvTcpFlush() != 0)
+	{
+		return -1;
+	}
+
+	length = (TRC_CFG_STREAM_PORT_TCP_STAGING_SIZE) - TRC_TCP_STAGED();
+	if (length > size)
+	{
+		length = size;
+	}
+
+	offset = trcTcpStagingHead & ((TRC_CFG_STREAM_PORT_TCP_STAGING_SIZE) - 1);
+	first = (TRC_CFG_STREAM_PORT_TCP_STAGING_SIZE) - offset;
+	if (first > length)
+	{
+		first = length;
+	}
+
+	memcpy(&trcTcpStagingRing[offset], data, first);
+	memcpy(&trcTcpStagingRing[0], (uint8_t*)data + first, length - first);
+	trcTcpStagingHead += length;
+
+	*ptrBytesWritten = (int32_t)length;
+
+	if (prvTcpFlush() != 0)
+	{
+		return -1;
+	}
+
+	if (length < size)
+	{
+		/* The ring is full, the recorder keeps the rest */
+		trcTcpStagingFull = 1;
+	}
+
+	return 0;
 }
 
 int32_t trcTcpRead(void* data, uint32_t size, int32_t *ptrBytesRead)
 {
+	int32_t status;
+
+	*ptrBytesRead = 0;
+
     trcSocketInitializeListener();
-        
-    trcSocketAccept();
-      
+
+	/* While recording, the data is staged until the host connects, so the
+	TzCtrl task must not block here */
+    status = trcSocketAccept(xTraceIsRecordingEnabled() == 0);
+	if (status == 1)
+	{
+		return 0;
+	}
+	if (status != 0)
+	{
+		return -1;
+	}
+
+	if (prvTcpFlush() != 0)
+	{
+		return -1;
+	}
+
     return trcSocketReceive(data, size, ptrBytesRead);
 }
 
+int32_t trcTcpBackpressure(void)
+{
+	return trcTcpStagingFull;
+}
+
+void trcTcpBegin(void)
+{
+	trcTcpStagingHead = 0;
+	trcTcpStagingTail = 0;
+	trcTcpStagingFull = 0;
+}
+
 #endif /*(TRC_USE_TRACEALYZER_RECORDER == 1)*/
 #endif /*(TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING)*/
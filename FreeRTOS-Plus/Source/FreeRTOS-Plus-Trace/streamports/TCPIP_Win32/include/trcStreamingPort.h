@@ -63,6 +63,9 @@ int32_t writeToSocket(void* data, uint32_t size, int32_t *ptrBytesWritten);
 
 #if (TRC_STREAM_PORT_USE_INTERNAL_BUFFER == 1)    
 	#define TRC_STREAM_PORT_WRITE_DATA(_ptrData, _size, _ptrBytesWritten) writeToSocket(_ptrData, _size, _ptrBytesWritten)
+
+	/* The TzCtrl task may write all buffer pages that are ready in one call */
+	#define TRC_STREAM_PORT_MAX_BURST_SIZE ((TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT) * (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE))
 #else
 	/* In the direct mode, _ptrBytesWritten is not used, so it is assumed that "all or nothing" is written. */
 	#define TRC_STREAM_PORT_WRITE_DATA(_ptrData, _size, UNUSED) writeToSocket(_ptrData, _size, NULL)
@@ -350,81 +350,230 @@ void cortex_a9_r5_exit_critical(int cs_type)
 
 #if defined(TRC_CFG_ENABLE_STACK_MONITOR) && (TRC_CFG_ENABLE_STACK_MONITOR == 1) && (TRC_CFG_SCHEDULING_ONLY == 0)
 
+#if (TRC_CFG_FREERTOS_VERSION >= TRC_FREERTOS_VERSION_9_0_0) && (portSTACK_GROWTH < 0)
+/* The stack is scanned by the recorder, from the stack base (as given by
+vTaskGetInfo) and up, instead of using uxTaskGetStackHighWaterMark. This way
+the scan can stop at the last known low mark and be split over several TzCtrl
+cycles. */
+#define TRC_STACK_MONITOR_INCREMENTAL 1
+
+/* The kernel fills the task stacks with 0xA5 bytes (tskSTACK_FILL_BYTE) */
+#define TRC_STACK_FILL_WORD ((StackType_t)(((StackType_t)~(StackType_t)0 / 0xFFU) * 0xA5U))
+#else /* (TRC_CFG_FREERTOS_VERSION >= TRC_FREERTOS_VERSION_9_0_0) && (portSTACK_GROWTH < 0) */
+#define TRC_STACK_MONITOR_INCREMENTAL 0
+#endif /* (TRC_CFG_FREERTOS_VERSION >= TRC_FREERTOS_VERSION_9_0_0) && (portSTACK_GROWTH < 0) */
+
 typedef struct {
 	void* tcb;
-	uint32_t uiPreviousLowMark;
+	uint32_t uiPreviousLowMark;	/* Unused stack (words) at the last completed scan */
+#if (TRC_STACK_MONITOR_INCREMENTAL == 1)
+	StackType_t* pxStackBase;	/* NULL until the task is scanned the first time */
+	uint32_t uiScanned;			/* Words verified unused in the current scan */
+#endif /* (TRC_STACK_MONITOR_INCREMENTAL == 1) */
 } TaskStackMonitorEntry_t;
 
+/* The monitored tasks are kept in the first stackMonitorCount entries, so a
+task is added by appending it and removed by moving the last entry into its
+place. */
 TaskStackMonitorEntry_t tasksInStackMonitor[TRC_CFG_STACK_MONITOR_MAX_TASKS] = { { NULL } };
 
+static uint32_t stackMonitorCount = 0;
+
 int tasksNotIncluded = 0;
 
+/* Each task remembers its entry index + 1 (0 if unknown), so that it can be
+removed without searching the entries. */
+#if (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING)
+
+/* The low 16 bits of the task number are not used in streaming mode */
+#define TRC_STACK_MONITOR_GET_INDEX(task) prvTraceGetTaskNumberLow16(task)
+#define TRC_STACK_MONITOR_SET_INDEX(task, index) prvTraceSetTaskNumberLow16(task, (uint16_t)(index))
+
+#else /* (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING) */
+
+/* The low 16 bits of the task number hold the task handle in snapshot mode,
+which is unique for the active tasks, so the index is kept per task handle. */
+static uint16_t stackMonitorIndexOfHandle[(TRC_CFG_NTASK) + 1] = { 0 };
+
+#define TRC_STACK_MONITOR_VALID_HANDLE(task) (TRACE_GET_TASK_NUMBER(task) > 0 && TRACE_GET_TASK_NUMBER(task) <= (TRC_CFG_NTASK))
+#define TRC_STACK_MONITOR_GET_INDEX(task) (TRC_STACK_MONITOR_VALID_HANDLE(task) ? stackMonitorIndexOfHandle[TRACE_GET_TASK_NUMBER(task)] : 0)
+#define TRC_STACK_MONITOR_SET_INDEX(task, index) if (TRC_STACK_MONITOR_VALID_HANDLE(task)) { stackMonitorIndexOfHandle[TRACE_GET_TASK_NUMBER(task)] = (uint16_t)(index); }
+
+#endif /* (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING) */
+
 void prvAddTaskToStackMonitor(void* task)
 {
-	int i;
-	int foundEmptySlot = 0;
+	if (stackMonitorCount >= TRC_CFG_STACK_MONITOR_MAX_TASKS)
+	{
+		tasksNotIncluded++;
+		return;
+	}
+
+	tasksInStackMonitor[stackMonitorCount].tcb = task;
+	tasksInStackMonitor[stackMonitorCount].uiPreviousLowMark = 0xFFFFFFFF;
+#if (TRC_STACK_MONITOR_INCREMENTAL == 1)
+	tasksInStackMonitor[stackMonitorCount].pxStackBase = NULL;
+	tasksInStackMonitor[stackMonitorCount].uiScanned = 0;
+#endif /* (TRC_STACK_MONITOR_INCREMENTAL == 1) */
+
+	stackMonitorCount++;
+	TRC_STACK_MONITOR_SET_INDEX(task, stackMonitorCount);
+}
 
-	// find an empty slot
-	for (i = 0; i < TRC_CFG_STACK_MONITOR_MAX_TASKS; i++)
+void prvRemoveTaskFromStackMonitor(void* task)
+{
+	uint32_t i = TRC_STACK_MONITOR_GET_INDEX(task);
+
+	if (i > 0 && i <= stackMonitorCount && tasksInStackMonitor[i - 1].tcb == task)
+	{
+		i--;
+	}
+	else
 	{
-		if (tasksInStackMonitor[i].tcb == NULL)
+		/* No valid index, e.g. the task got no handle in snapshot mode */
+		for (i = 0; i < stackMonitorCount; i++)
 		{
-			tasksInStackMonitor[i].tcb = task;
-			tasksInStackMonitor[i].uiPreviousLowMark = 0xFFFFFFFF;
-			foundEmptySlot = 1;
-			break;
+			if (tasksInStackMonitor[i].tcb == task)
+			{
+				break;
+			}
+		}
+
+		if (i == stackMonitorCount)
+		{
+			/* Not monitored */
+			return;
 		}
 	}
 
-	if (foundEmptySlot == 0)
+	TRC_STACK_MONITOR_SET_INDEX(task, 0);
+
+	stackMonitorCount--;
+	if (i != stackMonitorCount)
 	{
-		tasksNotIncluded++;
+		tasksInStackMonitor[i] = tasksInStackMonitor[stackMonitorCount];
+		TRC_STACK_MONITOR_SET_INDEX(tasksInStackMonitor[i].tcb, i + 1);
 	}
+
+	tasksInStackMonitor[stackMonitorCount].tcb = NULL;
+	tasksInStackMonitor[stackMonitorCount].uiPreviousLowMark = 0;
 }
 
-void prvRemoveTaskFromStackMonitor(void* task)
+#if (TRC_STACK_MONITOR_INCREMENTAL == 1)
+/*******************************************************************************
+ * prvScanStack
+ *
+ * Continues the scan of a task stack, from the stack base and up, for at most
+ * *pBudget words. The scan is complete when it finds a word that has been
+ * written, or when it reaches the previous low mark, since the stack above that
+ * was found used in an earlier scan. Returns 1 and updates uiPreviousLowMark
+ * when the scan is complete, otherwise 0 (continued in the next call).
+ ******************************************************************************/
+static int prvScanStack(TaskStackMonitorEntry_t* entry, uint32_t* pBudget)
 {
-	int i;
-	
-	for (i = 0; i < TRC_CFG_STACK_MONITOR_MAX_TASKS; i++)
+	uint32_t pos = entry->uiScanned;
+	uint32_t end = entry->uiPreviousLowMark;
+
+	if ((end - pos) > *pBudget)
 	{
-		if (tasksInStackMonitor[i].tcb == task)
-		{
-			tasksInStackMonitor[i].tcb = NULL;
-			tasksInStackMonitor[i].uiPreviousLowMark = 0;
-		}
+		end = pos + *pBudget;
 	}
+
+	while (pos < end && entry->pxStackBase[pos] == TRC_STACK_FILL_WORD)
+	{
+		pos++;
+	}
+
+	*pBudget -= pos - entry->uiScanned;
+
+	if (pos == entry->uiPreviousLowMark || (pos < end))
+	{
+		/* Reached the previous low mark, or found the first used word */
+		entry->uiPreviousLowMark = pos;
+		entry->uiScanned = 0;
+		return 1;
+	}
+
+	entry->uiScanned = pos;
+	return 0;
 }
+#endif /* (TRC_STACK_MONITOR_INCREMENTAL == 1) */
 
 void prvReportStackUsage()
 {
-	static int i = 0;	/* Static index used to loop over the monitored tasks */
-	int count = 0;		/* The number of generated reports */
-	int initial = i;	/* Used to make sure we break if we are back at the inital value */
-	
-	do
+	static uint32_t i = 0;	/* Static index used to loop over the monitored tasks */
+	uint32_t count = 0;		/* The number of generated reports */
+	uint32_t visited = 0;	/* Used to make sure each task is reported at most once */
+	TaskStackMonitorEntry_t entry;
+#if (TRC_STACK_MONITOR_INCREMENTAL == 1)
+	uint32_t budget = TRC_CFG_STACK_MONITOR_SCAN_WORDS;
+	TaskStatus_t status;
+#endif /* (TRC_STACK_MONITOR_INCREMENTAL == 1) */
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	while (count < TRC_CFG_STACK_MONITOR_MAX_REPORTS && visited < stackMonitorCount)
 	{
-		/* Check the current spot */
-		if (tasksInStackMonitor[i].tcb != NULL)
+		/* Entries may be moved by prvRemoveTaskFromStackMonitor, so work on a copy */
+		TRACE_ENTER_CRITICAL_SECTION();
+		if (i >= stackMonitorCount)
+		{
+			i = 0;
+		}
+		entry = tasksInStackMonitor[i];
+		TRACE_EXIT_CRITICAL_SECTION();
+
+		if (entry.tcb == NULL)
+		{
+			/* All tasks were removed */
+			break;
+		}
+
+#if (TRC_STACK_MONITOR_INCREMENTAL == 1)
+		if (entry.pxStackBase == NULL)
+		{
+			vTaskGetInfo((TaskType)entry.tcb, &status, pdFALSE, eReady);
+			entry.pxStackBase = status.pxStackBase;
+		}
+
+		if (prvScanStack(&entry, &budget) == 0)
+		{
+			/* Out of budget, continue with this task in the next cycle */
+			TRACE_ENTER_CRITICAL_SECTION();
+			if (i < stackMonitorCount && tasksInStackMonitor[i].tcb == entry.tcb)
+			{
+				tasksInStackMonitor[i] = entry;
+			}
+			TRACE_EXIT_CRITICAL_SECTION();
+			break;
+		}
+#else /* (TRC_STACK_MONITOR_INCREMENTAL == 1) */
 		{
 			/* Get the amount of unused stack */
-			uint32_t unusedStackSpace = uxTaskGetStackHighWaterMark((TaskType)tasksInStackMonitor[i].tcb);
+			uint32_t unusedStackSpace = uxTaskGetStackHighWaterMark((TaskType)entry.tcb);
+
+			if (entry.uiPreviousLowMark > unusedStackSpace)
+				entry.uiPreviousLowMark = unusedStackSpace;
+		}
+#endif /* (TRC_STACK_MONITOR_INCREMENTAL == 1) */
 
-			/* Store for later use */
-			if (tasksInStackMonitor[i].uiPreviousLowMark > unusedStackSpace)
-				tasksInStackMonitor[i].uiPreviousLowMark = unusedStackSpace;
+		/* Store for later use, unless the task was removed meanwhile */
+		TRACE_ENTER_CRITICAL_SECTION();
+		if (i < stackMonitorCount && tasksInStackMonitor[i].tcb == entry.tcb)
+		{
+			tasksInStackMonitor[i] = entry;
+		}
+		TRACE_EXIT_CRITICAL_SECTION();
 
 #if TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_SNAPSHOT
-			prvTraceStoreKernelCallWithParam(TRACE_UNUSED_STACK, TRACE_CLASS_TASK, TRACE_GET_TASK_NUMBER(tasksInStackMonitor[i].tcb), tasksInStackMonitor[i].uiPreviousLowMark);
+		prvTraceStoreKernelCallWithParam(TRACE_UNUSED_STACK, TRACE_CLASS_TASK, TRACE_GET_TASK_NUMBER(entry.tcb), entry.uiPreviousLowMark);
 #else /* TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_SNAPSHOT */
-			prvTraceStoreEvent2(PSF_EVENT_UNUSED_STACK, (uint32_t)tasksInStackMonitor[i].tcb, tasksInStackMonitor[i].uiPreviousLowMark);
+		prvTraceStoreEvent2(PSF_EVENT_UNUSED_STACK, (uint32_t)entry.tcb, entry.uiPreviousLowMark);
 #endif /* TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_SNAPSHOT */
 
-			count++;
-		}
-
-		i = (i + 1) % TRC_CFG_STACK_MONITOR_MAX_TASKS; // Move i beyond this task
-	} while (count < TRC_CFG_STACK_MONITOR_MAX_REPORTS && i != initial);
+		count++;
+		visited++;
+		i++; /* Move i beyond this task */
+	}
 }
 #endif /* defined(TRC_CFG_ENABLE_STACK_MONITOR) && (TRC_CFG_ENABLE_STACK_MONITOR == 1) && (TRC_CFG_SCHEDULING_ONLY == 0) */
 
@@ -437,6 +586,7 @@ extern volatile uint32_t NoRoomForSymbol;
 extern volatile uint32_t NoRoomForObjectData;
 extern volatile uint32_t LongestSymbolName;
 extern volatile uint32_t MaxBytesTruncated;
+extern volatile uint32_t SampledOutEventCounter;
 
 /* User Event Channel for giving warnings regarding NoRoomForSymbol etc. */
 traceString trcWarningChannel;
@@ -491,6 +641,11 @@ void vTraceEnable(int startOption)
 		{
 			prvTraceError(PSF_ERROR_TZCTRLTASK_NOT_CREATED);
 		}
+
+#if (TRC_SAMPLING_MODE == 1)
+		/* Samples are ignored by vTraceSample until the recorder is started */
+		TRC_PORT_SAMPLING_TIMER_INIT(TRC_CFG_SAMPLING_RATE_HZ);
+#endif /* (TRC_SAMPLING_MODE == 1) */
 	}
 
 	if (startOption == TRC_START_AWAIT_HOST)
@@ -706,6 +861,12 @@ static void prvCheckRecorderStatus(void)
 		prvTraceWarning(PSF_WARNING_STRING_TOO_LONG);
 		MaxBytesTruncated = 0;
 	}
+
+	if (SampledOutEventCounter > 0)
+	{
+		/* Given once per recording, the counter is kept for inspection */
+		prvTraceWarning(PSF_WARNING_STREAM_PORT_BACKPRESSURE);
+	}
 }
 
 /*******************************************************************************
@@ -760,6 +921,9 @@ static portTASK_FUNCTION( TzCtrl, pvParameters )
 		{
 			prvCheckRecorderStatus();
 			prvReportStackUsage();
+#if (TRC_SAMPLING_MODE == 1)
+			prvTraceReportSamples();
+#endif /* (TRC_SAMPLING_MODE == 1) */
 		}
 
 		vTaskDelay(TRC_CFG_CTRL_TASK_DELAY);
@@ -108,10 +108,25 @@ extern int8_t nISRactive;
 
 extern traceHandle handle_of_last_logged_task;
 
+#if (TRC_CFG_SYMBOL_TABLE_HASH_BITS < 6) || (TRC_CFG_SYMBOL_TABLE_HASH_BITS > 12)
+#error "TRC_CFG_SYMBOL_TABLE_HASH_BITS must be between 6 and 12"
+#endif
+
+#define SYMBOL_TABLE_HASH_MASK ((1u << (TRC_CFG_SYMBOL_TABLE_HASH_BITS)) - 1)
+
+#if (TRC_CFG_SYMBOL_TABLE_HASH_BITS > 6)
+/* The heads of the symbol table lookup lists, one per hash value. Kept outside
+RecorderDataType, as its layout is fixed (latestEntryOfChecksum is unused). */
+static uint16_t symbolTableListHeads[1 << (TRC_CFG_SYMBOL_TABLE_HASH_BITS)];
+#define SYMBOL_TABLE_LIST_HEAD(_crc) symbolTableListHeads[_crc]
+#else
+#define SYMBOL_TABLE_LIST_HEAD(_crc) RecorderDataPtr->SymbolTable.latestEntryOfChecksum[_crc]
+#endif
+
 /*************** Private Functions *******************************************/
 static void prvStrncpy(char* dst, const char* src, uint32_t maxLength);
 static uint8_t prvTraceGetObjectState(uint8_t objectclass, traceHandle id); 
-static void prvTraceGetChecksum(const char *pname, uint8_t* pcrc, uint8_t* plength); 
+static void prvTraceGetChecksum(const char *pname, uint16_t* pcrc, uint8_t* plength); 
 static void* prvTraceNextFreeEventBufferSlot(void); 
 static uint16_t prvTraceGetDTS(uint16_t param_maxDTS);
 static traceString prvTraceOpenSymbol(const char* name, traceString userEventChannel);
@@ -124,12 +139,12 @@ static void prvCheckDataToBeOverwrittenForMultiEntryEvents(uint8_t nEntries);
 #endif
 
 static traceString prvTraceCreateSymbolTableEntry(const char* name,
-										 uint8_t crc6,
+										 uint16_t crc,
 										 uint8_t len,
 										 traceString channel);
 
 static traceString prvTraceLookupSymbolTableEntry(const char* name,
-										 uint8_t crc6,
+										 uint16_t crc,
 										 uint8_t len,
 										 traceString channel);
 
@@ -171,6 +186,9 @@ void prvTracePortGetTimeStamp(uint32_t *puiTimestamp);
 static void prvTraceTaskInstanceFinish(int8_t direct);
 
 #if ((TRC_CFG_SCHEDULING_ONLY == 0) && (TRC_CFG_INCLUDE_USER_EVENTS == 1))
+#if (TRC_CFG_USE_SEPARATE_USER_EVENT_BUFFER == 0)
+static void prvTraceStoreUserEventData(uint32_t* data, uint32_t noOfSlots);
+#endif /* (TRC_CFG_USE_SEPARATE_USER_EVENT_BUFFER == 0) */
 #if (TRC_CFG_USE_SEPARATE_USER_EVENT_BUFFER == 1)
 static void vTraceUBData_Helper(traceUBChannel channelPair, va_list vl);
 static void prvTraceUBHelper1(traceUBChannel channel, traceString eventLabel, traceString formatLabel, va_list vl);
@@ -1007,6 +1025,90 @@ static uint8_t prvTraceUserEventFormat(const char* formatStr, va_list vl, uint8_
 }
 #endif
 
+/*******************************************************************************
+ * prvTraceStoreUserEventData
+ *
+ * Copies a user event, prepared in a local buffer by the caller, to the main
+ * event buffer. The first entry (the UserEvent) must have the payload set and
+ * type EVENT_BEING_WRITTEN. Must be called within a critical section, while
+ * the recorder is active.
+ ******************************************************************************/
+#if ((TRC_CFG_SCHEDULING_ONLY == 0) && (TRC_CFG_INCLUDE_USER_EVENTS == 1) && (TRC_CFG_USE_SEPARATE_USER_EVENT_BUFFER == 0))
+static void prvTraceStoreUserEventData(uint32_t* data, uint32_t noOfSlots)
+{
+	((UserEvent*)data)->dts = (uint8_t)prvTraceGetDTS(0xFF);
+
+	 /* prvTraceGetDTS might stop the recorder in some cases... */
+	if (RecorderDataPtr->recorderActive)
+	{
+
+		/* If the data does not fit in the remaining main buffer, wrap around to
+		0 if allowed, otherwise stop the recorder and quit). */
+		if (RecorderDataPtr->nextFreeIndex + noOfSlots > RecorderDataPtr->maxEvents)
+		{
+			#if (TRC_CFG_SNAPSHOT_MODE == TRC_SNAPSHOT_MODE_RING_BUFFER)
+			(void)memset(& RecorderDataPtr->eventData[RecorderDataPtr->nextFreeIndex * 4],
+					0,
+					(RecorderDataPtr->maxEvents - RecorderDataPtr->nextFreeIndex)*4);
+			RecorderDataPtr->nextFreeIndex = 0;
+			RecorderDataPtr->bufferIsFull = 1;
+			#else
+
+			/* Stop recorder, since the event data will not fit in the
+			buffer and not circular buffer in this case... */
+			vTraceStop();
+			#endif
+		}
+
+		/* Check if recorder has been stopped (i.e., vTraceStop above) */
+		if (RecorderDataPtr->recorderActive)
+		{
+			/* Check that the buffer to be overwritten does not contain any user
+			events that would be partially overwritten. If so, they must be "killed"
+			by replacing the user event and following data with NULL events (i.e.,
+			using a memset to zero).*/
+			#if (TRC_CFG_SNAPSHOT_MODE == TRC_SNAPSHOT_MODE_RING_BUFFER)
+			prvCheckDataToBeOverwrittenForMultiEntryEvents((uint8_t)noOfSlots);
+			#endif
+			/* Copy the local buffer to the main buffer */
+			(void)memcpy(& RecorderDataPtr->eventData[RecorderDataPtr->nextFreeIndex * 4],
+					data,
+					noOfSlots * 4);
+
+			/* Update the event type, i.e., number of data entries following the
+			main USER_EVENT entry (Note: important that this is after the memcpy,
+			but within the critical section!)*/
+			RecorderDataPtr->eventData[RecorderDataPtr->nextFreeIndex * 4] =
+			 (uint8_t) ( USER_EVENT + noOfSlots - 1 );
+
+			/* Update the main buffer event index (already checked that it fits in
+			the buffer, so no need to check for wrapping)*/
+
+			RecorderDataPtr->nextFreeIndex += noOfSlots;
+			RecorderDataPtr->numEvents += noOfSlots;
+
+			if (RecorderDataPtr->nextFreeIndex >= (TRC_CFG_EVENT_BUFFER_SIZE))
+			{
+				#if (TRC_CFG_SNAPSHOT_MODE == TRC_SNAPSHOT_MODE_RING_BUFFER)
+				/* We have reached the end, but this is a ring buffer. Start from the beginning again. */
+				RecorderDataPtr->bufferIsFull = 1;
+				RecorderDataPtr->nextFreeIndex = 0;
+				#else
+				/* We have reached the end so we stop. */
+				vTraceStop();
+				#endif
+			}
+		}
+
+		#if (TRC_CFG_SNAPSHOT_MODE == TRC_SNAPSHOT_MODE_RING_BUFFER)
+		/* Make sure the next entry is cleared correctly */
+		prvCheckDataToBeOverwrittenForMultiEntryEvents(1);
+		#endif
+
+	}
+}
+#endif
+
 /*******************************************************************************
  * prvTraceClearChannelBuffer
  *
@@ -1332,91 +1434,171 @@ void vTraceVPrintF(traceString eventLabel, const char* formatStr, va_list vl)
 		/* Store the format string, with a reference to the channel symbol */
 		ue1->payload = prvTraceOpenSymbol(formatStr, eventLabel);
 
-		ue1->dts = (uint8_t)prvTraceGetDTS(0xFF);
-
-		 /* prvTraceGetDTS might stop the recorder in some cases... */
-		if (RecorderDataPtr->recorderActive)
-		{
-
-			/* If the data does not fit in the remaining main buffer, wrap around to
-			0 if allowed, otherwise stop the recorder and quit). */
-			if (RecorderDataPtr->nextFreeIndex + noOfSlots > RecorderDataPtr->maxEvents)
-			{
-				#if (TRC_CFG_SNAPSHOT_MODE == TRC_SNAPSHOT_MODE_RING_BUFFER)
-				(void)memset(& RecorderDataPtr->eventData[RecorderDataPtr->nextFreeIndex * 4],
-						0,
-						(RecorderDataPtr->maxEvents - RecorderDataPtr->nextFreeIndex)*4);
-				RecorderDataPtr->nextFreeIndex = 0;
-				RecorderDataPtr->bufferIsFull = 1;
-				#else
+		prvTraceStoreUserEventData(tempDataBuffer, noOfSlots);
+	}
+	trcCRITICAL_SECTION_END();
 
-				/* Stop recorder, since the event data will not fit in the
-				buffer and not circular buffer in this case... */
-				vTraceStop();
-				#endif
-			}
+#elif (TRC_CFG_USE_SEPARATE_USER_EVENT_BUFFER == 1)
+	/* Use the separate user event buffer */
+	traceString formatLabel;
+	traceUBChannel channel;
 
-			/* Check if recorder has been stopped (i.e., vTraceStop above) */
-			if (RecorderDataPtr->recorderActive)
-			{
-				/* Check that the buffer to be overwritten does not contain any user
-				events that would be partially overwritten. If so, they must be "killed"
-				by replacing the user event and following data with NULL events (i.e.,
-				using a memset to zero).*/
-				#if (TRC_CFG_SNAPSHOT_MODE == TRC_SNAPSHOT_MODE_RING_BUFFER)
-				prvCheckDataToBeOverwrittenForMultiEntryEvents((uint8_t)noOfSlots);
-				#endif
-				/* Copy the local buffer to the main buffer */
-				(void)memcpy(& RecorderDataPtr->eventData[RecorderDataPtr->nextFreeIndex * 4],
-						tempDataBuffer,
-						noOfSlots * 4);
+	if (RecorderDataPtr->recorderActive && handle_of_last_logged_task)
+	{
+		formatLabel = xTraceRegisterString(formatStr);
 
-				/* Update the event type, i.e., number of data entries following the
-				main USER_EVENT entry (Note: important that this is after the memcpy,
-				but within the critical section!)*/
-				RecorderDataPtr->eventData[RecorderDataPtr->nextFreeIndex * 4] =
-				 (uint8_t) ( USER_EVENT + noOfSlots - 1 );
+		channel = xTraceRegisterUBChannel(eventLabel, formatLabel);
 
-				/* Update the main buffer event index (already checked that it fits in
-				the buffer, so no need to check for wrapping)*/
+		prvTraceUBHelper1(channel, eventLabel, formatLabel, vl);
+	}
+#endif
+}
+#endif
 
-				RecorderDataPtr->nextFreeIndex += noOfSlots;
-				RecorderDataPtr->numEvents += noOfSlots;
+/*******************************************************************************
+ * prvTraceGetFormatWordCount
+ *
+ * Returns the number of arguments in a format string for vTracePrintFormat, or
+ * 0xFF if the format string has arguments other than 32-bit integers. Uses the
+ * same rules as prvTraceUserEventFormat.
+ ******************************************************************************/
+#if ((TRC_CFG_SCHEDULING_ONLY == 0) && (TRC_CFG_INCLUDE_USER_EVENTS == 1))
+static uint8_t prvTraceGetFormatWordCount(const char* formatStr)
+{
+	uint16_t formatStrIndex = 0;
+	uint8_t argCounter = 0;
 
-				if (RecorderDataPtr->nextFreeIndex >= (TRC_CFG_EVENT_BUFFER_SIZE))
-				{
-					#if (TRC_CFG_SNAPSHOT_MODE == TRC_SNAPSHOT_MODE_RING_BUFFER)
-					/* We have reached the end, but this is a ring buffer. Start from the beginning again. */
-					RecorderDataPtr->bufferIsFull = 1;
-					RecorderDataPtr->nextFreeIndex = 0;
-					#else
-					/* We have reached the end so we stop. */
-					vTraceStop();
-					#endif
-				}
+	while (formatStr[formatStrIndex] != '\0')
+	{
+		if (formatStr[formatStrIndex] == '%')
+		{
+			if (formatStr[formatStrIndex + 1] == '%')
+			{
+				formatStrIndex += 2;
+				continue;
 			}
 
-			#if (TRC_CFG_SNAPSHOT_MODE == TRC_SNAPSHOT_MODE_RING_BUFFER)
-			/* Make sure the next entry is cleared correctly */
-			prvCheckDataToBeOverwrittenForMultiEntryEvents(1);
-			#endif
+			formatStrIndex++;
 
+			while ((formatStr[formatStrIndex] >= '0' && formatStr[formatStrIndex] <= '9') || formatStr[formatStrIndex] == '#' || formatStr[formatStrIndex] == '.')
+				formatStrIndex++;
+
+			switch (formatStr[formatStrIndex])
+			{
+				case '\0':
+					return argCounter;
+				case 'd':
+				case 'x':
+				case 'X':
+				case 'u':
+					argCounter++;
+					break;
+				case 's':
+				case 'f':
+				case 'l':
+				case 'h':
+				case 'b':
+					/* Not stored as a plain 32-bit word */
+					return 0xFF;
+				default:
+					/* Not a valid format specifier, ignored also by the host */
+					break;
+			}
 		}
+		formatStrIndex++;
 	}
-	trcCRITICAL_SECTION_END();
+	return argCounter;
+}
+#endif
 
-#elif (TRC_CFG_USE_SEPARATE_USER_EVENT_BUFFER == 1)
-	/* Use the separate user event buffer */
+/******************************************************************************
+ * xTraceRegisterFormat
+ *
+ * Registers a format string for vTracePrintFormat, in the same way as
+ * vTracePrintF does on every call: the format string is stored in the symbol
+ * table, referring to the channel, and parsed to get the number of arguments.
+ * Only 32-bit integer arguments (%d, %u, %x, %X) are allowed, with at most
+ * eight arguments, since these are stored as-is. Returns 0 on errors.
+ ******************************************************************************/
+#if ((TRC_CFG_SCHEDULING_ONLY == 0) && (TRC_CFG_INCLUDE_USER_EVENTS == 1))
+traceFormat xTraceRegisterFormat(traceString chn, const char* formatStr)
+{
+	uint8_t noOfArgs;
 	traceString formatLabel;
-	traceUBChannel channel;
+	traceUBChannel channel = 0;
 
-	if (RecorderDataPtr->recorderActive && handle_of_last_logged_task)
+	TRACE_ASSERT(formatStr != NULL, "xTraceRegisterFormat: formatStr == NULL", (traceFormat)0);
+	TRACE_ASSERT(RecorderDataPtr != NULL, "Recorder not initialized, call vTraceEnable() first!", (traceFormat)0);
+
+	noOfArgs = prvTraceGetFormatWordCount(formatStr);
+	if (noOfArgs > (MAX_ARG_SIZE - 4) / 4)
 	{
-		formatLabel = xTraceRegisterString(formatStr);
+		prvTraceError("xTraceRegisterFormat - Only up to 8 32-bit integer arguments allowed!");
+		return 0;
+	}
 
-		channel = xTraceRegisterUBChannel(eventLabel, formatLabel);
+#if (TRC_CFG_USE_SEPARATE_USER_EVENT_BUFFER == 0)
+	formatLabel = prvTraceOpenSymbol(formatStr, chn);
+#else
+	formatLabel = prvTraceOpenSymbol(formatStr, 0);
+	channel = xTraceRegisterUBChannel(chn, formatLabel);
+	if (channel == 0)
+	{
+		prvTraceError("xTraceRegisterFormat - No free channel, increase TRC_CFG_UB_CHANNELS!");
+		return 0;
+	}
+#endif
 
-		prvTraceUBHelper1(channel, eventLabel, formatLabel, vl);
+	return TRACE_FORMAT_CREATE(channel, noOfArgs, formatLabel);
+}
+#endif
+
+/******************************************************************************
+ * vTracePrintFormat
+ *
+ * Stores a user event with a format registered by xTraceRegisterFormat. The
+ * arguments are copied as 32-bit words, without parsing the format string or
+ * looking up any symbols, so this is considerably faster than vTracePrintF.
+ * The resulting event is identical to the one from vTracePrintF, so the
+ * formatting is done on the host when the trace is displayed.
+ ******************************************************************************/
+#if ((TRC_CFG_SCHEDULING_ONLY == 0) && (TRC_CFG_INCLUDE_USER_EVENTS == 1))
+void vTracePrintFormat(traceFormat fmt, ...)
+{
+	va_list vl;
+	uint32_t i;
+	uint32_t noOfSlots = TRACE_FORMAT_NARGS(fmt) + 1;
+	uint32_t tempDataBuffer[(3 + MAX_ARG_SIZE) / 4];
+#if (TRC_CFG_USE_SEPARATE_USER_EVENT_BUFFER == 0)
+	TRACE_ALLOC_CRITICAL_SECTION();
+#endif
+
+	if (fmt == 0)
+	{
+		/* Not registered, or registration failed */
+		return;
+	}
+
+	va_start(vl, fmt);
+	for (i = 1; i < noOfSlots; i++)
+	{
+		tempDataBuffer[i] = va_arg(vl, uint32_t);
+	}
+	va_end(vl);
+
+#if (TRC_CFG_USE_SEPARATE_USER_EVENT_BUFFER == 0)
+	trcCRITICAL_SECTION_BEGIN();
+	if (RecorderDataPtr->recorderActive && handle_of_last_logged_task)
+	{
+		((UserEvent*)tempDataBuffer)->type = EVENT_BEING_WRITTEN;
+		((UserEvent*)tempDataBuffer)->payload = TRACE_FORMAT_LABEL(fmt);
+		prvTraceStoreUserEventData(tempDataBuffer, noOfSlots);
+	}
+	trcCRITICAL_SECTION_END();
+#else
+	if (RecorderDataPtr->recorderActive && handle_of_last_logged_task)
+	{
+		prvTraceUBHelper2(TRACE_FORMAT_CHANNEL(fmt), tempDataBuffer, noOfSlots);
 	}
 #endif
 }
@@ -2142,6 +2324,9 @@ void prvTraceInitTraceData()
 	init_hwtc_count = TRC_HWTC_COUNT;
 		
 	(void)memset(RecorderDataPtr, 0, sizeof(RecorderDataType));
+#if (TRC_CFG_SYMBOL_TABLE_HASH_BITS > 6)
+	(void)memset(symbolTableListHeads, 0, sizeof(symbolTableListHeads));
+#endif
 	
 	RecorderDataPtr->version = TRACE_KERNEL_VERSION;
 	RecorderDataPtr->minor_version = TRACE_MINOR_VERSION;
@@ -2418,7 +2603,7 @@ traceString prvTraceOpenSymbol(const char* name, traceString userEventChannel)
 {
 	uint16_t result;
 	uint8_t len;
-	uint8_t crc;
+	uint16_t crc;
 	TRACE_ALLOC_CRITICAL_SECTION();
 	
 	len = 0;
@@ -2720,11 +2905,11 @@ uint16_t prvTraceGetDTS(uint16_t param_maxDTS)
  * zero-termination
  ******************************************************************************/
 traceString prvTraceLookupSymbolTableEntry(const char* name,
-										 uint8_t crc6,
+										 uint16_t crc,
 										 uint8_t len,
 										 traceString chn)
 {
-	uint16_t i = RecorderDataPtr->SymbolTable.latestEntryOfChecksum[ crc6 ];
+	uint16_t i = SYMBOL_TABLE_LIST_HEAD(crc);
 
 	TRACE_ASSERT(name != NULL, "prvTraceLookupSymbolTableEntry: name == NULL", (traceString)0);
 	TRACE_ASSERT(len != 0, "prvTraceLookupSymbolTableEntry: len == 0", (traceString)0);
@@ -2763,7 +2948,7 @@ traceString prvTraceLookupSymbolTableEntry(const char* name,
  * zero-termination
  ******************************************************************************/
 uint16_t prvTraceCreateSymbolTableEntry(const char* name,
-										uint8_t crc6,
+										uint16_t crc,
 										uint8_t len,
 										traceString channel)
 {
@@ -2782,11 +2967,11 @@ uint16_t prvTraceCreateSymbolTableEntry(const char* name,
 
 		RecorderDataPtr->SymbolTable.symbytes
 			[ RecorderDataPtr->SymbolTable.nextFreeSymbolIndex] =
-			(uint8_t)(RecorderDataPtr->SymbolTable.latestEntryOfChecksum[ crc6 ] & 0x00FF);
+			(uint8_t)(SYMBOL_TABLE_LIST_HEAD(crc) & 0x00FF);
 
 		RecorderDataPtr->SymbolTable.symbytes
 			[ RecorderDataPtr->SymbolTable.nextFreeSymbolIndex + 1] =
-			(uint8_t)(RecorderDataPtr->SymbolTable.latestEntryOfChecksum[ crc6 ] / 0x100);
+			(uint8_t)(SYMBOL_TABLE_LIST_HEAD(crc) / 0x100);
 
 		RecorderDataPtr->SymbolTable.symbytes
 			[ RecorderDataPtr->SymbolTable.nextFreeSymbolIndex + 2] =
@@ -2804,9 +2989,8 @@ uint16_t prvTraceCreateSymbolTableEntry(const char* name,
 		RecorderDataPtr->SymbolTable.symbytes
 			[RecorderDataPtr->SymbolTable.nextFreeSymbolIndex + 4 + len] = '\0';
 
-		/* store index of entry (for return value, and as head of LL[crc6]) */
-		RecorderDataPtr->SymbolTable.latestEntryOfChecksum
-			[ crc6 ] = (uint16_t)RecorderDataPtr->SymbolTable.nextFreeSymbolIndex;
+		/* store index of entry (for return value, and as head of LL[crc]) */
+		SYMBOL_TABLE_LIST_HEAD(crc) = (uint16_t)RecorderDataPtr->SymbolTable.nextFreeSymbolIndex;
 
 		RecorderDataPtr->SymbolTable.nextFreeSymbolIndex += (uint32_t) (len + 5);
 
@@ -2820,14 +3004,16 @@ uint16_t prvTraceCreateSymbolTableEntry(const char* name,
 /*******************************************************************************
  * prvTraceGetChecksum
  *
- * Calculates a simple 6-bit checksum from a string, used to index the string
- * for fast symbol table lookup.
+ * Calculates a TRC_CFG_SYMBOL_TABLE_HASH_BITS wide hash from a string, used to
+ * index the string for fast symbol table lookup. This is 32-bit FNV-1a, folded
+ * to the desired width, so that similar names (e.g. "Task1" and "Task2") and
+ * anagrams end up in different lists.
  ******************************************************************************/
-void prvTraceGetChecksum(const char *pname, uint8_t* pcrc, uint8_t* plength)
+void prvTraceGetChecksum(const char *pname, uint16_t* pcrc, uint8_t* plength)
 {
 	unsigned char c;
 	int length = 1;		/* Should be 1 to account for '\0' */
-	int crc = 0;
+	uint32_t hash = 2166136261u; /* FNV offset basis */
 
 	TRACE_ASSERT(pname != NULL, "prvTraceGetChecksum: pname == NULL", TRC_UNUSED);
 	TRACE_ASSERT(pcrc != NULL, "prvTraceGetChecksum: pcrc == NULL", TRC_UNUSED);
@@ -2837,11 +3023,11 @@ void prvTraceGetChecksum(const char *pname, uint8_t* pcrc, uint8_t* plength)
 	{
 		for (; (c = (unsigned char) *pname++) != '\0';)
 		{
-			crc += c;
+			hash = (hash ^ c) * 16777619u; /* FNV prime */
 			length++;
 		}
 	}
-	*pcrc = (uint8_t)(crc & 0x3F);
+	*pcrc = (uint16_t)((hash ^ (hash >> (TRC_CFG_SYMBOL_TABLE_HASH_BITS)) ^ (hash >> (2 * (TRC_CFG_SYMBOL_TABLE_HASH_BITS)))) & SYMBOL_TABLE_HASH_MASK);
 	*plength = (uint8_t)length;
 }
 
@@ -132,6 +132,48 @@ typedef struct{
 #error "TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT cannot be larger than 128"
 #endif /* (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT > 128) */
 
+#if ((TRC_CFG_SYMBOL_TABLE_SLOTS) > 0xFFFE) || ((TRC_CFG_OBJECT_DATA_SLOTS) > 0xFFFE)
+#error "TRC_CFG_SYMBOL_TABLE_SLOTS and TRC_CFG_OBJECT_DATA_SLOTS cannot be larger than 65534"
+#endif
+
+#if (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1)
+#if (TRC_STREAM_PORT_USE_INTERNAL_BUFFER == 0)
+#error "TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE requires a stream port using the internal buffer"
+#endif /* (TRC_STREAM_PORT_USE_INTERNAL_BUFFER == 0) */
+
+#ifndef TRC_PORT_ATOMIC_CAS32
+#error "TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE requires TRC_PORT_ATOMIC_CAS32 (see trcHardwarePort.h)"
+#endif /* TRC_PORT_ATOMIC_CAS32 */
+
+#if (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE > 0x7FFF)
+#error "TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE cannot be larger than 32767 with TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE"
+#endif /* (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE > 0x7FFF) */
+
+#if (TRC_CFG_COMPACT_EVENT_FORMAT == 1)
+#error "TRC_CFG_COMPACT_EVENT_FORMAT can't be combined with TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE, as the deltas require the events to be stored in order"
+#endif /* (TRC_CFG_COMPACT_EVENT_FORMAT == 1) */
+
+#if (TRC_CFG_PAGED_EVENT_BUFFER_ALLOW_UNORDERED != 1)
+#error "With TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE, events from preempted writers are stored out of EventCount or timestamp order, and host tools will see them out of order. Set TRC_CFG_PAGED_EVENT_BUFFER_ALLOW_UNORDERED to 1 to accept this."
+#endif /* (TRC_CFG_PAGED_EVENT_BUFFER_ALLOW_UNORDERED != 1) */
+#endif /* (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1) */
+
+#if (TRC_CFG_COMPACT_EVENT_FORMAT == 1)
+#if (TRC_CFG_COMPACT_SYNC_INTERVAL < 1)
+#error "TRC_CFG_COMPACT_SYNC_INTERVAL must be at least 1"
+#endif /* (TRC_CFG_COMPACT_SYNC_INTERVAL < 1) */
+#endif /* (TRC_CFG_COMPACT_EVENT_FORMAT == 1) */
+
+#if (TRC_SAMPLING_MODE == 1)
+#if ((TRC_CFG_SAMPLING_HISTOGRAM_SLOTS) < 1) || ((TRC_CFG_SAMPLING_REPORT_INTERVAL) < 1)
+#error "TRC_CFG_SAMPLING_HISTOGRAM_SLOTS and TRC_CFG_SAMPLING_REPORT_INTERVAL must be at least 1"
+#endif /* ((TRC_CFG_SAMPLING_HISTOGRAM_SLOTS) < 1) || ((TRC_CFG_SAMPLING_REPORT_INTERVAL) < 1) */
+
+#if ((TRC_CFG_SAMPLING_PC_SHIFT) > 16)
+#error "TRC_CFG_SAMPLING_PC_SHIFT cannot be larger than 16"
+#endif /* ((TRC_CFG_SAMPLING_PC_SHIFT) > 16) */
+#endif /* (TRC_SAMPLING_MODE == 1) */
+
 /* The Symbol Table type - just a byte array */
 typedef struct{
   union
@@ -150,21 +192,113 @@ typedef struct{
   } ObjectDataTableBuffer;
 } ObjectDataTable;
 
+#if (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1)
+typedef struct{
+	volatile uint32_t Status;    /* 32 bit, as updated by TRC_PORT_ATOMIC_CAS32 */
+	volatile uint32_t Reserved;  /* Generation, sealed flag and reserved bytes, see PAGE_RESERVED_* */
+	volatile uint32_t Committed; /* Bytes written in full, reaches the page size when sealed and done */
+} PageType;
+#else
 typedef struct{
 	uint16_t Status;  /* 16 bit to avoid implicit padding (warnings) */
 	uint16_t BytesRemaining;
 	char* WritePointer;
 } PageType;
+#endif /* (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1) */
+
+/* Hash index for the symbol and object data tables. The entries never move,
+as the slot address is used as handle for strings (see prvTraceSaveSymbol).
+Slot and bucket numbers are stored plus one, so that zero means none and the
+zero-initialized index is valid (empty). Deleted slots are kept in a free list,
+and slots never used are taken from highWater. */
+typedef struct{
+	uint32_t* table;     /* The table, where the first word of each slot is the key (address) */
+	uint16_t* bucket;    /* The first slot in each hash bucket */
+	uint16_t* next;      /* The next slot in the same hash bucket, or in the free list */
+	uint16_t slotWords;  /* Slot size, in 32-bit words */
+	uint16_t slotCount;  /* Number of slots, also the number of hash buckets */
+	uint16_t freeList;   /* The first deleted slot, available for reuse */
+	uint16_t highWater;  /* Number of slots used at some point */
+} HashedSlotIndex;
+
+#define SLOT_NONE 0xFFFFFFFF
 
 /* Code used for "task address" when no task has started, to indicate "(startup)".
  * This value was used since NULL/0 was already reserved for the idle task. */
 #define HANDLE_NO_TASK 2
 
+/* The number of histogram slots vTraceSample tries, before counting a sample
+as lost */
+#define SAMPLE_SLOT_PROBES 8
+
 /* The status codes for the pages of the internal trace buffer. */
 #define PAGE_STATUS_FREE 0
 #define PAGE_STATUS_WRITE 1
 #define PAGE_STATUS_READ 2
 
+#if (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1)
+/* The current write page is kept as a single word, holding the page index in
+the low 8 bits and a generation count above. The generation is increased on
+every page switch and also stored in the page's Reserved word, so a writer
+that was preempted while reading a stale write page will not reserve space in
+it after it has been recycled. */
+#define WRITE_PAGE_NONE 0xFFu
+#define WRITE_PAGE_INDEX(_w) ((_w) & 0xFFu)
+#define WRITE_PAGE_GENERATION(_w) (((_w) >> 8) & 0xFFFFu)
+#define WRITE_PAGE(_generation, _index) (((((uint32_t)(_generation)) & 0xFFFFu) << 8) | (_index))
+
+/* The Reserved word of a page - generation, sealed flag and byte offset */
+#define PAGE_RESERVED_GENERATION(_r) (((_r) >> 16) & 0xFFFFu)
+#define PAGE_RESERVED_SEALED 0x8000u
+#define PAGE_RESERVED_OFFSET(_r) ((_r) & 0x7FFFu)
+#define PAGE_RESERVED(_generation) ((((uint32_t)(_generation)) & 0xFFFFu) << 16)
+
+/* The event functions don't need a critical section, as the buffer is lock-free.
+The event counter is then the only shared state and is incremented atomically.
+The event count is taken before the space is reserved and the timestamp after,
+so if a writer is preempted in between, the EventCount or the timestamp of the
+stored events is not increasing (see TRC_CFG_PAGED_EVENT_BUFFER_ALLOW_UNORDERED). */
+#define PSF_ALLOC_EVENT_SECTION()
+#define PSF_ENTER_EVENT_SECTION()
+#define PSF_EXIT_EVENT_SECTION()
+#define PSF_NEXT_EVENT_COUNT() prvAtomicAdd32(&eventCounter, 1)
+#else
+#define PSF_ALLOC_EVENT_SECTION() TRACE_ALLOC_CRITICAL_SECTION()
+#define PSF_ENTER_EVENT_SECTION() TRACE_ENTER_CRITICAL_SECTION()
+#define PSF_EXIT_EVENT_SECTION() TRACE_EXIT_CRITICAL_SECTION()
+#define PSF_NEXT_EVENT_COUNT() (++eventCounter)
+#endif /* (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1) */
+
+#if (TRC_CFG_COMPACT_EVENT_FORMAT == 1)
+/* Set in the header version field, so that the trace is not mistaken for
+regular PSF data. psf_compact_decode.py restores the regular format. */
+#define PSF_COMPACT_FORMAT_FLAG 0x8000
+
+/* The header of a compact record is a varint with these fields:
+bit 0: the EventCount gap field is present (else the count increased by one)
+bit 1: the parameters are raw 32-bit words (else zigzag/delta varints)
+bit 2-5: number of parameters
+bit 6-17: event code
+A header of 0 (PSF_EVENT_NULL_EVENT, no flags) is a sync record. */
+#define COMPACT_FLAG_GAP 0x01
+#define COMPACT_FLAG_RAW 0x02
+#define COMPACT_HEADER(_code, _nParam, _flags) ((((uint32_t)(_code)) << 6) | (((uint32_t)(_nParam)) << 2) | (_flags))
+#define COMPACT_SYNC_HEADER 0
+
+/* Params 0-2 use their own predictor, the remaining share the last one */
+#define COMPACT_PREDICTORS 4
+
+/* The event functions build the regular event on the stack, which is then
+encoded by prvTraceStoreCompactEvent into the stream port. */
+#define PSF_ALLOCATE_EVENT(_type, _ptrData, _size) _type _ptrData##Storage; _type* _ptrData = &_ptrData##Storage;
+#define PSF_ALLOCATE_DYNAMIC_EVENT(_type, _ptrData, _size) PSF_ALLOCATE_EVENT(_type, _ptrData, _size)
+#define PSF_COMMIT_EVENT(_ptrData, _size) prvTraceStoreCompactEvent((BaseEvent*)(_ptrData), (uint32_t)(_size))
+#else
+#define PSF_ALLOCATE_EVENT(_type, _ptrData, _size) TRC_STREAM_PORT_ALLOCATE_EVENT(_type, _ptrData, _size)
+#define PSF_ALLOCATE_DYNAMIC_EVENT(_type, _ptrData, _size) TRC_STREAM_PORT_ALLOCATE_DYNAMIC_EVENT(_type, _ptrData, _size)
+#define PSF_COMMIT_EVENT(_ptrData, _size) TRC_STREAM_PORT_COMMIT_EVENT(_ptrData, _size)
+#endif /* (TRC_CFG_COMPACT_EVENT_FORMAT == 1) */
+
 /* Calls prvTraceError if the _assert condition is false. For void functions,
 where no return value is to be provided. */
 #define PSF_ASSERT_VOID(_assert, _err) if (! (_assert)){ prvTraceError(_err); return; }
@@ -186,14 +320,32 @@ static uint32_t ErrorAndWarningFlags = 0;
 /* The Symbol Table instance - keeps names of tasks and other named objects. */
 static SymbolTable symbolTable = { { { 0 } } };
 
-/* This points to the first unused entry in the symbol table. */
-static uint32_t firstFreeSymbolTableIndex = 0;
+/* Hash index for the symbol table, to find and reuse slots in constant time */
+static uint16_t symbolTableBucket[TRC_CFG_SYMBOL_TABLE_SLOTS];
+static uint16_t symbolTableNext[TRC_CFG_SYMBOL_TABLE_SLOTS];
+static HashedSlotIndex symbolTableIndex = {
+	symbolTable.SymbolTableBuffer.pSymbolTableBufferUINT32,
+	symbolTableBucket,
+	symbolTableNext,
+	SYMBOL_TABLE_SLOT_SIZE / sizeof(uint32_t),
+	(TRC_CFG_SYMBOL_TABLE_SLOTS),
+	0,
+	0 };
 
 /* The Object Data Table instance - keeps initial priorities of tasks. */
 static ObjectDataTable objectDataTable = { { { 0 } } };
 
-/* This points to the first unused entry in the object data table. */
-static uint32_t firstFreeObjectDataTableIndex = 0;
+/* Hash index for the object data table */
+static uint16_t objectDataTableBucket[TRC_CFG_OBJECT_DATA_SLOTS];
+static uint16_t objectDataTableNext[TRC_CFG_OBJECT_DATA_SLOTS];
+static HashedSlotIndex objectDataTableIndex = {
+	objectDataTable.ObjectDataTableBuffer.pObjectDataTableBufferUINT32,
+	objectDataTableBucket,
+	objectDataTableNext,
+	OBJECT_DATA_SLOT_SIZE / sizeof(uint32_t),
+	(TRC_CFG_OBJECT_DATA_SLOTS),
+	0,
+	0 };
 
 /* Keeps track of ISR nesting */
 static uint32_t ISR_stack[TRC_CFG_MAX_ISR_NESTING];
@@ -216,8 +368,22 @@ static uint32_t PSFEndianessIdentifier = 0x50534600;
 /* Used to interpret the data format */
 static uint16_t FormatVersion = 0x0006;
 
+#if (TRC_CFG_COMPACT_EVENT_FORMAT == 1)
+/* The state of the compact encoder, i.e. the last record written */
+static uint32_t compactLastTS = 0;
+static uint16_t compactLastCount = 0;
+static uint32_t compactLastParam[COMPACT_PREDICTORS];
+
+/* Number of records until the next sync record (0 => sync before next) */
+static uint32_t compactSyncCountdown = 0;
+#endif /* (TRC_CFG_COMPACT_EVENT_FORMAT == 1) */
+
 /* The number of events stored. Used as event sequence number. */
+#if (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1)
+static volatile uint32_t eventCounter = 0;
+#else
 static uint32_t eventCounter = 0;
+#endif /* (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1) */
 
 /* Remembers if an earlier ISR in a sequence of adjacent ISRs has triggered a task switch.
 In that case, vTraceStoreISREnd does not store a return to the previously executing task. */
@@ -226,11 +392,95 @@ int32_t isPendingContextSwitch = 0;
 uint32_t uiTraceTickCount = 0;
 uint32_t timestampFrequency = 0;
 uint32_t DroppedEventCounter = 0;
-uint32_t TotalBytesRemaining_LowWaterMark = (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT) * (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE);
 uint32_t TotalBytesRemaining = (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT) * (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE);
 
+/*******************************************************************************
+ * TotalBytesRemaining_LowWaterMark
+ *
+ * The lowest number of free bytes in the internal buffer since the recording
+ * was started, i.e. the headroom left when the TzCtrl task was furthest behind.
+ * If this gets close to zero, events are likely dropped (DroppedEventCounter).
+ * In that case, increase the buffer size, lower TRC_CFG_CTRL_TASK_DELAY or
+ * use a stream port with a larger TRC_STREAM_PORT_MAX_BURST_SIZE.
+ ******************************************************************************/
+uint32_t TotalBytesRemaining_LowWaterMark = (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT) * (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE);
+
+/*******************************************************************************
+ * TransferCount, LargestTransfer
+ *
+ * The number of transfers made by prvPagedEventBufferTransfer since the
+ * recording was started, and the largest number of bytes in one transfer.
+ * Each transfer is one or more calls to TRC_STREAM_PORT_WRITE_DATA, depending
+ * on how much the stream port accepts in each call.
+ ******************************************************************************/
+uint32_t TransferCount = 0;
+uint32_t LargestTransfer = 0;
+
+/*******************************************************************************
+ * SampledOutEventCounter
+ *
+ * The number of kernel service call events that were not stored since the
+ * recording was started, since the stream port reported backpressure (see
+ * TRC_STREAM_PORT_BACKPRESSURE and TRC_CFG_BACKPRESSURE_SAMPLING). Unlike
+ * dropped events, these don't leave gaps in the event count.
+ ******************************************************************************/
+volatile uint32_t SampledOutEventCounter = 0;
+
 PageType PageInfo[TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT];
 
+/* The buffer page last handed to prvPagedEventBufferTransfer */
+static int8_t lastReadPage = -1;
+
+/* A transfer left unfinished by prvPagedEventBufferTransfer on backpressure,
+continued on the next call. transferFirstPage is -1 if there is none. */
+static int8_t transferFirstPage = -1;
+static int transferPageCount = 0;
+static int transferPagesCompleted = 0;
+static int32_t transferBytes = 0;
+static int32_t transferBytesDone = 0;
+
+#if (TRC_CFG_BACKPRESSURE_SAMPLING > 1)
+/* Set while the stream port reports backpressure, see prvPagedEventBufferTransfer */
+static volatile uint8_t backpressureActive = 0;
+
+/* Counts the kernel service calls while sampling, one of every
+TRC_CFG_BACKPRESSURE_SAMPLING is stored */
+static volatile uint32_t backpressureSampleCount = 0;
+#endif /* (TRC_CFG_BACKPRESSURE_SAMPLING > 1) */
+
+#if (TRC_SAMPLING_MODE == 1)
+/* A slot in the histogram of samples: the number of samples of a task or ISR
+at a program counter, rounded down as set by TRC_CFG_SAMPLING_PC_SHIFT */
+typedef struct
+{
+	uint32_t context;
+	uint32_t pc;
+	uint32_t count;
+} SampleSlot;
+
+static SampleSlot sampleHistogram[TRC_CFG_SAMPLING_HISTOGRAM_SLOTS];
+
+/* The histogram slots in use, the samples since the last report, and those of
+them that found no free slot */
+static uint32_t sampleSlotsUsed = 0;
+static uint32_t samplesSinceReport = 0;
+static uint32_t samplesLost = 0;
+
+#if (TRC_CFG_SAMPLING_KERNEL_EVENT_INTERVAL > 0)
+/* Counts the kernel events, one of every TRC_CFG_SAMPLING_KERNEL_EVENT_INTERVAL
+is stored */
+static volatile uint32_t kernelEventSampleCount = 0;
+#endif /* (TRC_CFG_SAMPLING_KERNEL_EVENT_INTERVAL > 0) */
+#endif /* (TRC_SAMPLING_MODE == 1) */
+
+#if (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1)
+/* The page currently written to, as WRITE_PAGE(generation, index) */
+static volatile uint32_t currentWritePage = WRITE_PAGE(0, WRITE_PAGE_NONE);
+
+/* The last page written to before running out of pages, where to continue */
+static volatile uint32_t lastWritePage = (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT) - 1;
+#endif /* (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1) */
+
 char* EventBuffer = NULL;
 
 PSFExtensionInfoType PSFExtensionInfo = TRC_EXTENSION_INFO;
@@ -322,19 +572,53 @@ static void prvTraceStoreExtensionInfo(void);
 /* Internal function for starting/stopping the recorder. */
 static void prvSetRecorderEnabled(uint32_t isEnabled);
 
+#if (TRC_SAMPLING_MODE == 1)
+/* Store the Sampling Config event */
+static void prvTraceStoreSamplingConfig(void);
+
+/* Clears the histogram of samples */
+static void prvTraceResetSamples(void);
+#endif /* (TRC_SAMPLING_MODE == 1) */
+
 /* Mark the page read as complete. */
 static void prvPageReadComplete(int pageIndex);
 
 /* Retrieve a buffer page to write to. */
 static int prvAllocateBufferPage(int prevPage);
 
+#if (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1)
+/* Atomically adds a value and returns the result. */
+static uint32_t prvAtomicAdd32(volatile uint32_t* ptr, uint32_t value);
+
+/* Switches from the given write page to a new one, if no other writer has. */
+static int prvSwitchWritePage(uint32_t writePage);
+
+/* Adds to the committed bytes of a page, handing it over when complete. */
+static void prvPageCommitBytes(uint32_t pageIndex, uint32_t bytes);
+
+/* Lowers TotalBytesRemaining and updates the low water mark. */
+static void prvConsumeBytesRemaining(uint32_t bytes);
+#endif /* (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1) */
+
 /* Get the current buffer page index (return value) and the number 
 of valid bytes in the buffer page (bytesUsed). */
 static int prvGetBufferPage(int32_t* bytesUsed);
 
+/* Get the number of valid bytes in a buffer page that is ready to be read. */
+static int32_t prvGetPageBytesUsed(int pageIndex);
+
+/* Append the following buffer pages that are ready to a transfer (bytesToTransfer),
+returns the number of pages in the transfer. */
+static int prvGatherBufferPages(int firstPage, int32_t* bytesToTransfer);
+
 /* Performs timestamping using definitions in trcHardwarePort.h */
 static uint32_t prvGetTimestamp32(void);
 
+#if (TRC_CFG_COMPACT_EVENT_FORMAT == 1)
+/* Encodes a regular event as a compact record and stores it */
+static void prvTraceStoreCompactEvent(const BaseEvent* event, uint32_t size);
+#endif /* (TRC_CFG_COMPACT_EVENT_FORMAT == 1) */
+
 /* Returns the string associated with the error code */
 static const char* prvTraceGetError(int errCode);
 
@@ -736,6 +1020,84 @@ void vTraceStoreISREnd(int isTaskSwitchRequired)
 	TRACE_EXIT_CRITICAL_SECTION();
 }
 
+#if (TRC_SAMPLING_MODE == 1)
+/*******************************************************************************
+ * vTraceSample
+ *
+ * Records a sample of the execution in sampling mode. Called from a periodic
+ * timer interrupt, with the program counter of the interrupted code.
+ *
+ * The sample is counted in the histogram slot of the running ISR (the top of
+ * the ISR stack kept by vTraceStoreISRBegin/vTraceStoreISREnd) or task, and
+ * the program counter. The slot is found by hashing, with a few probes only,
+ * so that the time in the interrupt stays bounded. The histogram is stored in
+ * the trace by prvTraceReportSamples.
+ ******************************************************************************/
+void vTraceSample(uint32_t pc)
+{
+	uint32_t context;
+	uint32_t index;
+	uint32_t probe;
+	SampleSlot* slot;
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	if (! RecorderEnabled)
+	{
+		return;
+	}
+
+	pc &= ~((1UL << (TRC_CFG_SAMPLING_PC_SHIFT)) - 1UL);
+
+	TRACE_ENTER_CRITICAL_SECTION();
+
+	if (ISR_stack_index >= 0)
+	{
+		context = ISR_stack[ISR_stack_index];
+	}
+	else
+	{
+		context = (uint32_t)TRACE_GET_CURRENT_TASK();
+		if (context == 0)
+		{
+			context = HANDLE_NO_TASK;
+		}
+	}
+
+	index = (((pc >> (TRC_CFG_SAMPLING_PC_SHIFT)) * 0x9E3779B1UL) ^ context) % (TRC_CFG_SAMPLING_HISTOGRAM_SLOTS);
+
+	for (probe = 0; probe < SAMPLE_SLOT_PROBES; probe++)
+	{
+		slot = &sampleHistogram[index];
+
+		if (slot->count == 0)
+		{
+			slot->context = context;
+			slot->pc = pc;
+			slot->count = 1;
+			sampleSlotsUsed++;
+			break;
+		}
+
+		if ((slot->context == context) && (slot->pc == pc))
+		{
+			slot->count++;
+			break;
+		}
+
+		index = (index + 1) % (TRC_CFG_SAMPLING_HISTOGRAM_SLOTS);
+	}
+
+	if (probe == SAMPLE_SLOT_PROBES)
+	{
+		samplesLost++;
+	}
+
+	samplesSinceReport++;
+
+	TRACE_EXIT_CRITICAL_SECTION();
+}
+#endif /* (TRC_SAMPLING_MODE == 1) */
+
 /*******************************************************************************
  * xTraceGetLastError
  *
@@ -833,12 +1195,19 @@ static void prvSetRecorderEnabled(uint32_t isEnabled)
 		
      	eventCounter = 0;
         ISR_stack_index = -1;
+#if (TRC_CFG_COMPACT_EVENT_FORMAT == 1)
+		compactSyncCountdown = 0;
+#endif
         prvTraceStoreHeader();
 		prvTraceStoreSymbolTable();
     	prvTraceStoreObjectDataTable();
     	prvTraceStoreExtensionInfo();
         prvTraceStoreStartEvent();
         prvTraceStoreTSConfig();
+#if (TRC_SAMPLING_MODE == 1)
+		prvTraceStoreSamplingConfig();
+		prvTraceResetSamples();
+#endif /* (TRC_SAMPLING_MODE == 1) */
 	}
     else
     {
@@ -934,6 +1303,100 @@ static void prvTraceStoreTSConfig(void)
 	}
 }
 
+#if (TRC_SAMPLING_MODE == 1)
+/* Store the Sampling Config event. The address of vTraceSample lets the host
+map the sampled program counters to the symbols of a relocated executable. */
+static void prvTraceStoreSamplingConfig(void)
+{
+	eventCounter++;
+
+	{
+		TRC_STREAM_PORT_ALLOCATE_EVENT_BLOCKING(EventWithParam_3, event, sizeof(EventWithParam_3));
+		if (event != NULL)
+		{
+			event->base.EventID = PSF_EVENT_SAMPLING_CONFIG | (uint16_t)PARAM_COUNT(3);
+			event->base.EventCount = (uint16_t)eventCounter;
+			event->base.TS = prvGetTimestamp32();
+
+			event->param1 = (uint32_t)(TRC_CFG_SAMPLING_RATE_HZ);
+			event->param2 = (uint32_t)(TRC_CFG_SAMPLING_PC_SHIFT);
+			event->param3 = (uint32_t)(uintptr_t)vTraceSample;
+			TRC_STREAM_PORT_COMMIT_EVENT_BLOCKING(event, (uint32_t)sizeof(EventWithParam_3));
+		}
+	}
+}
+
+/* Clears the histogram of samples. Called within a critical section. */
+static void prvTraceResetSamples(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < (TRC_CFG_SAMPLING_HISTOGRAM_SLOTS); i++)
+	{
+		sampleHistogram[i].count = 0;
+	}
+
+	sampleSlotsUsed = 0;
+	samplesSinceReport = 0;
+	samplesLost = 0;
+}
+
+/*******************************************************************************
+ * prvTraceReportSamples
+ *
+ * Called by the TzCtrl task. Once TRC_CFG_SAMPLING_REPORT_INTERVAL samples have
+ * been taken, or the histogram is filling up, stores a PSF_EVENT_PC_SAMPLES
+ * event (context, pc, count) for each slot in use and clears it. Samples that
+ * found no free slot are reported with context and pc 0.
+ *
+ * The slots are taken one at a time, so vTraceSample is only blocked briefly.
+ * A slot cleared here may be taken again for the same context and pc before
+ * the report is complete, so the host must add up the counts of each report.
+ ******************************************************************************/
+void prvTraceReportSamples(void)
+{
+	uint32_t i;
+	SampleSlot sample;
+	uint32_t lost;
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	if ((samplesSinceReport < (TRC_CFG_SAMPLING_REPORT_INTERVAL)) &&
+		(sampleSlotsUsed < ((TRC_CFG_SAMPLING_HISTOGRAM_SLOTS) * 3) / 4) &&
+		(samplesLost == 0))
+	{
+		return;
+	}
+
+	for (i = 0; i < (TRC_CFG_SAMPLING_HISTOGRAM_SLOTS); i++)
+	{
+		TRACE_ENTER_CRITICAL_SECTION();
+		sample = sampleHistogram[i];
+		if (sample.count > 0)
+		{
+			sampleHistogram[i].count = 0;
+			sampleSlotsUsed--;
+		}
+		TRACE_EXIT_CRITICAL_SECTION();
+
+		if (sample.count > 0)
+		{
+			prvTraceStoreEvent3(PSF_EVENT_PC_SAMPLES, sample.context, sample.pc, sample.count);
+		}
+	}
+
+	TRACE_ENTER_CRITICAL_SECTION();
+	lost = samplesLost;
+	samplesLost = 0;
+	samplesSinceReport = 0;
+	TRACE_EXIT_CRITICAL_SECTION();
+
+	if (lost > 0)
+	{
+		prvTraceStoreEvent3(PSF_EVENT_PC_SAMPLES, 0, 0, lost);
+	}
+}
+#endif /* (TRC_SAMPLING_MODE == 1) */
+
 /* Stores the symbol table on Start */
 static void prvTraceStoreSymbolTable(void)
 {
@@ -995,6 +1458,9 @@ static void prvTraceStoreHeader(void)
 	  	TRC_STREAM_PORT_ALLOCATE_EVENT_BLOCKING(PSFHeaderInfo, header, sizeof(PSFHeaderInfo));
 		header->psf = PSFEndianessIdentifier;
 		header->version = FormatVersion;
+#if (TRC_CFG_COMPACT_EVENT_FORMAT == 1)
+		header->version |= PSF_COMPACT_FORMAT_FLAG;
+#endif
 		header->platform = TRACE_KERNEL_VERSION;
 		header->options = 0;
 		header->heapCounter = trcHeapCounter;
@@ -1091,6 +1557,14 @@ static const char* prvTraceGetError(int errCode)
 
 		return "TRC_CFG_STACK_MONITOR_MAX_TASKS too small!";
 
+	case PSF_WARNING_STREAM_PORT_BACKPRESSURE:
+		/* The stream port reported backpressure and kernel service calls were
+		sampled as set by TRC_CFG_BACKPRESSURE_SAMPLING. The number of events
+		not stored is counted by SampledOutEventCounter. Use a faster streaming
+		interface or a larger stream port buffer, or reduce the traced events. */
+
+		return "Stream port backpressure, kernel calls sampled.";
+
 	case PSF_WARNING_STREAM_PORT_INITIAL_BLOCKING:
 		/* Blocking occurred during vTraceEnable. This happens if the trace buffer is
 		smaller than the initial transmission (trace header, object table, and symbol table). */
@@ -1140,88 +1614,193 @@ static const char* prvTraceGetError(int errCode)
 	return NULL;
 }
 
+/* The kernel service calls, that are sampled on backpressure. Scheduling,
+ISR, object creation and user events are always stored. */
+#define PSF_IS_SAMPLED_EVENT(eventID) \
+	((((eventID) >= PSF_EVENT_QUEUE_SEND) && ((eventID) < PSF_EVENT_USER_EVENT)) || \
+	(((eventID) >= PSF_EVENT_TIMER_START) && ((eventID) < PSF_EVENT_MALLOC_FAILED)))
+
+#if (TRC_CFG_BACKPRESSURE_SAMPLING > 1) || ((TRC_SAMPLING_MODE == 1) && (TRC_CFG_SAMPLING_KERNEL_EVENT_INTERVAL > 0))
+
+/* Counts an event in *counter and returns 1 for every interval'th event, when
+the counter restarts from 0. The event section excludes other events, except
+with TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE where it is empty, so the counter is
+then updated with TRC_PORT_ATOMIC_CAS32. */
+static int prvTraceSampleCount(volatile uint32_t* counter, uint32_t interval)
+{
+#if (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1)
+	uint32_t oldValue;
+	uint32_t newValue;
+
+	do
+	{
+		oldValue = *counter;
+		newValue = (oldValue + 1 >= interval) ? 0 : oldValue + 1;
+	} while (!TRC_PORT_ATOMIC_CAS32(counter, oldValue, newValue));
+
+	return (newValue == 0);
+#else /* (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1) */
+	(*counter)++;
+	if (*counter >= interval)
+	{
+		*counter = 0;
+		return 1;
+	}
+
+	return 0;
+#endif /* (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1) */
+}
+
+#endif /* (TRC_CFG_BACKPRESSURE_SAMPLING > 1) || ((TRC_SAMPLING_MODE == 1) && (TRC_CFG_SAMPLING_KERNEL_EVENT_INTERVAL > 0)) */
+
+#if (TRC_CFG_BACKPRESSURE_SAMPLING > 1)
+
+/* Returns 1 if the event should not be stored, since the stream port reports
+backpressure. Called from the event functions, see prvTraceSampleCount. */
+static int prvTraceSampledOut(uint16_t eventID)
+{
+	if (! PSF_IS_SAMPLED_EVENT(eventID))
+	{
+		return 0;
+	}
+
+	if (prvTraceSampleCount(&backpressureSampleCount, (TRC_CFG_BACKPRESSURE_SAMPLING)))
+	{
+		return 0;
+	}
+
+#if (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1)
+	(void)prvAtomicAdd32(&SampledOutEventCounter, 1);
+#else /* (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1) */
+	SampledOutEventCounter++;
+#endif /* (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1) */
+	return 1;
+}
+
+#define PSF_BACKPRESSURE_SAMPLED_OUT(eventID) (backpressureActive && prvTraceSampledOut(eventID))
+
+#else /* (TRC_CFG_BACKPRESSURE_SAMPLING > 1) */
+
+#define PSF_BACKPRESSURE_SAMPLED_OUT(eventID) 0
+
+#endif /* (TRC_CFG_BACKPRESSURE_SAMPLING > 1) */
+
+#if (TRC_SAMPLING_MODE == 1)
+
+/* The kernel events, that are replaced by the samples in sampling mode */
+#define PSF_IS_KERNEL_EVENT(eventID) \
+	((((eventID) >= PSF_EVENT_TASK_READY) && ((eventID) <= PSF_EVENT_IFE_DIRECT)) || \
+	PSF_IS_SAMPLED_EVENT(eventID))
+
+/* Returns 1 if the event should not be stored, since it is a kernel event.
+Called from the event functions, see prvTraceSampleCount. */
+static int prvTraceKernelEventSampledOut(uint16_t eventID)
+{
+	if (! PSF_IS_KERNEL_EVENT(eventID))
+	{
+		return 0;
+	}
+
+#if (TRC_CFG_SAMPLING_KERNEL_EVENT_INTERVAL > 0)
+	if (prvTraceSampleCount(&kernelEventSampleCount, (TRC_CFG_SAMPLING_KERNEL_EVENT_INTERVAL)))
+	{
+		return 0;
+	}
+#endif /* (TRC_CFG_SAMPLING_KERNEL_EVENT_INTERVAL > 0) */
+
+	return 1;
+}
+
+#define PSF_SAMPLED_OUT(eventID) (prvTraceKernelEventSampledOut(eventID) || PSF_BACKPRESSURE_SAMPLED_OUT(eventID))
+
+#else /* (TRC_SAMPLING_MODE == 1) */
+
+#define PSF_SAMPLED_OUT(eventID) PSF_BACKPRESSURE_SAMPLED_OUT(eventID)
+
+#endif /* (TRC_SAMPLING_MODE == 1) */
+
 /* Store an event with zero parameters (event ID only) */
 void prvTraceStoreEvent0(uint16_t eventID)
 {
-  	TRACE_ALLOC_CRITICAL_SECTION();
+  	PSF_ALLOC_EVENT_SECTION();
 
 	PSF_ASSERT_VOID(eventID < 4096, PSF_ERROR_EVENT_CODE_TOO_LARGE);
 
-	TRACE_ENTER_CRITICAL_SECTION();
+	PSF_ENTER_EVENT_SECTION();
 
-	if (RecorderEnabled)
+	if (RecorderEnabled && ! PSF_SAMPLED_OUT(eventID))
 	{
-		eventCounter++;
+		uint32_t eventCount = PSF_NEXT_EVENT_COUNT();
 
 		{
-			TRC_STREAM_PORT_ALLOCATE_EVENT(BaseEvent, event, sizeof(BaseEvent));
+			PSF_ALLOCATE_EVENT(BaseEvent, event, sizeof(BaseEvent));
 			if (event != NULL)
 			{
 				event->EventID = eventID | PARAM_COUNT(0);
-				event->EventCount = (uint16_t)eventCounter;
+				event->EventCount = (uint16_t)eventCount;
 				event->TS = prvGetTimestamp32();
-				TRC_STREAM_PORT_COMMIT_EVENT(event, sizeof(BaseEvent));
+				PSF_COMMIT_EVENT(event, sizeof(BaseEvent));
 			}
 		}
 	}
-	TRACE_EXIT_CRITICAL_SECTION();
+	PSF_EXIT_EVENT_SECTION();
 }
 
 /* Store an event with one 32-bit parameter (pointer address or an int) */
 void prvTraceStoreEvent1(uint16_t eventID, uint32_t param1)
 {
-  	TRACE_ALLOC_CRITICAL_SECTION();
+  	PSF_ALLOC_EVENT_SECTION();
 
 	PSF_ASSERT_VOID(eventID < 4096, PSF_ERROR_EVENT_CODE_TOO_LARGE);
 
-	TRACE_ENTER_CRITICAL_SECTION();
+	PSF_ENTER_EVENT_SECTION();
 
-	if (RecorderEnabled)
+	if (RecorderEnabled && ! PSF_SAMPLED_OUT(eventID))
 	{
-		eventCounter++;
+		uint32_t eventCount = PSF_NEXT_EVENT_COUNT();
 		
 		{
-			TRC_STREAM_PORT_ALLOCATE_EVENT(EventWithParam_1, event, sizeof(EventWithParam_1));
+			PSF_ALLOCATE_EVENT(EventWithParam_1, event, sizeof(EventWithParam_1));
 			if (event != NULL)
 			{
 				event->base.EventID = eventID | PARAM_COUNT(1);
-				event->base.EventCount = (uint16_t)eventCounter;
+				event->base.EventCount = (uint16_t)eventCount;
 				event->base.TS = prvGetTimestamp32();
 				event->param1 = (uint32_t)param1;
-				TRC_STREAM_PORT_COMMIT_EVENT(event, sizeof(EventWithParam_1));
+				PSF_COMMIT_EVENT(event, sizeof(EventWithParam_1));
 			}
 		}
 	}
-	TRACE_EXIT_CRITICAL_SECTION();
+	PSF_EXIT_EVENT_SECTION();
 }
 
 /* Store an event with two 32-bit parameters */
 void prvTraceStoreEvent2(uint16_t eventID, uint32_t param1, uint32_t param2)
 {
-  	TRACE_ALLOC_CRITICAL_SECTION();
+  	PSF_ALLOC_EVENT_SECTION();
 
 	PSF_ASSERT_VOID(eventID < 4096, PSF_ERROR_EVENT_CODE_TOO_LARGE);
 
-	TRACE_ENTER_CRITICAL_SECTION();
+	PSF_ENTER_EVENT_SECTION();
 
-	if (RecorderEnabled)
+	if (RecorderEnabled && ! PSF_SAMPLED_OUT(eventID))
 	{
-		eventCounter++;
+		uint32_t eventCount = PSF_NEXT_EVENT_COUNT();
 
 		{
-			TRC_STREAM_PORT_ALLOCATE_EVENT(EventWithParam_2, event, sizeof(EventWithParam_2));
+			PSF_ALLOCATE_EVENT(EventWithParam_2, event, sizeof(EventWithParam_2));
 			if (event != NULL)
 			{
 				event->base.EventID = eventID | PARAM_COUNT(2);
-				event->base.EventCount = (uint16_t)eventCounter;
+				event->base.EventCount = (uint16_t)eventCount;
 				event->base.TS = prvGetTimestamp32();
 				event->param1 = (uint32_t)param1;
 				event->param2 = param2;
-				TRC_STREAM_PORT_COMMIT_EVENT(event, sizeof(EventWithParam_2));
+				PSF_COMMIT_EVENT(event, sizeof(EventWithParam_2));
 			}
 		}
 	}
-	TRACE_EXIT_CRITICAL_SECTION();
+	PSF_EXIT_EVENT_SECTION();
 }
 
 /* Store an event with three 32-bit parameters */
@@ -1230,31 +1809,31 @@ void prvTraceStoreEvent3(	uint16_t eventID,
 						uint32_t param2,
 						uint32_t param3)
 {
-  	TRACE_ALLOC_CRITICAL_SECTION();
+  	PSF_ALLOC_EVENT_SECTION();
 
 	PSF_ASSERT_VOID(eventID < 4096, PSF_ERROR_EVENT_CODE_TOO_LARGE);
 
-	TRACE_ENTER_CRITICAL_SECTION();
+	PSF_ENTER_EVENT_SECTION();
 
-	if (RecorderEnabled)
+	if (RecorderEnabled && ! PSF_SAMPLED_OUT(eventID))
 	{
-  		eventCounter++;
+  		uint32_t eventCount = PSF_NEXT_EVENT_COUNT();
 
 		{
-			TRC_STREAM_PORT_ALLOCATE_EVENT(EventWithParam_3, event, sizeof(EventWithParam_3));
+			PSF_ALLOCATE_EVENT(EventWithParam_3, event, sizeof(EventWithParam_3));
 			if (event != NULL)
 			{
 				event->base.EventID = eventID | PARAM_COUNT(3);
-				event->base.EventCount = (uint16_t)eventCounter;
+				event->base.EventCount = (uint16_t)eventCount;
 				event->base.TS = prvGetTimestamp32();
 				event->param1 = (uint32_t)param1;
 				event->param2 = param2;
 				event->param3 = param3;
-				TRC_STREAM_PORT_COMMIT_EVENT(event, sizeof(EventWithParam_3));
+				PSF_COMMIT_EVENT(event, sizeof(EventWithParam_3));
 			}
 		}
 	}
-	TRACE_EXIT_CRITICAL_SECTION();
+	PSF_EXIT_EVENT_SECTION();
 }
 
 /* Stores an event with <nParam> 32-bit integer parameters */
@@ -1262,24 +1841,24 @@ void prvTraceStoreEvent(int nParam, uint16_t eventID, ...)
 {
 	va_list vl;
 	int i;
-    TRACE_ALLOC_CRITICAL_SECTION();
+    PSF_ALLOC_EVENT_SECTION();
 
 	PSF_ASSERT_VOID(eventID < 4096, PSF_ERROR_EVENT_CODE_TOO_LARGE);
 
-	TRACE_ENTER_CRITICAL_SECTION();
+	PSF_ENTER_EVENT_SECTION();
 
-	if (RecorderEnabled)
+	if (RecorderEnabled && ! PSF_SAMPLED_OUT(eventID))
 	{
 	  	int eventSize = (int)sizeof(BaseEvent) + nParam * (int)sizeof(uint32_t);
 
-		eventCounter++;
+		uint32_t eventCount = PSF_NEXT_EVENT_COUNT();
 
 		{
-			TRC_STREAM_PORT_ALLOCATE_DYNAMIC_EVENT(largestEventType, event, eventSize);
+			PSF_ALLOCATE_DYNAMIC_EVENT(largestEventType, event, eventSize);
 			if (event != NULL)
 			{
 				event->base.EventID = eventID | (uint16_t)PARAM_COUNT(nParam);
-				event->base.EventCount = (uint16_t)eventCounter;
+				event->base.EventCount = (uint16_t)eventCount;
 				event->base.TS = prvGetTimestamp32();
 
 				va_start(vl, eventID);
@@ -1290,11 +1869,11 @@ void prvTraceStoreEvent(int nParam, uint16_t eventID, ...)
 				}
 				va_end(vl);
 
-				TRC_STREAM_PORT_COMMIT_EVENT(event, (uint32_t)eventSize);
+				PSF_COMMIT_EVENT(event, (uint32_t)eventSize);
 			}
 		}
 	}
-	TRACE_EXIT_CRITICAL_SECTION();
+	PSF_EXIT_EVENT_SECTION();
 }
 
 /* Stories an event with a string and <nParam> 32-bit integer parameters */
@@ -1322,7 +1901,7 @@ static void prvTraceStoreStringEventHelper(int nArgs,
 	int nStrWords;
 	int i;
 	int offset = 0;
-  	TRACE_ALLOC_CRITICAL_SECTION();
+  	PSF_ALLOC_EVENT_SECTION();
 	
 	/* The string length in multiples of 32 bit words (+1 for null character) */
 	nStrWords = (len+1+3)/4;
@@ -1350,22 +1929,22 @@ static void prvTraceStoreStringEventHelper(int nArgs,
 		len = 15 * 4 - offset;
 	}
 
-	TRACE_ENTER_CRITICAL_SECTION();
+	PSF_ENTER_EVENT_SECTION();
 
 	if (RecorderEnabled)
 	{
 		int eventSize = (int)sizeof(BaseEvent) + nWords * (int)sizeof(uint32_t);
 
-		eventCounter++;
+		uint32_t eventCount = PSF_NEXT_EVENT_COUNT();
 
 		{
-			TRC_STREAM_PORT_ALLOCATE_DYNAMIC_EVENT(largestEventType, event, eventSize);
+			PSF_ALLOCATE_DYNAMIC_EVENT(largestEventType, event, eventSize);
 			if (event != NULL)
 			{
 				uint32_t* data32;
 				uint8_t* data8;
 				event->base.EventID = (eventID) | (uint16_t)PARAM_COUNT(nWords);
-				event->base.EventCount = (uint16_t)eventCounter;
+				event->base.EventCount = (uint16_t)eventCount;
 				event->base.TS = prvGetTimestamp32();
 
 				/* 32-bit write-pointer for the data argument */
@@ -1392,12 +1971,12 @@ static void prvTraceStoreStringEventHelper(int nArgs,
 
 				if (len < (15 * 4 - offset))
 					data8[offset + len] = 0;	/* Only truncate if we don't fill up the buffer completely */
-				TRC_STREAM_PORT_COMMIT_EVENT(event, (uint32_t)eventSize);
+				PSF_COMMIT_EVENT(event, (uint32_t)eventSize);
 			}
 		}
 	}
 	
-	TRACE_EXIT_CRITICAL_SECTION();
+	PSF_EXIT_EVENT_SECTION();
 }
 
 /* Internal common function for storing string events without additional arguments */
@@ -1411,7 +1990,7 @@ void prvTraceStoreSimpleStringEventHelper(uint16_t eventID,
 	int i;
 	int nArgs = 0;
 	int offset = 0;
-  	TRACE_ALLOC_CRITICAL_SECTION();
+  	PSF_ALLOC_EVENT_SECTION();
 
 	for (len = 0; (str[len] != 0) && (len < 52); len++); /* empty loop */
 	
@@ -1448,22 +2027,22 @@ void prvTraceStoreSimpleStringEventHelper(uint16_t eventID,
 		len = 15 * 4 - offset;
 	}
 
-	TRACE_ENTER_CRITICAL_SECTION();
+	PSF_ENTER_EVENT_SECTION();
 
 	if (RecorderEnabled)
 	{
 		int eventSize = (int)sizeof(BaseEvent) + nWords * (int)sizeof(uint32_t);
 
-		eventCounter++;
+		uint32_t eventCount = PSF_NEXT_EVENT_COUNT();
 
 		{
-			TRC_STREAM_PORT_ALLOCATE_DYNAMIC_EVENT(largestEventType, event, eventSize);
+			PSF_ALLOCATE_DYNAMIC_EVENT(largestEventType, event, eventSize);
 			if (event != NULL)
 			{
 				uint32_t* data32;
 				uint8_t* data8;
 				event->base.EventID = (eventID) | (uint16_t)PARAM_COUNT(nWords);
-				event->base.EventCount = (uint16_t)eventCounter;
+				event->base.EventCount = (uint16_t)eventCount;
 				event->base.TS = prvGetTimestamp32();
 
 				/* 32-bit write-pointer for the data argument */
@@ -1483,158 +2062,402 @@ void prvTraceStoreSimpleStringEventHelper(uint16_t eventID,
 
 				if (len < (15 * 4 - offset))
 					data8[offset + len] = 0;	/* Only truncate if we don't fill up the buffer completely */
-				TRC_STREAM_PORT_COMMIT_EVENT(event, (uint32_t)eventSize);
+				PSF_COMMIT_EVENT(event, (uint32_t)eventSize);
 			}
 		}
 	}
 	
-	TRACE_EXIT_CRITICAL_SECTION();
+	PSF_EXIT_EVENT_SECTION();
 }
 
-/* Saves a symbol name in the symbol table and returns the slot address */
-void* prvTraceSaveSymbol(const char *name)
+#if (TRC_CFG_COMPACT_EVENT_FORMAT == 1)
+
+/* Writes a varint (7 bits per byte, LSB first) if out is not NULL. Returns the
+number of bytes. */
+static uint32_t prvCompactPutVarint(uint8_t* out, uint32_t value)
 {
-	void* retVal = 0;
-	TRACE_ALLOC_CRITICAL_SECTION();
+	uint32_t n = 0;
 
-	TRACE_ENTER_CRITICAL_SECTION();
-	if (firstFreeSymbolTableIndex < SYMBOL_TABLE_BUFFER_SIZE)
+	while (value >= 0x80)
+	{
+		if (out != NULL)
+		{
+			out[n] = (uint8_t)(value | 0x80);
+		}
+		value >>= 7;
+		n++;
+	}
+
+	if (out != NULL)
 	{
-		/* The address to the available symbol table slot is the address we use */
-		retVal = &symbolTable.SymbolTableBuffer.pSymbolTableBufferUINT8[firstFreeSymbolTableIndex];
-		prvTraceSaveObjectSymbol(retVal, name);
+		out[n] = (uint8_t)value;
 	}
-	TRACE_EXIT_CRITICAL_SECTION();
-	
-	return retVal;
+
+	return n + 1;
 }
 
-/* Saves a string in the symbol table for an object (task name etc.) */
-void prvTraceSaveObjectSymbol(void* address, const char *name)
+/* A parameter is encoded as (x << 1) | 1 with x the zigzag encoded difference
+to the predictor, or as (x << 1) with x the value itself, whichever is smaller.
+Handles are often close to the previous one, while counts and ticks are small. */
+static uint32_t prvCompactParamCode(uint32_t value, uint32_t predictor)
+{
+	uint32_t delta = value - predictor;
+	uint32_t zigzag = (delta << 1) ^ (uint32_t)(-(int32_t)(delta >> 31));
+
+	if (value <= zigzag)
+	{
+		return value << 1;
+	}
+
+	return (zigzag << 1) | 1;
+}
+
+/* Encodes the event into out, or only returns the size if out is NULL. */
+static uint32_t prvCompactEncode(uint8_t* out, const BaseEvent* event, uint32_t nParam, int raw)
 {
+	const uint32_t* param = (const uint32_t*)(event + 1);
+	uint16_t gap = (uint16_t)(event->EventCount - compactLastCount - 1);
+	uint32_t flags = (gap != 0 ? COMPACT_FLAG_GAP : 0) | (raw ? COMPACT_FLAG_RAW : 0);
+	uint32_t n;
 	uint32_t i;
-	uint8_t *ptrSymbol;
-	TRACE_ALLOC_CRITICAL_SECTION();
 
-	TRACE_ENTER_CRITICAL_SECTION();
+	n = prvCompactPutVarint(out, COMPACT_HEADER(event->EventID & 0xFFF, nParam, flags));
 
-	/* We do not look for previous entries -> changing a registered string is no longer possible */
-	if (firstFreeSymbolTableIndex < SYMBOL_TABLE_BUFFER_SIZE)
+	if (gap != 0)
 	{
-		/* We access the symbol table via the union member pSymbolTableBufferUINT32 to avoid strict-aliasing issues */
-		symbolTable.SymbolTableBuffer.pSymbolTableBufferUINT32[firstFreeSymbolTableIndex / sizeof(uint32_t)] = (uint32_t)address;
-		
-		/* We access the symbol table via the union member pSymbolTableBufferUINT8 to avoid strict-aliasing issues */
-		ptrSymbol = &symbolTable.SymbolTableBuffer.pSymbolTableBufferUINT8[firstFreeSymbolTableIndex + sizeof(uint32_t)];
-		for (i = 0; i < (TRC_CFG_SYMBOL_MAX_LENGTH); i++)
-		{
-			ptrSymbol[i] = (uint8_t)name[i];	/* We do this first to ensure we also get the 0 termination, if there is one */
+		n += prvCompactPutVarint((out != NULL) ? &out[n] : NULL, gap);
+	}
 
-			if (name[i] == 0)
-			break;
-		}
+	n += prvCompactPutVarint((out != NULL) ? &out[n] : NULL, event->TS - compactLastTS);
 
-		/* Check the length of "name", if longer than SYMBOL_MAX_LENGTH */
-		while ((name[i] != 0) && i < 128)
+	for (i = 0; i < nParam; i++)
+	{
+		if (raw)
 		{
-			i++;
+			if (out != NULL)
+			{
+				memcpy(&out[n], &param[i], sizeof(uint32_t));
+			}
+			n += (uint32_t)sizeof(uint32_t);
 		}
-
-		/* Remember the longest symbol name, for diagnostic purposes */
-		if (i > LongestSymbolName)
+		else
 		{
-			LongestSymbolName = i;
+			uint32_t predictor = compactLastParam[(i < COMPACT_PREDICTORS) ? i : (COMPACT_PREDICTORS - 1)];
+			n += prvCompactPutVarint((out != NULL) ? &out[n] : NULL, prvCompactParamCode(param[i], predictor));
 		}
-
-		firstFreeSymbolTableIndex += SYMBOL_TABLE_SLOT_SIZE;
 	}
-	else
-	{
-		NoRoomForSymbol++;
+
+	return n;
+}
+
+/* Stores a sync record, with the full timestamp and event count that the next
+record is relative to. Also resets the parameter predictors. */
+static int prvTraceStoreCompactSync(uint32_t timestamp, uint16_t eventCount)
+{
+	uint32_t i;
+
+	TRC_STREAM_PORT_ALLOCATE_DYNAMIC_EVENT(uint8_t, record, 7);
+	if (record == NULL)
+	{
+		return 0;
 	}
 
-	TRACE_EXIT_CRITICAL_SECTION();
+	record[0] = COMPACT_SYNC_HEADER;
+	record[1] = (uint8_t)(timestamp);
+	record[2] = (uint8_t)(timestamp >> 8);
+	record[3] = (uint8_t)(timestamp >> 16);
+	record[4] = (uint8_t)(timestamp >> 24);
+	record[5] = (uint8_t)(eventCount);
+	record[6] = (uint8_t)(eventCount >> 8);
+	TRC_STREAM_PORT_COMMIT_EVENT(record, 7);
+
+	compactLastTS = timestamp;
+	compactLastCount = eventCount;
+	for (i = 0; i < COMPACT_PREDICTORS; i++)
+	{
+		compactLastParam[i] = 0;
+	}
+	compactSyncCountdown = (TRC_CFG_COMPACT_SYNC_INTERVAL);
+
+	return 1;
 }
 
-/* Deletes a symbol name (task name etc.) from symbol table */
-void prvTraceDeleteSymbol(void *address)
+/*******************************************************************************
+ * prvTraceStoreCompactEvent
+ *
+ * Encodes a regular event record (as built by the event functions) using the
+ * compact format, see TRC_CFG_COMPACT_EVENT_FORMAT, and stores it using the
+ * stream port. Called within the critical section of the event functions.
+ *
+ * The parameters are stored as raw words if this is smaller (e.g. strings). A
+ * sync record is stored first every TRC_CFG_COMPACT_SYNC_INTERVAL records, or
+ * if the record would otherwise not fit in sizeof(largestEventType).
+ ******************************************************************************/
+static void prvTraceStoreCompactEvent(const BaseEvent* event, uint32_t size)
 {
-	uint32_t i, j;
-	uint32_t *ptr, *lastEntryPtr;
-	TRACE_ALLOC_CRITICAL_SECTION();
+	uint32_t nParam = (size - sizeof(BaseEvent)) / sizeof(uint32_t);
+	uint32_t recordSize;
+	int raw;
+	uint32_t i;
 
-	TRACE_ENTER_CRITICAL_SECTION();
+	if (compactSyncCountdown == 0)
+	{
+		if (prvTraceStoreCompactSync(event->TS, (uint16_t)(event->EventCount - 1)) == 0)
+		{
+			return;
+		}
+	}
+
+	raw = (prvCompactEncode(NULL, event, nParam, 0) > prvCompactEncode(NULL, event, nParam, 1));
+	recordSize = prvCompactEncode(NULL, event, nParam, raw);
+
+	if (recordSize > sizeof(largestEventType))
+	{
+		/* Large gap or timestamp delta. After a sync both take one byte. */
+		if (prvTraceStoreCompactSync(event->TS, (uint16_t)(event->EventCount - 1)) == 0)
+		{
+			return;
+		}
+		recordSize = prvCompactEncode(NULL, event, nParam, raw);
+	}
 
-	for (i = 0; i < firstFreeSymbolTableIndex; i += SYMBOL_TABLE_SLOT_SIZE)
 	{
-		/* We access the symbol table via the union member pSymbolTableBufferUINT32 to avoid strict-aliasing issues */
-		ptr = &symbolTable.SymbolTableBuffer.pSymbolTableBufferUINT32[i / sizeof(uint32_t)];
-		if (*ptr == (uint32_t)address)
+		TRC_STREAM_PORT_ALLOCATE_DYNAMIC_EVENT(uint8_t, record, recordSize);
+		if (record != NULL)
 		{
-			/* See if we have another entry in the table, and that this isn't already the last entry */
-			if (firstFreeSymbolTableIndex > SYMBOL_TABLE_SLOT_SIZE && i != (firstFreeSymbolTableIndex - SYMBOL_TABLE_SLOT_SIZE))
+			prvCompactEncode(record, event, nParam, raw);
+			TRC_STREAM_PORT_COMMIT_EVENT(record, recordSize);
+
+			/* Only update the encoder state when the record was stored */
+			compactLastTS = event->TS;
+			compactLastCount = event->EventCount;
+			if (!raw)
 			{
-				/* Another entry is available, get pointer to the last one */
-				/* We access the symbol table via the union member pSymbolTableBufferUINT32 to avoid strict-aliasing issues */
-				lastEntryPtr = &symbolTable.SymbolTableBuffer.pSymbolTableBufferUINT32[(firstFreeSymbolTableIndex - SYMBOL_TABLE_SLOT_SIZE) / sizeof(uint32_t)];
-				
-				/* Copy last entry to this position */
-				for (j = 0; j < (SYMBOL_TABLE_SLOT_SIZE) / sizeof(uint32_t); j++)
+				for (i = 0; i < nParam; i++)
 				{
-					ptr[j] = lastEntryPtr[j];
+					compactLastParam[(i < COMPACT_PREDICTORS) ? i : (COMPACT_PREDICTORS - 1)] = ((const uint32_t*)(event + 1))[i];
 				}
+			}
+			compactSyncCountdown--;
+		}
+	}
+}
+
+#endif /* (TRC_CFG_COMPACT_EVENT_FORMAT == 1) */
 
-				/* For good measure we also zero out the original position */
-				*lastEntryPtr = 0;
+/* Returns the hash bucket for an object address */
+static uint32_t prvHashedSlotBucket(const HashedSlotIndex* index, uint32_t key)
+{
+	/* The addresses are aligned and often close to each other, so mix the bits */
+	key ^= key >> 16;
+	key *= 0x45D9F3Bu;
+	key ^= key >> 16;
+
+	return key % index->slotCount;
+}
+
+/* Returns the slot with the given key (object address), or SLOT_NONE */
+static uint32_t prvHashedSlotFind(const HashedSlotIndex* index, uint32_t key)
+{
+	uint32_t slot = index->bucket[prvHashedSlotBucket(index, key)];
+
+	while (slot != 0)
+	{
+		if (index->table[(slot - 1) * index->slotWords] == key)
+		{
+			return slot - 1;
+		}
+		slot = index->next[slot - 1];
+	}
+
+	return SLOT_NONE;
+}
+
+/* Takes a free slot, reusing deleted slots first. Returns the slot or SLOT_NONE
+if the table is full. The slot must then be added using prvHashedSlotLink. */
+static uint32_t prvHashedSlotTake(HashedSlotIndex* index)
+{
+	uint32_t slot;
+
+	if (index->freeList != 0)
+	{
+		slot = (uint32_t)index->freeList - 1;
+		index->freeList = index->next[slot];
+	}
+	else if (index->highWater < index->slotCount)
+	{
+		slot = index->highWater++;
+	}
+	else
+	{
+		slot = SLOT_NONE;
+	}
+
+	return slot;
+}
+
+/* Sets the key (object address) of a slot taken by prvHashedSlotTake and
+adds it to the hash index */
+static void prvHashedSlotLink(HashedSlotIndex* index, uint32_t slot, uint32_t key)
+{
+	uint32_t bucket = prvHashedSlotBucket(index, key);
+
+	index->table[slot * index->slotWords] = key;
+	index->next[slot] = index->bucket[bucket];
+	index->bucket[bucket] = (uint16_t)(slot + 1);
+}
+
+/* Removes the slot with the given key (object address), if any, and puts it
+in the free list */
+static void prvHashedSlotRemove(HashedSlotIndex* index, uint32_t key)
+{
+	uint16_t* link = &index->bucket[prvHashedSlotBucket(index, key)];
+	uint32_t slot;
+	uint32_t i;
+
+	while (*link != 0)
+	{
+		slot = (uint32_t)*link - 1;
+		if (index->table[slot * index->slotWords] == key)
+		{
+			*link = index->next[slot];
+
+			/* Clear the slot, so it is seen as unused when the table is stored */
+			for (i = 0; i < index->slotWords; i++)
+			{
+				index->table[slot * index->slotWords + i] = 0;
 			}
-			else
-				*ptr = 0; /* No other entry found, or this is the last entry */
 
-			/* Lower index */
-			firstFreeSymbolTableIndex -= SYMBOL_TABLE_SLOT_SIZE;
+			index->next[slot] = index->freeList;
+			index->freeList = (uint16_t)(slot + 1);
+			return;
+		}
+		link = &index->next[slot];
+	}
+}
 
-			break;
+/* Writes the name of a symbol table slot */
+static void prvTraceSetSymbolName(uint32_t slot, const char *name)
+{
+	uint32_t i;
+	uint8_t *ptrSymbol;
+
+	/* We access the symbol table via the union member pSymbolTableBufferUINT8 to avoid strict-aliasing issues */
+	ptrSymbol = &symbolTable.SymbolTableBuffer.pSymbolTableBufferUINT8[slot * SYMBOL_TABLE_SLOT_SIZE + sizeof(uint32_t)];
+	for (i = 0; i < (TRC_CFG_SYMBOL_MAX_LENGTH); i++)
+	{
+		ptrSymbol[i] = (uint8_t)name[i];	/* We do this first to ensure we also get the 0 termination, if there is one */
+
+		if (name[i] == 0)
+		break;
+	}
+
+	/* Check the length of "name", if longer than SYMBOL_MAX_LENGTH */
+	while ((name[i] != 0) && i < 128)
+	{
+		i++;
+	}
+
+	/* Remember the longest symbol name, for diagnostic purposes */
+	if (i > LongestSymbolName)
+	{
+		LongestSymbolName = i;
+	}
+}
+
+/* Saves a symbol name in the symbol table and returns the slot address */
+void* prvTraceSaveSymbol(const char *name)
+{
+	void* retVal = 0;
+	uint32_t slot;
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	TRACE_ENTER_CRITICAL_SECTION();
+	slot = prvHashedSlotTake(&symbolTableIndex);
+	if (slot != SLOT_NONE)
+	{
+		/* The address to the available symbol table slot is the address we use.
+		It stays unique while in use, as the slots are never moved. */
+		retVal = &symbolTable.SymbolTableBuffer.pSymbolTableBufferUINT8[slot * SYMBOL_TABLE_SLOT_SIZE];
+		prvHashedSlotLink(&symbolTableIndex, slot, (uint32_t)retVal);
+		prvTraceSetSymbolName(slot, name);
+	}
+	else
+	{
+		NoRoomForSymbol++;
+	}
+	TRACE_EXIT_CRITICAL_SECTION();
+	
+	return retVal;
+}
+
+/* Saves a string in the symbol table for an object (task name etc.) */
+void prvTraceSaveObjectSymbol(void* address, const char *name)
+{
+	uint32_t slot;
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	TRACE_ENTER_CRITICAL_SECTION();
+
+	/* If the object already has a symbol, the name is replaced */
+	slot = prvHashedSlotFind(&symbolTableIndex, (uint32_t)address);
+	if (slot == SLOT_NONE)
+	{
+		slot = prvHashedSlotTake(&symbolTableIndex);
+		if (slot != SLOT_NONE)
+		{
+			prvHashedSlotLink(&symbolTableIndex, slot, (uint32_t)address);
 		}
 	}
 
+	if (slot != SLOT_NONE)
+	{
+		prvTraceSetSymbolName(slot, name);
+	}
+	else
+	{
+		NoRoomForSymbol++;
+	}
+
+	TRACE_EXIT_CRITICAL_SECTION();
+}
+
+/* Deletes a symbol name (task name etc.) from symbol table */
+void prvTraceDeleteSymbol(void *address)
+{
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	TRACE_ENTER_CRITICAL_SECTION();
+
+	/* The slot is reused by the next symbol saved */
+	prvHashedSlotRemove(&symbolTableIndex, (uint32_t)address);
+
 	TRACE_EXIT_CRITICAL_SECTION();
 }
 
 /* Saves an object data entry (current task priority) in object data table */
 void prvTraceSaveObjectData(const void *address, uint32_t data)
 {
-	uint32_t i;
-	uint32_t foundSlot;
-	uint32_t *ptr;
+	uint32_t slot;
 	TRACE_ALLOC_CRITICAL_SECTION();
 
 	TRACE_ENTER_CRITICAL_SECTION();
 	
-	foundSlot = firstFreeObjectDataTableIndex;
-
 	/* First look for previous entries using this address */
-	for (i = 0; i < firstFreeObjectDataTableIndex; i += OBJECT_DATA_SLOT_SIZE)
+	slot = prvHashedSlotFind(&objectDataTableIndex, (uint32_t)address);
+	if (slot == SLOT_NONE)
 	{
-		/* We access the data table via the union member pObjectDataTableBufferUINT32 to avoid strict-aliasing issues */
-		ptr = &objectDataTable.ObjectDataTableBuffer.pObjectDataTableBufferUINT32[i / sizeof(uint32_t)];
-		if (*ptr == (uint32_t)address)
+		slot = prvHashedSlotTake(&objectDataTableIndex);
+		if (slot != SLOT_NONE)
 		{
-			foundSlot = i;
-			break;
+			prvHashedSlotLink(&objectDataTableIndex, slot, (uint32_t)address);
 		}
 	}
 
-	if (foundSlot < OBJECT_DATA_TABLE_BUFFER_SIZE)
+	if (slot != SLOT_NONE)
 	{
 		/* We access the data table via the union member pObjectDataTableBufferUINT32 to avoid strict-aliasing issues */
-		objectDataTable.ObjectDataTableBuffer.pObjectDataTableBufferUINT32[foundSlot / sizeof(uint32_t)] = (uint32_t)address;
-		objectDataTable.ObjectDataTableBuffer.pObjectDataTableBufferUINT32[foundSlot / sizeof(uint32_t) + 1] = data;
-
-		/* Is this the last entry in the object data table? */
-		if (foundSlot == firstFreeObjectDataTableIndex)
-		{
-			firstFreeObjectDataTableIndex += OBJECT_DATA_SLOT_SIZE;
-		}
+		objectDataTable.ObjectDataTableBuffer.pObjectDataTableBufferUINT32[slot * (OBJECT_DATA_SLOT_SIZE / sizeof(uint32_t)) + 1] = data;
 	}
 	else
 	{
@@ -1647,43 +2470,11 @@ void prvTraceSaveObjectData(const void *address, uint32_t data)
 /* Removes an object data entry (task base priority) from object data table */
 void prvTraceDeleteObjectData(void *address)
 {
-	uint32_t i, j;
-	uint32_t *ptr, *lastEntryPtr;
 	TRACE_ALLOC_CRITICAL_SECTION();
 
 	TRACE_ENTER_CRITICAL_SECTION();
 
-	for (i = 0; i < firstFreeObjectDataTableIndex; i += OBJECT_DATA_SLOT_SIZE)
-	{
-		/* We access the data table via the union member pObjectDataTableBufferUINT32 to avoid strict-aliasing issues */
-		ptr = &objectDataTable.ObjectDataTableBuffer.pObjectDataTableBufferUINT32[i / sizeof(uint32_t)];
-		if (*ptr == (uint32_t)address)
-		{
-			/* See if we have another entry in the table, and that this isn't already the last entry */
-			if (firstFreeObjectDataTableIndex > OBJECT_DATA_SLOT_SIZE && i != (firstFreeObjectDataTableIndex - OBJECT_DATA_SLOT_SIZE))
-			{
-				/* Another entry is available, get pointer to the last one */
-				/* We access the data table via the union member pObjectDataTableBufferUINT32 to avoid strict-aliasing issues */
-				lastEntryPtr = &objectDataTable.ObjectDataTableBuffer.pObjectDataTableBufferUINT32[(firstFreeObjectDataTableIndex - OBJECT_DATA_SLOT_SIZE) / sizeof(uint32_t)];
-				
-				/* Copy last entry to this position */
-				for (j = 0; j < (OBJECT_DATA_SLOT_SIZE) / sizeof(uint32_t); j++)
-				{
-					ptr[j] = lastEntryPtr[j];
-				}
-
-				/* For good measure we also zero out the original position */
-				*lastEntryPtr = 0;
-			}
-			else
-				*ptr = 0; /* No other entry found, or this is the last entry */
-
-			/* Lower index */
-			firstFreeObjectDataTableIndex -= OBJECT_DATA_SLOT_SIZE;
-
-			break;
-		}
-	}
+	prvHashedSlotRemove(&objectDataTableIndex, (uint32_t)address);
 
 	TRACE_EXIT_CRITICAL_SECTION();
 }
@@ -1831,10 +2622,21 @@ static uint32_t prvGetTimestamp32(void)
 static int prvAllocateBufferPage(int prevPage)
 {
 	int index;
-	int count = 0;
 
 	index = (prevPage + 1) % (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT);
 
+#if (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1)
+	/* Several writers may look for a page at once, so claim it atomically.
+	Only the next page is used, as the pages are read in order. A writer that
+	skipped a page claimed by another one would otherwise get it written
+	after the following pages. */
+	if (TRC_PORT_ATOMIC_CAS32(&PageInfo[index].Status, PAGE_STATUS_FREE, PAGE_STATUS_WRITE))
+	{
+		return index;
+	}
+#else
+	int count = 0;
+
 	while((PageInfo[index].Status != PAGE_STATUS_FREE) && (count ++ < (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT)))
 	{
 		index = (index + 1) % (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT);
@@ -1844,6 +2646,7 @@ static int prvAllocateBufferPage(int prevPage)
 	{
 		return index;
 	}
+#endif /* (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1) */
 
 	return -1;
 }
@@ -1851,6 +2654,15 @@ static int prvAllocateBufferPage(int prevPage)
 /* Mark the page read as complete. */
 static void prvPageReadComplete(int pageIndex)
 {
+#if (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1)
+	/* The page keeps its sealed Reserved word until claimed again, and
+	Committed is cleared first, so stale writers can't use it meanwhile. */
+	PageInfo[pageIndex].Committed = 0;
+
+	prvAtomicAdd32(&TotalBytesRemaining, (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE));
+
+	PageInfo[pageIndex].Status = PAGE_STATUS_FREE;
+#else
   	TRACE_ALLOC_CRITICAL_SECTION();
 
 	TRACE_ENTER_CRITICAL_SECTION();
@@ -1861,24 +2673,42 @@ static void prvPageReadComplete(int pageIndex)
 	TotalBytesRemaining += (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE);
 
 	TRACE_EXIT_CRITICAL_SECTION();
+#endif /* (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1) */
+}
+
+/* Get the number of valid bytes in a buffer page that is ready to be read. */
+static int32_t prvGetPageBytesUsed(int pageIndex)
+{
+#if (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1)
+	/* The offset where the page was sealed, any bytes after that are unused */
+	return (int32_t)PAGE_RESERVED_OFFSET(PageInfo[pageIndex].Reserved);
+#else
+	return (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE) - PageInfo[pageIndex].BytesRemaining;
+#endif /* (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1) */
 }
 
 /* Get the current buffer page index and remaining number of bytes. */
 static int prvGetBufferPage(int32_t* bytesUsed)
 {
-	static int8_t lastPage = -1;
+  	int8_t index = (int8_t) ((lastReadPage + 1) % (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT));
+
+#if (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1)
+	/* The pages are written in order, but a page may wait for a preempted
+	writer to commit while the following pages are already complete. Only the
+	page after the last page read may be read, so that the pages stay in order. */
+#else
 	int count = 0;
-  	int8_t index = (int8_t) ((lastPage + 1) % (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT));
 
 	while((PageInfo[index].Status != PAGE_STATUS_READ) && (count++ < (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT)))
 	{
 		index = (int8_t)((index + 1) % (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT));
 	}
+#endif /* (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1) */
 
 	if (PageInfo[index].Status == PAGE_STATUS_READ)
 	{
-		*bytesUsed = (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE) - PageInfo[index].BytesRemaining;
-		lastPage = index;
+		*bytesUsed = prvGetPageBytesUsed(index);
+		lastReadPage = index;
 		return index;
 	}
 
@@ -1887,11 +2717,51 @@ static int prvGetBufferPage(int32_t* bytesUsed)
 	return -1;
 }
 
+/* Append the following buffer pages that are ready to a transfer. */
+static int prvGatherBufferPages(int firstPage, int32_t* bytesToTransfer)
+{
+	int pageCount = 1;
+	int32_t bytesUsed;
+	char* transferEnd = &EventBuffer[firstPage * (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE) + *bytesToTransfer];
+
+	/* Only pages up to the end of the buffer are contiguous with the first one.
+	The valid bytes of each page are moved down to follow the previous page,
+	over the unused bytes in its end, so a single write covers them all. */
+	while ((firstPage + pageCount < (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT)) &&
+		(*bytesToTransfer + (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE) <= (TRC_STREAM_PORT_MAX_BURST_SIZE)) &&
+		(PageInfo[firstPage + pageCount].Status == PAGE_STATUS_READ))
+	{
+		bytesUsed = prvGetPageBytesUsed(firstPage + pageCount);
+
+		if (transferEnd != &EventBuffer[(firstPage + pageCount) * (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE)])
+		{
+			memmove(transferEnd, &EventBuffer[(firstPage + pageCount) * (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE)], (size_t)bytesUsed);
+		}
+
+		transferEnd += bytesUsed;
+		*bytesToTransfer += bytesUsed;
+		lastReadPage = (int8_t)(firstPage + pageCount);
+		pageCount++;
+	}
+
+	return pageCount;
+}
+
 /*******************************************************************************
  * uint32_t prvPagedEventBufferTransfer(void)
  *
- * Transfers one buffer page of trace data, if a full page is available, using
- * the macro TRC_STREAM_PORT_WRITE_DATA as defined in trcStreamingPort.h.
+ * Transfers the buffer pages of trace data that are ready, using the macro
+ * TRC_STREAM_PORT_WRITE_DATA as defined in trcStreamingPort.h.
+ *
+ * Consecutive pages are gathered into one write, of at most
+ * TRC_STREAM_PORT_MAX_BURST_SIZE bytes (one page unless the stream port
+ * defines a larger burst size). The pages are handed back to the recorder as
+ * soon as their data has been written, also if the write is split in several
+ * calls by the stream port.
+ *
+ * If the stream port reports backpressure (TRC_STREAM_PORT_BACKPRESSURE) and
+ * doesn't accept any data, the transfer is left unfinished and continued on
+ * the next call, instead of retrying the write right away.
  *
  * This function is intended to be called the periodic TzCtrl task with a suitable
  * delay (e.g. 10-100 ms).
@@ -1906,46 +2776,293 @@ static int prvGetBufferPage(int32_t* bytesUsed)
  *******************************************************************************/
 uint32_t prvPagedEventBufferTransfer(void)
 {
-	int8_t pageToTransfer = -1;
-    int32_t bytesTransferredTotal = 0;
 	int32_t bytesTransferredNow = 0;
-	int32_t bytesToTransfer;
+	int32_t bytesTransferredHere = 0;
+	int backpressure = (TRC_STREAM_PORT_BACKPRESSURE() != 0);
 
-    pageToTransfer = (int8_t)prvGetBufferPage(&bytesToTransfer);
+#if (TRC_CFG_BACKPRESSURE_SAMPLING > 1)
+	backpressureActive = (uint8_t)backpressure;
+#endif /* (TRC_CFG_BACKPRESSURE_SAMPLING > 1) */
 
-	/* bytesToTransfer now contains the number of "valid" bytes in the buffer page, that should be transmitted.
-	There might be some unused junk bytes in the end, that must be ignored. */
-    
-    if (pageToTransfer > -1)
-    {
-        while (1)  /* Keep going until we have transferred all that we intended to */
-        {
-			if (TRC_STREAM_PORT_WRITE_DATA(
-					&EventBuffer[pageToTransfer * (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE) + bytesTransferredTotal],
-					(uint32_t)(bytesToTransfer - bytesTransferredTotal),
-					&bytesTransferredNow) == 0)
+	if (transferFirstPage == -1)
+	{
+		transferFirstPage = (int8_t)prvGetBufferPage(&transferBytes);
+
+		/* transferBytes now contains the number of "valid" bytes in the buffer page, that should be transmitted.
+		There might be some unused junk bytes in the end, that must be ignored. */
+
+		if (transferFirstPage == -1)
+		{
+			return 0;
+		}
+
+		transferPageCount = prvGatherBufferPages(transferFirstPage, &transferBytes);
+		transferPagesCompleted = 0;
+		transferBytesDone = 0;
+
+		TransferCount++;
+		if ((uint32_t)transferBytes > LargestTransfer)
+		{
+			LargestTransfer = (uint32_t)transferBytes;
+		}
+	}
+
+	while (1)  /* Keep going until we have transferred all that we intended to */
+	{
+		/* Hand back the pages whose part of the transfer has been written.
+		Pages left empty after gathering are handed back last, since the
+		pages must be reused in order to keep the events in order. */
+		while ((transferPagesCompleted < transferPageCount) &&
+			((transferBytesDone == transferBytes) ||
+			(transferBytesDone >= (transferPagesCompleted + 1) * (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE))))
+		{
+			prvPageReadComplete(transferFirstPage + transferPagesCompleted);
+			transferPagesCompleted++;
+		}
+
+		if (transferBytesDone == transferBytes)
+		{
+			/* All bytes have been transferred and all buffer pages are marked as "Read Complete", return OK. */
+			transferFirstPage = -1;
+			return (uint32_t)bytesTransferredHere;
+		}
+
+		bytesTransferredNow = 0;
+		if (TRC_STREAM_PORT_WRITE_DATA(
+				&EventBuffer[transferFirstPage * (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE) + transferBytesDone],
+				(uint32_t)(transferBytes - transferBytesDone),
+				&bytesTransferredNow) == 0)
+		{
+			/* Write was successful. Update the number of transferred bytes. */
+			transferBytesDone += bytesTransferredNow;
+			bytesTransferredHere += bytesTransferredNow;
+
+			if ((bytesTransferredNow == 0) && (backpressure || (TRC_STREAM_PORT_BACKPRESSURE() != 0)))
 			{
-				/* Write was successful. Update the number of transferred bytes. */
-				bytesTransferredTotal += bytesTransferredNow;
+				/* The stream port is full, continue this transfer later. */
+#if (TRC_CFG_BACKPRESSURE_SAMPLING > 1)
+				backpressureActive = 1;
+#endif /* (TRC_CFG_BACKPRESSURE_SAMPLING > 1) */
+				return (uint32_t)bytesTransferredHere;
+			}
+		}
+		else
+		{
+			/* Some error from the streaming interface... */
+			transferFirstPage = -1;
+			vTraceStop();
+			return 0;
+		}
+	}
+}
 
-				if (bytesTransferredTotal == bytesToTransfer)
-				{
-					/* All bytes have been transferred. Mark the buffer page as "Read Complete" (so it can be written to) and return OK. */
-					prvPageReadComplete(pageToTransfer);
-					return (uint32_t)bytesTransferredTotal;
-				}
+#if (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1)
+
+/* Atomically adds a value and returns the result. */
+static uint32_t prvAtomicAdd32(volatile uint32_t* ptr, uint32_t value)
+{
+	uint32_t oldValue;
+
+	do
+	{
+		oldValue = *ptr;
+	} while (!TRC_PORT_ATOMIC_CAS32(ptr, oldValue, oldValue + value));
+
+	return oldValue + value;
+}
+
+/* Lowers TotalBytesRemaining and updates the low water mark. */
+static void prvConsumeBytesRemaining(uint32_t bytes)
+{
+	uint32_t remaining = prvAtomicAdd32(&TotalBytesRemaining, 0u - bytes);
+	uint32_t lowWaterMark;
+
+	do
+	{
+		lowWaterMark = TotalBytesRemaining_LowWaterMark;
+		if (remaining >= lowWaterMark)
+		{
+			return;
+		}
+	} while (!TRC_PORT_ATOMIC_CAS32(&TotalBytesRemaining_LowWaterMark, lowWaterMark, remaining));
+}
+
+/* Adds to the committed bytes of a page, handing it over when complete. */
+static void prvPageCommitBytes(uint32_t pageIndex, uint32_t bytes)
+{
+	/* The committed bytes only reach the page size when the page is sealed
+	(the unused bytes in the end are then committed) and all writers that
+	reserved space in it are done. */
+	if (prvAtomicAdd32(&PageInfo[pageIndex].Committed, bytes) == (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE))
+	{
+		PageInfo[pageIndex].Status = PAGE_STATUS_READ;
+	}
+}
+
+/* Switches from the given write page to a new one, if no other writer has.
+Returns 0 if there is no free page, so that the event must be dropped. */
+static int prvSwitchWritePage(uint32_t writePage)
+{
+	uint32_t generation = WRITE_PAGE_GENERATION(writePage) + 1;
+	uint32_t prevIndex = WRITE_PAGE_INDEX(writePage);
+	int index;
+
+	/* Continue after the last page written also after running out of pages,
+	since the pages are read in this order */
+	if (prevIndex == WRITE_PAGE_NONE)
+	{
+		prevIndex = lastWritePage;
+	}
+
+	index = prvAllocateBufferPage((int)prevIndex);
+
+	if (index == -1)
+	{
+		if (currentWritePage != writePage)
+		{
+			/* Another writer has switched page already, try that one */
+			return 1;
+		}
+
+		if (PageInfo[(prevIndex + 1) % (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT)].Status == PAGE_STATUS_WRITE)
+		{
+			/* Another writer is switching to the next page. It may have been
+			preempted by this one, so drop the event instead of waiting. */
+			return 0;
+		}
+
+		if (WRITE_PAGE_INDEX(writePage) != WRITE_PAGE_NONE)
+		{
+			/* No free page, let the next writer try again */
+			lastWritePage = prevIndex;
+			(void)TRC_PORT_ATOMIC_CAS32(&currentWritePage, writePage, WRITE_PAGE(generation, WRITE_PAGE_NONE));
+		}
+
+		return 0;
+	}
+
+	/* Prepare the page before publishing it. Stale writers holding an older
+	generation will not match the Reserved word. */
+	PageInfo[index].Committed = 0;
+	PageInfo[index].Reserved = PAGE_RESERVED(generation);
+
+	if (!TRC_PORT_ATOMIC_CAS32(&currentWritePage, writePage, WRITE_PAGE(generation, (uint32_t)index)))
+	{
+		/* Another writer switched page first. No writer can have seen this page,
+		since it was never published, so just give it back. */
+		PageInfo[index].Status = PAGE_STATUS_FREE;
+	}
+
+	return 1;
+}
+
+/*******************************************************************************
+ * void* prvPagedEventBufferGetWritePointer(int sizeOfEvent)
+ *
+ * Returns a pointer to an available location in the buffer able to store the
+ * requested size, or NULL if no buffer page is available (event dropped).
+ *
+ * Lock-free version, which may be called from several tasks and ISRs at once.
+ * The space is reserved in the current page using TRC_PORT_ATOMIC_CAS32 and
+ * the caller must call prvPagedEventBufferCommit when the event is written.
+ * The writer that finds the page full seals it, and any writer that finds a
+ * sealed page helps switching to a new one, so a writer never waits for
+ * another one that it has preempted.
+ *
+ * Parameters:
+ * - sizeOfEvent: The size of the event that is to be placed in the buffer.
+ *
+*******************************************************************************/
+void* prvPagedEventBufferGetWritePointer(int sizeOfEvent)
+{
+	uint32_t writePage;
+	uint32_t index;
+	uint32_t reserved;
+	uint32_t offset;
+	uint32_t size = (uint32_t)sizeOfEvent;
+
+	if (size > (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE))
+	{
+		(void)prvAtomicAdd32(&DroppedEventCounter, 1);
+		return NULL;
+	}
+
+	while (1)
+	{
+		writePage = currentWritePage;
+		index = WRITE_PAGE_INDEX(writePage);
+
+		if (index == WRITE_PAGE_NONE)
+		{
+			if (prvSwitchWritePage(writePage) == 0)
+			{
+				(void)prvAtomicAdd32(&DroppedEventCounter, 1);
+				return NULL;
+			}
+			continue;
+		}
+
+		reserved = PageInfo[index].Reserved;
+
+		if (PAGE_RESERVED_GENERATION(reserved) != WRITE_PAGE_GENERATION(writePage))
+		{
+			/* The page was switched (and recycled) since reading currentWritePage */
+			continue;
+		}
+
+		if (reserved & PAGE_RESERVED_SEALED)
+		{
+			if (prvSwitchWritePage(writePage) == 0)
+			{
+				(void)prvAtomicAdd32(&DroppedEventCounter, 1);
+				return NULL;
 			}
-			else
+			continue;
+		}
+
+		offset = PAGE_RESERVED_OFFSET(reserved);
+
+		if (offset + size > (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE))
+		{
+			/* Full, seal the page. The unused bytes in the end are committed
+			right away, so the page is handed over when the writers are done. */
+			if (TRC_PORT_ATOMIC_CAS32(&PageInfo[index].Reserved, reserved, reserved | PAGE_RESERVED_SEALED))
 			{
-				/* Some error from the streaming interface... */
-				vTraceStop();
-				return 0;
+				prvConsumeBytesRemaining((TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE) - offset); // Last trailing bytes
+				prvPageCommitBytes(index, (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE) - offset);
 			}
+			continue;
+		}
+
+		if (TRC_PORT_ATOMIC_CAS32(&PageInfo[index].Reserved, reserved, reserved + size))
+		{
+			prvConsumeBytesRemaining(size);
+
+			return &EventBuffer[index * (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE) + offset];
 		}
 	}
-	return 0;
 }
 
+/*******************************************************************************
+ * void prvPagedEventBufferCommit(void* ptrData, int sizeOfEvent)
+ *
+ * Marks an event allocated by prvPagedEventBufferGetWritePointer as written
+ * in full. Used as TRC_STREAM_PORT_COMMIT_EVENT in lock-free mode.
+ *
+ * Parameters:
+ * - ptrData: The pointer returned by prvPagedEventBufferGetWritePointer.
+ * - sizeOfEvent: The size of the event, as given on allocation.
+ *
+*******************************************************************************/
+void prvPagedEventBufferCommit(void* ptrData, int sizeOfEvent)
+{
+	uint32_t index = (uint32_t)((char*)ptrData - EventBuffer) / (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE);
+
+	prvPageCommitBytes(index, (uint32_t)sizeOfEvent);
+}
+
+#else /* (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1) */
+
 /*******************************************************************************
  * void* prvPagedEventBufferGetWritePointer(int sizeOfEvent)
  *
@@ -1963,9 +3080,13 @@ void* prvPagedEventBufferGetWritePointer(int sizeOfEvent)
 	void* ret;
 	static int currentWritePage = -1;
 
+	/* The last page written to before running out of pages. The next page is
+	allocated after it, since the pages are read in this order. */
+	static int lastWritePage = -1;
+
 	if (currentWritePage == -1)
 	{
-	    currentWritePage = prvAllocateBufferPage(currentWritePage);
+	    currentWritePage = prvAllocateBufferPage(lastWritePage);
 		if (currentWritePage == -1)
 		{
 		  	DroppedEventCounter++;
@@ -1982,6 +3103,7 @@ void* prvPagedEventBufferGetWritePointer(int sizeOfEvent)
 		if (TotalBytesRemaining < TotalBytesRemaining_LowWaterMark)
 		  TotalBytesRemaining_LowWaterMark = TotalBytesRemaining;
 
+		lastWritePage = currentWritePage;
 		currentWritePage = prvAllocateBufferPage(currentWritePage);
 		if (currentWritePage == -1)
 		{
@@ -2001,6 +3123,8 @@ void* prvPagedEventBufferGetWritePointer(int sizeOfEvent)
 	return ret;
 }
 
+#endif /* (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1) */
+
 /*******************************************************************************
  * void prvPagedEventBufferInit(char* buffer)
  *
@@ -2022,10 +3146,30 @@ void prvPagedEventBufferInit(char* buffer)
 	TRACE_ENTER_CRITICAL_SECTION();
 	for (i = 0; i < (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT); i++)
 	{
+#if (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1)
+		PageInfo[i].Reserved = PAGE_RESERVED(0) | PAGE_RESERVED_SEALED;
+		PageInfo[i].Committed = 0;
+#else
 		PageInfo[i].BytesRemaining = (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE);
 		PageInfo[i].WritePointer = &EventBuffer[i * (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE)];
+#endif /* (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1) */
 		PageInfo[i].Status = PAGE_STATUS_FREE;
 	}
+#if (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1)
+	currentWritePage = WRITE_PAGE(0, WRITE_PAGE_NONE);
+	lastWritePage = (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT) - 1;
+	lastReadPage = -1;
+#endif /* (TRC_CFG_PAGED_EVENT_BUFFER_LOCK_FREE == 1) */
+	TotalBytesRemaining = (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT) * (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE);
+	TotalBytesRemaining_LowWaterMark = TotalBytesRemaining;
+	TransferCount = 0;
+	LargestTransfer = 0;
+	SampledOutEventCounter = 0;
+	transferFirstPage = -1;
+#if (TRC_CFG_BACKPRESSURE_SAMPLING > 1)
+	backpressureActive = 0;
+	backpressureSampleCount = 0;
+#endif /* (TRC_CFG_BACKPRESSURE_SAMPLING > 1) */
 	TRACE_EXIT_CRITICAL_SECTION();
 
 }
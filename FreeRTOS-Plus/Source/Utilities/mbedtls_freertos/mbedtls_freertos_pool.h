@@ -0,0 +1,132 @@
+/*
+ * FreeRTOS V202104.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file mbedtls_freertos_pool.h
+ * @brief Memory pools for the allocations of mbed TLS, see
+ * #MBEDTLS_FREERTOS_POOL_ALLOCATOR.
+ */
+
+#ifndef MBEDTLS_FREERTOS_POOL_H_
+#define MBEDTLS_FREERTOS_POOL_H_
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+
+/**
+ * @brief Define this in mbedtls_config.h to allocate the memory of mbed TLS
+ * from pools of fixed-size blocks rather than from the FreeRTOS heap.
+ *
+ * mbed TLS makes many small, short lived allocations, in particular during a
+ * handshake, which fragment the FreeRTOS heap and make the time of each
+ * allocation depend on the state of the heap. With this defined,
+ * mbedtls_platform_calloc() takes each allocation from the smallest size class
+ * whose blocks are large enough, in constant time. Larger allocations, and
+ * allocations of a class whose blocks are all used, are still taken from the
+ * FreeRTOS heap.
+ *
+ * The pools are static arrays, the number of blocks of each class is set with
+ * MBEDTLS_FREERTOS_POOL_BLOCKS_32 to MBEDTLS_FREERTOS_POOL_BLOCKS_1024, which
+ * must each be at least 1. Use mbedtls_platform_pool_get_stats() to tune them.
+ *
+ * #define MBEDTLS_FREERTOS_POOL_ALLOCATOR
+ */
+
+/**
+ * @brief The number of size classes, of 32, 64, 128, 256, 512 and 1024 bytes.
+ */
+#define MBEDTLS_FREERTOS_POOL_CLASSES    6U
+
+/**
+ * @brief The number of blocks of each size class. The defaults take 23 KB of
+ * RAM, use the high water marks of mbedtls_platform_pool_get_stats() to size
+ * them for an application.
+ */
+#ifndef MBEDTLS_FREERTOS_POOL_BLOCKS_32
+    #define MBEDTLS_FREERTOS_POOL_BLOCKS_32    96U
+#endif
+#ifndef MBEDTLS_FREERTOS_POOL_BLOCKS_64
+    #define MBEDTLS_FREERTOS_POOL_BLOCKS_64    64U
+#endif
+#ifndef MBEDTLS_FREERTOS_POOL_BLOCKS_128
+    #define MBEDTLS_FREERTOS_POOL_BLOCKS_128    32U
+#endif
+#ifndef MBEDTLS_FREERTOS_POOL_BLOCKS_256
+    #define MBEDTLS_FREERTOS_POOL_BLOCKS_256    16U
+#endif
+#ifndef MBEDTLS_FREERTOS_POOL_BLOCKS_512
+    #define MBEDTLS_FREERTOS_POOL_BLOCKS_512    8U
+#endif
+#ifndef MBEDTLS_FREERTOS_POOL_BLOCKS_1024
+    #define MBEDTLS_FREERTOS_POOL_BLOCKS_1024    4U
+#endif
+
+/**
+ * @brief The use of one size class of the pools, or of the FreeRTOS heap.
+ */
+typedef struct mbedtls_platform_pool_stats
+{
+    size_t blockSize;     /**< @brief The size of the blocks of the class, or 0 for the FreeRTOS heap. */
+    size_t blocks;        /**< @brief The number of blocks of the class, or 0 for the FreeRTOS heap. */
+    size_t used;          /**< @brief The number of blocks in use. */
+    size_t highWater;     /**< @brief The largest number of blocks in use at any time. */
+    uint32_t allocations; /**< @brief The number of allocations of the size of the class. */
+    uint32_t fallbacks;   /**< @brief The allocations that were taken from the FreeRTOS heap, because all the blocks of the class were used. */
+} mbedtls_platform_pool_stats_t;
+
+/**
+ * @brief Get the use of a size class of the pools.
+ *
+ * @param[in] classIndex The size class, from 0 for the smallest blocks to
+ * #MBEDTLS_FREERTOS_POOL_CLASSES - 1. #MBEDTLS_FREERTOS_POOL_CLASSES gets the
+ * use of the FreeRTOS heap by mbed TLS, for the allocations larger than the
+ * largest class and the fallbacks of all the classes.
+ * @param[out] pStats The use of the class.
+ *
+ * @return pdTRUE if classIndex is valid, pdFALSE otherwise.
+ */
+BaseType_t mbedtls_platform_pool_get_stats( size_t classIndex,
+                                            mbedtls_platform_pool_stats_t * pStats );
+
+/**
+ * @brief Set the high water marks of the size classes and of the FreeRTOS
+ * heap to the numbers of blocks in use, to measure the peak use of an
+ * operation such as a handshake.
+ */
+void mbedtls_platform_pool_reset_high_water( void );
+
+/**
+ * @brief Take the allocations of mbed TLS from the pools, which is the
+ * default, or from the FreeRTOS heap, to compare the two.
+ *
+ * The blocks in use are freed to where they were allocated from, so this can
+ * be called at any time.
+ *
+ * @param[in] enable pdTRUE to use the pools, pdFALSE to use the heap only.
+ */
+void mbedtls_platform_pool_enable( BaseType_t enable );
+
+#endif /* ifndef MBEDTLS_FREERTOS_POOL_H_ */
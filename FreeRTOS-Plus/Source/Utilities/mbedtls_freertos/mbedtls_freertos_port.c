@@ -31,6 +31,7 @@
 
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"
+#include "task.h"
 #include "FreeRTOS_Sockets.h"
 
 /* mbed TLS includes. */
@@ -39,6 +40,9 @@
 #include "mbedtls/entropy.h"
 #include "mbedtls/ssl.h"
 
+/* mbed TLS memory pools. */
+#include "mbedtls_freertos_pool.h"
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -52,6 +56,264 @@
 
 /*-----------------------------------------------------------*/
 
+#ifdef MBEDTLS_FREERTOS_POOL_ALLOCATOR
+
+/**
+ * @brief A free block of a size class, linked to the next free block.
+ */
+    typedef struct PoolBlock
+    {
+        struct PoolBlock * pNext;
+    } PoolBlock_t;
+
+/**
+ * @brief A size class of the pools.
+ */
+    typedef struct PoolClass
+    {
+        uint8_t * pStorage;                  /**< @brief The blocks of the class. */
+        size_t unused;                       /**< @brief The index of the first block that was never allocated. */
+        PoolBlock_t * pFreeList;             /**< @brief The blocks that were freed. */
+        mbedtls_platform_pool_stats_t stats; /**< @brief The use of the class. */
+    } PoolClass_t;
+
+/**
+ * @brief Declare the storage of a size class. The blocks are aligned for any
+ * type, as with pvPortMalloc().
+ */
+    #define POOL_STORAGE( blockSize, blocks )    static uint64_t pool ## blockSize[ ( ( blockSize ) * ( blocks ) ) / sizeof( uint64_t ) ]
+
+    POOL_STORAGE( 32, MBEDTLS_FREERTOS_POOL_BLOCKS_32 );
+    POOL_STORAGE( 64, MBEDTLS_FREERTOS_POOL_BLOCKS_64 );
+    POOL_STORAGE( 128, MBEDTLS_FREERTOS_POOL_BLOCKS_128 );
+    POOL_STORAGE( 256, MBEDTLS_FREERTOS_POOL_BLOCKS_256 );
+    POOL_STORAGE( 512, MBEDTLS_FREERTOS_POOL_BLOCKS_512 );
+    POOL_STORAGE( 1024, MBEDTLS_FREERTOS_POOL_BLOCKS_1024 );
+
+/**
+ * @brief The size classes, from the smallest blocks to the largest.
+ */
+    static PoolClass_t poolClasses[ MBEDTLS_FREERTOS_POOL_CLASSES ] =
+    {
+        { ( uint8_t * ) pool32,   0U, NULL, { 32U,   MBEDTLS_FREERTOS_POOL_BLOCKS_32,   0U, 0U, 0U, 0U } },
+        { ( uint8_t * ) pool64,   0U, NULL, { 64U,   MBEDTLS_FREERTOS_POOL_BLOCKS_64,   0U, 0U, 0U, 0U } },
+        { ( uint8_t * ) pool128,  0U, NULL, { 128U,  MBEDTLS_FREERTOS_POOL_BLOCKS_128,  0U, 0U, 0U, 0U } },
+        { ( uint8_t * ) pool256,  0U, NULL, { 256U,  MBEDTLS_FREERTOS_POOL_BLOCKS_256,  0U, 0U, 0U, 0U } },
+        { ( uint8_t * ) pool512,  0U, NULL, { 512U,  MBEDTLS_FREERTOS_POOL_BLOCKS_512,  0U, 0U, 0U, 0U } },
+        { ( uint8_t * ) pool1024, 0U, NULL, { 1024U, MBEDTLS_FREERTOS_POOL_BLOCKS_1024, 0U, 0U, 0U, 0U } }
+    };
+
+/**
+ * @brief The use of the FreeRTOS heap by mbed TLS.
+ */
+    static mbedtls_platform_pool_stats_t poolHeapStats = { 0 };
+
+/**
+ * @brief pdFALSE to take all the allocations from the FreeRTOS heap.
+ */
+    static BaseType_t poolEnabled = pdTRUE;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Allocate a block of the smallest size class that fits, or from the
+ * FreeRTOS heap.
+ *
+ * @param[in] size The number of bytes to allocate, greater than 0.
+ *
+ * @return Pointer to the allocated memory, or NULL.
+ */
+    static void * poolMalloc( size_t size )
+    {
+        PoolClass_t * pClass = NULL;
+        void * pBuffer = NULL;
+        size_t i;
+
+        if( poolEnabled == pdTRUE )
+        {
+            for( i = 0U; ( i < MBEDTLS_FREERTOS_POOL_CLASSES ) && ( pClass == NULL ); i++ )
+            {
+                if( size <= poolClasses[ i ].stats.blockSize )
+                {
+                    pClass = &( poolClasses[ i ] );
+                }
+            }
+        }
+
+        if( pClass != NULL )
+        {
+            taskENTER_CRITICAL();
+            {
+                pClass->stats.allocations++;
+
+                if( pClass->pFreeList != NULL )
+                {
+                    pBuffer = pClass->pFreeList;
+                    pClass->pFreeList = pClass->pFreeList->pNext;
+                }
+                else if( pClass->unused < pClass->stats.blocks )
+                {
+                    pBuffer = &( pClass->pStorage[ pClass->unused * pClass->stats.blockSize ] );
+                    pClass->unused++;
+                }
+                else
+                {
+                    pClass->stats.fallbacks++;
+                }
+
+                if( pBuffer != NULL )
+                {
+                    pClass->stats.used++;
+
+                    if( pClass->stats.used > pClass->stats.highWater )
+                    {
+                        pClass->stats.highWater = pClass->stats.used;
+                    }
+                }
+            }
+            taskEXIT_CRITICAL();
+        }
+
+        if( pBuffer == NULL )
+        {
+            pBuffer = pvPortMalloc( size );
+
+            taskENTER_CRITICAL();
+            {
+                poolHeapStats.allocations++;
+
+                if( pBuffer != NULL )
+                {
+                    poolHeapStats.used++;
+
+                    if( poolHeapStats.used > poolHeapStats.highWater )
+                    {
+                        poolHeapStats.highWater = poolHeapStats.used;
+                    }
+                }
+            }
+            taskEXIT_CRITICAL();
+        }
+
+        return pBuffer;
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Free memory allocated by poolMalloc(), to the size class it was
+ * allocated from or to the FreeRTOS heap.
+ *
+ * @param[in] ptr Pointer to the memory to be freed, or NULL.
+ */
+    static void poolFree( void * ptr )
+    {
+        PoolClass_t * pClass = NULL;
+        uintptr_t address = ( uintptr_t ) ptr;
+        uintptr_t start;
+        size_t i;
+
+        for( i = 0U; ( i < MBEDTLS_FREERTOS_POOL_CLASSES ) && ( pClass == NULL ); i++ )
+        {
+            start = ( uintptr_t ) poolClasses[ i ].pStorage;
+
+            if( ( address >= start ) &&
+                ( address < ( start + ( poolClasses[ i ].stats.blocks * poolClasses[ i ].stats.blockSize ) ) ) )
+            {
+                pClass = &( poolClasses[ i ] );
+
+                /* The pointer must be that of a block. */
+                configASSERT( ( ( address - start ) % pClass->stats.blockSize ) == 0U );
+            }
+        }
+
+        if( pClass != NULL )
+        {
+            taskENTER_CRITICAL();
+            {
+                configASSERT( pClass->stats.used > 0U );
+
+                ( ( PoolBlock_t * ) ptr )->pNext = pClass->pFreeList;
+                pClass->pFreeList = ( PoolBlock_t * ) ptr;
+                pClass->stats.used--;
+            }
+            taskEXIT_CRITICAL();
+        }
+        else if( ptr != NULL )
+        {
+            vPortFree( ptr );
+
+            taskENTER_CRITICAL();
+            {
+                configASSERT( poolHeapStats.used > 0U );
+                poolHeapStats.used--;
+            }
+            taskEXIT_CRITICAL();
+        }
+        else
+        {
+            /* Empty else for MISRA 15.7 compliance. */
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    BaseType_t mbedtls_platform_pool_get_stats( size_t classIndex,
+                                                mbedtls_platform_pool_stats_t * pStats )
+    {
+        BaseType_t status = pdTRUE;
+
+        configASSERT( pStats != NULL );
+
+        taskENTER_CRITICAL();
+        {
+            if( classIndex < MBEDTLS_FREERTOS_POOL_CLASSES )
+            {
+                *pStats = poolClasses[ classIndex ].stats;
+            }
+            else if( classIndex == MBEDTLS_FREERTOS_POOL_CLASSES )
+            {
+                *pStats = poolHeapStats;
+            }
+            else
+            {
+                status = pdFALSE;
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        return status;
+    }
+
+/*-----------------------------------------------------------*/
+
+    void mbedtls_platform_pool_reset_high_water( void )
+    {
+        size_t i;
+
+        taskENTER_CRITICAL();
+        {
+            for( i = 0U; i < MBEDTLS_FREERTOS_POOL_CLASSES; i++ )
+            {
+                poolClasses[ i ].stats.highWater = poolClasses[ i ].stats.used;
+            }
+
+            poolHeapStats.highWater = poolHeapStats.used;
+        }
+        taskEXIT_CRITICAL();
+    }
+
+/*-----------------------------------------------------------*/
+
+    void mbedtls_platform_pool_enable( BaseType_t enable )
+    {
+        poolEnabled = enable;
+    }
+
+/*-----------------------------------------------------------*/
+
+#endif /* ifdef MBEDTLS_FREERTOS_POOL_ALLOCATOR */
+
 /**
  * @brief Allocates memory for an array of members.
  *
@@ -72,7 +334,11 @@ void * mbedtls_platform_calloc( size_t nmemb,
         /* Overflow check. */
         if( ( totalSize / size ) == nmemb )
         {
-            pBuffer = pvPortMalloc( totalSize );
+            #ifdef MBEDTLS_FREERTOS_POOL_ALLOCATOR
+                pBuffer = poolMalloc( totalSize );
+            #else
+                pBuffer = pvPortMalloc( totalSize );
+            #endif
 
             if( pBuffer != NULL )
             {
@@ -93,7 +359,11 @@ void * mbedtls_platform_calloc( size_t nmemb,
  */
 void mbedtls_platform_free( void * ptr )
 {
-    vPortFree( ptr );
+    #ifdef MBEDTLS_FREERTOS_POOL_ALLOCATOR
+        poolFree( ptr );
+    #else
+        vPortFree( ptr );
+    #endif
 }
 
 /*-----------------------------------------------------------*/
@@ -0,0 +1,522 @@
+/*
+ * FreeRTOS V202104.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/******************************************************************************
+ * Measures the overhead of the FreeRTOS+Trace recorder on the Linux port.
+ *
+ * The recorder mode and, in streaming mode, the stream port are selected when
+ * building, see the Makefile.  "make run-all" runs the snapshot recorder and
+ * the streaming recorder with the RAM and File stream ports.
+ *
+ * Each case calls a recorder entry point (or a kernel API function that is
+ * traced) benchITERATIONS times.  The calls are timed in chunks of
+ * benchCHUNK_EVENTS events and the median chunk is reported, which keeps
+ * the numbers stable when Linux preempts the simulator thread.  In streaming
+ * mode the benchmark task blocks for a tick between chunks, so the TzCtrl task
+ * can transfer the buffered events to the stream port and no events are
+ * dropped while the latency is measured.
+ *
+ * The cases are run with the recorder recording and with the recorder stopped.
+ * The cases that go through the kernel trace hooks are also run with a filter
+ * mask that excludes all objects (vTraceSetFilterMask( 0 )).  The filter mask
+ * is only checked by the hooks in trcKernelPort.h, the recorder entry points
+ * called directly by the other cases store their events regardless.  The
+ * "(empty loop)" case is the cost of the benchmark loop itself.
+ *
+ * In streaming mode the sustained throughput through the stream port is
+ * measured as well, by storing events back to back for benchTHROUGHPUT_MS
+ * and counting how many were dropped because TzCtrl could not keep up.
+ *
+ * NOTE: The numbers are host numbers and only meaningful relative to each
+ * other, e.g. to compare recorder configurations or recorder versions.
+ *******************************************************************************
+ */
+
+/* Standard includes. */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* FreeRTOS kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+/* Number of events stored per case and setting. */
+#ifndef benchITERATIONS
+    #define benchITERATIONS       100000UL
+#endif
+
+/* Number of events timed together, the median chunk is reported. */
+#ifndef benchCHUNK_EVENTS
+    #define benchCHUNK_EVENTS     500UL
+#endif
+
+/* Duration of each sustained throughput measurement (streaming only). */
+#ifndef benchTHROUGHPUT_MS
+    #define benchTHROUGHPUT_MS    100UL
+#endif
+
+/* Below TzCtrl, which runs at configMAX_PRIORITIES - 1 (see trcConfig.h). */
+#define benchTASK_PRIORITY        ( tskIDLE_PRIORITY + 1 )
+
+#define benchMAX_CHUNKS           ( ( benchITERATIONS + benchCHUNK_EVENTS - 1 ) / benchCHUNK_EVENTS )
+
+#if ( TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING )
+    #define benchMODE_NAME        "streaming"
+    #define benchTASK_HANDLE( x )    ( ( uint32_t ) ( uintptr_t ) ( x ) )
+    #define benchEVENT0_NAME      "prvTraceStoreEvent0"
+    #define benchEVENT1_NAME      "prvTraceStoreEvent1"
+    #define benchEVENT2_NAME      "prvTraceStoreEvent2"
+    #define benchEVENT3_NAME      "prvTraceStoreEvent3"
+#else
+    #define benchMODE_NAME        "snapshot"
+    #define benchTASK_HANDLE( x )    ( TRACE_GET_TASK_NUMBER( x ) )
+    #define benchEVENT0_NAME      "KernelCallWithNumericParam"
+    #define benchEVENT1_NAME      "KernelCall"
+    #define benchEVENT2_NAME      "KernelCallWithParam"
+    #define benchEVENT3_NAME      "KernelCallWithParam (XPS)"
+#endif
+
+/*-----------------------------------------------------------*/
+
+typedef struct BENCH_CASE
+{
+    const char * pcName;
+    uint32_t ulEventsPerCall;   /* Events stored by one call of pxFunction. */
+    BaseType_t xFilterMask;     /* pdTRUE to also run the case with filter mask 0. */
+    void ( * pxFunction )( uint32_t ulValue );
+} BenchCase_t;
+
+/* The benchmark task. */
+static void prvBenchmarkTask( void * pvParameters );
+
+/* Runs the cases with the current recorder setting, only those the filter
+ * mask applies to (and the empty loop) if xFilterMaskOnly is pdTRUE. */
+static void prvRunLatencyCases( const char * pcSetting,
+                                BaseType_t xFilterMaskOnly );
+
+#if ( TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING )
+    /* Stores events back to back and reports how many reached the stream port. */
+    static void prvRunThroughputCases( void );
+#endif
+
+/* Returns the median of the chunk durations, in ns per event. */
+static double prvMedianNanoseconds( uint32_t ulChunks );
+
+static uint64_t prvNanoseconds( void );
+
+/* The benchmarked operations. */
+static void prvEmptyLoop( uint32_t ulValue );
+static void prvStoreEvent0( uint32_t ulValue );
+static void prvStoreEvent1( uint32_t ulValue );
+static void prvStoreEvent2( uint32_t ulValue );
+static void prvStoreEvent3( uint32_t ulValue );
+static void prvStoreISR( uint32_t ulValue );
+static void prvStoreTaskSwitch( uint32_t ulValue );
+static void prvPrint( uint32_t ulValue );
+static void prvPrintF( uint32_t ulValue );
+static void prvPrintFCached( uint32_t ulValue );
+static void prvQueueSendReceive( uint32_t ulValue );
+
+/*-----------------------------------------------------------*/
+
+static const BenchCase_t xLatencyCases[] =
+{
+    { "(empty loop)",                 1, pdTRUE,  prvEmptyLoop        },
+    { benchEVENT0_NAME,               1, pdFALSE, prvStoreEvent0      },
+    { benchEVENT1_NAME,               1, pdFALSE, prvStoreEvent1      },
+    { benchEVENT2_NAME,               1, pdFALSE, prvStoreEvent2      },
+    { benchEVENT3_NAME,               1, pdFALSE, prvStoreEvent3      },
+    { "vTraceStoreISRBegin/End",      2, pdFALSE, prvStoreISR         },
+    { "task switch",                  1, pdFALSE, prvStoreTaskSwitch  },
+    { "vTracePrint",                  1, pdFALSE, prvPrint            },
+    { "vTracePrintF (1 arg)",         1, pdFALSE, prvPrintF           },
+    { "vTracePrintFCached (1 arg)",   1, pdFALSE, prvPrintFCached     },
+    { "xQueueSend/xQueueReceive",     2, pdTRUE,  prvQueueSendReceive }
+};
+
+#if ( TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING )
+    static const BenchCase_t xThroughputCases[] =
+    {
+        { benchEVENT2_NAME,           1, pdFALSE, prvStoreEvent2      },
+        { "vTracePrintF (1 arg)",     1, pdFALSE, prvPrintF           },
+        { "xQueueSend/xQueueReceive", 2, pdTRUE,  prvQueueSendReceive }
+    };
+
+    extern uint32_t DroppedEventCounter;
+#endif
+
+static QueueHandle_t xBenchQueue = NULL;
+static TaskHandle_t xBenchTask = NULL;
+static traceHandle xBenchISR = 0;
+static traceString xBenchChannel = 0;
+
+/* Keeps the compiler from optimizing the empty loop away. */
+static volatile uint32_t ulSink = 0;
+
+static double pdChunkNanoseconds[ benchMAX_CHUNKS ];
+
+/*-----------------------------------------------------------*/
+
+int main( void )
+{
+    /* Start the recorder before any kernel object is created, so the objects
+     * get their names and handles in the trace. */
+    vTraceEnable( TRC_START );
+
+    xBenchQueue = xQueueCreate( 1, sizeof( uint32_t ) );
+    configASSERT( xBenchQueue );
+    vTraceSetQueueName( xBenchQueue, "BenchQ" );
+
+    xTaskCreate( prvBenchmarkTask, "Bench", configMINIMAL_STACK_SIZE, NULL, benchTASK_PRIORITY, &xBenchTask );
+
+    vTaskStartScheduler();
+
+    /* Only reached if there was not enough heap to start the scheduler. */
+    for( ; ; )
+    {
+    }
+
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+static void prvBenchmarkTask( void * pvParameters )
+{
+    ( void ) pvParameters;
+
+    xBenchISR = xTraceSetISRProperties( "BenchISR", 1 );
+    xBenchChannel = xTraceRegisterString( "Bench" );
+
+    printf( "Trace recorder overhead, %s recorder", benchMODE_NAME );
+    #if ( TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING )
+        printf( ", %s stream port", benchSTREAM_PORT_NAME );
+    #endif
+    printf( "\n%lu events per case, median of %lu event chunks\n\n",
+            ( unsigned long ) benchITERATIONS, ( unsigned long ) benchCHUNK_EVENTS );
+    printf( "%-14s %-28s %10s %14s\n", "setting", "operation", "ns/event", "events/s" );
+
+    vTraceSetFilterMask( 0xFFFF );
+    prvRunLatencyCases( "recording", pdFALSE );
+
+    if( xTraceIsRecordingEnabled() == 0 )
+    {
+        /* The numbers above would be those of a stopped recorder. */
+        printf( "The recorder stopped: %s\n",
+                ( xTraceGetLastError() != NULL ) ? xTraceGetLastError() : "(no error)" );
+        exit( 1 );
+    }
+
+    #if ( TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING )
+        prvRunThroughputCases();
+    #endif
+
+    vTraceSetFilterMask( 0 );
+    prvRunLatencyCases( "filter mask 0", pdTRUE );
+
+    vTraceStop();
+    prvRunLatencyCases( "stopped", pdFALSE );
+
+    exit( 0 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvRunLatencyCases( const char * pcSetting,
+                                BaseType_t xFilterMaskOnly )
+{
+    uint32_t ulCase, ulChunk, ulCall, ulCalls;
+    uint32_t ulValue = 0;
+    uint64_t ullStart;
+    double dNanoseconds;
+
+    #if ( TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING )
+        uint32_t ulDroppedBefore;
+    #endif
+
+    for( ulCase = 0; ulCase < sizeof( xLatencyCases ) / sizeof( xLatencyCases[ 0 ] ); ulCase++ )
+    {
+        if( ( xFilterMaskOnly != pdFALSE ) && ( xLatencyCases[ ulCase ].xFilterMask == pdFALSE ) )
+        {
+            /* The filter mask does not apply to this case. */
+            continue;
+        }
+
+        ulCalls = benchCHUNK_EVENTS / xLatencyCases[ ulCase ].ulEventsPerCall;
+
+        #if ( TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING )
+            ulDroppedBefore = DroppedEventCounter;
+        #endif
+
+        for( ulChunk = 0; ulChunk < benchMAX_CHUNKS; ulChunk++ )
+        {
+            #if ( TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING )
+                /* Let TzCtrl empty the buffer. */
+                vTaskDelay( 1 );
+            #endif
+
+            ullStart = prvNanoseconds();
+
+            for( ulCall = 0; ulCall < ulCalls; ulCall++ )
+            {
+                xLatencyCases[ ulCase ].pxFunction( ulValue++ );
+            }
+
+            pdChunkNanoseconds[ ulChunk ] = ( double ) ( prvNanoseconds() - ullStart ) /
+                                            ( double ) ( ulCalls * xLatencyCases[ ulCase ].ulEventsPerCall );
+        }
+
+        if( xLatencyCases[ ulCase ].pxFunction == prvStoreTaskSwitch )
+        {
+            /* Leave the recorder with this task as the running task. */
+            prvStoreTaskSwitch( 0 );
+        }
+
+        dNanoseconds = prvMedianNanoseconds( benchMAX_CHUNKS );
+
+        printf( "%-14s %-28s %10.1f %14.0f\n", pcSetting, xLatencyCases[ ulCase ].pcName,
+                dNanoseconds, ( dNanoseconds > 0.0 ) ? 1.0e9 / dNanoseconds : 0.0 );
+
+        #if ( TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING )
+            if( DroppedEventCounter != ulDroppedBefore )
+            {
+                printf( "    warning: %lu events dropped, increase TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT\n",
+                        ( unsigned long ) ( DroppedEventCounter - ulDroppedBefore ) );
+            }
+        #endif
+    }
+
+    printf( "\n" );
+}
+/*-----------------------------------------------------------*/
+
+#if ( TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING )
+
+    static void prvRunThroughputCases( void )
+    {
+        uint32_t ulCase, ulEvents, ulDropped, ulDroppedBefore;
+        uint32_t ulValue = 0;
+        uint64_t ullStart, ullElapsed;
+        const uint64_t ullDuration = ( uint64_t ) benchTHROUGHPUT_MS * 1000000ULL;
+
+        printf( "Sustained throughput, %s stream port, %lu ms per case\n",
+                benchSTREAM_PORT_NAME, ( unsigned long ) benchTHROUGHPUT_MS );
+        printf( "%-28s %14s %14s %9s\n", "operation", "offered/s", "stored/s", "dropped" );
+
+        for( ulCase = 0; ulCase < sizeof( xThroughputCases ) / sizeof( xThroughputCases[ 0 ] ); ulCase++ )
+        {
+            /* Start with an empty buffer. */
+            vTaskDelay( 10 );
+
+            ulEvents = 0;
+            ulDroppedBefore = DroppedEventCounter;
+            ullStart = prvNanoseconds();
+
+            do
+            {
+                xThroughputCases[ ulCase ].pxFunction( ulValue++ );
+                ulEvents += xThroughputCases[ ulCase ].ulEventsPerCall;
+                ullElapsed = prvNanoseconds() - ullStart;
+            } while( ullElapsed < ullDuration );
+
+            ulDropped = DroppedEventCounter - ulDroppedBefore;
+
+            printf( "%-28s %14.0f %14.0f %8.1f%%\n", xThroughputCases[ ulCase ].pcName,
+                    ( double ) ulEvents * 1.0e9 / ( double ) ullElapsed,
+                    ( double ) ( ulEvents - ulDropped ) * 1.0e9 / ( double ) ullElapsed,
+                    100.0 * ( double ) ulDropped / ( double ) ulEvents );
+        }
+
+        /* Let TzCtrl catch up before the next measurements. */
+        vTaskDelay( 10 );
+        printf( "\n" );
+    }
+
+#endif /* ( TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING ) */
+/*-----------------------------------------------------------*/
+
+static int prvCompareDouble( const void * pvA, const void * pvB )
+{
+    double dA = *( const double * ) pvA;
+    double dB = *( const double * ) pvB;
+
+    return ( dA > dB ) - ( dA < dB );
+}
+/*-----------------------------------------------------------*/
+
+static double prvMedianNanoseconds( uint32_t ulChunks )
+{
+    qsort( pdChunkNanoseconds, ulChunks, sizeof( pdChunkNanoseconds[ 0 ] ), prvCompareDouble );
+
+    return pdChunkNanoseconds[ ulChunks / 2 ];
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvNanoseconds( void )
+{
+    struct timespec xNow;
+
+    clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( uint64_t ) xNow.tv_sec * 1000000000ULL + ( uint64_t ) xNow.tv_nsec;
+}
+/*-----------------------------------------------------------*/
+
+static void prvEmptyLoop( uint32_t ulValue )
+{
+    ulSink = ulValue;
+}
+/*-----------------------------------------------------------*/
+
+#if ( TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING )
+
+    static void prvStoreEvent0( uint32_t ulValue )
+    {
+        ( void ) ulValue;
+        prvTraceStoreEvent0( PSF_EVENT_IFE_NEXT );
+    }
+
+    static void prvStoreEvent1( uint32_t ulValue )
+    {
+        prvTraceStoreEvent1( PSF_EVENT_TASK_DELAY, ulValue );
+    }
+
+    static void prvStoreEvent2( uint32_t ulValue )
+    {
+        prvTraceStoreEvent2( PSF_EVENT_QUEUE_SEND, ( uint32_t ) ( uintptr_t ) xBenchQueue, ulValue );
+    }
+
+    static void prvStoreEvent3( uint32_t ulValue )
+    {
+        prvTraceStoreEvent3( PSF_EVENT_QUEUE_RECEIVE, ( uint32_t ) ( uintptr_t ) xBenchQueue, 0, ulValue );
+    }
+
+    static void prvStoreTaskSwitch( uint32_t ulValue )
+    {
+        /* What traceTASK_SWITCHED_IN stores, alternating between two tasks
+         * so prvIsNewTCB reports a switch every time. */
+        void * pvTCB = ( ulValue & 1 ) ? ( void * ) xTaskGetIdleTaskHandle() : ( void * ) xBenchTask;
+
+        if( prvIsNewTCB( pvTCB ) )
+        {
+            prvTraceStoreEvent2( PSF_EVENT_TASK_ACTIVATE, benchTASK_HANDLE( pvTCB ), ( ulValue & 1 ) ? tskIDLE_PRIORITY : benchTASK_PRIORITY );
+        }
+    }
+
+#else /* ( TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING ) */
+
+    /* The snapshot recorder has no generic event functions, so the kernel
+     * call functions used by the same hooks are measured instead. */
+
+    static void prvStoreEvent0( uint32_t ulValue )
+    {
+        prvTraceStoreKernelCallWithNumericParamOnly( TASK_DELAY, ulValue );
+    }
+
+    static void prvStoreEvent1( uint32_t ulValue )
+    {
+        ( void ) ulValue;
+        prvTraceStoreKernelCall( EVENTGROUP_SEND_TRCSUCCESS + TRACE_CLASS_QUEUE, TRACE_CLASS_QUEUE,
+                                 TRACE_GET_OBJECT_NUMBER( QUEUE, xBenchQueue ) );
+    }
+
+    static void prvStoreEvent2( uint32_t ulValue )
+    {
+        prvTraceStoreKernelCallWithParam( EVENTGROUP_RECEIVE_TRCSUCCESS + TRACE_CLASS_QUEUE, TRACE_CLASS_QUEUE,
+                                          TRACE_GET_OBJECT_NUMBER( QUEUE, xBenchQueue ), ulValue );
+    }
+
+    static void prvStoreEvent3( uint32_t ulValue )
+    {
+        /* A parameter too large for the event is stored in an extra XPS
+         * event, which is the most expensive kernel call. */
+        prvTraceStoreKernelCallWithParam( EVENTGROUP_RECEIVE_TRCSUCCESS + TRACE_CLASS_QUEUE, TRACE_CLASS_QUEUE,
+                                          TRACE_GET_OBJECT_NUMBER( QUEUE, xBenchQueue ), ulValue | 0x10000UL );
+    }
+
+    static void prvStoreTaskSwitch( uint32_t ulValue )
+    {
+        /* A switch to the task that is already logged is not stored, so
+         * alternate between two tasks. */
+        void * pvTCB = ( ulValue & 1 ) ? ( void * ) xTaskGetIdleTaskHandle() : ( void * ) xBenchTask;
+
+        prvTraceStoreTaskswitch( benchTASK_HANDLE( pvTCB ) );
+    }
+
+#endif /* ( TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING ) */
+/*-----------------------------------------------------------*/
+
+static void prvStoreISR( uint32_t ulValue )
+{
+    ( void ) ulValue;
+    vTraceStoreISRBegin( xBenchISR );
+    vTraceStoreISREnd( 0 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvPrint( uint32_t ulValue )
+{
+    ( void ) ulValue;
+    vTracePrint( xBenchChannel, "Bench" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvPrintF( uint32_t ulValue )
+{
+    vTracePrintF( xBenchChannel, "Value %d", ( int ) ulValue );
+}
+/*-----------------------------------------------------------*/
+
+static void prvPrintFCached( uint32_t ulValue )
+{
+    vTracePrintFCached( xBenchChannel, "Value %d", ( int ) ulValue );
+}
+/*-----------------------------------------------------------*/
+
+static void prvQueueSendReceive( uint32_t ulValue )
+{
+    uint32_t ulReceived;
+
+    xQueueSend( xBenchQueue, &ulValue, 0 );
+    xQueueReceive( xBenchQueue, &ulReceived, 0 );
+}
+/*-----------------------------------------------------------*/
+
+unsigned long ulGetRunTimeCounterValue( void )
+{
+    /* 100 kHz, as TRC_HWTC_FREQ_HZ of the recorder's Win32 hardware port. */
+    return ( unsigned long ) ( prvNanoseconds() / 10000ULL );
+}
+/*-----------------------------------------------------------*/
+
+void vAssertCalled( const char * const pcFileName,
+                    unsigned long ulLine )
+{
+    printf( "ASSERT! Line %lu, file %s\n", ulLine, pcFileName );
+    abort();
+}
+/*-----------------------------------------------------------*/
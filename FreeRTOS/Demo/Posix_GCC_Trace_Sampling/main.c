@@ -0,0 +1,323 @@
+/*
+ * FreeRTOS V202104.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/******************************************************************************
+ * Profiles a small application with the sampling mode of the FreeRTOS+Trace
+ * recorder (TRC_RECORDER_MODE_SAMPLING, see trcConfig.h).
+ *
+ * The recorder's Win32 hardware port, used for the Linux port, calls
+ * vConfigureTimerForTraceSampling() from vTraceEnable().  Here that starts an
+ * ITIMER_PROF timer, so SIGPROF is delivered to the thread that is using the
+ * CPU, i.e. the running task.  The signal handler passes the program counter
+ * of the interrupted code to vTraceSample(), which counts it together with
+ * the running task in a histogram that the TzCtrl task reports periodically.
+ *
+ * Three tasks share the CPU: prvCrunchTask does floating point work, and
+ * prvProducerTask sends buffers to prvConsumerTask through a queue.  After
+ * mainRUN_TIME_MS the trace is stopped and the program exits.  The trace is
+ * written to trace.psf by the File stream port, "make profile" prints the
+ * profile with tools/trace_recorder/psf_profile.py.
+ *
+ * NOTE: The events still in the recorder's paged event buffer when the trace
+ * is stopped are not written, so the last report or two may be missing.
+ *******************************************************************************
+ */
+
+/* Standard includes. */
+#define _GNU_SOURCE    /* For the register names in ucontext.h. */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/time.h>
+#include <ucontext.h>
+
+/* FreeRTOS kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+/* How long to profile the application. */
+#ifndef mainRUN_TIME_MS
+    #define mainRUN_TIME_MS       5000UL
+#endif
+
+#define mainBUFFER_WORDS          256
+#define mainQUEUE_LENGTH          4
+
+/* The application tasks share the CPU by time slicing. */
+#define mainTASK_PRIORITY         ( tskIDLE_PRIORITY + 1 )
+
+/* Above the application tasks, below TzCtrl (see trcConfig.h). */
+#define mainCONTROL_PRIORITY      ( configMAX_PRIORITIES - 2 )
+
+/* The program counter of the interrupted code, from the signal context. */
+#if defined( __x86_64__ )
+    #define mainSIGNAL_PC( pxContext )    ( ( uintptr_t ) ( pxContext )->uc_mcontext.gregs[ REG_RIP ] )
+#elif defined( __i386__ )
+    #define mainSIGNAL_PC( pxContext )    ( ( uintptr_t ) ( pxContext )->uc_mcontext.gregs[ REG_EIP ] )
+#elif defined( __aarch64__ )
+    #define mainSIGNAL_PC( pxContext )    ( ( uintptr_t ) ( pxContext )->uc_mcontext.pc )
+#else
+    #warning "The program counter is not known for this architecture, only the tasks are profiled."
+    #define mainSIGNAL_PC( pxContext )    ( ( uintptr_t ) 0 )
+#endif
+
+/*-----------------------------------------------------------*/
+
+static void prvCrunchTask( void * pvParameters );
+static void prvProducerTask( void * pvParameters );
+static void prvConsumerTask( void * pvParameters );
+static void prvControlTask( void * pvParameters );
+
+/* The profiled functions, not inlined so they show up in the profile. */
+static double prvCrunch( uint32_t ulRounds ) __attribute__( ( noinline ) );
+static void prvFillBuffer( uint32_t * pulBuffer, uint32_t ulSeed ) __attribute__( ( noinline ) );
+static uint32_t prvChecksum( const uint32_t * pulBuffer ) __attribute__( ( noinline ) );
+
+static void prvSampleHandler( int iSignal,
+                              siginfo_t * pxInfo,
+                              void * pvContext );
+
+static uint64_t prvNanoseconds( void );
+
+/*-----------------------------------------------------------*/
+
+static QueueHandle_t xBufferQueue = NULL;
+
+/* Keeps the results, so the work is not optimized away. */
+static volatile double dResult;
+static volatile uint32_t ulResult;
+
+/* The number of SIGPROF signals, i.e. of calls to vTraceSample(). */
+static volatile uint32_t ulSamples = 0;
+
+/*-----------------------------------------------------------*/
+
+int main( void )
+{
+    /* Start the recorder before any kernel object is created, so the objects
+     * get their names and handles in the trace.  This also starts the
+     * sampling timer, see vConfigureTimerForTraceSampling(). */
+    vTraceEnable( TRC_START );
+
+    xBufferQueue = xQueueCreate( mainQUEUE_LENGTH, sizeof( uint32_t * ) );
+    configASSERT( xBufferQueue );
+    vTraceSetQueueName( xBufferQueue, "Buffers" );
+
+    xTaskCreate( prvCrunchTask, "Crunch", configMINIMAL_STACK_SIZE, NULL, mainTASK_PRIORITY, NULL );
+    xTaskCreate( prvProducerTask, "Producer", configMINIMAL_STACK_SIZE, NULL, mainTASK_PRIORITY, NULL );
+    xTaskCreate( prvConsumerTask, "Consumer", configMINIMAL_STACK_SIZE, NULL, mainTASK_PRIORITY, NULL );
+    xTaskCreate( prvControlTask, "Control", configMINIMAL_STACK_SIZE, NULL, mainCONTROL_PRIORITY, NULL );
+
+    vTaskStartScheduler();
+
+    /* Only reached if there was not enough heap to start the scheduler. */
+    for( ; ; )
+    {
+    }
+
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+static void prvCrunchTask( void * pvParameters )
+{
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        dResult = prvCrunch( 100000UL );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvProducerTask( void * pvParameters )
+{
+    static uint32_t ulBuffers[ mainQUEUE_LENGTH + 2 ][ mainBUFFER_WORDS ];
+    uint32_t ulNext = 0;
+    uint32_t * pulBuffer;
+
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        /* The consumer can hold one buffer and the queue the others. */
+        pulBuffer = ulBuffers[ ulNext ];
+        ulNext = ( ulNext + 1 ) % ( mainQUEUE_LENGTH + 2 );
+
+        prvFillBuffer( pulBuffer, ulNext );
+        xQueueSend( xBufferQueue, &pulBuffer, portMAX_DELAY );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvConsumerTask( void * pvParameters )
+{
+    uint32_t * pulBuffer;
+
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        if( xQueueReceive( xBufferQueue, &pulBuffer, portMAX_DELAY ) == pdPASS )
+        {
+            ulResult = prvChecksum( pulBuffer );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvControlTask( void * pvParameters )
+{
+    ( void ) pvParameters;
+
+    vTaskDelay( pdMS_TO_TICKS( mainRUN_TIME_MS ) );
+
+    printf( "%lu samples in %lu ms\n", ( unsigned long ) ulSamples, ( unsigned long ) mainRUN_TIME_MS );
+
+    if( xTraceGetLastError() != NULL )
+    {
+        printf( "Recorder error: %s\n", xTraceGetLastError() );
+    }
+
+    vTraceStop();
+    exit( 0 );
+}
+/*-----------------------------------------------------------*/
+
+static double prvCrunch( uint32_t ulRounds )
+{
+    double dX = 1.0;
+    uint32_t ul;
+
+    for( ul = 0; ul < ulRounds; ul++ )
+    {
+        dX = dX * 1.0000001 + 0.5 / ( dX + 1.0 );
+    }
+
+    return dX;
+}
+/*-----------------------------------------------------------*/
+
+static void prvFillBuffer( uint32_t * pulBuffer,
+                           uint32_t ulSeed )
+{
+    uint32_t ulRound, ulWord;
+
+    /* A few rounds of a xorshift generator, to make this the heavier half. */
+    for( ulRound = 0; ulRound < 64; ulRound++ )
+    {
+        for( ulWord = 0; ulWord < mainBUFFER_WORDS; ulWord++ )
+        {
+            ulSeed ^= ulSeed << 13;
+            ulSeed ^= ulSeed >> 17;
+            ulSeed ^= ulSeed << 5;
+            pulBuffer[ ulWord ] = ulSeed;
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvChecksum( const uint32_t * pulBuffer )
+{
+    uint32_t ulSum = 0;
+    uint32_t ulWord;
+
+    for( ulWord = 0; ulWord < mainBUFFER_WORDS; ulWord++ )
+    {
+        ulSum = ( ulSum << 1 | ulSum >> 31 ) ^ pulBuffer[ ulWord ];
+    }
+
+    return ulSum;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSampleHandler( int iSignal,
+                              siginfo_t * pxInfo,
+                              void * pvContext )
+{
+    ( void ) iSignal;
+    ( void ) pxInfo;
+
+    ulSamples++;
+
+    /* Only the low 32 bits of a 64-bit address are stored.  The trace also
+     * has the address of vTraceSample, which psf_profile.py uses to map them
+     * back to the symbols of the executable. */
+    vTraceSample( ( uint32_t ) mainSIGNAL_PC( ( ucontext_t * ) pvContext ) );
+}
+/*-----------------------------------------------------------*/
+
+void vConfigureTimerForTraceSampling( uint32_t ulRateHz )
+{
+    struct sigaction xAction;
+    struct itimerval xTimer;
+    int iResult;
+
+    memset( &xAction, 0, sizeof( xAction ) );
+    xAction.sa_sigaction = prvSampleHandler;
+    xAction.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset( &xAction.sa_mask );
+    iResult = sigaction( SIGPROF, &xAction, NULL );
+    configASSERT( iResult == 0 );
+
+    /* ITIMER_PROF counts the CPU time of the process, and the signal goes to
+     * the thread that used it.  Only the thread of the running task uses CPU
+     * time in the Linux port, so the samples are taken in the running task. */
+    xTimer.it_interval.tv_sec = 0;
+    xTimer.it_interval.tv_usec = ( suseconds_t ) ( 1000000UL / ulRateHz );
+    xTimer.it_value = xTimer.it_interval;
+    iResult = setitimer( ITIMER_PROF, &xTimer, NULL );
+    configASSERT( iResult == 0 );
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvNanoseconds( void )
+{
+    struct timespec xNow;
+
+    clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( uint64_t ) xNow.tv_sec * 1000000000ULL + ( uint64_t ) xNow.tv_nsec;
+}
+/*-----------------------------------------------------------*/
+
+unsigned long ulGetRunTimeCounterValue( void )
+{
+    /* 100 kHz, as TRC_HWTC_FREQ_HZ of the recorder's Win32 hardware port. */
+    return ( unsigned long ) ( prvNanoseconds() / 10000ULL );
+}
+/*-----------------------------------------------------------*/
+
+void vAssertCalled( const char * const pcFileName,
+                    unsigned long ulLine )
+{
+    printf( "ASSERT! Line %lu, file %s\n", ulLine, pcFileName );
+    abort();
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,66 @@
+"""
+Reading the preamble of streaming traces (PSF format), as written by
+trcStreamingRecorder.c: the header, symbol table, object data table and
+extension info. The events follow at Preamble.events_offset.
+"""
+
+import struct
+
+PSF_IDENTIFIER = 0x50534600
+HEADER_SIZE = 24
+
+
+class FormatError(Exception):
+    pass
+
+
+class Preamble:
+    pass
+
+
+def read_preamble(data):
+    """ Parses the PSF preamble, returns a Preamble object """
+    if len(data) < HEADER_SIZE:
+        raise FormatError("file too short for a PSF header")
+
+    trace = Preamble()
+    if struct.unpack_from("<I", data, 0)[0] == PSF_IDENTIFIER:
+        trace.endian = "<"
+    elif struct.unpack_from(">I", data, 0)[0] == PSF_IDENTIFIER:
+        trace.endian = ">"
+    else:
+        raise FormatError("not a PSF trace (bad identifier)")
+
+    (_, trace.version, trace.platform, trace.options, trace.heap_counter,
+     trace.symbol_size, trace.symbol_count, trace.object_data_size,
+     trace.object_data_count) = struct.unpack_from(trace.endian + "IHHIIHHHH", data, 0)
+
+    pos = HEADER_SIZE
+
+    trace.symbols = {}
+    for _ in range(trace.symbol_count):
+        address, = struct.unpack_from(trace.endian + "I", data, pos)
+        name = data[pos + 4:pos + trace.symbol_size].split(b"\0", 1)[0]
+        if address != 0:
+            trace.symbols[address] = name.decode("ascii", "replace")
+        pos += trace.symbol_size
+
+    trace.object_data = {}
+    for _ in range(trace.object_data_count):
+        address, value = struct.unpack_from(trace.endian + "II", data, pos)
+        if address != 0:
+            trace.object_data[address] = value
+        pos += trace.object_data_size
+
+    # PSFExtensionInfoType
+    entry_count, trace.extension_base_code = struct.unpack_from(trace.endian + "HH", data, pos)
+    pos += 4
+    if entry_count > 0:
+        _, entry_size = struct.unpack_from("BB", data, pos)
+        pos += 2 + entry_count * entry_size
+
+    if pos > len(data):
+        raise FormatError("file too short for the PSF preamble")
+
+    trace.events_offset = pos
+    return trace
@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""
+Converts a streaming trace recorded with TRC_CFG_COMPACT_EVENT_FORMAT = 1
+into the regular PSF format, that can be opened in Tracealyzer.
+
+The header, symbol table, object data table, extension info and the
+start-up events (TRACE_START, TS_CONFIG and, in sampling mode,
+SAMPLING_CONFIG) are stored in the regular format also in compact traces.
+The events that follow are compact records, starting with a sync record,
+see prvTraceStoreCompactEvent in trcStreamingRecorder.c.
+
+Usage: python psf_compact_decode.py trace.psf trace_decoded.psf
+"""
+
+import argparse
+import struct
+import sys
+
+import psf
+
+PSF_COMPACT_FORMAT_FLAG = 0x8000
+
+COMPACT_FLAG_GAP = 0x01
+COMPACT_FLAG_RAW = 0x02
+COMPACT_SYNC_HEADER = 0
+COMPACT_PREDICTORS = 4
+SYNC_RECORD_SIZE = 7
+
+
+class DecodeError(Exception):
+    pass
+
+
+class CompactDecoder:
+    """ Mirrors the encoder state in trcStreamingRecorder.c """
+
+    def __init__(self, data, offset, endian):
+        self.data = data
+        self.pos = offset
+        self.endian = endian
+        self.last_ts = 0
+        self.last_count = 0
+        self.last_param = [0] * COMPACT_PREDICTORS
+        self.synced = False
+        self.records = 0
+        self.syncs = 0
+
+    def varint(self):
+        value = 0
+        shift = 0
+        while True:
+            if self.pos >= len(self.data):
+                raise DecodeError("truncated varint at offset %d" % self.pos)
+            byte = self.data[self.pos]
+            self.pos += 1
+            value |= (byte & 0x7F) << shift
+            if byte < 0x80:
+                return value
+            shift += 7
+            if shift > 35:
+                raise DecodeError("bad varint at offset %d" % self.pos)
+
+    def param(self, predictor):
+        code = self.varint()
+        if code & 1:
+            zigzag = code >> 1
+            delta = (zigzag >> 1) ^ (-(zigzag & 1) & 0xFFFFFFFF)
+            return (predictor + delta) & 0xFFFFFFFF
+        return (code >> 1) & 0xFFFFFFFF
+
+    def sync(self):
+        if self.pos + SYNC_RECORD_SIZE - 1 > len(self.data):
+            raise DecodeError("truncated sync record at offset %d" % self.pos)
+        # Sync fields are little endian regardless of the target
+        ts, count = struct.unpack_from("<IH", self.data, self.pos)
+        self.pos += SYNC_RECORD_SIZE - 1
+        self.last_ts = ts
+        self.last_count = count
+        self.last_param = [0] * COMPACT_PREDICTORS
+        self.synced = True
+        self.syncs += 1
+
+    def records_iter(self):
+        """ Yields the events as regular PSF event records """
+        while self.pos < len(self.data):
+            start = self.pos
+            header = self.varint()
+            if header == COMPACT_SYNC_HEADER:
+                self.sync()
+                continue
+
+            if not self.synced:
+                raise DecodeError("record before first sync at offset %d" % start)
+
+            code = header >> 6
+            nparam = (header >> 2) & 0xF
+            flags = header & 0x3
+
+            gap = self.varint() if flags & COMPACT_FLAG_GAP else 0
+            count = (self.last_count + 1 + gap) & 0xFFFF
+            ts = (self.last_ts + self.varint()) & 0xFFFFFFFF
+
+            if flags & COMPACT_FLAG_RAW:
+                size = nparam * 4
+                if self.pos + size > len(self.data):
+                    raise DecodeError("truncated record at offset %d" % start)
+                payload = self.data[self.pos:self.pos + size]
+                self.pos += size
+            else:
+                params = []
+                for i in range(nparam):
+                    slot = min(i, COMPACT_PREDICTORS - 1)
+                    params.append(self.param(self.last_param[slot]))
+                for i, value in enumerate(params):
+                    self.last_param[min(i, COMPACT_PREDICTORS - 1)] = value
+                payload = struct.pack(self.endian + "%dI" % nparam, *params)
+
+            self.last_ts = ts
+            self.last_count = count
+            self.records += 1
+
+            event_id = (nparam << 12) | code
+            yield struct.pack(self.endian + "HHI", event_id, count, ts) + payload
+
+
+def decode(data):
+    """ Returns the regular PSF data and a tuple of statistics """
+    trace = psf.read_preamble(data)
+
+    if not trace.version & PSF_COMPACT_FORMAT_FLAG:
+        raise DecodeError("not a compact trace (already regular PSF?)")
+
+    out = bytearray(data[:trace.events_offset])
+    version_offset = 4
+    struct.pack_into(trace.endian + "H", out, version_offset,
+                     trace.version & ~PSF_COMPACT_FORMAT_FLAG)
+
+    # The start-up events are regular events. Their number depends on the
+    # recorder mode, so they are copied up to the first sync record, which is
+    # a zero byte. A regular start-up event never starts with one, as it has
+    # parameters and a non-zero event code.
+    pos = trace.events_offset
+    while pos < len(data) and data[pos] != COMPACT_SYNC_HEADER:
+        if pos + 2 > len(data):
+            raise DecodeError("truncated start-up event at offset %d" % pos)
+        event_id, = struct.unpack_from(trace.endian + "H", data, pos)
+        size = 8 + 4 * (event_id >> 12)
+        out += data[pos:pos + size]
+        pos += size
+
+    decoder = CompactDecoder(data, pos, trace.endian)
+    for record in decoder.records_iter():
+        out += record
+
+    return bytes(out), (len(data), len(out), decoder.records, decoder.syncs)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("input", help="compact trace (.psf)")
+    parser.add_argument("output", help="regular trace to write (.psf)")
+    args = parser.parse_args()
+
+    with open(args.input, "rb") as f:
+        data = f.read()
+
+    try:
+        out, stats = decode(data)
+    except (DecodeError, psf.FormatError) as e:
+        print("%s: %s" % (args.input, e), file=sys.stderr)
+        return 1
+
+    with open(args.output, "wb") as f:
+        f.write(out)
+
+    compact_size, regular_size, records, syncs = stats
+    print("%d events, %d sync records, %d -> %d bytes (%.2fx)"
+          % (records, syncs, compact_size, regular_size,
+             regular_size / float(max(compact_size, 1))))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
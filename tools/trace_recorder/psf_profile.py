@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+"""
+Prints the CPU profile from a trace of the recorder's sampling mode.
+
+In sampling mode (TRC_RECORDER_MODE_SAMPLING in trcConfig.h), a timer calls
+vTraceSample at a fixed rate and the recorder counts the running task or ISR
+together with the program counter, which the TzCtrl task stores as PC_SAMPLES
+events. This sums up the samples per task and ISR, and per code location.
+
+With --elf, the locations are mapped to the functions of the executable, as
+listed by nm. The trace has the address of vTraceSample, so executables that
+were loaded at another address (position independent) are handled, as are
+program counters that were stored as the low 32 bits of 64-bit addresses.
+
+Usage: python psf_profile.py trace.psf [--elf build/app] [--top 20]
+"""
+
+import argparse
+import bisect
+import subprocess
+import sys
+
+import psf
+import psf_compact_decode
+import trace_analyze
+
+# HANDLE_NO_TASK in trcStreamingRecorder.c, i.e. before the scheduler started
+HANDLE_NO_TASK = 2
+
+CONTEXT_NO_TASK = "(no task)"
+CONTEXT_LOST = "(lost)"
+
+
+class Symbols:
+    """ The functions of an executable, from nm """
+
+    def __init__(self, path, nm="nm"):
+        output = subprocess.run([nm, "--defined-only", "-n", "-S", path],
+                                check=True, stdout=subprocess.PIPE,
+                                universal_newlines=True).stdout
+        self.addresses = []
+        self.sizes = []
+        self.names = []
+        self.reference = None
+        for line in output.splitlines():
+            # Functions have a size, which leaves out labels such as _start
+            fields = line.split()
+            if len(fields) < 4 or fields[2] not in "TtWw":
+                continue
+            address = int(fields[0], 16)
+            if fields[3] == "vTraceSample":
+                self.reference = address
+            self.addresses.append(address & 0xFFFFFFFF)
+            self.sizes.append(int(fields[1], 16))
+            self.names.append(fields[3])
+
+    def lookup(self, address):
+        """ Returns the function containing address as name+offset, or the address """
+        i = bisect.bisect_right(self.addresses, address) - 1
+        if i < 0 or address - self.addresses[i] >= self.sizes[i]:
+            return "0x%08X" % address
+        return "%s+0x%X" % (self.names[i], address - self.addresses[i])
+
+
+def read_samples(data):
+    """ Returns the sampling configuration and the samples, summed per (context, pc) """
+    reader = trace_analyze.StreamingReader(data)
+    samples = {}
+    for _, kind, arg in reader.events():
+        if kind == trace_analyze.EV_SAMPLES:
+            context, pc, count = arg
+            if context is None:
+                key = (CONTEXT_LOST, None)
+            elif context == reader.name(HANDLE_NO_TASK):
+                key = (CONTEXT_NO_TASK, pc)
+            else:
+                key = (context, pc)
+            samples[key] = samples.get(key, 0) + count
+    return reader.sampling, samples
+
+
+def print_profile(sampling, samples, symbols, top):
+    total = sum(samples.values())
+    if total == 0:
+        print("no samples in the trace (not recorded in sampling mode?)")
+        return
+
+    rate, pc_shift, reference = sampling if sampling else (0, 0, 0)
+
+    # Maps a stored program counter to an address of the executable
+    bias = 0
+    if symbols is not None and symbols.reference is not None and sampling:
+        bias = (reference - symbols.reference) & 0xFFFFFFFF
+
+    def location(pc):
+        if pc is None:
+            return "-"
+        if symbols is None:
+            return "0x%08X" % pc
+        return symbols.lookup((pc - bias) & 0xFFFFFFFF)
+
+    if rate:
+        print("%d samples at %d Hz (%.1f s of CPU time), PC resolution %d bytes"
+              % (total, rate, float(total) / rate, 1 << pc_shift))
+    else:
+        print("%d samples" % total)
+
+    per_context = {}
+    per_location = {}
+    for (context, pc), count in samples.items():
+        per_context[context] = per_context.get(context, 0) + count
+        key = (context, location(pc))
+        per_location[key] = per_location.get(key, 0) + count
+
+    print("\n%7s %9s  %s" % ("share", "samples", "task / ISR"))
+    for context, count in sorted(per_context.items(), key=lambda item: -item[1]):
+        print("%6.1f%% %9d  %s" % (100.0 * count / total, count, context))
+
+    print("\n%7s %9s  %-20s %s" % ("share", "samples", "task / ISR", "location"))
+    ranked = sorted(per_location.items(), key=lambda item: -item[1])
+    for (context, where), count in ranked[:top]:
+        print("%6.1f%% %9d  %-20s %s" % (100.0 * count / total, count, context, where))
+    if len(ranked) > top:
+        print("(%d more locations, see --top)" % (len(ranked) - top))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("trace", help="streaming trace (.psf) recorded in sampling mode")
+    parser.add_argument("--elf", help="the traced executable, to map the locations to functions")
+    parser.add_argument("--nm", default="nm", help="the nm to use for --elf, e.g. arm-none-eabi-nm")
+    parser.add_argument("--top", type=int, default=20, help="number of locations to print")
+    args = parser.parse_args()
+
+    with open(args.trace, "rb") as f:
+        data = f.read()
+
+    try:
+        sampling, samples = read_samples(data)
+    except (psf.FormatError, psf_compact_decode.DecodeError) as e:
+        print("%s: %s" % (args.trace, e), file=sys.stderr)
+        return 1
+
+    symbols = None
+    if args.elf:
+        try:
+            symbols = Symbols(args.elf, args.nm)
+        except (OSError, subprocess.CalledProcessError) as e:
+            print("%s: %s" % (args.elf, e), file=sys.stderr)
+            return 1
+        if symbols.reference is None:
+            print("%s: no vTraceSample, the addresses are not relocated" % args.elf, file=sys.stderr)
+
+    print_profile(sampling, samples, symbols, args.top)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
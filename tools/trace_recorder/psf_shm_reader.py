@@ -0,0 +1,214 @@
+#!/usr/bin/env python3
+"""
+Drains the shared memory ring of the POSIX_SHM stream port to a file.
+
+The recorder (streamports/POSIX_SHM/trcStreamingPort.c) publishes the trace
+data into a POSIX shared memory object and only waits for this reader if it
+falls behind by the whole ring, so the traced application runs at full speed.
+The output is a regular (or compact) PSF stream, the same as the File stream
+port would have written. Use "-" as output to pipe the stream into another
+tool for live analysis.
+
+Usage: python psf_shm_reader.py --wait trace.psf
+"""
+
+import argparse
+import mmap
+import os
+import struct
+import sys
+import time
+
+SHM_MAGIC = 0x48535254
+SHM_VERSION = 1
+
+STATE_IDLE = 0
+STATE_TRACING = 1
+STATE_STOPPED = 2
+
+# Field offsets in TraceShmRing, native byte order
+OFS_MAGIC = 0
+OFS_VERSION = 4
+OFS_SIZE = 8
+OFS_DATA_OFFSET = 12
+OFS_HEAD = 16
+OFS_WRITER_STATE = 20
+OFS_WRITER_PID = 24
+OFS_SESSION = 28
+OFS_DROPPED_BYTES = 32
+OFS_FULL_WAITS = 36
+OFS_TAIL = 64
+OFS_READER_PID = 68
+HEADER_SIZE = 128
+
+
+class RingError(Exception):
+    pass
+
+
+def shm_path(name):
+    return os.path.join("/dev/shm", name.lstrip("/"))
+
+
+def process_alive(pid):
+    if pid == 0:
+        return False
+    try:
+        os.kill(pid, 0)
+    except ProcessLookupError:
+        return False
+    except PermissionError:
+        pass
+    return True
+
+
+class ShmRing:
+    """ The reader side of TraceShmRing """
+
+    def __init__(self, name):
+        fd = os.open(shm_path(name), os.O_RDWR)
+        try:
+            total = os.fstat(fd).st_size
+            if total < HEADER_SIZE:
+                raise RingError("%s is not initialized" % name)
+            self.mem = mmap.mmap(fd, total)
+        finally:
+            os.close(fd)
+
+        if self.get(OFS_MAGIC) != SHM_MAGIC:
+            self.mem.close()
+            raise RingError("%s is not initialized" % name)
+        if self.get(OFS_VERSION) != SHM_VERSION:
+            self.mem.close()
+            raise RingError("%s has unsupported version %d"
+                            % (name, self.get(OFS_VERSION)))
+
+        self.size = self.get(OFS_SIZE)
+        self.data_offset = self.get(OFS_DATA_OFFSET)
+        if self.data_offset + self.size > total:
+            self.mem.close()
+            raise RingError("%s is truncated" % name)
+
+    def get(self, offset):
+        return struct.unpack_from("=I", self.mem, offset)[0]
+
+    def put(self, offset, value):
+        struct.pack_into("=I", self.mem, offset, value & 0xFFFFFFFF)
+
+    def attach(self):
+        self.put(OFS_READER_PID, os.getpid())
+
+    def detach(self):
+        self.put(OFS_READER_PID, 0)
+        self.mem.close()
+
+    def read(self):
+        """ Returns the bytes published since the last call """
+        head = self.get(OFS_HEAD)
+        tail = self.get(OFS_TAIL)
+        count = (head - tail) & 0xFFFFFFFF
+        if count == 0:
+            return b""
+        if count > self.size:
+            raise RingError("ring corrupted (head %u, tail %u)" % (head, tail))
+
+        start = self.data_offset + (tail & (self.size - 1))
+        first = min(count, self.data_offset + self.size - start)
+        chunk = self.mem[start:start + first]
+        if first < count:
+            chunk += self.mem[self.data_offset:self.data_offset + count - first]
+
+        self.put(OFS_TAIL, tail + count)
+        return chunk
+
+    def writer_gone(self):
+        return not process_alive(self.get(OFS_WRITER_PID))
+
+
+def open_ring(name, wait, poll):
+    while True:
+        try:
+            ring = ShmRing(name)
+            if not ring.writer_gone():
+                return ring
+            ring.mem.close()
+            if not wait:
+                raise RingError("%s is left over from an exited recorder" % name)
+        except (FileNotFoundError, RingError):
+            if not wait:
+                raise
+        time.sleep(poll)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("output", help="trace file to write (.psf), or - for stdout")
+    parser.add_argument("--name", default="/trace_recorder",
+                        help="shared memory name (TRC_CFG_STREAM_PORT_SHM_NAME)")
+    parser.add_argument("--wait", action="store_true",
+                        help="wait for the recorder to create the ring")
+    parser.add_argument("--follow", action="store_true",
+                        help="keep reading when the recording is stopped")
+    parser.add_argument("--stats", type=float, default=0, metavar="SECONDS",
+                        help="print throughput and ring fill level periodically")
+    parser.add_argument("--poll", type=float, default=0.001, metavar="SECONDS",
+                        help="how long to sleep when the ring is empty")
+    args = parser.parse_args()
+
+    try:
+        ring = open_ring(args.name, args.wait, args.poll)
+    except (FileNotFoundError, RingError) as e:
+        print("%s: %s" % (args.name, e), file=sys.stderr)
+        return 1
+
+    out = sys.stdout.buffer if args.output == "-" else open(args.output, "wb")
+    ring.attach()
+
+    total = 0
+    last_total = 0
+    last_stats = time.monotonic()
+    try:
+        while True:
+            chunk = ring.read()
+            if chunk:
+                out.write(chunk)
+                total += len(chunk)
+            else:
+                state = ring.get(OFS_WRITER_STATE)
+                if ring.writer_gone() or (state == STATE_STOPPED and not args.follow):
+                    # The recorder publishes before changing state, read once more
+                    chunk = ring.read()
+                    out.write(chunk)
+                    total += len(chunk)
+                    break
+                out.flush()
+                time.sleep(args.poll)
+
+            now = time.monotonic()
+            if args.stats > 0 and now - last_stats >= args.stats:
+                fill = (ring.get(OFS_HEAD) - ring.get(OFS_TAIL)) & 0xFFFFFFFF
+                print("%.1f kB/s, ring %d%% full, %d full waits, %d bytes dropped"
+                      % ((total - last_total) / 1024.0 / (now - last_stats),
+                         100 * fill // ring.size, ring.get(OFS_FULL_WAITS),
+                         ring.get(OFS_DROPPED_BYTES)), file=sys.stderr)
+                last_total = total
+                last_stats = now
+    except KeyboardInterrupt:
+        pass
+    finally:
+        dropped = ring.get(OFS_DROPPED_BYTES)
+        sessions = ring.get(OFS_SESSION)
+        ring.detach()
+        out.flush()
+        if out is not sys.stdout.buffer:
+            out.close()
+
+    print("%d bytes read, %d recording sessions" % (total, sessions), file=sys.stderr)
+    if dropped:
+        print("warning: the recorder dropped %d bytes while no reader was attached"
+              % dropped, file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
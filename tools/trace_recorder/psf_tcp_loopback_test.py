@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+"""
+Loopback test of the TCPIP stream port, against a FreeRTOS simulator.
+
+Connects to the recorder (streamports/TCPIP/trcStreamingPort.c, built with
+TRC_CFG_STREAM_PORT_TCP_BSD_SOCKETS, e.g. FreeRTOS/Demo/Posix_GCC with
+make TRACE_STREAMPORT=TCPIP), reads the trace for a while and checks that it
+is a valid PSF stream. Reading can be paused (--stall) or throttled (--rate),
+so that the stream port's staging ring fills up and the recorder has to
+handle the backpressure. The test fails if the stream is corrupt, or if more
+events were dropped than allowed by --max-dropped.
+
+Usage: python psf_tcp_loopback_test.py --stall 2 --duration 10 -o trace.psf
+"""
+
+import argparse
+import socket
+import sys
+import time
+
+import psf
+import psf_compact_decode
+import trace_analyze
+
+CMD_SET_ACTIVE = 1
+
+# The text of PSF_WARNING_STREAM_PORT_BACKPRESSURE, see prvTraceGetError
+BACKPRESSURE_WARNING = b"Stream port backpressure"
+
+
+def command(code, param1):
+    """ Returns a TracealyzerCommandType """
+    checksum = (0xFFFF - (code + param1)) & 0xFFFF
+    return bytes((code, param1, 0, 0, 0, 0, checksum & 0xFF, checksum >> 8))
+
+
+def connect(host, port, wait):
+    deadline = time.monotonic() + wait
+    while True:
+        try:
+            return socket.create_connection((host, port), timeout=1.0)
+        except OSError:
+            if time.monotonic() >= deadline:
+                raise
+            time.sleep(0.1)
+
+
+def receive(sock, args):
+    """ Reads the stream as set by the arguments, returns the data """
+    data = bytearray()
+    start = time.monotonic()
+    stall_end = start + args.stall_after + args.stall
+    sock.settimeout(0.1)
+
+    while True:
+        now = time.monotonic()
+        if now - start >= args.duration:
+            break
+
+        if args.stall > 0 and start + args.stall_after <= now < stall_end:
+            # Not reading lets the socket buffers and then the staging ring fill up
+            time.sleep(stall_end - now)
+            continue
+
+        if args.rate > 0 and len(data) > args.rate * (now - start):
+            time.sleep(0.01)
+            continue
+
+        try:
+            chunk = sock.recv(65536)
+        except socket.timeout:
+            continue
+        if not chunk:
+            break
+        data += chunk
+
+    return bytes(data)
+
+
+def check(data, max_dropped):
+    """ Validates the stream, returns a list of problems (empty if none) """
+    problems = []
+
+    reader = trace_analyze.StreamingReader(data)
+    events = 0
+    dropped = 0
+    gaps = 0
+    for _, kind, arg in reader.events():
+        if kind == trace_analyze.EV_GAP:
+            gaps += 1
+            dropped += arg
+        else:
+            events += 1
+
+    print("%d bytes, %d events, %d dropped in %d gaps, %d recording sessions"
+          % (len(data), events, dropped, gaps, reader.sessions))
+
+    if BACKPRESSURE_WARNING in data:
+        print("the recorder reported backpressure and sampled the kernel calls")
+
+    if events == 0:
+        problems.append("no events received")
+    if max_dropped >= 0 and dropped > max_dropped:
+        problems.append("%d events dropped, at most %d allowed" % (dropped, max_dropped))
+    return problems
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=12000, help="TRC_TCPIP_PORT")
+    parser.add_argument("--wait", type=float, default=10, metavar="SECONDS",
+                        help="how long to retry connecting")
+    parser.add_argument("--start", action="store_true",
+                        help="send the start command, for vTraceEnable(TRC_START_AWAIT_HOST)")
+    parser.add_argument("--duration", type=float, default=5, metavar="SECONDS",
+                        help="how long to read the trace")
+    parser.add_argument("--stall", type=float, default=0, metavar="SECONDS",
+                        help="pause reading for this long, to cause backpressure")
+    parser.add_argument("--stall-after", type=float, default=1, metavar="SECONDS",
+                        help="when to pause reading")
+    parser.add_argument("--rate", type=float, default=0, metavar="BYTES_PER_SECOND",
+                        help="limit the reading rate")
+    parser.add_argument("--max-dropped", type=int, default=-1, metavar="EVENTS",
+                        help="fail if more events were dropped (default: no limit)")
+    parser.add_argument("-o", "--output", help="also write the trace to this file")
+    args = parser.parse_args()
+
+    try:
+        sock = connect(args.host, args.port, args.wait)
+    except OSError as e:
+        print("%s:%d: %s" % (args.host, args.port, e), file=sys.stderr)
+        return 1
+
+    with sock:
+        if args.start:
+            sock.sendall(command(CMD_SET_ACTIVE, 1))
+        data = receive(sock, args)
+
+    if args.output:
+        with open(args.output, "wb") as f:
+            f.write(data)
+
+    try:
+        problems = check(data, args.max_dropped)
+    except (psf.FormatError, psf_compact_decode.DecodeError) as e:
+        problems = [str(e)]
+
+    for problem in problems:
+        print("FAIL: %s" % problem, file=sys.stderr)
+    if problems:
+        return 1
+    print("PASS")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,811 @@
+#!/usr/bin/env python3
+"""
+Computes scheduling and kernel object statistics from a recorded trace.
+
+Reads both streaming traces (.psf, as written by the File, POSIX_SHM and
+other stream ports, regular or compact format) and snapshot traces (a dump of
+RecorderDataType, e.g. Trace.dump from Demo/Posix_GCC). The result is written
+as JSON or CSV, so that the numbers from two builds can be diffed directly:
+
+ - CPU time and share per task and ISR, context switch rate
+ - ISR durations, and the latency from an ISR readying a task until it runs
+ - Ready-to-running latency and blocking time histograms per task
+ - Operations, failures, blocking and blocked time per queue, semaphore,
+   mutex, event group, stream buffer and message buffer
+ - Windows with dropped events (streaming) or overwritten events (snapshot)
+
+Usage: python trace_analyze.py trace.psf [--format csv] [-o out.csv]
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+import psf
+import psf_compact_decode
+
+# Normalized events, produced by the readers and consumed by Analyzer
+EV_SWITCH = "switch"        # task starts or resumes executing
+EV_ISR_BEGIN = "isr_begin"
+EV_ISR_RESUME = "isr_resume"  # return to an interrupted (nested) ISR
+EV_READY = "ready"
+EV_BLOCK = "block"          # the running task blocks on an object, or delays
+EV_OP = "op"                # an operation on a kernel object
+EV_GAP = "gap"              # events were lost before this point
+EV_SAMPLES = "samples"      # sampling mode histogram entry: (context, pc, count)
+
+RESULT_OK = "ok"
+RESULT_FAIL = "failed"
+RESULT_BLOCK = "blocked"
+
+CLASS_DELAY = "delay"
+
+
+class TraceError(Exception):
+    pass
+
+
+###############################################################################
+# Streaming traces (PSF)
+###############################################################################
+
+PSF_EVENT_TRACE_START = 0x01
+PSF_EVENT_TS_CONFIG = 0x02
+PSF_EVENT_OBJ_NAME = 0x03
+PSF_EVENT_DEFINE_ISR = 0x07
+PSF_EVENT_TASK_READY = 0x30
+PSF_EVENT_ISR_BEGIN = 0x33
+PSF_EVENT_ISR_RESUME = 0x34
+PSF_EVENT_TS_BEGIN = 0x35
+PSF_EVENT_TS_RESUME = 0x36
+PSF_EVENT_TASK_ACTIVATE = 0x37
+PSF_EVENT_TASK_DELAY_UNTIL = 0x79
+PSF_EVENT_TASK_DELAY = 0x7A
+PSF_EVENT_TASK_SUSPEND = 0x7B
+PSF_EVENT_SAMPLING_CONFIG = 0xEB
+PSF_EVENT_PC_SAMPLES = 0xEC
+
+PSF_CREATE_CLASSES = {
+    0x10: "task", 0x11: "queue", 0x12: "semaphore", 0x13: "mutex",
+    0x14: "timer", 0x15: "eventgroup", 0x16: "semaphore", 0x17: "mutex",
+    0x18: "streambuffer", 0x19: "messagebuffer",
+}
+
+
+def psf_op_table():
+    """ Maps PSF event codes (trcKernelPort.h) to (class, result, from ISR) """
+    table = {}
+    qsm = ("queue", "semaphore", "mutex")
+    for base, result, isr in ((0x50, RESULT_OK, False), (0x53, RESULT_FAIL, False),
+                              (0x56, RESULT_BLOCK, False), (0x60, RESULT_OK, False),
+                              (0x63, RESULT_FAIL, False), (0x66, RESULT_BLOCK, False),
+                              (0x70, RESULT_OK, False), (0x73, RESULT_FAIL, False),
+                              (0x76, RESULT_BLOCK, False)):
+        for i, cls in enumerate(qsm):
+            table[base + i] = (cls, result, isr)
+    for base, result in ((0x59, RESULT_OK), (0x5C, RESULT_FAIL),
+                         (0x69, RESULT_OK), (0x6C, RESULT_FAIL)):
+        table[base] = ("queue", result, True)
+        table[base + 1] = ("semaphore", result, True)
+    table.update({
+        0xC0: ("queue", RESULT_OK, False), 0xC1: ("queue", RESULT_FAIL, False),
+        0xC2: ("queue", RESULT_BLOCK, False), 0xC3: ("queue", RESULT_OK, True),
+        0xC4: ("queue", RESULT_FAIL, True),
+        0xC5: ("mutex", RESULT_OK, False), 0xC6: ("mutex", RESULT_FAIL, False),
+        0xC7: ("mutex", RESULT_OK, False), 0xC8: ("mutex", RESULT_FAIL, False),
+        0xB0: ("eventgroup", RESULT_OK, False), 0xB1: ("eventgroup", RESULT_OK, False),
+        0xB2: ("eventgroup", RESULT_OK, False), 0xB3: ("eventgroup", RESULT_OK, True),
+        0xB4: ("eventgroup", RESULT_OK, False), 0xB5: ("eventgroup", RESULT_OK, True),
+        0xB6: ("eventgroup", RESULT_BLOCK, False), 0xB7: ("eventgroup", RESULT_BLOCK, False),
+        0xB8: ("eventgroup", RESULT_FAIL, False), 0xB9: ("eventgroup", RESULT_FAIL, False),
+    })
+    for base, cls in ((0xD3, "streambuffer"), (0xDE, "messagebuffer")):
+        results = ((RESULT_OK, False), (RESULT_BLOCK, False), (RESULT_FAIL, False),
+                   (RESULT_OK, False), (RESULT_BLOCK, False), (RESULT_FAIL, False),
+                   (RESULT_OK, True), (RESULT_FAIL, True), (RESULT_OK, True),
+                   (RESULT_FAIL, True))
+        for i, (result, isr) in enumerate(results):
+            table[base + i] = (cls, result, isr)
+    # Task notifications block on the task itself
+    table.update({
+        0xCB: ("notify", RESULT_BLOCK, False), 0xCC: ("notify", RESULT_FAIL, False),
+        0xCE: ("notify", RESULT_BLOCK, False), 0xCF: ("notify", RESULT_FAIL, False),
+    })
+    return table
+
+
+PSF_OPS = psf_op_table()
+
+
+class StreamingReader:
+    """ Reads a PSF trace into normalized events """
+
+    kind = "psf"
+
+    def __init__(self, data):
+        trace = psf.read_preamble(data)
+        if trace.version & psf_compact_decode.PSF_COMPACT_FORMAT_FLAG:
+            data, _ = psf_compact_decode.decode(data)
+            trace = psf.read_preamble(data)
+
+        self.data = data
+        self.trace = trace
+        self.endian = trace.endian
+        self.names = dict(trace.symbols)
+        self.classes = {}
+        self.frequency = 0
+        self.overwritten = False
+        self.error = None
+        self.sessions = 1
+        self.sampling = None        # (rate in Hz, PC shift, address of vTraceSample)
+
+    def name(self, handle):
+        name = self.names.get(handle)
+        if name is None:
+            return "0x%08X" % handle
+        return name
+
+    def string_at(self, pos, end):
+        return self.data[pos:end].split(b"\0", 1)[0].decode("ascii", "replace")
+
+    def events(self):
+        data = self.data
+        endian = self.endian
+        pos = self.trace.events_offset
+        last_count = None
+        base_ts = None
+        last_ts = 0
+        wraps = 0
+        current = None
+
+        while pos + 8 <= len(data):
+            if struct.unpack_from(endian + "I", data, pos)[0] == psf.PSF_IDENTIFIER:
+                # A new recording session appended to the same file
+                self.sessions += 1
+                break
+
+            event_id, count, ts = struct.unpack_from(endian + "HHI", data, pos)
+            nparam = event_id >> 12
+            code = event_id & 0xFFF
+            end = pos + 8 + 4 * nparam
+            if end > len(data):
+                break
+            params = struct.unpack_from(endian + "%dI" % nparam, data, pos + 8)
+            pos = end
+
+            if ts < last_ts and base_ts is not None:
+                wraps += 1
+            last_ts = ts
+            if base_ts is None:
+                base_ts = ts
+            t = ts + (wraps << 32) - base_ts
+
+            if last_count is not None:
+                missing = (count - last_count - 1) & 0xFFFF
+                if missing:
+                    yield (t, EV_GAP, missing)
+            last_count = count
+
+            if code == PSF_EVENT_TS_CONFIG and nparam >= 1:
+                self.frequency = params[0]
+            elif code == PSF_EVENT_TRACE_START and nparam >= 2:
+                current = params[1]
+                if current:
+                    yield (t, EV_SWITCH, self.name(current))
+            elif code == PSF_EVENT_OBJ_NAME and nparam >= 1:
+                self.names[params[0]] = self.string_at(pos - 4 * (nparam - 1), pos)
+            elif code == PSF_EVENT_DEFINE_ISR and nparam >= 2:
+                self.names[params[0]] = self.string_at(pos - 4 * (nparam - 2), pos)
+            elif code in PSF_CREATE_CLASSES and nparam >= 1:
+                self.classes[params[0]] = PSF_CREATE_CLASSES[code]
+            elif code == PSF_EVENT_SAMPLING_CONFIG and nparam >= 3:
+                self.sampling = params[:3]
+            elif code == PSF_EVENT_PC_SAMPLES and nparam >= 3:
+                # Context 0 counts the samples that found the histogram full
+                context = self.name(params[0]) if params[0] else None
+                yield (t, EV_SAMPLES, (context, params[1], params[2]))
+            elif nparam == 0:
+                continue
+            elif code in (PSF_EVENT_TASK_ACTIVATE, PSF_EVENT_TS_RESUME, PSF_EVENT_TS_BEGIN):
+                current = params[0]
+                yield (t, EV_SWITCH, self.name(current))
+            elif code == PSF_EVENT_ISR_BEGIN:
+                yield (t, EV_ISR_BEGIN, self.name(params[0]))
+            elif code == PSF_EVENT_ISR_RESUME:
+                yield (t, EV_ISR_RESUME, self.name(params[0]))
+            elif code == PSF_EVENT_TASK_READY:
+                yield (t, EV_READY, self.name(params[0]))
+            elif code in (PSF_EVENT_TASK_DELAY, PSF_EVENT_TASK_DELAY_UNTIL):
+                yield (t, EV_BLOCK, (CLASS_DELAY, "delay"))
+            elif code == PSF_EVENT_TASK_SUSPEND:
+                if params[0] == current:
+                    yield (t, EV_BLOCK, (CLASS_DELAY, "suspend"))
+            elif code in PSF_OPS:
+                cls, result, isr = PSF_OPS[code]
+                obj = (self.classes.get(params[0], cls), self.name(params[0]))
+                yield (t, EV_OP, (obj, result, isr))
+                if result == RESULT_BLOCK:
+                    yield (t, EV_BLOCK, obj)
+
+
+###############################################################################
+# Snapshot traces (RecorderDataType)
+###############################################################################
+
+SNAPSHOT_START_MARKER = bytes((0x01, 0x02, 0x03, 0x04, 0x71, 0x72, 0x73, 0x74,
+                               0xF1, 0xF2, 0xF3, 0xF4))
+TRACE_KERNEL_VERSION = 0x1AA1
+TRACE_NCLASSES = 9
+
+SNAPSHOT_CLASSES = ("queue", "semaphore", "mutex", "task", "isr", "timer",
+                    "eventgroup", "streambuffer", "messagebuffer")
+CLASS_TASK = 3
+CLASS_ISR = 4
+
+DIV_XPS = 0x01
+DIV_TASK_READY = 0x02
+TS_ISR_BEGIN = 0x04
+TS_ISR_RESUME = 0x05
+TS_TASK_BEGIN = 0x06
+TS_TASK_RESUME = 0x07
+OBJCLOSE_NAME = 0x08
+TASK_DELAY_UNTIL = 0x88
+TASK_DELAY = 0x89
+TASK_SUSPEND = 0x8A
+USER_EVENT = 0x98
+XTS8 = 0xA8
+XTS16 = 0xA9
+XID = 0xAE
+
+# Where the differential timestamp of each event code is stored
+DTS_NONE = 0
+DTS16 = 1       # bytes 2-3, handle in byte 1 (TSEvent, KernelCall, ...)
+DTS8_B1 = 2     # byte 1 (KernelCallWithParam16, UserEvent, MemEventSize)
+DTS8_B3 = 3     # byte 3 (KernelCallWithParamAndHandle, TaskInstanceStatusEvent)
+
+
+def snapshot_dts_layout():
+    layout = [DTS16] * 256
+    none = [0x00, DIV_XPS, 0x95, 0x97, 0xE9, XTS8, XTS16, 0xAA, 0xAB, XID, 0xAF]
+    none += list(range(0x08, 0x18)) + list(range(0xE4, 0xE8))
+    for code in none:
+        layout[code] = DTS_NONE
+    b1 = [0x03, TASK_DELAY_UNTIL, TASK_DELAY, 0x94, 0x96, 0xB9, 0xC3, 0xE8]
+    b1 += list(range(0x40, 0x48)) + list(range(USER_EVENT, USER_EVENT + 16))
+    for code in b1:
+        layout[code] = DTS8_B1
+    b3 = [0x8D, 0x8E, 0x8F, 0xEA] + list(range(0xB1, 0xB5)) + list(range(0xB6, 0xB9))
+    b3 += list(range(0xBA, 0xC2)) + list(range(0xC4, 0xCB)) + list(range(0xCC, 0xD2))
+    b3 += list(range(0xD3, 0xD9))
+    for code in b3:
+        layout[code] = DTS8_B3
+    return layout
+
+
+def snapshot_op_table():
+    """ Maps snapshot event codes to (class index, result, from ISR) """
+    table = {}
+    # Lower three bits: queue, semaphore, mutex, stream buffer, message buffer,
+    # queue send to front
+    group_class = (0, 1, 2, 7, 8, 0)
+    for base, result, isr in ((0x20, RESULT_OK, False), (0x28, RESULT_OK, False),
+                              (0x30, RESULT_OK, True), (0x38, RESULT_OK, True),
+                              (0x48, RESULT_FAIL, False), (0x50, RESULT_FAIL, False),
+                              (0x58, RESULT_FAIL, True), (0x60, RESULT_FAIL, True),
+                              (0x68, RESULT_BLOCK, False), (0x70, RESULT_BLOCK, False),
+                              (0x78, RESULT_OK, False)):
+        for i, cls in enumerate(group_class):
+            table[base + i] = (cls, result, isr)
+    for i in range(3):
+        table[0xDC + i] = (i, RESULT_BLOCK, False)
+        table[0xDF + i] = (i, RESULT_FAIL, False)
+    table.update({
+        0xC4: (6, RESULT_BLOCK, False), 0xC5: (6, RESULT_OK, False),
+        0xC6: (6, RESULT_BLOCK, False), 0xC7: (6, RESULT_OK, False),
+        0xC8: (6, RESULT_OK, False), 0xC9: (6, RESULT_OK, True),
+        0xCA: (6, RESULT_OK, False), 0xCC: (6, RESULT_FAIL, False),
+        0xCD: (6, RESULT_FAIL, False), 0xCE: (6, RESULT_OK, True),
+        0xCF: (6, RESULT_FAIL, True),
+        0xD4: ("notify", RESULT_BLOCK, False), 0xD5: ("notify", RESULT_FAIL, False),
+        0xD7: ("notify", RESULT_BLOCK, False), 0xD8: ("notify", RESULT_FAIL, False),
+    })
+    return table
+
+
+SNAPSHOT_DTS = snapshot_dts_layout()
+SNAPSHOT_OPS = snapshot_op_table()
+
+
+class SnapshotReader:
+    """ Reads a snapshot trace (RecorderDataType) into normalized events """
+
+    kind = "snapshot"
+
+    def __init__(self, data):
+        if data[:12] != SNAPSHOT_START_MARKER:
+            raise TraceError("not a snapshot trace (bad start marker)")
+
+        if struct.unpack_from("<H", data, 12)[0] == TRACE_KERNEL_VERSION:
+            self.endian = "<"
+        elif struct.unpack_from(">H", data, 12)[0] == TRACE_KERNEL_VERSION:
+            self.endian = ">"
+        else:
+            raise TraceError("unsupported kernel version in snapshot trace")
+
+        self.data = data
+        (self.num_events, self.max_events, self.next_free_index, buffer_full,
+         self.frequency) = self.u32s(20, 5)
+        self.overwritten = buffer_full != 0
+        self.sessions = 1
+
+        pos = 84
+        if self.u32s(pos, 1)[0] != 0xF0F0F0F0:
+            raise TraceError("bad debug marker 0")
+        is16bit, nclasses, table_size = self.u32s(pos + 4, 3)
+        if nclasses != TRACE_NCLASSES:
+            raise TraceError("unexpected number of object classes (%d)" % nclasses)
+        pos += 16
+
+        if is16bit:
+            objects_per_class = struct.unpack_from(self.endian + "%dH" % nclasses, data, pos)
+            pos += 2 * 2 * ((nclasses + 1) // 2)
+        else:
+            objects_per_class = struct.unpack_from("%dB" % nclasses, data, pos)
+            pos += 4 * ((nclasses + 3) // 4)
+        name_len = struct.unpack_from("%dB" % nclasses, data, pos)
+        pos += 4 * ((nclasses + 3) // 4)
+        prop_bytes = struct.unpack_from("%dB" % nclasses, data, pos)
+        pos += 4 * ((nclasses + 3) // 4)
+        start_index = struct.unpack_from(self.endian + "%dH" % nclasses, data, pos)
+        pos += 2 * 2 * ((nclasses + 1) // 2)
+        objbytes = pos
+        pos += 4 * ((table_size + 3) // 4)
+
+        self.names = {}
+        for cls in range(nclasses):
+            for handle in range(1, objects_per_class[cls] + 1):
+                offset = objbytes + start_index[cls] + (handle - 1) * prop_bytes[cls]
+                name = self.cstring(offset, offset + name_len[cls])
+                if name:
+                    self.names[(cls, handle)] = name
+
+        if self.u32s(pos, 1)[0] != 0xF1F1F1F1:
+            raise TraceError("bad debug marker 1")
+        sym_size, = self.u32s(pos + 4, 1)
+        self.symbols = pos + 12
+        pos = self.symbols + 4 * ((sym_size + 3) // 4) + 2 * 64
+
+        _, internal_error, marker2 = self.u32s(pos, 3)
+        if marker2 != 0xF2F2F2F2:
+            raise TraceError("bad debug marker 2")
+        self.error = self.cstring(pos + 12, pos + 92) if internal_error else None
+        pos += 92
+        if self.u32s(pos, 1)[0] != 0xF3F3F3F3:
+            raise TraceError("bad debug marker 3")
+        self.event_data = pos + 4
+        if self.event_data + 4 * self.max_events > len(data):
+            raise TraceError("file too short for the event buffer")
+
+    def u32s(self, pos, n):
+        return struct.unpack_from(self.endian + "%dI" % n, self.data, pos)
+
+    def cstring(self, start, end):
+        return self.data[start:end].split(b"\0", 1)[0].decode("ascii", "replace")
+
+    def name(self, cls, handle):
+        name = self.names.get((cls, handle))
+        if name is None:
+            return "%s #%d" % (SNAPSHOT_CLASSES[cls], handle)
+        return name
+
+    def records(self):
+        """ Yields (time, code, handle, raw record) of the stored events """
+        data = self.data
+        if self.overwritten:
+            order = list(range(self.next_free_index, self.max_events))
+            order += list(range(0, self.next_free_index))
+        else:
+            order = range(0, min(self.next_free_index, self.max_events))
+
+        t = 0
+        xts = 0
+        xid = None
+        skip = 0
+        for index in order:
+            pos = self.event_data + 4 * index
+            if skip:
+                skip -= 1
+                continue
+            code = data[pos]
+            layout = SNAPSHOT_DTS[code]
+
+            if code == XTS8:
+                xts = (data[pos + 1] << 24) | (struct.unpack_from(self.endian + "H", data, pos + 2)[0] << 8)
+                continue
+            if code == XTS16:
+                xts = struct.unpack_from(self.endian + "H", data, pos + 2)[0] << 16
+                continue
+            if code == XID:
+                xid = struct.unpack_from(self.endian + "H", data, pos + 2)[0]
+                continue
+            if layout == DTS_NONE:
+                yield (t, code, data[pos + 1], data[pos:pos + 4])
+                continue
+
+            if layout == DTS16:
+                dts = struct.unpack_from(self.endian + "H", data, pos + 2)[0]
+            elif layout == DTS8_B1:
+                dts = data[pos + 1]
+            else:
+                dts = data[pos + 3]
+            t += xts | dts
+            xts = 0
+
+            handle = data[pos + 1]
+            if xid is not None and handle == 255:
+                handle = xid
+            xid = None
+
+            if USER_EVENT < code < USER_EVENT + 16:
+                skip = code - USER_EVENT
+
+            yield (t, code, handle, data[pos:pos + 4])
+
+    def events(self):
+        # Names of deleted objects are given by the close events, which come
+        # after the last use of the handle. Resolve them backwards.
+        records = list(self.records())
+        names = dict(self.names)
+        resolved = []
+        for t, code, handle, raw in reversed(records):
+            if OBJCLOSE_NAME <= code < OBJCLOSE_NAME + 8:
+                symbol, = struct.unpack_from(self.endian + "H", raw, 2)
+                names[(code - OBJCLOSE_NAME, handle)] = self.cstring(
+                    self.symbols + symbol + 4, self.symbols + symbol + 64)
+            resolved.append(names)
+        resolved.reverse()
+
+        current = None
+        for (t, code, handle, raw), names in zip(records, resolved):
+            self.names = names
+            if code in (TS_TASK_BEGIN, TS_TASK_RESUME):
+                current = handle
+                yield (t, EV_SWITCH, self.name(CLASS_TASK, handle))
+            elif code == TS_ISR_BEGIN:
+                yield (t, EV_ISR_BEGIN, self.name(CLASS_ISR, handle))
+            elif code == TS_ISR_RESUME:
+                yield (t, EV_ISR_RESUME, self.name(CLASS_ISR, handle))
+            elif code == DIV_TASK_READY:
+                yield (t, EV_READY, self.name(CLASS_TASK, handle))
+            elif code in (TASK_DELAY, TASK_DELAY_UNTIL):
+                yield (t, EV_BLOCK, (CLASS_DELAY, "delay"))
+            elif code == TASK_SUSPEND:
+                if handle == current:
+                    yield (t, EV_BLOCK, (CLASS_DELAY, "suspend"))
+            elif code in SNAPSHOT_OPS:
+                cls, result, isr = SNAPSHOT_OPS[code]
+                if cls == "notify":
+                    obj = ("notify", self.name(CLASS_TASK, handle))
+                else:
+                    obj = (SNAPSHOT_CLASSES[cls], self.name(cls, handle))
+                yield (t, EV_OP, (obj, result, isr))
+                if result == RESULT_BLOCK:
+                    yield (t, EV_BLOCK, obj)
+
+
+def open_trace(data):
+    if data[:12] == SNAPSHOT_START_MARKER:
+        return SnapshotReader(data)
+    try:
+        return StreamingReader(data)
+    except psf.FormatError as e:
+        raise TraceError("neither a snapshot nor a streaming trace (%s)" % e)
+
+
+###############################################################################
+# Analysis
+###############################################################################
+
+class Distribution:
+    """ Count, min, mean, max and a log2 histogram of durations """
+
+    def __init__(self):
+        self.values = []
+
+    def add(self, value):
+        self.values.append(value)
+
+    def summary(self, scale):
+        if not self.values:
+            return {"count": 0}
+        values = [v * scale for v in self.values]
+        histogram = {}
+        for value in values:
+            bound = 1
+            while value > bound:
+                bound *= 2
+            histogram[bound] = histogram.get(bound, 0) + 1
+        return {
+            "count": len(values),
+            "total": round(sum(values), 3),
+            "min": round(min(values), 3),
+            "mean": round(sum(values) / len(values), 3),
+            "max": round(max(values), 3),
+            "histogram": dict(("le_%d" % bound, histogram[bound])
+                              for bound in sorted(histogram)),
+        }
+
+
+class Analyzer:
+
+    def __init__(self):
+        self.task_time = {}
+        self.isr_time = {}
+        self.activations = {}
+        self.ready_latency = {}
+        self.blocked = {}
+        self.isr_duration = {}
+        self.isr_to_task = Distribution()
+        self.objects = {}
+        self.switches = 0
+        self.events = 0
+        self.dropped = 0
+        self.gaps = []
+
+        self.first = None
+        self.last = 0
+        self.previous = 0
+        self.context = None         # (is ISR, name)
+        self.context_start = 0
+        self.task = None
+        self.isr_stack = []         # (name, start time)
+        self.ready_since = {}       # task -> (time, readied by ISR)
+        self.blocked_since = {}     # task -> (time, object)
+
+    def account(self, t):
+        if self.context is not None:
+            is_isr, name = self.context
+            times = self.isr_time if is_isr else self.task_time
+            times[name] = times.get(name, 0) + t - self.context_start
+        self.context_start = t
+
+    def object_stats(self, obj):
+        stats = self.objects.get(obj)
+        if stats is None:
+            stats = self.objects[obj] = {
+                "operations": 0, RESULT_FAIL: 0, RESULT_BLOCK: 0,
+                "from_isr": 0, "blocked_time": Distribution(), "waiters": set(),
+            }
+        return stats
+
+    def end_isrs(self, t):
+        while self.isr_stack:
+            name, start = self.isr_stack.pop()
+            self.isr_duration.setdefault(name, Distribution()).add(t - start)
+
+    def feed(self, t, kind, arg):
+        self.events += 1
+        if self.first is None:
+            self.first = t
+            self.context_start = t
+        self.last = t
+
+        if kind == EV_SWITCH:
+            self.account(t)
+            self.end_isrs(t)
+            if arg != self.task:
+                self.switches += 1
+                self.activations[arg] = self.activations.get(arg, 0) + 1
+                ready = self.ready_since.pop(arg, None)
+                if ready is not None:
+                    self.ready_latency.setdefault(arg, Distribution()).add(t - ready[0])
+                    if ready[1]:
+                        self.isr_to_task.add(t - ready[0])
+            self.task = arg
+            self.context = (False, arg)
+
+        elif kind == EV_ISR_BEGIN:
+            self.account(t)
+            self.isr_stack.append((arg, t))
+            self.context = (True, arg)
+
+        elif kind == EV_ISR_RESUME:
+            self.account(t)
+            if self.isr_stack:
+                name, start = self.isr_stack.pop()
+                self.isr_duration.setdefault(name, Distribution()).add(t - start)
+            self.context = (True, arg)
+
+        elif kind == EV_READY:
+            blocked = self.blocked_since.pop(arg, None)
+            if blocked is not None:
+                since, obj = blocked
+                self.blocked.setdefault(arg, Distribution()).add(t - since)
+                if obj[0] != CLASS_DELAY:
+                    self.object_stats(obj)["blocked_time"].add(t - since)
+            if arg not in self.ready_since and arg != self.task:
+                self.ready_since[arg] = (t, bool(self.isr_stack))
+
+        elif kind == EV_BLOCK:
+            if self.task is not None and not self.isr_stack:
+                self.blocked_since[self.task] = (t, arg)
+                if arg[0] != CLASS_DELAY:
+                    self.object_stats(arg)["waiters"].add(self.task)
+
+        elif kind == EV_OP:
+            obj, result, isr = arg
+            stats = self.object_stats(obj)
+            stats["operations"] += 1
+            if result != RESULT_OK:
+                stats[result] += 1
+            if isr:
+                stats["from_isr"] += 1
+
+        elif kind == EV_GAP:
+            self.dropped += arg
+            self.gaps.append((self.previous, t, arg))
+            # The state may be stale after lost events
+            self.ready_since.clear()
+            self.blocked_since.clear()
+
+        self.previous = t
+
+    def finish(self):
+        if self.first is not None:
+            self.account(self.last)
+
+    def report(self, reader):
+        frequency = reader.frequency
+        if frequency:
+            scale = 1e6 / frequency
+            unit = "us"
+        else:
+            scale = 1.0
+            unit = "ticks"
+
+        duration = (self.last - self.first) if self.first is not None else 0
+        busy = float(max(duration, 1))
+
+        def share(value):
+            return round(100.0 * value / busy, 3)
+
+        tasks = {}
+        for name in sorted(set(self.task_time) | set(self.activations)):
+            cpu = self.task_time.get(name, 0)
+            tasks[name] = {
+                "cpu_time": round(cpu * scale, 3),
+                "cpu_share_pct": share(cpu),
+                "activations": self.activations.get(name, 0),
+                "ready_latency": self.ready_latency.get(name, Distribution()).summary(scale),
+                "blocked_time": self.blocked.get(name, Distribution()).summary(scale),
+            }
+
+        isrs = {}
+        for name in sorted(set(self.isr_time) | set(self.isr_duration)):
+            cpu = self.isr_time.get(name, 0)
+            isrs[name] = {
+                "cpu_time": round(cpu * scale, 3),
+                "cpu_share_pct": share(cpu),
+                "duration": self.isr_duration.get(name, Distribution()).summary(scale),
+            }
+
+        objects = {}
+        for (cls, name) in sorted(self.objects):
+            stats = self.objects[(cls, name)]
+            objects["%s:%s" % (cls, name)] = {
+                "class": cls,
+                "operations": stats["operations"],
+                "failed": stats[RESULT_FAIL],
+                "blocked": stats[RESULT_BLOCK],
+                "from_isr": stats["from_isr"],
+                "waiting_tasks": len(stats["waiters"]),
+                "blocked_time": stats["blocked_time"].summary(scale),
+            }
+
+        dropped = {
+            "events": self.dropped,
+            "windows": [{"start": round((start - self.first) * scale, 3),
+                         "end": round((end - self.first) * scale, 3),
+                         "events": count} for start, end, count in self.gaps],
+        }
+        if reader.kind == "snapshot":
+            dropped["overwritten_before_start"] = reader.overwritten
+
+        seconds = duration / float(frequency) if frequency else 0
+        result = {
+            "format": reader.kind,
+            "time_unit": unit,
+            "frequency_hz": frequency,
+            "duration": round(duration * scale, 3),
+            "events": self.events,
+            "context_switches": self.switches,
+            "context_switch_rate_hz": round(self.switches / seconds, 3) if seconds else None,
+            "tasks": tasks,
+            "isrs": isrs,
+            "isr_to_task_latency": self.isr_to_task.summary(scale),
+            "objects": objects,
+            "dropped": dropped,
+        }
+        if reader.error:
+            result["recorder_error"] = reader.error
+        if reader.sessions > 1:
+            result["ignored_sessions"] = reader.sessions - 1
+        return result
+
+
+def analyze(data):
+    reader = open_trace(data)
+    analyzer = Analyzer()
+    for t, kind, arg in reader.events():
+        analyzer.feed(t, kind, arg)
+    analyzer.finish()
+    return analyzer.report(reader)
+
+
+###############################################################################
+# Output
+###############################################################################
+
+def flatten(prefix, value, rows):
+    if isinstance(value, dict):
+        for key, item in value.items():
+            flatten("%s.%s" % (prefix, key) if prefix else str(key), item, rows)
+    elif isinstance(value, list):
+        for i, item in enumerate(value):
+            flatten("%s.%d" % (prefix, i), item, rows)
+    else:
+        rows.append((prefix, "" if value is None else value))
+
+
+def write_csv(result, out):
+    """ One "section,name,metric,value" row per number, stable for diffing """
+    out.write("section,name,metric,value\n")
+    for section in ("tasks", "isrs", "objects"):
+        for name, stats in result[section].items():
+            rows = []
+            flatten("", stats, rows)
+            for metric, value in rows:
+                out.write("%s,%s,%s,%s\n" % (section, csv_field(name), metric, value))
+    rows = []
+    flatten("", dict((k, v) for k, v in result.items()
+                     if k not in ("tasks", "isrs", "objects")), rows)
+    for metric, value in rows:
+        out.write("trace,,%s,%s\n" % (metric, csv_field(str(value))))
+
+
+def csv_field(text):
+    if any(c in text for c in ",\"\n"):
+        return '"%s"' % text.replace('"', '""')
+    return text
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("input", help="streaming (.psf) or snapshot (.dump) trace")
+    parser.add_argument("--format", choices=("json", "csv"), default="json")
+    parser.add_argument("-o", "--output", help="output file (default: stdout)")
+    args = parser.parse_args()
+
+    with open(args.input, "rb") as f:
+        data = f.read()
+
+    try:
+        result = analyze(data)
+    except (TraceError, psf.FormatError, psf_compact_decode.DecodeError) as e:
+        print("%s: %s" % (args.input, e), file=sys.stderr)
+        return 1
+
+    out = open(args.output, "w") if args.output else sys.stdout
+    if args.format == "json":
+        json.dump(result, out, indent=2, sort_keys=False)
+        out.write("\n")
+    else:
+        write_csv(result, out)
+    if args.output:
+        out.close()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())